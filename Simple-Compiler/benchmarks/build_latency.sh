@@ -0,0 +1,64 @@
+#!/bin/bash
+# Measures end-to-end build latency, source to runnable executable, three
+# ways: NASM text through nasm and ld, an in-process object through ld, and
+# an in-process executable with no external tool at all. Then, for -m64,
+# source to results: building the executable and running it, against
+# --jit, which does both in the compiler's process. Prints the best of ten
+# of each. Skips the nasm row if nasm is not installed. Run from
+# Simple-Compiler after `make`.
+set -e
+PROGRAM=${1:-benchmarks/regalloc_pressure.c}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+best_of_ten() {
+    local best=""
+    for run in 1 2 3 4 5 6 7 8 9 10; do
+        start=$(date +%s%N)
+        "$@" > /dev/null
+        elapsed=$(( ($(date +%s%N) - start) / 1000 ))
+        if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then best=$elapsed; fi
+    done
+    echo "$best"
+}
+
+build_with_nasm() {
+    echo 0 | ./bin/compiler -O2 $1 -o "$OUT/prog.asm" "$PROGRAM"
+    nasm -f $2 "$OUT/prog.asm" -o "$OUT/prog.o"
+    ld $3 "$OUT/prog.o" -o "$OUT/prog"
+}
+
+build_object() {
+    echo 0 | ./bin/compiler -O2 $1 --emit=obj -o "$OUT/prog.o" "$PROGRAM"
+    ld $3 "$OUT/prog.o" -o "$OUT/prog"
+}
+
+build_executable() {
+    echo 0 | ./bin/compiler -O2 $1 --emit=exe -o "$OUT/prog" "$PROGRAM"
+}
+
+build_and_run() {
+    build_executable -m64
+    "$OUT/prog"
+}
+
+run_jit() {
+    echo 0 | ./bin/compiler -O2 --jit "$PROGRAM"
+}
+
+for target in "-m32 elf32 -m elf_i386" "-m64 elf64"; do
+    set -- $target
+    flag=$1 format=$2
+    shift 2
+    echo "$flag:"
+    if command -v nasm > /dev/null; then
+        echo "  nasm + ld:           $(best_of_ten build_with_nasm "$flag" "$format" "$*") us"
+    else
+        echo "  nasm + ld:           skipped, nasm not found"
+    fi
+    echo "  --emit=obj + ld:     $(best_of_ten build_object "$flag" "$format" "$*") us"
+    echo "  --emit=exe:          $(best_of_ten build_executable "$flag" "$format" "$*") us"
+done
+echo "-m64, build and run:"
+echo "  --emit=exe, then run: $(best_of_ten build_and_run) us"
+echo "  --jit:                $(best_of_ten run_jit) us"
@@ -0,0 +1,43 @@
+#!/bin/bash
+# Compares the ways the compiler can run a program itself: the AST
+# tree-walker, the bytecode VM on unoptimized (-O0) and optimized (-O2) TAC,
+# tiered execution, and, on x86-64 hosts, the JIT. Prints each engine's run
+# time as reported by --pass-stats, best of five, and checks that all of
+# them print the same variables. Tiered execution pays for compiling only
+# the loops that get hot; on a short program it stays in the VM. Run from
+# Simple-Compiler after `make`.
+set -e
+PROGRAM=${1:-benchmarks/interpreter_loop.c}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+# best_of_five NAME STATS_PREFIX FLAGS...
+best_of_five() {
+    local name=$1 prefix=$2 best=""
+    shift 2
+    for run in 1 2 3 4 5; do
+        echo 0 | ./bin/compiler --pass-stats "$@" "$PROGRAM" > "$OUT/$name.txt"
+        elapsed=$(grep "^$prefix:" "$OUT/$name.txt" | sed 's/.*ran in \([0-9]*\) us/\1/')
+        if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then best=$elapsed; fi
+    done
+    # The variables, after the engine's banner
+    sed -n '/^INTERPRETER\|^JIT EXECUTION/,$p' "$OUT/$name.txt" | grep " = " > "$OUT/$name.values"
+    printf "  %-22s %10s us\n" "$name:" "$best"
+}
+
+best_of_five "AST tree-walk" "AST interpreter" -O0 --interpret=ast
+best_of_five "bytecode VM, -O0" "Bytecode VM" -O0 --interpret
+best_of_five "bytecode VM, -O2" "Bytecode VM" -O2 --interpret
+best_of_five "tiered, -O2" "Tiered" -O2 --interpret=tiered
+engines=("AST tree-walk" "bytecode VM, -O0" "bytecode VM, -O2" "tiered, -O2")
+if [ "$(uname -m)" = x86_64 ]; then
+    best_of_five "JIT, -O2" "JIT" -O2 --jit
+    engines+=("JIT, -O2")
+fi
+for engine in "${engines[@]}"; do
+    if ! cmp -s "$OUT/AST tree-walk.values" "$OUT/$engine.values"; then
+        echo "  $engine disagrees with the AST tree-walk"
+        exit 1
+    fi
+done
+echo "  all engines agree: $(tr '\n' ' ' < "$OUT/AST tree-walk.values")"
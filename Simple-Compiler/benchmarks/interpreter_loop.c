@@ -0,0 +1,11 @@
+// Interpreter kernel: a nested loop of small arithmetic and branches, the
+// kind of code where dispatch and variable lookup dominate. The branches
+// on s keep scalar evolution from closing the loops.
+int s = 1; int hits = 0; int i; int j;
+for (i = 0; i < 1000; i++) {
+  for (j = 0; j < 1000; j++) {
+    s = s * 3 + j - i;
+    if (s > 100000) { s = s % 1000; hits++; }
+    if (s < 0) { s = 0 - s; }
+  }
+}
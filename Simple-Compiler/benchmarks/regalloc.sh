@@ -0,0 +1,23 @@
+#!/bin/bash
+# Compares the linear-scan and graph-coloring register allocators on a
+# kernel: spill statistics from the compiler, then the best of five runs.
+# Needs nasm and a 32-bit capable ld. Run from Simple-Compiler after `make`.
+set -e
+KERNEL=${1:-benchmarks/regalloc_pressure.c}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+for allocator in linear graph; do
+    echo 5 | ./bin/compiler -O2 --pass-stats --regalloc=$allocator -o "$OUT/$allocator.asm" "$KERNEL" \
+        | grep "Register allocation"
+    nasm -f elf32 "$OUT/$allocator.asm" -o "$OUT/$allocator.o"
+    ld -m elf_i386 "$OUT/$allocator.o" -o "$OUT/$allocator"
+    best=""
+    for run in 1 2 3 4 5; do
+        start=$(date +%s%N)
+        "$OUT/$allocator" > /dev/null || true
+        elapsed=$(( ($(date +%s%N) - start) / 1000 ))
+        if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then best=$elapsed; fi
+    done
+    echo "  best of 5 runs: ${best} us"
+done
@@ -0,0 +1,9 @@
+// Register-pressure kernel: a wide expression tree inside a hot loop.
+// The branch on y keeps scalar evolution from closing the loop.
+int a = 3; int b = 5; int c = 7; int d = 11; int e = 13; int f = 17; int g = 19; int h = 23;
+int i; int y = 1; int limit = 1000000;
+for (i = 0; i < 1000000; i++) {
+  y = y + ((((((((f + g) * (a + i)) + ((f * a) * (d + b))) - (((g + d) + (i - a)) * ((b + y) + (y * g)))) + ((((d + i) + (e - c)) * ((b * e) * (c + y))) * (((d - b) * (b * a)) * ((d - i) - (f - y))))) - (((((f - d) + (d + y)) - ((i - f) * (h - y))) + (((b * g) + (f + h)) - ((a * b) * (y - f)))) * ((((f * h) * (h + b)) - ((h * b) + (e * y))) * (((h - g) * (f + h)) - ((c * b) - (a + e)))))) + ((((((d - g) - (b + h)) - ((i - c) - (i - g))) - (((g + c) + (c + d)) * ((d + h) * (c - e)))) + ((((c - i) - (y * f)) + ((i * a) - (i - g))) - (((g + h) * (g + d)) + ((d - c) + (f * a))))) + (((((a * c) * (b - y)) + ((b + y) - (c * e))) - (((y - h) + (b - h)) - ((h - b) + (b * f)))) * ((((e - c) * (a + i)) - ((c * i) + (i - b))) * (((e * f) + (f + i)) * ((i - d) * (d + g))))))) * (((((((d + i) - (f * a)) + ((e - e) + (y - h))) * (((f - b) + (b + h)) + ((f + h) * (y + h)))) * ((((f * b) * (b - d)) - ((c - f) + (g - g))) * (((b * c) + (c + c)) * ((h * c) * (y - f))))) + (((((i * c) + (a * b)) * ((c - d) + (a - d))) - (((i + y) - (e * g)) + ((a * f) - (y * g)))) * ((((c * c) * (i + h)) + ((y + c) + (c - y))) * (((b * a) - (i * i)) - ((b * a) + (d - a)))))) + ((((((i - i) + (b - f)) * ((i * i) + (e - i))) * (((h * d) * (i - i)) + ((h + g) + (g - f)))) + ((((d - b) + (e + c)) * ((f + e) + (h + b))) - (((h + d) + (g * g)) - ((g + f) - (b * f))))) + (((((f * h) - (a - f)) * ((y - i) + (b + b))) + (((e - a) + (e + g)) * ((e - c) * (i * h)))) * ((((f + e) + (c - b)) - ((a * b) - (b * d))) + (((e + h) + (f * g)) - ((y + a) * (d + c))))))));
+  if (y > limit) { y = y - limit; }
+  if (y < 0) { y = 0 - y; }
+}
@@ -0,0 +1,40 @@
+#!/bin/bash
+# Compares the vectorizer's instruction sets on an array kernel: the JIT
+# runs the -O2 code scalar (--vectorize=none), with SSE2 and, when the
+# host has it, with AVX2. Prints each run time as reported by --pass-stats,
+# best of five, and checks that all of them print the same variables, and
+# the same as the bytecode VM on unvectorized -O0 TAC. Run from
+# Simple-Compiler after `make` on an x86-64 host.
+set -e
+PROGRAM=${1:-benchmarks/vectorize_kernel.c}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+# best_of_five NAME FLAGS...
+best_of_five() {
+    local name=$1 best=""
+    shift
+    for run in 1 2 3 4 5; do
+        echo 0 | ./bin/compiler --pass-stats "$@" "$PROGRAM" > "$OUT/$name.txt"
+        elapsed=$(grep "^JIT:" "$OUT/$name.txt" | sed 's/.*ran in \([0-9]*\) us/\1/')
+        if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then best=$elapsed; fi
+    done
+    sed -n '/^JIT EXECUTION/,$p' "$OUT/$name.txt" | grep " = " > "$OUT/$name.values"
+    printf "  %-8s %10s us\n" "$name:" "$best"
+}
+
+echo 0 | ./bin/compiler -O0 --interpret "$PROGRAM" | sed -n '/^INTERPRETER/,$p' | grep " = " > "$OUT/vm.values"
+best_of_five none -O2 --jit --vectorize=none
+best_of_five sse2 -O2 --jit --vectorize=sse2
+widths=(none sse2)
+if grep -qw avx2 /proc/cpuinfo; then
+    best_of_five avx2 -O2 --jit --vectorize=avx2
+    widths+=(avx2)
+fi
+for width in "${widths[@]}"; do
+    if ! cmp -s "$OUT/vm.values" "$OUT/$width.values"; then
+        echo "  $width disagrees with the bytecode VM"
+        exit 1
+    fi
+done
+echo "  all agree: $(tr '\n' ' ' < "$OUT/vm.values")"
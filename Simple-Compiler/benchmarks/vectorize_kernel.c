@@ -0,0 +1,12 @@
+// Vectorizer kernel: element-wise multiply-add over arrays, repeated. The
+// inner loop has no dependence between iterations, so -O2 runs it 4 (SSE2)
+// or 8 (AVX2) elements at a time; the outer loop only repeats it.
+int a[4096]; int b[4096]; int c[4096];
+int i; int r; int s = 0;
+for (i = 0; i < 4096; i++) { a[i] = i % 17; b[i] = 3 - i; }
+for (r = 0; r < 2000; r++) {
+  for (i = 0; i < 4096; i++) {
+    c[i] = a[i] * b[i] + c[i] - r;
+  }
+}
+for (i = 0; i < 4096; i++) { s = s * 31 + c[i]; }
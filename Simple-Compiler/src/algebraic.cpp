@@ -0,0 +1,255 @@
+#include "algebraic.h"
+#include <cstdint>
+#include <map>
+#include <utility>
+
+AlgebraicSimplifier::AlgebraicSimplifier()
+    : simplified(0), reassociated(0), canonicalized(0), numbered(0), propagated(0), code(nullptr) {}
+
+static int32_t constant_value(const std::string& operand) {
+    return static_cast<int32_t>(static_cast<uint32_t>(std::stoll(operand)));
+}
+
+// + and * with the target's 32-bit wrap-around
+static std::string fold_constants(const std::string& op, int32_t a, int32_t b) {
+    uint32_t ua = static_cast<uint32_t>(a), ub = static_cast<uint32_t>(b);
+    uint32_t result = op == "*" ? ua * ub : ua + ub;
+    return std::to_string(static_cast<int32_t>(result));
+}
+
+static void make_copy(TacInstr& instr, const std::string& value) {
+    instr.arg1 = value;
+    instr.op.clear();
+    instr.arg2.clear();
+}
+
+static void make_negation(TacInstr& instr, const std::string& value) {
+    instr.arg1 = value;
+    instr.op = "-";
+    instr.arg2.clear();
+}
+
+void AlgebraicSimplifier::analyze() {
+    def_count.clear();
+    def_position.clear();
+    block_of.assign(code->size(), 0);
+    int block = 0;
+    for (size_t i = 0; i < code->size(); ++i) {
+        const TacInstr& instr = (*code)[i];
+        if (instr.kind == TacOp::Label) ++block;
+        block_of[i] = block;
+        if (instr.is_jump()) ++block;
+        if (!instr.dest.empty()) {
+            def_count[instr.dest]++;
+            def_position[instr.dest] = static_cast<int>(i);
+        }
+    }
+}
+
+bool AlgebraicSimplifier::single_def_temp(const std::string& name) const {
+    if (!is_temporary_name(name)) return false;
+    auto found = def_count.find(name);
+    return found != def_count.end() && found->second == 1;
+}
+
+// Whether `operand` holds at `to` the value it had at `from`. Temps written
+// once hold one value everywhere they are read; anything else must not be
+// written in between, inside one straight-line run.
+bool AlgebraicSimplifier::unchanged_between(const std::string& operand, int from, int to) const {
+    if (is_constant(operand) || single_def_temp(operand)) return true;
+    if (block_of[from] != block_of[to]) return false;
+    for (int i = from + 1; i < to; ++i) {
+        if ((*code)[i].dest == operand) return false;
+    }
+    return true;
+}
+
+// The Assign that computes a single-definition temp, if any
+const TacInstr* AlgebraicSimplifier::defining(const std::string& temp, int& position) const {
+    if (!single_def_temp(temp)) return nullptr;
+    position = def_position.at(temp);
+    const TacInstr& instr = (*code)[position];
+    return instr.kind == TacOp::Assign ? &instr : nullptr;
+}
+
+// Constants go right and `x - c` becomes `x + -c`, so constant chains and
+// repeated expressions look alike; an operand that is also the destination
+// goes left, which keeps the in-place form the backend emits best
+bool AlgebraicSimplifier::canonicalize(TacInstr& instr) {
+    if (instr.op == "-" && !instr.arg2.empty() && is_constant(instr.arg2) && !is_constant(instr.arg1)) {
+        instr.op = "+";
+        instr.arg2 = std::to_string(static_cast<int32_t>(0u - static_cast<uint32_t>(constant_value(instr.arg2))));
+        canonicalized++;
+        return true;
+    }
+    if (instr.op != "+" && instr.op != "*") return false;
+    if (instr.arg1 == instr.dest) return false;
+    bool swap = instr.arg2 == instr.dest;
+    if (!swap && is_constant(instr.arg1) != is_constant(instr.arg2)) swap = is_constant(instr.arg1);
+    else if (!swap && !is_constant(instr.arg1)) swap = instr.arg2 < instr.arg1;
+    if (!swap) return false;
+    std::swap(instr.arg1, instr.arg2);
+    canonicalized++;
+    return true;
+}
+
+bool AlgebraicSimplifier::apply_identities(TacInstr& instr, int position) {
+    const std::string& a = instr.arg1;
+    const std::string& b = instr.arg2;
+    int def = 0;
+
+    if (instr.is_unary()) {
+        // - - x
+        const TacInstr* inner = defining(a, def);
+        if (instr.op == "-" && inner && inner->is_unary() && inner->op == "-" &&
+            unchanged_between(inner->arg1, def, position)) {
+            make_copy(instr, inner->arg1);
+            simplified++;
+            return true;
+        }
+        return false;
+    }
+
+    if (is_constant(b)) {
+        int32_t c = constant_value(b);
+        std::string result;
+        bool negate = false;
+        if ((instr.op == "+" || instr.op == "-" || instr.op == ">>>") && c == 0) result = a;
+        else if ((instr.op == "*" || instr.op == "/") && c == 1) result = a;
+        else if (instr.op == "*" && c == 0) result = "0";
+        else if (instr.op == "%" && (c == 1 || c == -1)) result = "0";
+        else if ((instr.op == "*" || instr.op == "/") && c == -1) negate = true;
+        if (negate) {
+            make_negation(instr, a);
+            simplified++;
+            return true;
+        }
+        if (!result.empty()) {
+            make_copy(instr, result);
+            simplified++;
+            return true;
+        }
+    }
+    if (instr.op == "-" && a == "0") {
+        make_negation(instr, b);
+        simplified++;
+        return true;
+    }
+    if (instr.op == "-" && a == b && !is_constant(a)) {
+        make_copy(instr, "0");
+        simplified++;
+        return true;
+    }
+
+    // x + - y  ->  x - y,  x - - y  ->  x + y
+    const TacInstr* inner = defining(b, def);
+    if ((instr.op == "+" || instr.op == "-") && inner && inner->is_unary() && inner->op == "-" &&
+        unchanged_between(inner->arg1, def, position)) {
+        instr.op = instr.op == "+" ? "-" : "+";
+        instr.arg2 = inner->arg1;
+        simplified++;
+        return true;
+    }
+    return false;
+}
+
+// (x + c1) + c2  ->  x + (c1 + c2), and the same for *
+bool AlgebraicSimplifier::reassociate(TacInstr& instr, int position) {
+    if ((instr.op != "+" && instr.op != "*") || !is_constant(instr.arg2)) return false;
+    int def = 0;
+    const TacInstr* inner = defining(instr.arg1, def);
+    if (!inner || inner->op != instr.op || !is_constant(inner->arg2) || is_constant(inner->arg1)) return false;
+    if (!unchanged_between(inner->arg1, def, position)) return false;
+    instr.arg2 = fold_constants(instr.op, constant_value(inner->arg2), constant_value(instr.arg2));
+    instr.arg1 = inner->arg1;
+    reassociated++;
+    return true;
+}
+
+// Block-local value numbering: an expression computed again while its
+// operands and the temp holding it are unchanged becomes a copy
+bool AlgebraicSimplifier::number_values() {
+    bool changed = false;
+    struct Value {
+        std::string holder;
+        std::string arg1, arg2;
+    };
+    std::map<std::string, Value> available;
+    for (TacInstr& instr : *code) {
+        if (instr.kind == TacOp::Label) available.clear();
+        if (instr.kind == TacOp::Assign && !instr.op.empty() && is_temporary_name(instr.dest)) {
+            std::string key = instr.op + " " + instr.arg1 + " " + instr.arg2;
+            auto found = available.find(key);
+            if (found != available.end() && found->second.holder != instr.dest) {
+                make_copy(instr, found->second.holder);
+                numbered++;
+                changed = true;
+            }
+        }
+        if (!instr.dest.empty()) {
+            for (auto it = available.begin(); it != available.end();) {
+                const Value& value = it->second;
+                bool stale = value.holder == instr.dest || value.arg1 == instr.dest || value.arg2 == instr.dest;
+                it = stale ? available.erase(it) : std::next(it);
+            }
+        }
+        if (instr.kind == TacOp::Assign && !instr.op.empty() && is_temporary_name(instr.dest) &&
+            instr.arg1 != instr.dest && instr.arg2 != instr.dest) {
+            available[instr.op + " " + instr.arg1 + " " + instr.arg2] = {instr.dest, instr.arg1, instr.arg2};
+        }
+        if (instr.is_jump()) available.clear();
+    }
+    return changed;
+}
+
+// t = x or t = c with t written once: a read of t can read x instead while
+// x still holds the value it had at the copy
+bool AlgebraicSimplifier::propagate_copies() {
+    std::unordered_map<std::string, int> copy_at;
+    for (size_t i = 0; i < code->size(); ++i) {
+        const TacInstr& instr = (*code)[i];
+        if (instr.kind == TacOp::Assign && instr.op.empty() && single_def_temp(instr.dest) &&
+            instr.arg1 != instr.dest && (is_constant(instr.arg1) || is_temporary_name(instr.arg1))) {
+            copy_at[instr.dest] = static_cast<int>(i);
+        }
+    }
+    bool changed = false;
+    for (size_t i = 0; i < code->size(); ++i) {
+        TacInstr& instr = (*code)[i];
+        if (instr.kind == TacOp::Label || instr.kind == TacOp::Goto) continue;
+        for (std::string* operand : {&instr.arg1, &instr.arg2}) {
+            auto found = copy_at.find(*operand);
+            if (found == copy_at.end()) continue;
+            const std::string& value = (*code)[found->second].arg1;
+            // ADD/SUB read their destination through arg1 and keep it there
+            if (operand == &instr.arg1 && (instr.kind == TacOp::Add || instr.kind == TacOp::Sub)) continue;
+            if (!unchanged_between(value, found->second, static_cast<int>(i))) continue;
+            *operand = value;
+            propagated++;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void AlgebraicSimplifier::run(std::vector<TacInstr>& listing) {
+    code = &listing;
+    simplified = reassociated = canonicalized = numbered = propagated = 0;
+    bool changed = true;
+    for (int round = 0; changed && round < 8; ++round) {
+        changed = false;
+        analyze();
+        for (size_t i = 0; i < listing.size(); ++i) {
+            TacInstr& instr = listing[i];
+            if (instr.kind != TacOp::Assign || instr.op.empty()) continue;
+            int position = static_cast<int>(i);
+            changed |= canonicalize(instr);
+            changed |= apply_identities(instr, position);
+            if (!instr.op.empty()) changed |= reassociate(instr, position);
+            if (!instr.op.empty()) changed |= apply_identities(instr, position);
+        }
+        changed |= number_values();
+        analyze();
+        changed |= propagate_copies();
+    }
+}
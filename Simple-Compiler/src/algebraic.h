@@ -0,0 +1,50 @@
+#ifndef ALGEBRAIC_H
+#define ALGEBRAIC_H
+
+#include "ir.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Algebraic simplification of TAC assignments. Applies identities (x + 0,
+// x * 1, x * 0, x - x, x % 1, 0 - x, - - x, x + - y), merges chains of
+// constant adds and multiplies into one instruction, and puts the operands
+// of + and * in a canonical order: a destination that is also an operand
+// first, constants last, otherwise by name. With the canonical order,
+// block-local value numbering finds `b + a` to repeat `a + b` and turns the
+// repeat into a copy; copies between single-definition temps are then
+// propagated to their uses. Repeats until nothing changes, and leaves the
+// instructions it made dead to DCE.
+//
+// Multiplying by powers of two and by 3, 5 or 9 is left as it is; the
+// instruction selector turns those into shl and lea.
+class AlgebraicSimplifier {
+public:
+    AlgebraicSimplifier();
+    void run(std::vector<TacInstr>& code);
+
+    int simplified;     // Identities applied
+    int reassociated;   // Constant chains merged
+    int canonicalized;  // Operand pairs swapped and constant subtractions made adds
+    int numbered;       // Repeated expressions replaced by copies
+    int propagated;     // Operands replaced by the temp they were copied from
+
+private:
+    std::vector<TacInstr>* code;
+    std::unordered_map<std::string, int> def_count;    // Writes of each operand
+    std::unordered_map<std::string, int> def_position; // Position of each operand's last write
+    std::vector<int> block_of;                         // Straight-line run of each position
+
+    void analyze();
+    bool single_def_temp(const std::string& name) const;
+    bool unchanged_between(const std::string& operand, int from, int to) const;
+    const TacInstr* defining(const std::string& temp, int& position) const;
+
+    bool canonicalize(TacInstr& instr);
+    bool apply_identities(TacInstr& instr, int position);
+    bool reassociate(TacInstr& instr, int position);
+    bool number_values();
+    bool propagate_copies();
+};
+
+#endif // ALGEBRAIC_H
@@ -1,7 +1,11 @@
 #include "assembly_gen.h"
+#include "ir.h"
+#include "liveness.h"
+#include "graph_coloring.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <stdexcept>
 
 // Helper to trim strings
 std::string trim(const std::string& str) {
@@ -11,63 +15,180 @@ std::string trim(const std::string& str) {
     return str.substr(first, (last - first + 1));
 }
 
-AssemblyGenerator::AssemblyGenerator() {
-    available_registers = {"eax", "ebx", "ecx", "edx", "esi", "edi"};
-    register_pool = available_registers;
-    spill_index = 0;
+// x86 condition-code suffix of a TAC comparison, as in jl, setl and cmovl
+static std::string condition_code(const std::string& relation) {
+    static const std::map<std::string, std::string> codes = {
+        {"<", "l"}, {">", "g"}, {"<=", "le"}, {">=", "ge"}, {"==", "e"}, {"!=", "ne"}
+    };
+    return codes.at(relation);
 }
 
-bool AssemblyGenerator::is_temporary(const std::string& name) {
-    return name.rfind('t', 0) == 0 && isdigit(name[1]);
+// eax is reserved as the scratch register for loads in handle_if,
+// handle_mov and handle_add_sub, so it is never handed out to a temp
+AssemblyGenerator::AssemblyGenerator()
+    : optimize_assembly(false), bounds_checked(false), divide_checked(false), wide_vectors(false), target(TargetArch::X86), position(0) {
+    set_allocator(AllocatorKind::LinearScan);
+}
+
+bool parse_target(const std::string& flag, TargetArch& target) {
+    if (flag == "-m32") target = TargetArch::X86;
+    else if (flag == "-m64") target = TargetArch::X86_64;
+    else return false;
+    return true;
+}
+
+std::string data_symbol(const std::string& name) {
+    return "g_" + name;
+}
+
+void AssemblyGenerator::set_target(TargetArch arch) {
+    target = arch;
 }
 
-std::string AssemblyGenerator::get_register(const std::string& temp) {
-    if (register_map.count(temp)) {
-        return register_map[temp];
+void AssemblyGenerator::set_allocator(AllocatorKind kind) {
+    allocator_kind = kind;
+    build_allocator(false);
+}
+
+// A program with arrays on x86-64 keeps r11 for the array base
+void AssemblyGenerator::build_allocator(bool reserve_r11) {
+    std::vector<std::string> registers = {"ebx", "ecx", "edx", "esi", "edi"};
+    if (target == TargetArch::X86_64) {
+        for (int r = 8; r <= 15; ++r) {
+            if (r != 11 || !reserve_r11) registers.push_back("r" + std::to_string(r) + "d");
+        }
     }
-    if (!register_pool.empty()) {
-        std::string reg = register_pool.front();
-        register_pool.erase(register_pool.begin());
-        register_map[temp] = reg;
-       // std::cout << "Assembly: Allocating register " << reg << " for " << temp << std::endl;
-        return reg;
+    if (allocator_kind == AllocatorKind::GraphColoring) {
+        allocator.reset(new GraphColoringAllocator(registers));
+    } else {
+        allocator.reset(new LinearScanAllocator(registers));
     }
-    // Spill
-    std::string reg_to_reuse = available_registers[spill_index];
-    spill_index = (spill_index + 1) % available_registers.size();
-    for (auto const& [key, val] : register_map) {
-        if (val == reg_to_reuse) {
-            register_map.erase(key);
-            std::cout << "Assembly: Spilling " << key << " from " << val << " for " << temp << std::endl;
-            break;
+}
+
+bool AssemblyGenerator::is_temporary(const std::string& name) {
+    return name.rfind('t', 0) == 0 && isdigit(name[1]);
+}
+
+// The frame holds the allocator's spill slots, then the locals' slots
+std::string AssemblyGenerator::frame_pointer() const {
+    return target == TargetArch::X86_64 ? "rbp" : "ebp";
+}
+
+std::string AssemblyGenerator::slot_operand(int slot) {
+    return "dword [" + frame_pointer() + " - " + std::to_string(4 * (slot + 1)) + "]";
+}
+
+// Memory operand of a variable: its .data cell, or its frame slot for a
+// block local
+std::string AssemblyGenerator::memory(const std::string& var) {
+    if (is_local_name(var)) {
+        int slot = frame.slot_of(var);
+        if (slot < 0) {
+            throw std::runtime_error("Assembly Error: No stack slot for " + var + ".");
         }
+        return "[" + frame_pointer() + " - " + std::to_string(4 * (allocator->slot_count + slot + 1)) + "]";
     }
-    register_map[temp] = reg_to_reuse;
-    std::cout << "Assembly: Reusing register " << reg_to_reuse << " for " << temp << std::endl;
-    return reg_to_reuse;
+    add_variable(var);
+    // Globals are addressed relative to rip on x86-64, so no relocations
+    // against absolute addresses are needed
+    return target == TargetArch::X86_64 ? "[rel " + data_symbol(var) + "]" : "[" + data_symbol(var) + "]";
+}
+
+bool AssemblyGenerator::is_register(const std::string& operand) {
+    return operand.find('[') == std::string::npos && !is_constant(operand);
 }
 
-void AssemblyGenerator::free_register(const std::string& temp) {
-    if (register_map.count(temp)) {
-        std::string reg = register_map[temp];
-        //std::cout << "Assembly: Freeing register " << reg << " from " << temp << std::endl;
-        register_pool.push_back(reg);
-        register_map.erase(temp);
+// Where a temp is at the instruction being translated: its register, or
+// its stack slot if the allocator spilled it here
+std::string AssemblyGenerator::location(const std::string& temp) {
+    std::string reg = allocator->register_at(temp, position);
+    if (!reg.empty()) return reg;
+    int slot = allocator->slot_of(temp);
+    if (slot < 0) {
+        throw std::runtime_error("Assembly Error: No location for " + temp + ".");
     }
+    return slot_operand(slot);
+}
+
+// Any TAC operand as an x86 source operand
+std::string AssemblyGenerator::source(const std::string& operand) {
+    if (is_temporary(operand)) return location(operand);
+    if (is_constant(operand)) return operand;
+    return memory(operand);
+}
+
+// The register as an address register. On x86-64 that is the full
+// register; its upper half is zero, since every write to a 32-bit register
+// clears it.
+std::string AssemblyGenerator::wide_register(const std::string& reg) const {
+    if (target != TargetArch::X86_64) return reg;
+    if (reg[0] == 'e') return "r" + reg.substr(1);
+    return reg.substr(0, reg.size() - 1); // r8d -> r8
+}
+
+// Memory operand of a lea tile
+std::string AssemblyGenerator::address(const Tile& tile) {
+    auto address_register = [this](const std::string& temp) {
+        return wide_register(allocator->register_at(temp, position));
+    };
+    std::string text;
+    if (!tile.base.empty()) text = address_register(tile.base);
+    if (!tile.index.empty()) {
+        if (!text.empty()) text += " + ";
+        text += address_register(tile.index);
+        if (tile.scale != 1) text += "*" + std::to_string(tile.scale);
+    }
+    if (tile.displacement > 0) text += " + " + std::to_string(tile.displacement);
+    if (tile.displacement < 0) text += " - " + std::to_string(-tile.displacement);
+    return "[" + text + "]";
 }
 
 void AssemblyGenerator::emit(const std::string& instruction) {
-    assembly_code.push_back("    " + instruction);
+    assembly_code.push_back(parse_machine_instr(instruction));
+}
+
+// Whether element `index` of `array` can be addressed without eax: the
+// index is a register or a constant within the array
+bool AssemblyGenerator::direct_index(const std::string& array, const std::string& index) {
+    if (is_constant(index)) {
+        long long value = std::stoll(index);
+        return value >= 0 && value < array_size.at(array);
+    }
+    return is_temporary(index) && !allocator->register_at(index, position).empty();
+}
+
+// Memory operand of an array element, loading the index into eax unless
+// direct_index. x86 addresses the array by its absolute address, as in
+// [a + ebx*4]. x86-64 code has no absolute 32-bit addresses and rip cannot
+// be indexed, so the address goes into r11 first.
+std::string AssemblyGenerator::element(const std::string& array, const std::string& index) {
+    bool wide = target == TargetArch::X86_64;
+    std::string base = wide ? "r11" : data_symbol(array);
+    if (wide && array_base != array) {
+        emit("mov r11, " + data_symbol(array));
+        array_base = array;
+    }
+    if (is_constant(index) && direct_index(array, index)) {
+        long long offset = 4 * std::stoll(index);
+        return "dword [" + base + (offset > 0 ? " + " + std::to_string(offset) : "") + "]";
+    }
+    std::string reg = direct_index(array, index) ? allocator->register_at(index, position) : "eax";
+    if (reg == "eax") emit("mov eax, " + source(index));
+    return "dword [" + base + " + " + wide_register(reg) + "*4]";
 }
 
 void AssemblyGenerator::emit_label(const std::string& label) {
-    assembly_code.push_back(label + ":");
+    array_base.clear();
+    MachineInstr instr;
+    instr.kind = MachineInstr::Label;
+    instr.opcode = label;
+    assembly_code.push_back(instr);
 }
 
 void AssemblyGenerator::add_variable(const std::string& var) {
     if (variables.find(var) == variables.end()) {
         variables.insert(var);
-        data_section.push_back(var + " dd 0");
+        data_section.push_back(var);
     }
 }
 
@@ -79,21 +200,76 @@ std::string AssemblyGenerator::generate_from_tac(const std::string& tac_code) {
 
     std::stringstream ss(tac_code);
     std::string line;
-
+    std::vector<std::string> lines;
+    std::vector<TacInstr> code;
     while (std::getline(ss, line)) {
         line = trim(line);
         if (line.empty()) continue;
+        lines.push_back(line);
+        code.push_back(parse_tac_line(line));
+    }
+
+    arrays.clear();
+    array_size.clear();
+    array_base.clear();
+    bounds_checked = false;
+    divide_checked = false;
+    wide_vectors = false;
+    for (const auto& instr : code) {
+        if (instr.kind != TacOp::ArrayDecl) continue;
+        arrays.push_back({instr.array, std::stoll(instr.arg1)});
+        array_size[instr.array] = arrays.back().size;
+    }
+    for (const auto& instr : code) {
+        if (!instr.array.empty() && !array_size.count(instr.array)) {
+            throw std::runtime_error("Assembly Error: Undeclared array " + instr.array + ".");
+        }
+        if (instr.lanes == 8) wide_vectors = true;
+    }
+    if (!arrays.empty() && target == TargetArch::X86_64) build_allocator(true);
+
+    LivenessAnalysis liveness(code, false);
+    allocator->run(liveness);
+    selector.run(code, liveness, *allocator);
+    bool has_locals = std::any_of(code.begin(), code.end(), [](const TacInstr& instr) {
+        return is_local_name(instr.dest) || is_local_name(instr.arg1) || is_local_name(instr.arg2);
+    });
+    if (has_locals) {
+        frame.run(LivenessAnalysis(code, true));
+    } else {
+        frame = FrameLayout();
+    }
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        line = lines[i];
+        position = static_cast<int>(i);
         //std::cout << "Processing TAC: " << line << std::endl;
+        for (const auto& move : allocator->moves_before(position)) {
+            std::string slot = slot_operand(allocator->slot_of(move.temp));
+            if (move.kind == SpillMove::Store) emit("mov " + slot + ", " + move.reg);
+            else emit("mov " + move.reg + ", " + slot);
+        }
 
-        if (line.find("IF") == 0) handle_if(line);
+        // Array names could pass for the keywords tested below
+        if (code[i].kind == TacOp::ArrayDecl) continue;
+        if (code[i].kind == TacOp::Load) handle_load(code[i]);
+        else if (code[i].kind == TacOp::Store) handle_store(code[i]);
+        else if (code[i].kind == TacOp::BoundsCheck) handle_bounds_check(code[i]);
+        else if (code[i].kind == TacOp::VectorLoad) handle_vector_load(code[i]);
+        else if (code[i].kind == TacOp::VectorStore) handle_vector_store(code[i]);
+        else if (code[i].kind == TacOp::VectorSplat) handle_vector_splat(code[i]);
+        else if (code[i].kind == TacOp::VectorOp) handle_vector_op(code[i]);
+        else if (line.find("IF") == 0) handle_if(line);
         else if (line.find("GOTO") == 0) handle_goto(line);
         else if (line.find("ADD") == 0) handle_add_sub(line, "add");
         else if (line.find("SUB") == 0) handle_add_sub(line, "sub");
         else if (line.find("MOV") == 0) handle_mov(line);
+        else if (line.find("CMOV") == 0) handle_conditional_move(line);
         else if (line.find('=') != std::string::npos) handle_assignment(line);
         else if (line.back() == ':') emit_label(line.substr(0, line.length() - 1));
     }
 
+    if (optimize_assembly) peephole.run(assembly_code);
     return get_assembly_code();
 }
 
@@ -103,13 +279,15 @@ void AssemblyGenerator::handle_mov(const std::string& line) {
     std::string dest = trim(content.substr(0, comma_pos));
     std::string src = trim(content.substr(comma_pos + 1));
 
-    add_variable(dest);
-    if (is_temporary(src)) {
-        std::string src_reg = get_register(src);
-        emit("mov [" + dest + "], " + src_reg);
-        free_register(src);
-    } else { // Assuming src is a number for simplicity
-        emit("mov dword [" + dest + "], " + src);
+    std::string target = memory(dest);
+    std::string value = source(src);
+    if (is_register(value)) {
+        emit("mov " + target + ", " + value);
+    } else if (is_constant(src)) {
+        emit("mov dword " + target + ", " + src);
+    } else { // x86 has no memory-to-memory mov
+        emit("mov eax, " + value);
+        emit("mov " + target + ", eax");
     }
 }
 
@@ -124,92 +302,397 @@ void AssemblyGenerator::handle_add_sub(const std::string& line, const std::strin
     src1 = trim(src1);
     src2 = trim(src2);
 
-    add_variable(dest);
+    std::string target = memory(dest);
+    const Tile& tile = selector.tile(position);
+    if (tile.kind == Tile::Increment || tile.kind == Tile::Decrement) {
+        emit(std::string(tile.kind == Tile::Increment ? "inc" : "dec") + " dword " + target);
+        return;
+    }
     if(dest == src1){
-        if(isdigit(src2[0])){
-            emit(op + " dword [" + dest + "], " + src2);
+        std::string value = source(src2);
+        if(is_constant(src2) || is_register(value)){
+            emit(op + " dword " + target + ", " + value);
         } else {
-             add_variable(src2);
-             emit("mov eax, [" + src2 + "]");
-             emit(op + " dword [" + dest + "], eax");
+             emit("mov eax, " + value);
+             emit(op + " dword " + target + ", eax");
         }
     }
 }
 
 
 void AssemblyGenerator::handle_assignment(const std::string& line) {
+    const Tile& tile = selector.tile(position);
+    if (tile.kind == Tile::Folded) return; // Computed by the tile of its reader
+
     size_t eq_pos = line.find('=');
     std::string dest = trim(line.substr(0, eq_pos));
     std::string expr = trim(line.substr(eq_pos + 1));
 
-    // Simple case: t1 = 5 OR t1 = var
-    if (expr.find_first_of("+-*/") == std::string::npos) {
-        std::string dest_reg = get_register(dest);
-        if (is_temporary(expr)) {
-            emit("mov " + dest_reg + ", " + get_register(expr));
-            free_register(expr);
-        } else if (isdigit(expr[0]) || expr[0] == '-') {
-            emit("mov " + dest_reg + ", " + expr);
-        } else {
-            add_variable(expr);
-            emit("mov " + dest_reg + ", [" + expr + "]");
-        }
+    std::stringstream expr_ss(expr);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (expr_ss >> token) tokens.push_back(token);
+
+    // Compute into the destination's register, or into eax and then store
+    // it if the destination lives in a stack slot
+    std::string dest_loc = location(dest);
+    std::string work = is_register(dest_loc) ? dest_loc : "eax";
+
+    // Single-instruction tiles always write a register destination
+    switch (tile.kind) {
+    case Tile::Zero:
+        emit("xor " + dest_loc + ", " + dest_loc);
+        return;
+    case Tile::Increment:
+        emit("inc " + dest_loc);
+        return;
+    case Tile::Decrement:
+        emit("dec " + dest_loc);
+        return;
+    case Tile::Lea:
+        emit("lea " + dest_loc + ", " + address(tile));
+        return;
+    case Tile::MultiplyImmediate:
+        emit("imul " + dest_loc + ", " + source(tokens[0]) + ", " + tokens[2]);
+        return;
+    case Tile::Divide:
+    case Tile::DivideShift:
+    case Tile::DivideMagic:
+        handle_division(tile, dest, tokens[0], tokens[1], tokens[2]);
+        return;
+    case Tile::SetCondition:
+        emit_compare(tokens[0], tokens[2]);
+        emit("set" + condition_code(tokens[1]) + " al");
+        emit("movzx " + work + ", al");
+        if (work != dest_loc) emit("mov " + dest_loc + ", " + work);
+        return;
+    case Tile::ShiftLeft: {
+        std::string value = source(tokens[0]);
+        if (value != work) emit("mov " + work + ", " + value);
+        emit("shl " + work + ", " + std::to_string(tile.shift));
+        if (work != dest_loc) emit("mov " + dest_loc + ", " + work);
+        return;
+    }
+    default:
+        break;
+    }
+
+    if (tokens.size() == 1) { // t1 = 5 OR t1 = var OR t1 = t2
+        std::string value = source(expr);
+        if (value != work) emit("mov " + work + ", " + value);
+    } else if (tokens.size() == 2) { // t2 = - t1
+        emit("mov " + work + ", " + source(tokens[1]));
+        emit("neg " + work);
     } else { // t3 = t1 + t2
-        std::stringstream expr_ss(expr);
-        std::string left, op, right;
-        expr_ss >> left >> op >> right;
-
-        std::string dest_reg = get_register(dest);
-        if(is_temporary(left)){
-            emit("mov " + dest_reg + ", " + get_register(left));
-        } else if (isdigit(left[0])) {
-            emit("mov " + dest_reg + ", " + left);
-        } else {
-            add_variable(left);
-            emit("mov " + dest_reg + ", [" + left + "]");
-        }
+        std::string left = tokens[0], op = tokens[1], right = tokens[2];
+        std::string value = source(left);
+        if (value != work) emit("mov " + work + ", " + value);
 
         std::string op_instr = "add";
         if(op == "-") op_instr = "sub";
         if(op == "*") op_instr = "imul";
-        // Div is more complex, skipping for brevity
+        if(op == ">>>") op_instr = "shr"; // Shift counts are always immediates
+
+        emit(op_instr + " " + work + ", " + source(right));
+    }
+    if (work != dest_loc) emit("mov " + dest_loc + ", " + work);
+}
+
+// Signed division and remainder, which round toward zero. The dividend goes
+// through eax and edx is scratch; the allocators keep temps read here or
+// live across this instruction out of edx (see clobbered_registers).
+void AssemblyGenerator::handle_division(const Tile& tile, const std::string& dest, const std::string& left,
+                                        const std::string& op, const std::string& right) {
+    std::string dest_loc = location(dest);
+    bool remainder = op == "%";
+    auto sized = [](const std::string& operand) {
+        return operand.find('[') != std::string::npos && operand.rfind("dword", 0) != 0 ? "dword " + operand : operand;
+    };
+    std::string dividend = sized(source(left));
+    std::string result = remainder ? "edx" : "eax";
+
+    if (tile.kind == Tile::DivideShift) {
+        long long divisor = std::stoll(right);
+        int mask = (1 << tile.shift) - 1;
+        emit("mov eax, " + dividend);
+        if (tile.shift == 0) { // x / 1, x / -1 and x % +-1
+            if (remainder) emit("xor eax, eax");
+            else if (divisor < 0) emit("neg eax");
+        } else {
+            // Negative dividends are biased by divisor - 1 so the shift
+            // rounds toward zero; the remainder is the low bits of the
+            // biased value less the bias
+            emit("cdq");
+            emit("and edx, " + std::to_string(mask));
+            emit("add eax, edx");
+            if (remainder) {
+                emit("and eax, " + std::to_string(mask));
+                emit("sub eax, edx");
+            } else {
+                emit("sar eax, " + std::to_string(tile.shift));
+                if (divisor < 0) emit("neg eax");
+            }
+        }
+        result = "eax";
+    } else if (tile.kind == Tile::DivideMagic) {
+        long long divisor = std::stoll(right);
+        if (is_constant(dividend)) { // Unfolded at -O0; the divisor is not 0 or -1 here
+            long long n = std::stoll(dividend);
+            long long value = remainder ? n % divisor : n / divisor;
+            emit("mov " + std::string(is_register(dest_loc) ? "" : "dword ") + dest_loc + ", " + std::to_string(value));
+            return;
+        }
+        emit("mov eax, " + std::to_string(tile.magic));
+        emit("imul " + dividend);
+        if (divisor > 0 && tile.magic < 0) emit("add edx, " + dividend);
+        if (divisor < 0 && tile.magic > 0) emit("sub edx, " + dividend);
+        if (tile.shift > 0) emit("sar edx, " + std::to_string(tile.shift));
+        // Add one for negative quotients to round toward zero
+        emit("mov eax, edx");
+        emit("shr eax, 31");
+        emit("add edx, eax");
+        result = "edx";
+        if (remainder) {
+            emit("imul edx, edx, " + right);
+            emit("mov eax, " + dividend);
+            emit("sub eax, edx");
+            result = "eax";
+        }
+    } else {
+        // A zero divisor ends the program through __divide_error instead of
+        // the trap idiv would raise
+        bool zero = is_constant(right) && std::stoll(right) == 0;
+        if (zero || !is_constant(right)) {
+            if (!zero) {
+                emit("cmp " + sized(source(right)) + ", 0");
+                emit("je __divide_error");
+            } else {
+                emit("jmp __divide_error");
+            }
+            add_variable("__divide_by_zero");
+            divide_checked = true;
+        }
+        emit("mov eax, " + dividend);
+        emit("cdq");
+        if (is_constant(right)) { // idiv has no immediate form
+            std::string sp = target == TargetArch::X86_64 ? "rsp" : "esp";
+            emit("push " + right);
+            emit("idiv dword [" + sp + "]");
+            emit("add " + sp + ", " + (target == TargetArch::X86_64 ? "8" : "4"));
+        } else {
+            emit("idiv " + sized(source(right)));
+        }
+    }
+    if (result != dest_loc) emit("mov " + dest_loc + ", " + result);
+}
+
+// CMOV d, c, v. cmov has no immediate or memory-destination form: a
+// constant goes through eax, and a destination in a stack slot is computed
+// in eax with the condition inverted, keeping the old value unless it holds.
+void AssemblyGenerator::handle_conditional_move(const std::string& line) {
+    std::stringstream ss(trim(line.substr(4)));
+    std::string dest, condition, value;
+    std::getline(ss, dest, ',');
+    std::getline(ss, condition, ',');
+    std::getline(ss, value, ',');
+    dest = trim(dest);
+    condition = trim(condition);
+    value = trim(value);
 
-        if(is_temporary(right)){
-             emit(op_instr + " " + dest_reg + ", " + get_register(right));
-             free_register(right);
-        } else if(isdigit(right[0])) {
-             emit(op_instr + " " + dest_reg + ", " + right);
+    const Tile& tile = selector.tile(position);
+    std::string relation = "!=";
+    if (tile.kind == Tile::CompareMove) {
+        emit_compare(tile.left, tile.right);
+        relation = tile.relation;
+    } else {
+        std::string flag = source(condition);
+        if (is_register(flag)) {
+            emit("test " + flag + ", " + flag);
         } else {
-            add_variable(right);
-            emit(op_instr + " " + dest_reg + ", [" + right + "]");
+            emit_compare(condition, "0");
+        }
+    }
+
+    std::string dest_loc = is_temporary(dest) ? location(dest) : memory(dest);
+    std::string moved = source(value);
+    if (is_register(dest_loc)) {
+        if (is_constant(moved)) {
+            emit("mov eax, " + moved); // mov leaves the flags alone
+            moved = "eax";
         }
+        emit("cmov" + condition_code(relation) + " " + dest_loc + ", " + moved);
+    } else {
+        emit("mov eax, " + moved);
+        emit("cmov" + condition_code(negate_comparison(relation)) + " eax, " + dest_loc);
+        emit("mov " + dest_loc + ", eax");
     }
 }
 
+// cmp with the left operand in a register; eax holds it if it is not in one
+void AssemblyGenerator::emit_compare(const std::string& left, const std::string& right) {
+    std::string left_reg = source(left);
+    if (!is_register(left_reg)) {
+        emit("mov eax, " + left_reg);
+        left_reg = "eax";
+    }
+    emit("cmp " + left_reg + ", " + source(right));
+}
+
 void AssemblyGenerator::handle_if(const std::string& line) {
     std::stringstream ss(line);
-    std::string token, left, op, right, go, to, label;
-    ss >> token >> left >> op >> right >> go >> to >> label;
+    std::string token, left, op, right, go, label;
+    ss >> token >> left >> op >> right >> go >> label;
 
-    std::string left_reg = is_temporary(left) ? get_register(left) : "eax";
-    if (!is_temporary(left)) {
-        add_variable(left);
-        emit("mov eax, [" + left + "]");
+    const Tile& tile = selector.tile(position);
+    std::string left_reg = source(left);
+    if (tile.kind == Tile::Test) {
+        emit("test " + left_reg + ", " + left_reg);
+    } else if (tile.kind == Tile::CompareMemory) {
+        if (left_reg.rfind("dword", 0) != 0) left_reg = "dword " + left_reg;
+        emit("cmp " + left_reg + ", " + right);
+    } else {
+        emit_compare(left, right);
     }
+    emit("j" + condition_code(op) + " " + label);
+}
 
-    if (is_temporary(right)) {
-        emit("cmp " + left_reg + ", " + get_register(right));
-    } else if (isdigit(right[0])) {
-        emit("cmp " + left_reg + ", " + right);
+// t = a[i]
+void AssemblyGenerator::handle_load(const TacInstr& instr) {
+    std::string dest_loc = is_temporary(instr.dest) ? location(instr.dest) : memory(instr.dest);
+    std::string value = element(instr.array, instr.arg1);
+    if (is_register(dest_loc)) {
+        emit("mov " + dest_loc + ", " + value);
     } else {
-        add_variable(right);
-        emit("cmp " + left_reg + ", [" + right + "]");
+        emit("mov eax, " + value);
+        emit("mov " + dest_loc + ", eax");
     }
+}
 
-    std::map<std::string, std::string> jump_map = {
-        {"<", "jl"}, {">", "jg"}, {"<=", "jle"}, {">=", "jge"}, {"==", "je"}, {"!=", "jne"}
-    };
-    emit(jump_map[op] + " " + label);
+// a[i] = v. A value in memory needs a register on the way, and eax may be
+// taken by the index: x86 then copies it through the stack, and x86-64
+// moves the element's address into r11 to free eax.
+void AssemblyGenerator::handle_store(const TacInstr& instr) {
+    std::string value = source(instr.arg2);
+    if (is_register(value) || is_constant(value)) {
+        emit("mov " + element(instr.array, instr.arg1) + ", " + value);
+        return;
+    }
+    if (direct_index(instr.array, instr.arg1)) {
+        emit("mov eax, " + value);
+        emit("mov " + element(instr.array, instr.arg1) + ", eax");
+        return;
+    }
+    std::string target_element = element(instr.array, instr.arg1);
+    if (target == TargetArch::X86_64) {
+        emit("lea r11, " + target_element.substr(6));
+        array_base.clear();
+        emit("mov eax, " + value);
+        emit("mov dword [r11], eax");
+    } else {
+        emit("push " + (value.rfind("dword", 0) == 0 ? value : "dword " + value));
+        emit("pop " + target_element);
+    }
+}
+
+// BOUNDS i, a: an unsigned compare catches negative indices too
+void AssemblyGenerator::handle_bounds_check(const TacInstr& instr) {
+    std::string limit = std::to_string(array_size.at(instr.array));
+    std::string index = source(instr.arg1);
+    if (is_constant(index)) {
+        emit("mov eax, " + index);
+        index = "eax";
+    } else if (!is_register(index) && index.rfind("dword", 0) != 0) {
+        index = "dword " + index;
+    }
+    emit("cmp " + index + ", " + limit);
+    emit("jae __bounds_error");
+    add_variable("__out_of_bounds");
+    bounds_checked = true;
+}
+
+// Vector code. Four lanes are SSE2 in xmm registers and eight are AVX2 in
+// ymm registers, %vN in register N of either; xmm6 and xmm7 are scratch.
+// AVX2 code is all VEX-encoded, so it never mixes with legacy SSE.
+// Elements are addressed like scalar ones, with an unaligned move.
+std::string AssemblyGenerator::vector_register(int number, int lanes) const {
+    if (number < 0 || number > 5 || (lanes != 4 && lanes != 8)) {
+        throw std::runtime_error("Assembly Error: No register for a " + std::to_string(lanes) + "-lane %v" +
+                                 std::to_string(number) + ".");
+    }
+    return (lanes == 8 ? "ymm" : "xmm") + std::to_string(number);
+}
+
+// VLOAD %vN, a[i]
+void AssemblyGenerator::handle_vector_load(const TacInstr& instr) {
+    std::string dest = vector_register(instr.vdest, instr.lanes);
+    std::string value = element(instr.array, instr.arg1).substr(6); // Without "dword "
+    emit((instr.lanes == 8 ? "vmovdqu " : "movdqu ") + dest + ", " + value);
+}
+
+// VSTORE a[i], %vN
+void AssemblyGenerator::handle_vector_store(const TacInstr& instr) {
+    std::string value = vector_register(instr.vsrc1, instr.lanes);
+    std::string target_element = element(instr.array, instr.arg1).substr(6);
+    emit((instr.lanes == 8 ? "vmovdqu " : "movdqu ") + target_element + ", " + value);
+}
+
+// VSPLAT %vN, x: x into the low lane, then copied to the others
+void AssemblyGenerator::handle_vector_splat(const TacInstr& instr) {
+    std::string dest = vector_register(instr.vdest, instr.lanes);
+    std::string low = "xmm" + std::to_string(instr.vdest);
+    std::string value = source(instr.arg1);
+    if (is_constant(value)) {
+        emit("mov eax, " + value);
+        value = "eax";
+    } else if (value.rfind("dword ", 0) == 0) {
+        value = value.substr(6);
+    }
+    if (instr.lanes == 8) {
+        emit("vmovd " + low + ", " + value);
+        emit("vpbroadcastd " + dest + ", " + low);
+    } else {
+        emit("movd " + low + ", " + value);
+        emit("pshufd " + dest + ", " + dest + ", 0");
+    }
+}
+
+// VADD/VSUB/VMUL %vD, %vX, %vY. AVX2 has three-operand forms of all
+// three. SSE2 works in place, and has no 32-bit multiply: pmuludq
+// multiplies lanes 0 and 2 into 64-bit products, so lanes 1 and 3 are
+// shifted down and multiplied apart, and the low halves are put back
+// together.
+void AssemblyGenerator::handle_vector_op(const TacInstr& instr) {
+    std::string dest = vector_register(instr.vdest, instr.lanes);
+    std::string left = vector_register(instr.vsrc1, instr.lanes);
+    std::string right = vector_register(instr.vsrc2, instr.lanes);
+    static const std::map<std::string, std::string> sse = {{"+", "paddd"}, {"-", "psubd"}};
+    static const std::map<std::string, std::string> avx = {{"+", "vpaddd"}, {"-", "vpsubd"}, {"*", "vpmulld"}};
+    if (instr.lanes == 8) {
+        emit(avx.at(instr.op) + " " + dest + ", " + left + ", " + right);
+        return;
+    }
+    if (dest == right && dest != left) {
+        if (instr.op == "-") {
+            emit("movdqa xmm7, " + right);
+            right = "xmm7";
+        } else {
+            std::swap(left, right);
+        }
+    }
+    if (dest != left) emit("movdqa " + dest + ", " + left);
+    if (instr.op != "*") {
+        emit(sse.at(instr.op) + " " + dest + ", " + right);
+        return;
+    }
+    emit("movdqa xmm6, " + dest);
+    emit("pmuludq " + dest + ", " + right);
+    emit("psrlq xmm6, 32");
+    emit("movdqa xmm7, " + right);
+    emit("psrlq xmm7, 32");
+    emit("pmuludq xmm6, xmm7");
+    emit("pshufd " + dest + ", " + dest + ", 8");
+    emit("pshufd xmm6, xmm6, 8");
+    emit("punpckldq " + dest + ", xmm6");
 }
 
 void AssemblyGenerator::handle_goto(const std::string& line) {
@@ -217,21 +700,102 @@ void AssemblyGenerator::handle_goto(const std::string& line) {
     emit("jmp " + label);
 }
 
+std::vector<MachineInstr> AssemblyGenerator::program(ProgramExit exit) const {
+    std::vector<MachineInstr> code;
+    auto add = [&code](const std::string& text) { code.push_back(parse_machine_instr(text)); };
+    add("_start:");
+    bool wide = target == TargetArch::X86_64;
+    std::vector<std::string> saved;
+    if (exit == ProgramExit::Return) {
+        if (wide) saved = {"rbx", "r12", "r13", "r14", "r15"};
+        else saved = {"ebx", "esi", "edi"};
+        for (const auto& reg : saved) add("push " + reg);
+    }
+    int frame_slots = allocator->slot_count + frame.slot_count;
+    if (frame_slots > 0) {
+        // Stack frame for spilled temps and block locals. The x86-64 ABI
+        // keeps rsp 16-byte aligned.
+        int size = 4 * frame_slots;
+        if (wide) size = (size + 15) & ~15;
+        std::string sp = wide ? "rsp" : "esp";
+        add("push " + frame_pointer());
+        add("mov " + frame_pointer() + ", " + sp);
+        add("sub " + sp + ", " + std::to_string(size));
+    }
+    code.insert(code.end(), assembly_code.begin(), assembly_code.end());
+    if (exit == ProgramExit::Return) {
+        if (bounds_checked || divide_checked) add("__exit:");
+        // Dirty upper ymm halves would slow down the caller's SSE code
+        if (wide_vectors) add("vzeroupper");
+        if (frame_slots > 0) {
+            add("mov " + std::string(wide ? "rsp" : "esp") + ", " + frame_pointer());
+            add("pop " + frame_pointer());
+        }
+        for (auto reg = saved.rbegin(); reg != saved.rend(); ++reg) add("pop " + *reg);
+        add("ret");
+    } else if (wide) {
+        add("mov eax, 60");
+        add("xor edi, edi");
+        add("syscall");
+    } else {
+        add("mov eax, 1");
+        add("xor ebx, ebx");
+        add("int 0x80");
+    }
+    // An index out of bounds or a zero divisor sets its flag and ends the
+    // program, with exit status 1 if it is a process of its own
+    auto error_exit = [&](const std::string& label, const std::string& variable) {
+        add(label + ":");
+        std::string flag = data_symbol(variable);
+        add("mov dword " + (wide ? "[rel " + flag + "]" : "[" + flag + "]") + ", 1");
+        if (exit == ProgramExit::Return) {
+            add("jmp __exit");
+        } else if (wide) {
+            add("mov eax, 60");
+            add("mov edi, 1");
+            add("syscall");
+        } else {
+            add("mov eax, 1");
+            add("mov ebx, 1");
+            add("int 0x80");
+        }
+    };
+    if (bounds_checked) error_exit("__bounds_error", "__out_of_bounds");
+    if (divide_checked) error_exit("__divide_error", "__divide_by_zero");
+    return code;
+}
+
+std::vector<std::string> AssemblyGenerator::data_symbols() const {
+    return data_section;
+}
+
 std::string AssemblyGenerator::get_assembly_code() {
     std::stringstream full_code;
+    if (target == TargetArch::X86_64) full_code << "bits 64\n\n";
     full_code << "section .data\n";
     for (const auto& var : data_section) {
-        full_code << "    " << var << "\n";
+        full_code << "    " << data_symbol(var) << " dd 0\n";
+    }
+    if (!arrays.empty()) {
+        full_code << "\nsection .bss\n";
+        for (const auto& array : arrays) {
+            full_code << "    alignb 32\n";
+            full_code << "    " << data_symbol(array.name) << " resd " << array.size << "\n";
+        }
     }
     full_code << "\nsection .text\n";
     full_code << "    global _start\n\n";
-    full_code << "_start:\n";
-    for (const auto& line : assembly_code) {
-        full_code << line << "\n";
-    }
-    full_code << "\n    ; Exit program\n";
-    full_code << "    mov eax, 1\n";
-    full_code << "    xor ebx, ebx\n";
-    full_code << "    int 0x80\n";
+    // The exit sequence is the last three instructions, or the three before
+    // the five of each error exit
+    std::vector<MachineInstr> code = program();
+    size_t bounds_at = code.size() - (divide_checked ? 5 : 0) - (bounds_checked ? 5 : 0);
+    size_t divide_at = code.size() - (divide_checked ? 5 : 0);
+    size_t exit_at = bounds_at - 3;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (i == exit_at) full_code << "\n    ; Exit program\n";
+        if (bounds_checked && i == bounds_at) full_code << "\n    ; Array index out of bounds\n";
+        if (divide_checked && i == divide_at) full_code << "\n    ; Division by zero\n";
+        full_code << machine_instr_to_string(code[i]) << "\n";
+    }
     return full_code.str();
 }
@@ -5,24 +5,92 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <memory>
+#include "regalloc.h"
+#include "frame.h"
+#include "machine.h"
+#include "peephole.h"
+#include "isel.h"
+
+// Output architecture. Both are Linux ELF with a bare _start. The language's
+// int is 32 bits on either, so x86-64 does arithmetic in the 32-bit halves
+// of its registers (which zero-extends) and gains r8-r15 for allocation.
+enum class TargetArch { X86, X86_64 };
+
+// Accepts -m32 and -m64; returns false for any other flag
+bool parse_target(const std::string& flag, TargetArch& target);
+
+// How the program ends: with the exit system call when it is a process of
+// its own, or by returning to its caller when the JIT runs it inside the
+// compiler. A returning program saves and restores the callee-saved
+// registers it may use.
+enum class ProgramExit { SystemCall, Return };
+
+// An array of the program: `size` zeroed 4-byte elements in .bss
+struct ArraySymbol {
+    std::string name;
+    long long size;
+};
+
+// The assembly symbol of a variable or array: its name behind a fixed
+// prefix, so that no name reads as a register (eax, r8, xmm0) or clashes
+// with a label of the code
+std::string data_symbol(const std::string& name);
 
 class AssemblyGenerator {
 public:
     AssemblyGenerator();
     std::string generate_from_tac(const std::string& tac_code);
+    // Picks the register set, so it must precede set_allocator
+    void set_target(TargetArch arch);
+    void set_allocator(AllocatorKind kind);
+    const RegisterAllocator& register_allocator() const { return *allocator; }
+    const FrameLayout& frame_layout() const { return frame; }
+    const PeepholeOptimizer& peephole_optimizer() const { return peephole; }
+    const InstructionSelector& instruction_selector() const { return selector; }
+    // The whole program after generate_from_tac: the frame setup, the code
+    // and the exit sequence. With SystemCall it is what the assembly text
+    // lists.
+    std::vector<MachineInstr> program(ProgramExit exit = ProgramExit::SystemCall) const;
+    // The .data variables, one zeroed 4-byte cell each, in layout order.
+    // Like array_symbols these are source names; see data_symbol.
+    std::vector<std::string> data_symbols() const;
+    // The .bss arrays, in declaration order. Each starts 32-byte aligned.
+    const std::vector<ArraySymbol>& array_symbols() const { return arrays; }
+    bool optimize_assembly; // Run the peephole optimizer on the output
 
 private:
-    std::vector<std::string> assembly_code;
+    std::vector<MachineInstr> assembly_code;
     std::vector<std::string> data_section;
-    std::map<std::string, std::string> register_map;
-    std::vector<std::string> available_registers;
-    std::vector<std::string> register_pool;
     std::set<std::string> variables;
-    int spill_index;
+    std::unique_ptr<RegisterAllocator> allocator;
+    AllocatorKind allocator_kind;
+    std::vector<ArraySymbol> arrays;
+    std::map<std::string, long long> array_size;
+    // On x86-64 an element is addressed from r11, which holds the address
+    // of this array until the next label or until r11 is changed
+    std::string array_base;
+    bool bounds_checked; // Some BOUNDS jumps to __bounds_error
+    bool divide_checked; // Some division jumps to __divide_error
+    bool wide_vectors;   // Some vector code uses ymm registers
+    FrameLayout frame;
+    TargetArch target;
+    PeepholeOptimizer peephole;
+    InstructionSelector selector;
+    int position; // Index of the TAC line being translated
 
     bool is_temporary(const std::string& name);
-    std::string get_register(const std::string& temp);
-    void free_register(const std::string& temp);
+    bool is_register(const std::string& operand);
+    std::string wide_register(const std::string& reg) const;
+    void build_allocator(bool reserve_r11);
+    std::string frame_pointer() const;
+    std::string slot_operand(int slot);
+    std::string memory(const std::string& var);
+    std::string location(const std::string& temp);
+    std::string source(const std::string& operand);
+    std::string address(const Tile& tile);
+    bool direct_index(const std::string& array, const std::string& index);
+    std::string element(const std::string& array, const std::string& index);
     void emit(const std::string& instruction);
     void emit_label(const std::string& label);
     void add_variable(const std::string& var);
@@ -33,6 +101,18 @@ private:
     void handle_if(const std::string& line);
     void handle_goto(const std::string& line);
     void handle_add_sub(const std::string& line, const std::string& op);
+    void handle_conditional_move(const std::string& line);
+    void handle_load(const TacInstr& instr);
+    void handle_store(const TacInstr& instr);
+    void handle_bounds_check(const TacInstr& instr);
+    std::string vector_register(int number, int lanes) const;
+    void handle_vector_load(const TacInstr& instr);
+    void handle_vector_store(const TacInstr& instr);
+    void handle_vector_splat(const TacInstr& instr);
+    void handle_vector_op(const TacInstr& instr);
+    void emit_compare(const std::string& left, const std::string& right);
+    void handle_division(const Tile& tile, const std::string& dest, const std::string& left,
+                         const std::string& op, const std::string& right);
 };
 
 #endif // ASSEMBLY_GEN_H
\ No newline at end of file
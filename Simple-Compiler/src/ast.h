@@ -47,6 +47,14 @@ struct UnaryOp : public Expression {
         : op(o), expr(std::move(e)) {}
 };
 
+// a[i]
+struct ArrayAccess : public Expression {
+    std::string id;
+    std::unique_ptr<Expression> index;
+    ArrayAccess(const std::string& i, std::unique_ptr<Expression> idx)
+        : id(i), index(std::move(idx)) {}
+};
+
 
 // Statement nodes
 struct Declaration : public Statement {
@@ -57,6 +65,15 @@ struct Declaration : public Statement {
         : type(t), id(i), expr(std::move(e)) {}
 };
 
+// int a[N]; at the top level only, with N a constant
+struct ArrayDeclaration : public Statement {
+    std::string type;
+    std::string id;
+    long long size;
+    ArrayDeclaration(const std::string& t, const std::string& i, long long n)
+        : type(t), id(i), size(n) {}
+};
+
 struct Assignment : public Statement {
     std::string id;
     std::unique_ptr<Expression> expr;
@@ -64,6 +81,15 @@ struct Assignment : public Statement {
         : id(i), expr(std::move(e)) {}
 };
 
+// a[i] = expr
+struct ArrayAssignment : public Statement {
+    std::string id;
+    std::unique_ptr<Expression> index;
+    std::unique_ptr<Expression> expr;
+    ArrayAssignment(const std::string& i, std::unique_ptr<Expression> idx, std::unique_ptr<Expression> e)
+        : id(i), index(std::move(idx)), expr(std::move(e)) {}
+};
+
 struct IncrementStatement : public Statement {
     std::string id;
     std::string op; // "++" or "--"
@@ -85,6 +111,18 @@ struct ForStatement : public Statement {
     std::unique_ptr<Statement> body;
     ForStatement(std::unique_ptr<Statement> i, std::unique_ptr<BinaryOp> c, std::unique_ptr<Statement> inc, std::unique_ptr<Statement> b)
         : init(std::move(i)), condition(std::move(c)), increment(std::move(inc)), body(std::move(b)) {}
+    bool keep_rolled = false; // Set by the vectorizer; the unroller leaves the loop alone
+};
+
+// `lanes` consecutive iterations of `store`, one for each value of `var`
+// from its current value up. Made by the vectorizer from the body of a loop
+// over `var`; never written in source.
+struct VectorAssignment : public Statement {
+    std::string var;
+    int lanes;
+    std::unique_ptr<ArrayAssignment> store;
+    VectorAssignment(const std::string& v, int n, std::unique_ptr<ArrayAssignment> s)
+        : var(v), lanes(n), store(std::move(s)) {}
 };
 
 struct Block : public Statement {
@@ -0,0 +1,123 @@
+#include "ast_interpreter.h"
+#include <chrono>
+#include <climits>
+#include <stdexcept>
+
+AstInterpreter::AstInterpreter() : run_microseconds(0) {}
+
+void AstInterpreter::run(const StatementList* root) {
+    values.clear();
+    scopes.assign(1, {});
+    arrays.clear();
+    auto start = std::chrono::steady_clock::now();
+    execute_list(root);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    run_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    for (const auto& stmt : root->statements) {
+        if (auto decl = dynamic_cast<const Declaration*>(stmt.get())) {
+            values.push_back({decl->id, scopes.front()[decl->id]});
+        }
+    }
+}
+
+void AstInterpreter::execute_list(const StatementList* list) {
+    for (const auto& stmt : list->statements) execute(stmt.get());
+}
+
+void AstInterpreter::execute(const Statement* stmt) {
+    if (!stmt) return;
+    if (auto decl = dynamic_cast<const Declaration*>(stmt)) {
+        // The initializer sees the enclosing declaration of the same name
+        int32_t value = decl->expr ? evaluate(decl->expr.get()) : 0;
+        scopes.back()[decl->id] = value;
+    } else if (auto assign = dynamic_cast<const Assignment*>(stmt)) {
+        int32_t value = evaluate(assign->expr.get());
+        lookup(assign->id) = value;
+    } else if (auto array = dynamic_cast<const ArrayDeclaration*>(stmt)) {
+        arrays[array->id].assign(static_cast<size_t>(array->size), 0);
+    } else if (auto store = dynamic_cast<const ArrayAssignment*>(stmt)) {
+        int32_t index = evaluate(store->index.get());
+        int32_t value = evaluate(store->expr.get());
+        element(store->id, index) = value;
+    } else if (auto inc = dynamic_cast<const IncrementStatement*>(stmt)) {
+        int32_t& var = lookup(inc->id);
+        uint32_t value = static_cast<uint32_t>(var);
+        var = static_cast<int32_t>(inc->op == "++" ? value + 1 : value - 1);
+    } else if (auto if_stmt = dynamic_cast<const IfStatement*>(stmt)) {
+        if (test(if_stmt->condition.get())) {
+            execute(if_stmt->if_body.get());
+        } else {
+            execute(if_stmt->else_body.get());
+        }
+    } else if (auto loop = dynamic_cast<const ForStatement*>(stmt)) {
+        scopes.emplace_back();
+        execute(loop->init.get());
+        while (test(loop->condition.get())) {
+            execute(loop->body.get());
+            execute(loop->increment.get());
+        }
+        scopes.pop_back();
+    } else if (auto block = dynamic_cast<const Block*>(stmt)) {
+        scopes.emplace_back();
+        execute_list(block->statement_list.get());
+        scopes.pop_back();
+    }
+}
+
+bool AstInterpreter::test(const BinaryOp* cond) {
+    int32_t left = evaluate(cond->left.get());
+    int32_t right = evaluate(cond->right.get());
+    if (cond->op == "<") return left < right;
+    if (cond->op == "<=") return left <= right;
+    if (cond->op == ">") return left > right;
+    if (cond->op == ">=") return left >= right;
+    if (cond->op == "==") return left == right;
+    return left != right;
+}
+
+int32_t AstInterpreter::evaluate(const Expression* expr) {
+    if (auto num = dynamic_cast<const Number*>(expr)) {
+        return static_cast<int32_t>(static_cast<long long>(num->value));
+    }
+    if (auto id = dynamic_cast<const Identifier*>(expr)) return lookup(id->name);
+    if (auto access = dynamic_cast<const ArrayAccess*>(expr)) {
+        return element(access->id, evaluate(access->index.get()));
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(expr)) {
+        return static_cast<int32_t>(0u - static_cast<uint32_t>(evaluate(unop->expr.get())));
+    }
+    auto binop = dynamic_cast<const BinaryOp*>(expr);
+    if (!binop) throw std::runtime_error("Runtime Error: Unknown expression.");
+    int32_t left = evaluate(binop->left.get());
+    int32_t right = evaluate(binop->right.get());
+    uint32_t a = static_cast<uint32_t>(left);
+    uint32_t b = static_cast<uint32_t>(right);
+    const std::string& op = binop->op;
+    if (op == "+") return static_cast<int32_t>(a + b);
+    if (op == "-") return static_cast<int32_t>(a - b);
+    if (op == "*") return static_cast<int32_t>(a * b);
+    if (op == ">>>") return static_cast<int32_t>(a >> (b & 31));
+    if (op == "/" || op == "%") {
+        if (right == 0) throw std::runtime_error("Runtime Error: Division by zero.");
+        if (left == INT32_MIN && right == -1) throw std::runtime_error("Runtime Error: Division overflow.");
+        return op == "/" ? left / right : left % right;
+    }
+    return test(binop) ? 1 : 0;
+}
+
+int32_t& AstInterpreter::lookup(const std::string& name) {
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        auto found = scope->find(name);
+        if (found != scope->end()) return found->second;
+    }
+    throw std::runtime_error("Runtime Error: Undefined variable " + name);
+}
+
+int32_t& AstInterpreter::element(const std::string& array, int32_t index) {
+    std::vector<int32_t>& elements = arrays.at(array);
+    if (index < 0 || static_cast<size_t>(index) >= elements.size()) {
+        throw std::runtime_error("Runtime Error: Array index out of bounds.");
+    }
+    return elements[index];
+}
@@ -0,0 +1,38 @@
+#ifndef AST_INTERPRETER_H
+#define AST_INTERPRETER_H
+
+#include "ast.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runs a checked AST directly, node by node. This is the simplest way to
+// execute a program and the baseline the bytecode VM is measured against:
+// every node is found by dynamic_cast, every variable access searches a
+// chain of scope maps by name, and nothing is cached between iterations.
+// Arithmetic wraps at 32 bits like the generated code; a division by zero
+// or an array index out of bounds is a Runtime Error.
+class AstInterpreter {
+public:
+    AstInterpreter();
+    void run(const StatementList* root);
+
+    // Top-level variables after the run, in declaration order
+    std::vector<std::pair<std::string, int32_t>> values;
+    long long run_microseconds;
+
+private:
+    std::vector<std::map<std::string, int32_t>> scopes;
+    std::map<std::string, std::vector<int32_t>> arrays; // Top level only, so never shadowed
+
+    void execute(const Statement* stmt);
+    void execute_list(const StatementList* list);
+    int32_t evaluate(const Expression* expr);
+    bool test(const BinaryOp* cond);
+    int32_t& lookup(const std::string& name);
+    int32_t& element(const std::string& array, int32_t index);
+};
+
+#endif // AST_INTERPRETER_H
@@ -0,0 +1,383 @@
+#include "ast_utils.h"
+
+/******************************************************************
+ * Cloning
+ ******************************************************************/
+
+std::unique_ptr<Expression> clone_expression(const Expression* expr) {
+    if (!expr) return nullptr;
+    if (auto num = dynamic_cast<const Number*>(expr)) {
+        return std::make_unique<Number>(num->value);
+    }
+    if (auto id = dynamic_cast<const Identifier*>(expr)) {
+        return std::make_unique<Identifier>(id->name);
+    }
+    if (auto binop = dynamic_cast<const BinaryOp*>(expr)) {
+        return clone_condition(binop);
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(expr)) {
+        return std::make_unique<UnaryOp>(unop->op, clone_expression(unop->expr.get()));
+    }
+    if (auto access = dynamic_cast<const ArrayAccess*>(expr)) {
+        return std::make_unique<ArrayAccess>(access->id, clone_expression(access->index.get()));
+    }
+    return nullptr;
+}
+
+std::unique_ptr<BinaryOp> clone_condition(const BinaryOp* cond) {
+    if (!cond) return nullptr;
+    return std::make_unique<BinaryOp>(cond->op,
+                                      clone_expression(cond->left.get()),
+                                      clone_expression(cond->right.get()));
+}
+
+std::unique_ptr<StatementList> clone_statement_list(const StatementList* list) {
+    auto copy = std::make_unique<StatementList>();
+    if (!list) return copy;
+    for (const auto& stmt : list->statements) {
+        copy->statements.push_back(clone_statement(stmt.get()));
+    }
+    return copy;
+}
+
+std::unique_ptr<Statement> clone_statement(const Statement* stmt) {
+    if (!stmt) return nullptr;
+    if (auto decl = dynamic_cast<const Declaration*>(stmt)) {
+        return std::make_unique<Declaration>(decl->type, decl->id, clone_expression(decl->expr.get()));
+    }
+    if (auto assign = dynamic_cast<const Assignment*>(stmt)) {
+        return std::make_unique<Assignment>(assign->id, clone_expression(assign->expr.get()));
+    }
+    if (auto store = dynamic_cast<const ArrayAssignment*>(stmt)) {
+        return std::make_unique<ArrayAssignment>(store->id, clone_expression(store->index.get()),
+                                                 clone_expression(store->expr.get()));
+    }
+    if (auto array = dynamic_cast<const ArrayDeclaration*>(stmt)) {
+        return std::make_unique<ArrayDeclaration>(array->type, array->id, array->size);
+    }
+    if (auto inc = dynamic_cast<const IncrementStatement*>(stmt)) {
+        return std::make_unique<IncrementStatement>(inc->id, inc->op);
+    }
+    if (auto if_stmt = dynamic_cast<const IfStatement*>(stmt)) {
+        return std::make_unique<IfStatement>(clone_condition(if_stmt->condition.get()),
+                                             clone_statement(if_stmt->if_body.get()),
+                                             clone_statement(if_stmt->else_body.get()));
+    }
+    if (auto for_stmt = dynamic_cast<const ForStatement*>(stmt)) {
+        auto copy = std::make_unique<ForStatement>(clone_statement(for_stmt->init.get()),
+                                                   clone_condition(for_stmt->condition.get()),
+                                                   clone_statement(for_stmt->increment.get()),
+                                                   clone_statement(for_stmt->body.get()));
+        copy->keep_rolled = for_stmt->keep_rolled;
+        return copy;
+    }
+    if (auto vector = dynamic_cast<const VectorAssignment*>(stmt)) {
+        const ArrayAssignment* store = vector->store.get();
+        return std::make_unique<VectorAssignment>(
+            vector->var, vector->lanes,
+            std::make_unique<ArrayAssignment>(store->id, clone_expression(store->index.get()),
+                                              clone_expression(store->expr.get())));
+    }
+    if (auto block = dynamic_cast<const Block*>(stmt)) {
+        return std::make_unique<Block>(clone_statement_list(block->statement_list.get()));
+    }
+    return nullptr;
+}
+
+/******************************************************************
+ * Def/use queries
+ ******************************************************************/
+
+void collect_assigned(const Node* node, std::set<std::string>& out) {
+    if (!node) return;
+    if (auto sl = dynamic_cast<const StatementList*>(node)) {
+        for (const auto& stmt : sl->statements) collect_assigned(stmt.get(), out);
+    } else if (auto decl = dynamic_cast<const Declaration*>(node)) {
+        out.insert(decl->id);
+    } else if (auto assign = dynamic_cast<const Assignment*>(node)) {
+        out.insert(assign->id);
+    } else if (auto store = dynamic_cast<const ArrayAssignment*>(node)) {
+        out.insert(store->id);
+    } else if (auto vector = dynamic_cast<const VectorAssignment*>(node)) {
+        out.insert(vector->store->id);
+    } else if (auto inc = dynamic_cast<const IncrementStatement*>(node)) {
+        out.insert(inc->id);
+    } else if (auto if_stmt = dynamic_cast<const IfStatement*>(node)) {
+        collect_assigned(if_stmt->if_body.get(), out);
+        collect_assigned(if_stmt->else_body.get(), out);
+    } else if (auto for_stmt = dynamic_cast<const ForStatement*>(node)) {
+        collect_assigned(for_stmt->init.get(), out);
+        collect_assigned(for_stmt->increment.get(), out);
+        collect_assigned(for_stmt->body.get(), out);
+    } else if (auto block = dynamic_cast<const Block*>(node)) {
+        collect_assigned(block->statement_list.get(), out);
+    }
+}
+
+void collect_used(const Node* node, std::set<std::string>& out) {
+    if (!node) return;
+    if (auto sl = dynamic_cast<const StatementList*>(node)) {
+        for (const auto& stmt : sl->statements) collect_used(stmt.get(), out);
+    } else if (auto decl = dynamic_cast<const Declaration*>(node)) {
+        collect_used(decl->expr.get(), out);
+    } else if (auto assign = dynamic_cast<const Assignment*>(node)) {
+        collect_used(assign->expr.get(), out);
+    } else if (auto store = dynamic_cast<const ArrayAssignment*>(node)) {
+        collect_used(store->index.get(), out);
+        collect_used(store->expr.get(), out);
+    } else if (auto vector = dynamic_cast<const VectorAssignment*>(node)) {
+        out.insert(vector->var);
+        collect_used(vector->store.get(), out);
+    } else if (auto inc = dynamic_cast<const IncrementStatement*>(node)) {
+        out.insert(inc->id);
+    } else if (auto if_stmt = dynamic_cast<const IfStatement*>(node)) {
+        collect_used(if_stmt->condition.get(), out);
+        collect_used(if_stmt->if_body.get(), out);
+        collect_used(if_stmt->else_body.get(), out);
+    } else if (auto for_stmt = dynamic_cast<const ForStatement*>(node)) {
+        collect_used(for_stmt->init.get(), out);
+        collect_used(for_stmt->condition.get(), out);
+        collect_used(for_stmt->increment.get(), out);
+        collect_used(for_stmt->body.get(), out);
+    } else if (auto block = dynamic_cast<const Block*>(node)) {
+        collect_used(block->statement_list.get(), out);
+    } else if (auto id = dynamic_cast<const Identifier*>(node)) {
+        out.insert(id->name);
+    } else if (auto binop = dynamic_cast<const BinaryOp*>(node)) {
+        collect_used(binop->left.get(), out);
+        collect_used(binop->right.get(), out);
+    } else if (auto unop = dynamic_cast<const UnaryOp*>(node)) {
+        collect_used(unop->expr.get(), out);
+    } else if (auto access = dynamic_cast<const ArrayAccess*>(node)) {
+        out.insert(access->id);
+        collect_used(access->index.get(), out);
+    }
+}
+
+bool reads_array(const Node* node) {
+    if (!node) return false;
+    if (dynamic_cast<const ArrayAccess*>(node)) return true;
+    if (auto sl = dynamic_cast<const StatementList*>(node)) {
+        for (const auto& stmt : sl->statements) {
+            if (reads_array(stmt.get())) return true;
+        }
+        return false;
+    }
+    if (auto decl = dynamic_cast<const Declaration*>(node)) return reads_array(decl->expr.get());
+    if (auto assign = dynamic_cast<const Assignment*>(node)) return reads_array(assign->expr.get());
+    if (auto store = dynamic_cast<const ArrayAssignment*>(node)) {
+        return reads_array(store->index.get()) || reads_array(store->expr.get());
+    }
+    if (auto vector = dynamic_cast<const VectorAssignment*>(node)) return reads_array(vector->store.get());
+    if (auto if_stmt = dynamic_cast<const IfStatement*>(node)) {
+        return reads_array(if_stmt->condition.get()) || reads_array(if_stmt->if_body.get()) ||
+               reads_array(if_stmt->else_body.get());
+    }
+    if (auto for_stmt = dynamic_cast<const ForStatement*>(node)) {
+        return reads_array(for_stmt->init.get()) || reads_array(for_stmt->condition.get()) ||
+               reads_array(for_stmt->increment.get()) || reads_array(for_stmt->body.get());
+    }
+    if (auto block = dynamic_cast<const Block*>(node)) return reads_array(block->statement_list.get());
+    if (auto binop = dynamic_cast<const BinaryOp*>(node)) {
+        return reads_array(binop->left.get()) || reads_array(binop->right.get());
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(node)) return reads_array(unop->expr.get());
+    return false;
+}
+
+bool contains_loop(const Node* node) {
+    if (!node) return false;
+    if (dynamic_cast<const ForStatement*>(node)) return true;
+    if (auto sl = dynamic_cast<const StatementList*>(node)) {
+        for (const auto& stmt : sl->statements) {
+            if (contains_loop(stmt.get())) return true;
+        }
+        return false;
+    }
+    if (auto if_stmt = dynamic_cast<const IfStatement*>(node)) {
+        return contains_loop(if_stmt->if_body.get()) || contains_loop(if_stmt->else_body.get());
+    }
+    if (auto block = dynamic_cast<const Block*>(node)) {
+        return contains_loop(block->statement_list.get());
+    }
+    return false;
+}
+
+int node_count(const Node* node) {
+    if (!node) return 0;
+    if (auto sl = dynamic_cast<const StatementList*>(node)) {
+        int count = 0;
+        for (const auto& stmt : sl->statements) count += node_count(stmt.get());
+        return count;
+    }
+    if (auto decl = dynamic_cast<const Declaration*>(node)) return 1 + node_count(decl->expr.get());
+    if (auto assign = dynamic_cast<const Assignment*>(node)) return 1 + node_count(assign->expr.get());
+    if (auto store = dynamic_cast<const ArrayAssignment*>(node)) {
+        return 1 + node_count(store->index.get()) + node_count(store->expr.get());
+    }
+    if (auto vector = dynamic_cast<const VectorAssignment*>(node)) return node_count(vector->store.get());
+    if (auto access = dynamic_cast<const ArrayAccess*>(node)) return 1 + node_count(access->index.get());
+    if (auto if_stmt = dynamic_cast<const IfStatement*>(node)) {
+        return 1 + node_count(if_stmt->condition.get()) + node_count(if_stmt->if_body.get())
+                 + node_count(if_stmt->else_body.get());
+    }
+    if (auto for_stmt = dynamic_cast<const ForStatement*>(node)) {
+        return 1 + node_count(for_stmt->init.get()) + node_count(for_stmt->condition.get())
+                 + node_count(for_stmt->increment.get()) + node_count(for_stmt->body.get());
+    }
+    if (auto block = dynamic_cast<const Block*>(node)) return node_count(block->statement_list.get());
+    if (auto binop = dynamic_cast<const BinaryOp*>(node)) {
+        return 1 + node_count(binop->left.get()) + node_count(binop->right.get());
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(node)) return 1 + node_count(unop->expr.get());
+    return 1; // Number, Identifier, IncrementStatement
+}
+
+/******************************************************************
+ * Constant evaluation
+ ******************************************************************/
+
+bool evaluate_constant(const Expression* expr, long long& value) {
+    if (auto num = dynamic_cast<const Number*>(expr)) {
+        value = static_cast<long long>(num->value);
+        return true;
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(expr)) {
+        long long inner;
+        if (unop->op != "-" || !evaluate_constant(unop->expr.get(), inner)) return false;
+        value = -inner;
+        return true;
+    }
+    if (auto binop = dynamic_cast<const BinaryOp*>(expr)) {
+        long long l, r;
+        if (!evaluate_constant(binop->left.get(), l) || !evaluate_constant(binop->right.get(), r)) {
+            return false;
+        }
+        if (binop->op == "+") value = l + r;
+        else if (binop->op == "-") value = l - r;
+        else if (binop->op == "*") value = l * r;
+        else if (binop->op == "/" && r != 0) value = l / r;
+        else if (binop->op == "%" && r != 0) value = l % r;
+        else if (binop->op == ">>>") value = static_cast<unsigned int>(l) >> r;
+        else return false;
+        return true;
+    }
+    return false;
+}
+
+bool evaluate_condition(const BinaryOp* cond, bool& result) {
+    long long l, r;
+    if (!cond || !evaluate_constant(cond->left.get(), l) || !evaluate_constant(cond->right.get(), r)) {
+        return false;
+    }
+    if (cond->op == "<") result = l < r;
+    else if (cond->op == "<=") result = l <= r;
+    else if (cond->op == ">") result = l > r;
+    else if (cond->op == ">=") result = l >= r;
+    else if (cond->op == "==") result = l == r;
+    else if (cond->op == "!=") result = l != r;
+    else return false;
+    return true;
+}
+
+/******************************************************************
+ * Induction variables
+ ******************************************************************/
+
+// Returns the step of an increment statement on `var`, or 0 if it is not
+// of the form var++, var--, var = var + c or var = var - c.
+static long long increment_step(const Statement* inc, const std::string& var) {
+    if (auto incdec = dynamic_cast<const IncrementStatement*>(inc)) {
+        if (incdec->id != var) return 0;
+        return incdec->op == "++" ? 1 : -1;
+    }
+    auto assign = dynamic_cast<const Assignment*>(inc);
+    if (!assign || assign->id != var) return 0;
+    auto binop = dynamic_cast<const BinaryOp*>(assign->expr.get());
+    if (!binop || (binop->op != "+" && binop->op != "-")) return 0;
+
+    long long c;
+    auto left_id = dynamic_cast<const Identifier*>(binop->left.get());
+    auto right_id = dynamic_cast<const Identifier*>(binop->right.get());
+    if (left_id && left_id->name == var && evaluate_constant(binop->right.get(), c)) {
+        return binop->op == "+" ? c : -c;
+    }
+    if (binop->op == "+" && right_id && right_id->name == var && evaluate_constant(binop->left.get(), c)) {
+        return c;
+    }
+    return 0;
+}
+
+static std::string swap_comparison(const std::string& op) {
+    if (op == "<") return ">";
+    if (op == ">") return "<";
+    if (op == "<=") return ">=";
+    if (op == ">=") return "<=";
+    return op;
+}
+
+long long compute_trip_count(long long start, const std::string& op, long long bound, long long step) {
+    if (op == "<") {
+        if (step <= 0) return start < bound ? -1 : 0;
+        return start < bound ? (bound - start + step - 1) / step : 0;
+    }
+    if (op == "<=") {
+        if (step <= 0) return start <= bound ? -1 : 0;
+        return start <= bound ? (bound - start) / step + 1 : 0;
+    }
+    if (op == ">") {
+        if (step >= 0) return start > bound ? -1 : 0;
+        return start > bound ? (start - bound - step - 1) / -step : 0;
+    }
+    if (op == ">=") {
+        if (step >= 0) return start >= bound ? -1 : 0;
+        return start >= bound ? (start - bound) / -step + 1 : 0;
+    }
+    if (op == "!=") {
+        long long distance = bound - start;
+        if (distance % step != 0 || distance / step < 0) return -1;
+        return distance / step;
+    }
+    return -1;
+}
+
+bool match_induction_variable(const ForStatement* loop, InductionVariable& iv) {
+    const BinaryOp* cond = loop->condition.get();
+    if (!cond || !loop->increment) return false;
+
+    // Find the induction variable on either side of the condition
+    auto left_id = dynamic_cast<const Identifier*>(cond->left.get());
+    auto right_id = dynamic_cast<const Identifier*>(cond->right.get());
+    if (left_id && increment_step(loop->increment.get(), left_id->name) != 0) {
+        iv.var = left_id->name;
+        iv.op = cond->op;
+        iv.bound = cond->right.get();
+    } else if (right_id && increment_step(loop->increment.get(), right_id->name) != 0) {
+        iv.var = right_id->name;
+        iv.op = swap_comparison(cond->op);
+        iv.bound = cond->left.get();
+    } else {
+        return false;
+    }
+    iv.step = increment_step(loop->increment.get(), iv.var);
+
+    // The body may not touch the induction variable, and the bound must not
+    // change while the loop runs.
+    std::set<std::string> assigned;
+    collect_assigned(loop->body.get(), assigned);
+    if (assigned.count(iv.var)) return false;
+    collect_assigned(loop->increment.get(), assigned);
+    std::set<std::string> bound_uses;
+    collect_used(iv.bound, bound_uses);
+    for (const auto& name : bound_uses) {
+        if (assigned.count(name)) return false;
+    }
+
+    iv.start = nullptr;
+    if (auto assign = dynamic_cast<const Assignment*>(loop->init.get())) {
+        if (assign->id == iv.var) iv.start = assign->expr.get();
+    } else if (auto decl = dynamic_cast<const Declaration*>(loop->init.get())) {
+        if (decl->id == iv.var) iv.start = decl->expr.get();
+    }
+    return true;
+}
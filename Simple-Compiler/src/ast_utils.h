@@ -0,0 +1,58 @@
+#ifndef AST_UTILS_H
+#define AST_UTILS_H
+
+#include "ast.h"
+#include <set>
+#include <string>
+#include <memory>
+
+// Deep copies of AST subtrees. Passes that duplicate code (unrolling,
+// versioning) need fresh nodes because the tree owns its children.
+std::unique_ptr<Expression> clone_expression(const Expression* expr);
+std::unique_ptr<Statement> clone_statement(const Statement* stmt);
+std::unique_ptr<StatementList> clone_statement_list(const StatementList* list);
+std::unique_ptr<BinaryOp> clone_condition(const BinaryOp* cond);
+
+// Collects every variable written by a statement (assignments, ++/--,
+// and declarations, which re-initialize their variable on each execution).
+// A store to an array element counts as a write of the array.
+void collect_assigned(const Node* node, std::set<std::string>& out);
+
+// Collects every variable read by an expression or statement, including
+// the arrays whose elements it reads.
+void collect_used(const Node* node, std::set<std::string>& out);
+
+// True if the statement or expression (recursively) reads an array element.
+bool reads_array(const Node* node);
+
+// True if the statement (recursively) contains a for loop.
+bool contains_loop(const Node* node);
+
+// Number of AST nodes in a subtree; used as a code-size estimate.
+int node_count(const Node* node);
+
+// Evaluates an expression made only of numbers and arithmetic.
+// Returns false if the expression depends on a variable.
+bool evaluate_constant(const Expression* expr, long long& value);
+
+// Evaluates a comparison whose operands are both constant.
+bool evaluate_condition(const BinaryOp* cond, bool& result);
+
+// A for loop of the form
+//   for (var = start; var op bound; var += step) body
+// where the body never writes `var` and `bound` is loop-invariant.
+struct InductionVariable {
+    std::string var;
+    std::string op;          // Comparison with the induction variable on the left
+    long long step;          // Added to the variable on each iteration
+    const Expression* bound; // Loop-invariant right-hand side of the condition
+    const Expression* start; // Value assigned by the init statement, or nullptr
+};
+
+bool match_induction_variable(const ForStatement* loop, InductionVariable& iv);
+
+// Number of iterations of `for (v = start; v op bound; v += step)`,
+// or -1 if the loop does not terminate in a simple way.
+long long compute_trip_count(long long start, const std::string& op, long long bound, long long step);
+
+#endif // AST_UTILS_H
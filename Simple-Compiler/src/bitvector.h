@@ -0,0 +1,55 @@
+#ifndef BITVECTOR_H
+#define BITVECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size set of small integers packed 64 per word. Dataflow passes use
+// one per block, so union and difference work a word at a time.
+class BitVector {
+public:
+    explicit BitVector(size_t bits = 0) : bit_count(bits), words((bits + 63) / 64, 0) {}
+
+    size_t size() const { return bit_count; }
+    bool test(size_t bit) const { return (words[bit >> 6] >> (bit & 63)) & 1; }
+    void set(size_t bit) { words[bit >> 6] |= uint64_t(1) << (bit & 63); }
+    void reset(size_t bit) { words[bit >> 6] &= ~(uint64_t(1) << (bit & 63)); }
+
+    // this |= other; returns true if any bit was added
+    bool union_with(const BitVector& other) {
+        bool changed = false;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t merged = words[i] | other.words[i];
+            changed |= merged != words[i];
+            words[i] = merged;
+        }
+        return changed;
+    }
+
+    // this &= ~other
+    void subtract(const BitVector& other) {
+        for (size_t i = 0; i < words.size(); ++i) words[i] &= ~other.words[i];
+    }
+
+    bool operator==(const BitVector& other) const { return words == other.words; }
+    bool operator!=(const BitVector& other) const { return words != other.words; }
+
+    // Calls f(bit) for every set bit in increasing order
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t word = words[i];
+            while (word) {
+                f(i * 64 + __builtin_ctzll(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+private:
+    size_t bit_count;
+    std::vector<uint64_t> words;
+};
+
+#endif // BITVECTOR_H
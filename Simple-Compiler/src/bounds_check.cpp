@@ -0,0 +1,227 @@
+#include "bounds_check.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <set>
+#include <utility>
+
+BoundsCheckEliminator::BoundsCheckEliminator()
+    : checks(0), constant(0), repeated(0), induction(0), code(nullptr) {}
+
+static long long constant_value(const std::string& operand) {
+    return static_cast<int32_t>(static_cast<uint32_t>(std::stoll(operand)));
+}
+
+static bool fits_int(long long value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+// `instr` is `dest = from + c`, `dest = c + from` or `dest = from - c`
+static bool is_step(const TacInstr& instr, const std::string& from, long long& step) {
+    if (instr.kind != TacOp::Assign) return false;
+    if (instr.op == "+" && instr.arg1 == from && is_constant(instr.arg2)) step = constant_value(instr.arg2);
+    else if (instr.op == "+" && instr.arg2 == from && is_constant(instr.arg1)) step = constant_value(instr.arg1);
+    else if (instr.op == "-" && instr.arg1 == from && is_constant(instr.arg2)) step = -constant_value(instr.arg2);
+    else return false;
+    return true;
+}
+
+bool BoundsCheckEliminator::in_bounds(const Range& range, const std::string& array) const {
+    auto found = array_size.find(array);
+    return found != array_size.end() && range.low >= 0 && range.high < found->second;
+}
+
+void BoundsCheckEliminator::remove_constant_and_repeated() {
+    std::set<std::pair<std::string, std::string>> checked; // Index and array, since the last label
+    for (size_t i = 0; i < code->size(); ++i) {
+        const TacInstr& instr = (*code)[i];
+        if (instr.kind == TacOp::Label) {
+            checked.clear();
+            continue;
+        }
+        if (instr.kind != TacOp::BoundsCheck) {
+            if (instr.dest.empty()) continue;
+            for (auto it = checked.begin(); it != checked.end();) {
+                it = it->first == instr.dest ? checked.erase(it) : std::next(it);
+            }
+            continue;
+        }
+        ++checks;
+        if (is_constant(instr.arg1)) {
+            long long index = constant_value(instr.arg1);
+            if (in_bounds({index, index}, instr.array)) {
+                removed[i] = true;
+                ++constant;
+            }
+        } else if (!checked.insert({instr.arg1, instr.array}).second) {
+            removed[i] = true;
+            ++repeated;
+        }
+    }
+}
+
+// The range of a temp the check at `check` reads, if it was computed from
+// the counter earlier in the same straight-line run
+bool BoundsCheckEliminator::derived_range(int check, int header, const std::string& index,
+                                          const std::string& counter, int increment, const Range& before,
+                                          const Range& after, Range& range) const {
+    const std::vector<TacInstr>& listing = *code;
+    for (int p = check - 1; p > header; --p) {
+        const TacInstr& instr = listing[p];
+        if (instr.kind == TacOp::Label || instr.is_jump()) return false;
+        if (instr.dest != index) continue;
+        if (instr.kind != TacOp::Assign || instr.arg2.empty()) return false;
+        const Range& from = p < increment ? before : after;
+        bool left = instr.arg1 == counter && is_constant(instr.arg2);
+        bool right = instr.arg2 == counter && is_constant(instr.arg1);
+        if (!left && !right) return false;
+        long long k = constant_value(left ? instr.arg2 : instr.arg1);
+        if (instr.op == "+") {
+            range = {from.low + k, from.high + k};
+        } else if (instr.op == "-") {
+            range = left ? Range{from.low - k, from.high - k} : Range{k - from.high, k - from.low};
+        } else if (instr.op == "*") {
+            range = k >= 0 ? Range{from.low * k, from.high * k} : Range{from.high * k, from.low * k};
+        } else {
+            return false;
+        }
+        // A result that wraps around is not in the range
+        return fits_int(range.low) && fits_int(range.high);
+    }
+    return false;
+}
+
+void BoundsCheckEliminator::remove_in_loop(int back_edge) {
+    const std::vector<TacInstr>& listing = *code;
+    const TacInstr& test = listing[back_edge];
+    auto header_found = label_at.find(test.label);
+    if (header_found == label_at.end() || header_found->second >= back_edge || header_found->second == 0) return;
+    const int header = header_found->second;
+
+    // IF v op B with the counter on the left
+    std::string counter, op;
+    long long bound;
+    static const std::map<std::string, std::string> swapped = {{"<", ">"}, {"<=", ">="}, {">", "<"}, {">=", "<="}};
+    if (!swapped.count(test.op)) return;
+    if (is_constant(test.arg2) && is_temporary_name(test.arg1)) {
+        counter = test.arg1;
+        op = test.op;
+        bound = constant_value(test.arg2);
+    } else if (is_constant(test.arg1) && is_temporary_name(test.arg2)) {
+        counter = test.arg2;
+        op = swapped.at(test.op);
+        bound = constant_value(test.arg1);
+    } else {
+        return;
+    }
+
+    // The header is entered by falling into it and by the back edge only,
+    // and the body only from the header
+    for (size_t q = 0; q < listing.size(); ++q) {
+        const TacInstr& instr = listing[q];
+        int at = static_cast<int>(q);
+        if (!instr.is_jump() || at == back_edge) continue;
+        auto target_found = label_at.find(instr.label);
+        if (target_found == label_at.end()) return;
+        int target = target_found->second;
+        bool inside = at > header && at < back_edge;
+        if (target == header || (!inside && target > header && target < back_edge)) return;
+    }
+
+    // One write of the counter, `v = v + c`, or `v = x` after `x = v + c`
+    int write = -1;
+    for (int i = header + 1; i < back_edge; ++i) {
+        if (listing[i].dest != counter) continue;
+        if (write >= 0) return;
+        write = i;
+    }
+    if (write < 0) return;
+    long long step = 0;
+    if (!is_step(listing[write], counter, step)) {
+        const TacInstr& copy = listing[write];
+        if (copy.kind != TacOp::Assign || !copy.op.empty() || !is_temporary_name(copy.arg1)) return;
+        int p = write - 1;
+        while (p > header && listing[p].dest != copy.arg1 && listing[p].kind != TacOp::Label &&
+               !listing[p].is_jump()) {
+            --p;
+        }
+        if (p <= header || !is_step(listing[p], counter, step)) return;
+    }
+    bool increasing = op == "<" || op == "<=";
+    if (step == 0 || (step > 0) != increasing) return;
+
+    // The write runs once on every iteration: no jump inside the loop skips
+    // it or goes back above it
+    for (int i = header + 1; i < back_edge; ++i) {
+        if (!listing[i].is_jump()) continue;
+        int target = label_at.at(listing[i].label);
+        if (i < write && target > write) return;
+        if (i > write && target < write && target > header) return;
+    }
+
+    // The counter's constant value on entry, set in the straight-line run
+    // that falls into the header
+    long long start = 0;
+    bool found_start = false;
+    for (int i = header - 1; i >= 0; --i) {
+        const TacInstr& instr = listing[i];
+        if (instr.kind == TacOp::Label || instr.is_jump()) return;
+        if (instr.dest != counter) continue;
+        if (instr.kind != TacOp::Assign || !instr.op.empty() || !is_constant(instr.arg1)) return;
+        start = constant_value(instr.arg1);
+        found_start = true;
+        break;
+    }
+    if (!found_start) return;
+
+    Range before;
+    if (increasing) {
+        long long last = op == "<" ? bound - 1 : bound;
+        before = {start, std::max(start, last)};
+    } else {
+        long long last = op == ">" ? bound + 1 : bound;
+        before = {std::min(start, last), start};
+    }
+    Range after = {before.low + step, before.high + step};
+    if (!fits_int(after.low) || !fits_int(after.high)) return;
+
+    for (int i = header + 1; i < back_edge; ++i) {
+        const TacInstr& instr = listing[i];
+        if (instr.kind != TacOp::BoundsCheck || removed[i]) continue;
+        Range range;
+        if (instr.arg1 == counter) {
+            range = i < write ? before : after;
+        } else if (!derived_range(i, header, instr.arg1, counter, write, before, after, range)) {
+            continue;
+        }
+        if (in_bounds(range, instr.array)) {
+            removed[i] = true;
+            ++induction;
+        }
+    }
+}
+
+void BoundsCheckEliminator::run(std::vector<TacInstr>& listing) {
+    code = &listing;
+    checks = constant = repeated = induction = 0;
+    array_size.clear();
+    label_at.clear();
+    removed.assign(listing.size(), false);
+    for (size_t i = 0; i < listing.size(); ++i) {
+        const TacInstr& instr = listing[i];
+        if (instr.kind == TacOp::ArrayDecl) array_size[instr.array] = std::stoll(instr.arg1);
+        if (instr.kind == TacOp::Label) label_at[instr.label] = static_cast<int>(i);
+    }
+    if (array_size.empty()) return;
+
+    remove_constant_and_repeated();
+    for (size_t i = 0; i < listing.size(); ++i) {
+        if (listing[i].kind == TacOp::IfGoto) remove_in_loop(static_cast<int>(i));
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < listing.size(); ++i) {
+        if (!removed[i]) listing[kept++] = listing[i];
+    }
+    listing.resize(kept);
+}
@@ -0,0 +1,58 @@
+#ifndef BOUNDS_CHECK_H
+#define BOUNDS_CHECK_H
+
+#include "ir.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Removes `BOUNDS i, a` checks that can never fail. Three cases:
+//
+//  - a constant index inside the array;
+//  - a repeat of a check on the same index and array earlier in the same
+//    straight-line run, with the index not written in between;
+//  - an index whose range is known from a counting loop. A bottom-tested
+//    loop
+//
+//        v = K  L: ...  v = v + c  ...  IF v < B GOTO L
+//
+//    with constant K, c and B, whose header only the back edge jumps to,
+//    into whose body nothing outside jumps, and which writes v once, on
+//    every iteration, keeps v within [K, B - 1] above the increment and
+//    within [K + c, B - 1 + c] below it (the decreasing forms with > and
+//    >= likewise). A temp set from v by adding, subtracting or multiplying
+//    a constant, and checked later in the same straight-line run, has the
+//    range v had there shifted or scaled.
+//
+// Loops whose increment could wrap around are left alone, so every range
+// is exact. Runs after algebraic simplification, which has propagated the
+// copies that would otherwise hide the counter.
+class BoundsCheckEliminator {
+public:
+    BoundsCheckEliminator();
+    void run(std::vector<TacInstr>& code);
+
+    int checks;     // BOUNDS instructions seen
+    int constant;   // Removed for a constant index
+    int repeated;   // Removed as a repeat
+    int induction;  // Removed for a loop counter or a temp derived from one
+
+private:
+    struct Range {
+        long long low, high;
+    };
+
+    std::vector<TacInstr>* code;
+    std::map<std::string, long long> array_size;
+    std::unordered_map<std::string, int> label_at;
+    std::vector<bool> removed;
+
+    bool in_bounds(const Range& range, const std::string& array) const;
+    void remove_constant_and_repeated();
+    void remove_in_loop(int back_edge);
+    bool derived_range(int check, int header, const std::string& index, const std::string& counter,
+                       int increment, const Range& before, const Range& after, Range& range) const;
+};
+
+#endif // BOUNDS_CHECK_H
@@ -0,0 +1,354 @@
+#include "bytecode.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <map>
+#include <stdexcept>
+
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+namespace {
+
+const size_t kMaxField = UINT16_MAX;
+
+// Hands out slots: program variables first, so they can be read back by
+// index after the run, then everything else as it is met.
+class SlotTable {
+public:
+    explicit SlotTable(BytecodeProgram& program) : program(program) {}
+
+    void add_variable(const std::string& name) {
+        if (name.empty() || is_constant(name) || is_temporary_name(name) || is_local_name(name)) return;
+        if (program.slot_of.count(name)) return;
+        program.slot_of[name] = new_slot(0);
+        program.variables.push_back(name);
+    }
+
+    uint16_t operator[](const std::string& operand) {
+        auto found = program.slot_of.find(operand);
+        if (found != program.slot_of.end()) return found->second;
+        int32_t value = 0;
+        if (is_constant(operand)) value = static_cast<int32_t>(std::stoll(operand));
+        uint16_t slot = new_slot(value);
+        program.slot_of[operand] = slot;
+        return slot;
+    }
+
+private:
+    BytecodeProgram& program;
+
+    uint16_t new_slot(int32_t value) {
+        if (program.initial_slots.size() >= kMaxField) {
+            throw std::runtime_error("IR Error: Too many values for the bytecode VM.");
+        }
+        program.initial_slots.push_back(value);
+        return static_cast<uint16_t>(program.initial_slots.size() - 1);
+    }
+};
+
+VmOp arithmetic_op(const std::string& op) {
+    static const std::map<std::string, VmOp> ops = {
+        {"+", VmOp::Add},        {"-", VmOp::Sub},          {"*", VmOp::Mul},
+        {"/", VmOp::Div},        {"%", VmOp::Mod},          {">>>", VmOp::ShiftRight},
+        {"<", VmOp::Less},       {"<=", VmOp::LessEqual},   {">", VmOp::Greater},
+        {">=", VmOp::GreaterEqual}, {"==", VmOp::Equal},    {"!=", VmOp::NotEqual},
+    };
+    auto found = ops.find(op);
+    if (found == ops.end()) throw std::runtime_error("IR Error: Unknown operator '" + op + "' in bytecode.");
+    return found->second;
+}
+
+VmOp jump_op(const std::string& op) {
+    static const std::map<std::string, VmOp> ops = {
+        {"<", VmOp::JumpLess},        {"<=", VmOp::JumpLessEqual}, {">", VmOp::JumpGreater},
+        {">=", VmOp::JumpGreaterEqual}, {"==", VmOp::JumpEqual},   {"!=", VmOp::JumpNotEqual},
+    };
+    auto found = ops.find(op);
+    if (found == ops.end()) throw std::runtime_error("IR Error: Unknown comparison '" + op + "' in bytecode.");
+    return found->second;
+}
+
+VmOp vector_op(const std::string& op) {
+    if (op == "+") return VmOp::VectorAdd;
+    if (op == "-") return VmOp::VectorSub;
+    if (op == "*") return VmOp::VectorMul;
+    throw std::runtime_error("IR Error: Unknown vector operator '" + op + "' in bytecode.");
+}
+
+// dest = x op y in each lane, wrapping
+void lanewise(VmOp op, int32_t* dest, const int32_t* x, const int32_t* y, int lanes) {
+    for (int lane = 0; lane < lanes; ++lane) {
+        uint32_t left = static_cast<uint32_t>(x[lane]), right = static_cast<uint32_t>(y[lane]);
+        uint32_t result = op == VmOp::VectorAdd ? left + right : op == VmOp::VectorSub ? left - right : left * right;
+        dest[lane] = static_cast<int32_t>(result);
+    }
+}
+
+} // namespace
+
+// One pass emits the instructions with jump targets still as labels, then
+// the targets are patched to instruction indices. Labels emit nothing,
+// except that a loop header gets its LoopHeader when loops are counted.
+BytecodeProgram compile_bytecode(const std::vector<TacInstr>& code, bool count_loops) {
+    BytecodeProgram program;
+    SlotTable slots(program);
+    std::map<std::string, size_t> label_position;
+    std::map<std::string, uint16_t> array_number;
+    for (size_t i = 0; i < code.size(); ++i) {
+        slots.add_variable(code[i].dest);
+        slots.add_variable(code[i].arg1);
+        slots.add_variable(code[i].arg2);
+        if (code[i].kind == TacOp::Label) label_position[code[i].label] = i;
+        if (code[i].kind == TacOp::ArrayDecl) {
+            array_number[code[i].array] = static_cast<uint16_t>(program.arrays.size());
+            program.arrays.push_back({code[i].array, static_cast<size_t>(std::stoll(code[i].arg1))});
+        }
+    }
+    auto array = [&array_number](const std::string& name) {
+        auto found = array_number.find(name);
+        if (found == array_number.end()) throw std::runtime_error("IR Error: Undeclared array " + name + " in bytecode.");
+        return found->second;
+    };
+    auto vector = [&program](const TacInstr& instr, int reg) {
+        if (program.lanes != 0 && program.lanes != instr.lanes) {
+            throw std::runtime_error("IR Error: Vector instructions of different widths in bytecode.");
+        }
+        if (reg < 0 || reg >= kVectorRegisters) {
+            throw std::runtime_error("IR Error: Vector register %v" + std::to_string(reg) + " out of range in bytecode.");
+        }
+        program.lanes = instr.lanes;
+        return static_cast<uint16_t>(reg);
+    };
+
+    // A jump to an earlier label closes a loop; the last one decides its extent
+    std::map<size_t, size_t> loop_number; // Header TAC index -> loop
+    if (count_loops) {
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (!code[i].is_jump()) continue;
+            auto header = label_position.find(code[i].label);
+            if (header == label_position.end() || header->second > i) continue;
+            auto [found, inserted] = loop_number.emplace(header->second, program.loops.size());
+            if (inserted) {
+                program.loops.push_back({header->second, i});
+            } else {
+                program.loops[found->second].back_edge = i;
+            }
+        }
+    }
+
+    std::vector<std::pair<size_t, std::string>> pending_jumps;
+    for (size_t i = 0; i < code.size(); ++i) {
+        const TacInstr& instr = code[i];
+        program.instruction_of.push_back(program.code.size());
+        VmInstr out{VmOp::Halt, 0, 0, 0};
+        switch (instr.kind) {
+        case TacOp::Label: {
+            program.labels[instr.label] = program.code.size();
+            auto loop = loop_number.find(i);
+            if (loop == loop_number.end()) continue;
+            out = {VmOp::LoopHeader, static_cast<uint16_t>(loop->second), 0, 0};
+            break;
+        }
+        case TacOp::Goto:
+            out.op = VmOp::Jump;
+            pending_jumps.push_back({program.code.size(), instr.label});
+            break;
+        case TacOp::IfGoto:
+            out = {jump_op(instr.op), 0, slots[instr.arg1], slots[instr.arg2]};
+            pending_jumps.push_back({program.code.size(), instr.label});
+            break;
+        case TacOp::Assign:
+            if (instr.op.empty()) {
+                out = {VmOp::Move, slots[instr.dest], slots[instr.arg1], 0};
+            } else if (instr.is_unary()) {
+                if (instr.op != "-") throw std::runtime_error("IR Error: Unknown operator '" + instr.op + "' in bytecode.");
+                out = {VmOp::Negate, slots[instr.dest], slots[instr.arg1], 0};
+            } else {
+                out = {arithmetic_op(instr.op), slots[instr.dest], slots[instr.arg1], slots[instr.arg2]};
+            }
+            break;
+        case TacOp::Mov:
+            out = {VmOp::Move, slots[instr.dest], slots[instr.arg1], 0};
+            break;
+        case TacOp::Add:
+        case TacOp::Sub:
+            out = {instr.kind == TacOp::Add ? VmOp::Add : VmOp::Sub, slots[instr.dest], slots[instr.arg1],
+                   slots[instr.arg2]};
+            break;
+        case TacOp::CondMove:
+            out = {VmOp::CondMove, slots[instr.dest], slots[instr.arg1], slots[instr.arg2]};
+            break;
+        case TacOp::ArrayDecl:
+            continue;
+        case TacOp::Load:
+            out = {VmOp::Load, slots[instr.dest], slots[instr.arg1], array(instr.array)};
+            break;
+        case TacOp::Store:
+            out = {VmOp::Store, array(instr.array), slots[instr.arg1], slots[instr.arg2]};
+            break;
+        case TacOp::BoundsCheck:
+            out = {VmOp::BoundsCheck, array(instr.array), slots[instr.arg1], 0};
+            break;
+        case TacOp::VectorLoad:
+            out = {VmOp::VectorLoad, vector(instr, instr.vdest), slots[instr.arg1], array(instr.array)};
+            break;
+        case TacOp::VectorStore:
+            out = {VmOp::VectorStore, array(instr.array), slots[instr.arg1], vector(instr, instr.vsrc1)};
+            break;
+        case TacOp::VectorSplat:
+            out = {VmOp::VectorSplat, vector(instr, instr.vdest), slots[instr.arg1], 0};
+            break;
+        case TacOp::VectorOp:
+            out = {vector_op(instr.op), vector(instr, instr.vdest), vector(instr, instr.vsrc1),
+                   vector(instr, instr.vsrc2)};
+            break;
+        }
+        program.code.push_back(out);
+    }
+    program.instruction_of.push_back(program.code.size());
+    program.code.push_back({VmOp::Halt, 0, 0, 0});
+    if (program.code.size() > kMaxField) {
+        throw std::runtime_error("IR Error: Program too long for the bytecode VM.");
+    }
+
+    for (const auto& [index, label] : pending_jumps) {
+        auto found = program.labels.find(label);
+        if (found == program.labels.end()) throw std::runtime_error("IR Error: Jump to undefined label " + label);
+        program.code[index].a = static_cast<uint16_t>(found->second);
+    }
+    return program;
+}
+
+BytecodeVM::BytecodeVM() : pc(0), run_microseconds(0) {}
+
+void BytecodeVM::run(const BytecodeProgram& program) {
+    auto start_time = std::chrono::steady_clock::now();
+    start(program);
+    // Nobody is listening for hot loops: skip the header and go on
+    while (resume(program) >= 0) {
+        loop_budget[program.code[pc].a] = UINT32_MAX;
+        ++pc;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    run_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    collect_values(program);
+}
+
+void BytecodeVM::start(const BytecodeProgram& program) {
+    slots = program.initial_slots;
+    arrays.clear();
+    for (const auto& [name, size] : program.arrays) arrays.emplace_back(size, 0);
+    vectors.assign(kVectorRegisters * std::max(program.lanes, 1), 0);
+    loop_budget.assign(program.loops.size(), UINT32_MAX);
+    pc = 0;
+}
+
+void BytecodeVM::collect_values(const BytecodeProgram& program) {
+    values.clear();
+    for (size_t i = 0; i < program.variables.size(); ++i) values.push_back({program.variables[i], slots[i]});
+}
+
+int BytecodeVM::resume(const BytecodeProgram& program) {
+    int32_t* s = slots.data();
+    uint32_t* budget = loop_budget.data();
+    const VmInstr* base = program.code.data();
+    const VmInstr* ip = base + this->pc;
+    std::vector<int32_t>* a = arrays.data();
+
+    // Wrapping arithmetic is done on uint32_t; signed overflow is undefined
+    auto wrap = [](uint32_t value) { return static_cast<int32_t>(value); };
+    auto u = [s](uint16_t slot) { return static_cast<uint32_t>(s[slot]); };
+    auto check_divisor = [s](const VmInstr* instr) {
+        if (s[instr->c] == 0) throw std::runtime_error("Runtime Error: Division by zero.");
+        if (s[instr->b] == INT32_MIN && s[instr->c] == -1) throw std::runtime_error("Runtime Error: Division overflow.");
+    };
+    auto element = [s, a](uint16_t array, uint16_t index) -> int32_t& {
+        std::vector<int32_t>& elements = a[array];
+        if (static_cast<uint32_t>(s[index]) >= elements.size()) {
+            throw std::runtime_error("Runtime Error: Array index out of bounds.");
+        }
+        return elements[static_cast<uint32_t>(s[index])];
+    };
+    // A vector register, and the `lanes` elements from an index on
+    const int lanes = program.lanes;
+    int32_t* vectors = this->vectors.data();
+    auto v = [vectors, lanes](uint16_t reg) { return vectors + reg * lanes; };
+    auto elements = [s, a, lanes](uint16_t array, uint16_t index) {
+        std::vector<int32_t>& elements = a[array];
+        uint32_t first = static_cast<uint32_t>(s[index]);
+        if (first >= elements.size() || elements.size() - first < static_cast<size_t>(lanes)) {
+            throw std::runtime_error("Runtime Error: Array index out of bounds.");
+        }
+        return elements.data() + first;
+    };
+
+#ifdef VM_COMPUTED_GOTO
+    // In VmOp order
+    static void* const dispatch[] = {
+        &&op_Move,      &&op_Negate,       &&op_Add,      &&op_Sub,          &&op_Mul,
+        &&op_Div,       &&op_Mod,          &&op_ShiftRight, &&op_Less,       &&op_LessEqual,
+        &&op_Greater,   &&op_GreaterEqual, &&op_Equal,    &&op_NotEqual,     &&op_CondMove,
+        &&op_Load,      &&op_Store,        &&op_BoundsCheck,
+        &&op_VectorLoad, &&op_VectorStore, &&op_VectorSplat, &&op_VectorAdd, &&op_VectorSub, &&op_VectorMul,
+        &&op_Jump,      &&op_JumpLess,     &&op_JumpLessEqual, &&op_JumpGreater, &&op_JumpGreaterEqual,
+        &&op_JumpEqual, &&op_JumpNotEqual, &&op_LoopHeader, &&op_Halt,
+    };
+#define VM_CASE(name) op_##name:
+#define VM_NEXT() goto *dispatch[static_cast<uint8_t>(ip->op)]
+    VM_NEXT();
+#else
+#define VM_CASE(name) case VmOp::name:
+#define VM_NEXT() continue
+    for (;;) {
+        switch (ip->op) {
+#endif
+    VM_CASE(Move) s[ip->a] = s[ip->b]; ++ip; VM_NEXT();
+    VM_CASE(Negate) s[ip->a] = wrap(0u - u(ip->b)); ++ip; VM_NEXT();
+    VM_CASE(Add) s[ip->a] = wrap(u(ip->b) + u(ip->c)); ++ip; VM_NEXT();
+    VM_CASE(Sub) s[ip->a] = wrap(u(ip->b) - u(ip->c)); ++ip; VM_NEXT();
+    VM_CASE(Mul) s[ip->a] = wrap(u(ip->b) * u(ip->c)); ++ip; VM_NEXT();
+    VM_CASE(Div) check_divisor(ip); s[ip->a] = s[ip->b] / s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(Mod) check_divisor(ip); s[ip->a] = s[ip->b] % s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(ShiftRight) s[ip->a] = wrap(u(ip->b) >> (u(ip->c) & 31)); ++ip; VM_NEXT();
+    VM_CASE(Less) s[ip->a] = s[ip->b] < s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(LessEqual) s[ip->a] = s[ip->b] <= s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(Greater) s[ip->a] = s[ip->b] > s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(GreaterEqual) s[ip->a] = s[ip->b] >= s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(Equal) s[ip->a] = s[ip->b] == s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(NotEqual) s[ip->a] = s[ip->b] != s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(CondMove) if (s[ip->b] != 0) s[ip->a] = s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(Load) s[ip->a] = element(ip->c, ip->b); ++ip; VM_NEXT();
+    VM_CASE(Store) element(ip->a, ip->b) = s[ip->c]; ++ip; VM_NEXT();
+    VM_CASE(BoundsCheck) element(ip->a, ip->b); ++ip; VM_NEXT();
+    VM_CASE(VectorLoad) std::copy_n(elements(ip->c, ip->b), lanes, v(ip->a)); ++ip; VM_NEXT();
+    VM_CASE(VectorStore) std::copy_n(v(ip->c), lanes, elements(ip->a, ip->b)); ++ip; VM_NEXT();
+    VM_CASE(VectorSplat) std::fill_n(v(ip->a), lanes, s[ip->b]); ++ip; VM_NEXT();
+    VM_CASE(VectorAdd) lanewise(ip->op, v(ip->a), v(ip->b), v(ip->c), lanes); ++ip; VM_NEXT();
+    VM_CASE(VectorSub) lanewise(ip->op, v(ip->a), v(ip->b), v(ip->c), lanes); ++ip; VM_NEXT();
+    VM_CASE(VectorMul) lanewise(ip->op, v(ip->a), v(ip->b), v(ip->c), lanes); ++ip; VM_NEXT();
+    VM_CASE(Jump) ip = base + ip->a; VM_NEXT();
+    VM_CASE(JumpLess) ip = s[ip->b] < s[ip->c] ? base + ip->a : ip + 1; VM_NEXT();
+    VM_CASE(JumpLessEqual) ip = s[ip->b] <= s[ip->c] ? base + ip->a : ip + 1; VM_NEXT();
+    VM_CASE(JumpGreater) ip = s[ip->b] > s[ip->c] ? base + ip->a : ip + 1; VM_NEXT();
+    VM_CASE(JumpGreaterEqual) ip = s[ip->b] >= s[ip->c] ? base + ip->a : ip + 1; VM_NEXT();
+    VM_CASE(JumpEqual) ip = s[ip->b] == s[ip->c] ? base + ip->a : ip + 1; VM_NEXT();
+    VM_CASE(JumpNotEqual) ip = s[ip->b] != s[ip->c] ? base + ip->a : ip + 1; VM_NEXT();
+    VM_CASE(LoopHeader)
+        if (--budget[ip->a] == 0) {
+            this->pc = ip - base;
+            return ip->a;
+        }
+        ++ip;
+        VM_NEXT();
+    VM_CASE(Halt)
+        this->pc = ip - base;
+        return -1;
+#ifndef VM_COMPUTED_GOTO
+        }
+    }
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+}
@@ -0,0 +1,126 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "ir.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Register-based bytecode for running TAC without generating native code.
+//
+// Every value the program touches (variable, local, temp or constant) gets
+// a slot in one flat array of 32-bit ints, and every instruction names its
+// operands by slot index. Constants are slots preloaded with their value,
+// so no instruction needs an immediate form. Instructions are fixed-width,
+// 8 bytes: an opcode and three 16-bit fields. `a` is the destination, or
+// the target instruction of a jump; `b` and `c` are the sources.
+enum class VmOp : uint8_t {
+    Move,         // a = b
+    Negate,       // a = -b
+    Add,          // a = b + c, wrapping
+    Sub,
+    Mul,
+    Div,          // Traps on a zero divisor, like idiv
+    Mod,
+    ShiftRight,   // a = b >>> c, logical
+    Less,         // a = b < c ? 1 : 0
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    CondMove,     // if b != 0: a = c
+    Load,         // a = array c [b]
+    Store,        // array a [b] = c
+    BoundsCheck,  // Runtime Error unless 0 <= b < size of array a
+    // Vector registers, BytecodeProgram::lanes ints each, numbered 0 .. kVectorRegisters - 1
+    VectorLoad,   // vector a = array c [b .. b + lanes - 1]
+    VectorStore,  // array a [b .. b + lanes - 1] = vector c
+    VectorSplat,  // vector a = b in every lane
+    VectorAdd,    // vector a = vector b + vector c, lane by lane
+    VectorSub,
+    VectorMul,
+    Jump,         // goto a
+    JumpLess,     // if b < c: goto a
+    JumpLessEqual,
+    JumpGreater,
+    JumpGreaterEqual,
+    JumpEqual,
+    JumpNotEqual,
+    LoopHeader,   // Counts an entry to loop a; see BytecodeVM::resume
+    Halt,
+};
+
+const int kVectorRegisters = 16;
+
+struct VmInstr {
+    VmOp op;
+    uint16_t a, b, c;
+};
+
+// A loop of the TAC: the label a backward jump targets, through the last
+// such jump. Only recorded when loops are counted.
+struct BytecodeLoop {
+    size_t header;    // TAC index of the label
+    size_t back_edge; // TAC index of the jump
+};
+
+struct BytecodeProgram {
+    std::vector<VmInstr> code;
+    std::vector<int32_t> initial_slots; // Constants hold their value; all else starts at 0
+    // Slots 0 .. variables.size()-1 are the program's variables, in order of
+    // first appearance; the rest are locals, temps and constants
+    std::vector<std::string> variables;
+    // Arrays, numbered as Load, Store and BoundsCheck name them
+    std::vector<std::pair<std::string, size_t>> arrays; // Name, element count
+    int lanes = 0; // Of every vector instruction; 0 if there are none
+
+    // Where the TAC went, for tiered execution
+    std::map<std::string, uint16_t> slot_of;  // Operand -> slot
+    std::map<std::string, size_t> labels;     // Label -> instruction it marks
+    std::vector<size_t> instruction_of;       // TAC index -> first instruction, plus one past the end
+    std::vector<BytecodeLoop> loops;          // Numbered as LoopHeader instructions name them
+};
+
+// Lowers TAC to bytecode. With `count_loops`, every loop header gets a
+// LoopHeader instruction. Throws an IR Error for a program with more slots
+// or instructions than 16-bit fields can name, or with vector instructions
+// of different widths or past the last vector register.
+BytecodeProgram compile_bytecode(const std::vector<TacInstr>& code, bool count_loops = false);
+
+// The interpreter. Dispatch is a computed goto through a table of label
+// addresses where the compiler supports it (GCC and Clang), so each
+// instruction ends in its own indirect jump; elsewhere it is a switch.
+// A division by zero, or of INT_MIN by -1, stops the run with a Runtime
+// Error, where the native code would trap. An array index out of bounds is
+// a Runtime Error too; Load and Store check it again even where the pass
+// that removes BOUNDS proved it cannot happen, so the VM never trusts it.
+class BytecodeVM {
+public:
+    BytecodeVM();
+    // Runs the whole program and collects its variables
+    void run(const BytecodeProgram& program);
+
+    // Step by step, for tiered execution: start() sets every slot to its
+    // initial value and pc to the first instruction. resume() runs from pc
+    // until Halt, returning -1, or until a LoopHeader uses up its loop's
+    // budget, returning the loop number with pc still on the LoopHeader.
+    // The caller may change slots, pc and budgets before resuming.
+    void start(const BytecodeProgram& program);
+    int resume(const BytecodeProgram& program);
+    void collect_values(const BytecodeProgram& program);
+
+    std::vector<int32_t> slots;
+    std::vector<std::vector<int32_t>> arrays; // Zeroed by start()
+    std::vector<int32_t> vectors; // kVectorRegisters registers of the program's lanes
+    std::vector<uint32_t> loop_budget; // Entries left before each loop is reported
+    size_t pc;
+
+    // The program's variables after the run, in layout order
+    std::vector<std::pair<std::string, int32_t>> values;
+    long long run_microseconds;
+};
+
+#endif // BYTECODE_H
@@ -0,0 +1,189 @@
+#include "cfg.h"
+#include <map>
+#include <stdexcept>
+#include <cctype>
+
+std::vector<int> BasicBlock::successors() const {
+    std::vector<int> result;
+    if (terminator != Jump && next >= 0) result.push_back(next);
+    if (terminator != FallThrough && taken >= 0 && taken != next) result.push_back(taken);
+    return result;
+}
+
+ControlFlowGraph::ControlFlowGraph(const std::vector<TacInstr>& code) : label_counter(0) {
+    std::vector<std::string> jump_targets;
+    blocks.emplace_back();
+    jump_targets.emplace_back();
+
+    auto start_block = [&]() {
+        blocks.emplace_back();
+        jump_targets.emplace_back();
+    };
+
+    for (size_t index = 0; index < code.size(); ++index) {
+        const TacInstr& instr = code[index];
+        if (instr.kind != TacOp::Label && blocks.back().position < 0) {
+            blocks.back().position = static_cast<int>(index);
+        }
+        if (instr.kind == TacOp::Label) {
+            // Remember the highest numeric label so fresh labels never clash
+            if (instr.label.size() > 1 && instr.label[0] == 'L' &&
+                isdigit(static_cast<unsigned char>(instr.label[1]))) {
+                label_counter = std::max(label_counter, std::stoi(instr.label.substr(1)));
+            }
+            if (!blocks.back().label.empty() || !blocks.back().instrs.empty()) start_block();
+            blocks.back().label = instr.label;
+        } else if (instr.is_jump()) {
+            BasicBlock& block = blocks.back();
+            block.terminator = instr.kind == TacOp::Goto ? BasicBlock::Jump : BasicBlock::CondJump;
+            block.condition = instr;
+            block.indent = instr.indent;
+            jump_targets.back() = instr.label;
+            start_block();
+        } else {
+            blocks.back().instrs.push_back(instr);
+        }
+    }
+
+    // Sink block for control leaving the program
+    start_block();
+    exit = static_cast<int>(blocks.size()) - 1;
+    entry = 0;
+
+    std::map<std::string, int> label_to_block;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (!blocks[i].label.empty()) label_to_block[blocks[i].label] = static_cast<int>(i);
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        BasicBlock& block = blocks[i];
+        if (block.terminator != BasicBlock::Jump && static_cast<int>(i) != exit) {
+            block.next = static_cast<int>(i) + 1;
+        }
+        if (block.terminator != BasicBlock::FallThrough) {
+            auto found = label_to_block.find(jump_targets[i]);
+            if (found == label_to_block.end()) {
+                throw std::runtime_error("IR Error: Jump to undefined label '" + jump_targets[i] + "'.");
+            }
+            block.taken = found->second;
+        }
+    }
+}
+
+std::string ControlFlowGraph::fresh_label() {
+    return "L" + std::to_string(++label_counter);
+}
+
+int ControlFlowGraph::live_block_count() const {
+    int count = 0;
+    for (const auto& block : blocks) {
+        if (!block.removed) count++;
+    }
+    return count;
+}
+
+std::vector<int> ControlFlowGraph::loop_depths() const {
+    std::vector<int> depth(blocks.size(), 0);
+    std::vector<std::vector<int>> preds = predecessors();
+    std::vector<int> mark(blocks.size(), -1);
+    int loop = 0;
+    for (size_t latch = 0; latch < blocks.size(); ++latch) {
+        if (blocks[latch].removed) continue;
+        for (int header : blocks[latch].successors()) {
+            if (header > static_cast<int>(latch)) continue;
+            // Natural loop: the header plus everything that reaches the
+            // latch without passing through the header
+            std::vector<int> stack = {static_cast<int>(latch)};
+            mark[header] = loop;
+            depth[header]++;
+            while (!stack.empty()) {
+                int id = stack.back();
+                stack.pop_back();
+                if (mark[id] == loop) continue;
+                mark[id] = loop;
+                depth[id]++;
+                for (int pred : preds[id]) stack.push_back(pred);
+            }
+            loop++;
+        }
+    }
+    return depth;
+}
+
+std::vector<std::vector<int>> ControlFlowGraph::predecessors() const {
+    std::vector<std::vector<int>> preds(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (blocks[i].removed) continue;
+        for (int succ : blocks[i].successors()) preds[succ].push_back(static_cast<int>(i));
+    }
+    return preds;
+}
+
+int ControlFlowGraph::remove_unreachable() {
+    std::vector<bool> reachable(blocks.size(), false);
+    std::vector<int> stack = {entry};
+    reachable[entry] = true;
+    while (!stack.empty()) {
+        int id = stack.back();
+        stack.pop_back();
+        for (int succ : blocks[id].successors()) {
+            if (!reachable[succ]) {
+                reachable[succ] = true;
+                stack.push_back(succ);
+            }
+        }
+    }
+    int removed = 0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (!reachable[i] && !blocks[i].removed && static_cast<int>(i) != exit) {
+            blocks[i].removed = true;
+            removed++;
+        }
+    }
+    return removed;
+}
+
+std::vector<TacInstr> ControlFlowGraph::linearize() {
+    std::vector<int> order;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (!blocks[i].removed) order.push_back(static_cast<int>(i));
+    }
+
+    // Decide which blocks are jumped to, and give unlabeled ones a label
+    std::vector<bool> needs_label(blocks.size(), false);
+    for (size_t pos = 0; pos < order.size(); ++pos) {
+        const BasicBlock& block = blocks[order[pos]];
+        int following = pos + 1 < order.size() ? order[pos + 1] : -1;
+        if (block.terminator == BasicBlock::CondJump) needs_label[block.taken] = true;
+        if (block.terminator == BasicBlock::Jump && block.taken != following) needs_label[block.taken] = true;
+        if (block.terminator != BasicBlock::Jump && block.next >= 0 && block.next != following) {
+            needs_label[block.next] = true;
+        }
+    }
+    for (int id : order) {
+        if (needs_label[id] && blocks[id].label.empty()) blocks[id].label = fresh_label();
+    }
+
+    std::vector<TacInstr> code;
+    for (size_t pos = 0; pos < order.size(); ++pos) {
+        const BasicBlock& block = blocks[order[pos]];
+        int following = pos + 1 < order.size() ? order[pos + 1] : -1;
+        if (needs_label[order[pos]]) code.push_back(make_label(block.label));
+        code.insert(code.end(), block.instrs.begin(), block.instrs.end());
+
+        if (block.terminator == BasicBlock::CondJump) {
+            TacInstr branch = block.condition;
+            branch.label = blocks[block.taken].label;
+            code.push_back(branch);
+        } else if (block.terminator == BasicBlock::Jump && block.taken != following) {
+            TacInstr jump = make_goto(blocks[block.taken].label);
+            jump.indent = block.indent;
+            code.push_back(jump);
+        }
+        if (block.terminator != BasicBlock::Jump && block.next >= 0 && block.next != following) {
+            TacInstr jump = make_goto(blocks[block.next].label);
+            jump.indent = block.indent;
+            code.push_back(jump);
+        }
+    }
+    return code;
+}
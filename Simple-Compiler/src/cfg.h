@@ -0,0 +1,62 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "ir.h"
+#include <string>
+#include <vector>
+
+// A maximal straight-line run of TAC. The leading label and the trailing
+// jump are not kept in `instrs`; they are modelled by `label`, `terminator`,
+// `taken` and `next` so passes can retarget edges without editing text.
+struct BasicBlock {
+    enum Terminator { FallThrough, Jump, CondJump };
+
+    std::string label;            // Empty if no label started the block
+    std::vector<TacInstr> instrs; // Straight-line body
+    Terminator terminator = FallThrough;
+    TacInstr condition;           // The IfGoto of a CondJump block
+    int taken = -1;               // Target of Jump / CondJump
+    int next = -1;                // Fall-through successor of FallThrough / CondJump
+    bool removed = false;         // Deleted blocks stay in the vector to keep ids stable
+    int indent = 0;               // Indentation of the terminator when printed
+    int position = -1;            // Index in the source listing of the first instruction
+                                  // or terminator; -1 for label-only blocks
+
+    std::vector<int> successors() const;
+};
+
+// Control-flow graph over a TAC listing. Block ids are indices into
+// `blocks`; `entry` is the first block and `exit` an empty sink block that
+// every path leaving the program falls into.
+class ControlFlowGraph {
+public:
+    std::vector<BasicBlock> blocks;
+    int entry;
+    int exit;
+
+    ControlFlowGraph(const std::vector<TacInstr>& code);
+
+    // Rebuilds a TAC listing. Blocks are laid out in id order; jumps to the
+    // next block are dropped, missing fall-through jumps are added and only
+    // labels that some jump refers to are printed.
+    std::vector<TacInstr> linearize();
+
+    // Predecessor lists of all live blocks, indexed by block id
+    std::vector<std::vector<int>> predecessors() const;
+
+    // Marks blocks not reachable from the entry as removed; returns how many
+    int remove_unreachable();
+
+    int live_block_count() const;
+
+    // Number of loops each block is nested in. A loop is the natural loop
+    // of an edge to a block at or before its source in layout order, which
+    // for the structured code the front end emits is exactly the back edge.
+    std::vector<int> loop_depths() const;
+
+private:
+    int label_counter;
+    std::string fresh_label();
+};
+
+#endif // CFG_H
@@ -1,11 +1,65 @@
 #include "compiler.h"
 #include "printing_options.h"
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <stdexcept>
 
 StatementList* ast_root = nullptr;
 
-Compiler::Compiler() : semantic_analyzer(codegen) {}
+namespace {
+
+// Prints what a run left in the program's variables
+void print_values(const std::string& title, const std::vector<std::pair<std::string, int32_t>>& values) {
+    std::cout << "\n" << std::string(50, '=') << std::endl;
+    std::cout << title << std::endl;
+    std::cout << std::string(50, '=') << std::endl;
+    for (const auto& [name, value] : values) {
+        if (name.rfind("__", 0) == 0) continue; // Made up by the loop passes
+        std::cout << name << " = " << value << std::endl;
+    }
+}
+
+void report_runtime_error(const std::runtime_error& e) {
+    std::cerr << "\n" << std::string(50, '=') << std::endl;
+    std::cerr << "EXECUTION FAILED: " << e.what() << std::endl;
+    std::cerr << std::string(50, '=') << "\n" << std::endl;
+}
+
+} // namespace
+
+Compiler::Compiler(const CompilerOptions& options) : semantic_analyzer(codegen), options(options) {
+    build_pipeline();
+
+    // Graph coloring costs more compile time; it is the -O2 default
+    AllocatorKind allocator = options.allocator;
+    if (allocator == AllocatorKind::Default) {
+        allocator = options.opt_level == OptLevel::O2 ? AllocatorKind::GraphColoring : AllocatorKind::LinearScan;
+    }
+    asm_gen.set_target(options.target);
+    asm_gen.set_allocator(allocator);
+    asm_gen.optimize_assembly = options.opt_level != OptLevel::O0;
+}
+
+// TAC passes for the selected optimization level, in execution order. -O1
+// keeps to the cheap cleanups; the AST loop passes run before lowering and
+// are gated in compile().
+void Compiler::build_pipeline() {
+    pass_manager.clear();
+    pass_manager.verify_each = options.verify_ir;
+    if (options.opt_level == OptLevel::O0) return;
+
+    pass_manager.add_pass("mem2reg", [this](std::vector<TacInstr>& code) { variable_promoter.run(code); });
+    pass_manager.add_pass("sccp", [this](std::vector<TacInstr>& code) { constant_propagator.run(code); });
+    if (options.opt_level != OptLevel::O1) {
+        pass_manager.add_pass("algebraic", [this](std::vector<TacInstr>& code) { algebraic_simplifier.run(code); });
+        pass_manager.add_pass("bounds-check", [this](std::vector<TacInstr>& code) { bounds_check_eliminator.run(code); });
+        pass_manager.add_pass("loop-reverse", [this](std::vector<TacInstr>& code) { loop_reverser.run(code); });
+        pass_manager.add_pass("if-convert", [this](std::vector<TacInstr>& code) { if_converter.run(code); });
+    }
+    pass_manager.add_pass("dce", [this](std::vector<TacInstr>& code) { dead_code_eliminator.run(code); });
+    pass_manager.add_pass("simplify-cfg", [this](std::vector<TacInstr>& code) { cfg_simplifier.run(code); });
+}
 
 void Compiler::tokenize(const std::string& text) {
     if (should_print(PRINT_TOKENS)) {
@@ -18,6 +72,10 @@ void Compiler::tokenize(const std::string& text) {
 void Compiler::compile(const std::string& text) {
     codegen.reset();
     semantic_analyzer.reset();
+    scalar_evolution.reset();
+    loop_vectorizer.reset();
+    loop_unroller.reset();
+    bytecode_values.clear();
     
     tokenize(text);
 
@@ -58,21 +116,118 @@ void Compiler::compile(const std::string& text) {
         return;
     }
 
+    // The tree-walker runs the program as written, before any pass touches it
+    if (options.interpret == InterpreterKind::Tree) run_tree_interpreter();
+
+    // AST-level loop optimizations run on the checked tree before lowering.
+    // Closed forms only ever shrink code; vectorizing and unrolling grow it
+    // and are left out of -Os. Vectorized loops are not unrolled further.
+    if (options.opt_level == OptLevel::O2 || options.opt_level == OptLevel::Os) {
+        scalar_evolution.run(ast_root);
+    }
+    if (options.opt_level == OptLevel::O2) {
+        loop_vectorizer.run(ast_root, options.vectorize);
+        loop_unroller.run(ast_root);
+    }
+    semantic_analyzer.generate(ast_root);
+
     if (ast_root) {
         delete ast_root;
         ast_root = nullptr;
     }
     
+    std::string tac_code;
+    std::vector<TacInstr> tac;
+    try {
+        tac = parse_tac(codegen.get_code());
+        pass_manager.run(tac);
+        tac_code = print_tac(tac);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "\n" << std::string(50, '=') << std::endl;
+        std::cerr << "COMPILATION FAILED DUE TO INTERNAL ERROR: " << e.what() << std::endl;
+        std::cerr << std::string(50, '=') << "\n" << std::endl;
+        return;
+    }
+
+    if (options.pass_stats) {
+        std::cout << "\n" << std::string(50, '=') << std::endl;
+        std::cout << "PASS STATISTICS (" << opt_level_name(options.opt_level) << ")" << std::endl;
+        std::cout << std::string(50, '=') << std::endl;
+        pass_manager.print_statistics(std::cout);
+        if (options.opt_level != OptLevel::O0) {
+            std::cout << "Promoted " << variable_promoter.promoted_variables << " variables to temps ("
+                      << variable_promoter.loads << " loads at entry, " << variable_promoter.stores
+                      << " stores at exit)" << std::endl;
+            if (options.opt_level != OptLevel::O1) {
+                std::cout << "Algebraic: " << algebraic_simplifier.simplified << " identities, "
+                          << algebraic_simplifier.reassociated << " constant chains merged, "
+                          << algebraic_simplifier.numbered << " repeated expressions, "
+                          << algebraic_simplifier.propagated << " copies propagated, "
+                          << algebraic_simplifier.canonicalized << " operand orders canonicalized" << std::endl;
+                std::cout << "Bounds checks: " << bounds_check_eliminator.constant + bounds_check_eliminator.repeated +
+                                                       bounds_check_eliminator.induction
+                          << " of " << bounds_check_eliminator.checks << " removed (" << bounds_check_eliminator.constant
+                          << " constant, " << bounds_check_eliminator.repeated << " repeated, "
+                          << bounds_check_eliminator.induction << " loop counters)" << std::endl;
+                if (options.opt_level == OptLevel::O2 && options.vectorize != VectorExtension::None) {
+                    std::cout << "Vectorizer: " << loop_vectorizer.vectorized << " loops vectorized, "
+                              << loop_vectorizer.dependent << " left scalar for a dependence ("
+                              << loop_vectorizer.gcd_proofs << " pairs independent by GCD, "
+                              << loop_vectorizer.banerjee_proofs << " by Banerjee)" << std::endl;
+                }
+                std::cout << "Reversed " << loop_reverser.reversed_loops << " loops to count down" << std::endl;
+                std::cout << "If-conversion: " << if_converter.converted << " branches removed, " << if_converter.selects
+                          << " cmovs, " << if_converter.set_flags << " setccs" << std::endl;
+            }
+        }
+    }
+
     if (should_print(PRINT_3AC)) {
         std::cout << "\n" << std::string(50, '=') << std::endl;
         std::cout << "GENERATED INTERMEDIATE CODE (TAC)" << std::endl;
         std::cout << std::string(50, '=') << std::endl;
-        std::string tac_code = codegen.get_code();
         std::cout << tac_code << std::endl;
     }
     
-    std::string tac_code = codegen.get_code();
+    // The VM runs the optimized TAC; with --jit it is also the oracle for the native code
+    if (options.interpret == InterpreterKind::Bytecode) run_bytecode(tac);
+    if (options.interpret == InterpreterKind::Tiered) run_tiered(tac);
+
     std::string asm_code = asm_gen.generate_from_tac(tac_code);
+
+    if (options.pass_stats) {
+        const RegisterAllocator& allocator = asm_gen.register_allocator();
+        std::cout << "Register allocation (" << allocator.name() << "): " << allocator.interval_count << " temps, "
+                  << allocator.spilled_intervals << " spilled, " << allocator.split_intervals << " split, "
+                  << allocator.coalesced_moves << " moves coalesced, "
+                  << allocator.slot_count << " stack slots" << std::endl;
+        const FrameLayout& frame = asm_gen.frame_layout();
+        std::cout << "Stack frame: " << frame.local_count << " block locals in " << frame.slot_count << " slots"
+                  << std::endl;
+        const InstructionSelector& selector = asm_gen.instruction_selector();
+        std::cout << "Instruction selection: " << selector.folded_nodes << " nodes folded";
+        bool any_tile = false;
+        for (const auto& [tile, count] : selector.statistics()) {
+            if (count == 0) continue;
+            std::cout << (any_tile ? ", " : " (") << tile << " " << count;
+            any_tile = true;
+        }
+        std::cout << (any_tile ? ")" : "") << std::endl;
+        if (asm_gen.optimize_assembly) {
+            const PeepholeOptimizer& peephole = asm_gen.peephole_optimizer();
+            std::cout << "Peephole: " << peephole.rewrites << " rewrites";
+            const char* separator = " (";
+            for (const auto& [rule, count] : peephole.statistics()) {
+                if (count == 0) continue;
+                std::cout << separator << rule << " " << count;
+                separator = ", ";
+            }
+            std::cout << (peephole.rewrites > 0 ? ")" : "") << std::endl;
+        }
+    }
+
+    if (!options.output_path.empty()) write_output(asm_code);
+    if (options.jit) run_jit();
     
     if (should_print(PRINT_ASSEMBLY)) {
         std::cout << "\n" << std::string(50, '=') << std::endl;
@@ -80,4 +235,139 @@ void Compiler::compile(const std::string& text) {
         std::cout << std::string(50, '=') << std::endl;
         std::cout << asm_code << std::endl;
     }
-}
\ No newline at end of file
+}
+
+// Writes -o in the selected format. Objects and executables are encoded
+// in-process, so no assembler or linker runs.
+void Compiler::write_output(const std::string& asm_code) {
+    if (options.emit == OutputFormat::Assembly) {
+        std::ofstream output(options.output_path);
+        if (!output) {
+            std::cerr << "Cannot write '" << options.output_path << "'" << std::endl;
+        }
+        output << asm_code;
+        return;
+    }
+
+    std::vector<uint8_t> bytes;
+    X86Encoder encoder(options.target);
+    try {
+        encoder.encode(asm_gen.program());
+        ElfWriter writer(options.target, encoder, asm_gen.data_symbols(), asm_gen.array_symbols());
+        bytes = options.emit == OutputFormat::Object ? writer.object_file() : writer.executable();
+    } catch (const std::runtime_error& e) {
+        std::cerr << "\n" << std::string(50, '=') << std::endl;
+        std::cerr << "COMPILATION FAILED DUE TO INTERNAL ERROR: " << e.what() << std::endl;
+        std::cerr << std::string(50, '=') << "\n" << std::endl;
+        return;
+    }
+    if (options.pass_stats) {
+        std::cout << "Encoder: " << encoder.code.size() << " bytes of code, " << encoder.short_jumps
+                  << " short jumps, " << encoder.long_jumps << " long jumps, " << encoder.relocations.size()
+                  << " relocations" << std::endl;
+    }
+    if (!write_binary_file(options.output_path, bytes, options.emit == OutputFormat::Executable)) {
+        std::cerr << "Cannot write '" << options.output_path << "'" << std::endl;
+    }
+}
+
+void Compiler::run_jit() {
+    JitExecutor jit;
+    try {
+        jit.run(asm_gen.program(ProgramExit::Return), asm_gen.data_symbols(), asm_gen.array_symbols());
+    } catch (const std::runtime_error& e) {
+        std::cerr << "\n" << std::string(50, '=') << std::endl;
+        std::cerr << "COMPILATION FAILED DUE TO INTERNAL ERROR: " << e.what() << std::endl;
+        std::cerr << std::string(50, '=') << "\n" << std::endl;
+        return;
+    }
+    // The program stopped at __bounds_error or __divide_error
+    for (const auto& [name, value] : jit.values) {
+        if (name == "__out_of_bounds" && value != 0) {
+            report_runtime_error(std::runtime_error("Runtime Error: Array index out of bounds."));
+            return;
+        }
+        if (name == "__divide_by_zero" && value != 0) {
+            report_runtime_error(std::runtime_error("Runtime Error: Division by zero."));
+            return;
+        }
+    }
+    if (options.pass_stats) {
+        std::cout << "JIT: " << jit.code_bytes << " bytes of code, ran in " << jit.run_microseconds << " us"
+                  << std::endl;
+    }
+    print_values("JIT EXECUTION (x86-64)", jit.values);
+    if (options.interpret == InterpreterKind::Bytecode) check_against_bytecode(jit.values);
+}
+
+void Compiler::run_tree_interpreter() {
+    AstInterpreter interpreter;
+    try {
+        interpreter.run(ast_root);
+    } catch (const std::runtime_error& e) {
+        report_runtime_error(e);
+        return;
+    }
+    if (options.pass_stats) {
+        std::cout << "AST interpreter: ran in " << interpreter.run_microseconds << " us" << std::endl;
+    }
+    print_values("INTERPRETER (AST tree-walk)", interpreter.values);
+}
+
+void Compiler::run_bytecode(const std::vector<TacInstr>& tac) {
+    BytecodeProgram program;
+    BytecodeVM vm;
+    try {
+        program = compile_bytecode(tac);
+        vm.run(program);
+    } catch (const std::runtime_error& e) {
+        report_runtime_error(e);
+        return;
+    }
+    if (options.pass_stats) {
+        std::cout << "Bytecode VM: " << program.code.size() << " instructions, " << program.initial_slots.size()
+                  << " slots, ran in " << vm.run_microseconds << " us" << std::endl;
+    }
+    print_values("INTERPRETER (bytecode VM)", vm.values);
+    bytecode_values = vm.values;
+}
+
+void Compiler::run_tiered(const std::vector<TacInstr>& tac) {
+    TieredExecutor executor;
+    executor.hot_threshold = options.tier_threshold;
+    try {
+        executor.run(tac);
+    } catch (const std::runtime_error& e) {
+        report_runtime_error(e);
+        return;
+    }
+    if (options.pass_stats) {
+        std::cout << "Tiered: " << executor.compiled_loops << " loops compiled in " << executor.compile_microseconds
+                  << " us, " << executor.rejected_loops << " left in the VM, " << executor.native_entries
+                  << " native entries, ran in " << executor.run_microseconds << " us" << std::endl;
+    }
+    print_values("INTERPRETER (tiered)", executor.values);
+}
+
+// Compares the native run with the VM's, variable by variable. A variable
+// only one of them has is not compared: the backend drops variables the
+// program never reads.
+void Compiler::check_against_bytecode(const std::vector<std::pair<std::string, int32_t>>& native) {
+    if (bytecode_values.empty()) return;
+    std::map<std::string, int32_t> expected(bytecode_values.begin(), bytecode_values.end());
+    int compared = 0;
+    int mismatches = 0;
+    for (const auto& [name, value] : native) {
+        auto found = expected.find(name);
+        if (found == expected.end()) continue;
+        ++compared;
+        if (found->second != value) {
+            ++mismatches;
+            std::cerr << "Oracle mismatch: " << name << " = " << value << " natively, " << found->second
+                      << " in the bytecode VM" << std::endl;
+        }
+    }
+    if (mismatches == 0) {
+        std::cout << "Oracle: native code and bytecode VM agree on " << compared << " variables" << std::endl;
+    }
+}
@@ -5,6 +5,24 @@
 #include "codegen.h"
 #include "semantic.h"
 #include "assembly_gen.h"
+#include "x86_encoder.h"
+#include "elf_writer.h"
+#include "jit.h"
+#include "bytecode.h"
+#include "ast_interpreter.h"
+#include "tiered.h"
+#include "loop_unroll.h"
+#include "scalar_evolution.h"
+#include "vectorize.h"
+#include "mem2reg.h"
+#include "sccp.h"
+#include "algebraic.h"
+#include "bounds_check.h"
+#include "loop_reverse.h"
+#include "if_convert.h"
+#include "dce.h"
+#include "simplify_cfg.h"
+#include "pass_manager.h"
 #include "ast.h"
 
 // Bison's generated parser function
@@ -18,17 +36,70 @@ void yy_delete_buffer(yy_buffer_state*);
 // This is a common but simple way to link the parser to the driver.
 extern StatementList* ast_root;
 
+// What -o writes
+enum class OutputFormat {
+    Assembly,  // NASM source
+    Object,    // ELF relocatable object, for ld
+    Executable // Static ELF executable
+};
+
+// What --interpret runs the program with
+enum class InterpreterKind {
+    None,
+    Bytecode, // The bytecode VM, on the optimized TAC
+    Tiered,   // The bytecode VM, compiling hot loops to native code
+    Tree      // The AST tree-walker, on the checked source tree
+};
+
+// Per-job settings, filled from the command line in main
+struct CompilerOptions {
+    OptLevel opt_level = OptLevel::O2;
+    bool verify_ir = false;   // --verify-ir: check the TAC before and after every pass
+    bool pass_stats = false;  // --pass-stats: report time and size changes per pass
+    AllocatorKind allocator = AllocatorKind::Default; // --regalloc=linear|graph
+    std::string output_path;  // -o: also write the program to this file
+    OutputFormat emit = OutputFormat::Assembly; // --emit=asm|obj|exe
+    bool jit = false;         // --jit: run the x86-64 code in-process and print the variables
+    InterpreterKind interpret = InterpreterKind::None; // --interpret[=vm|ast|tiered]: run in an interpreter
+    uint32_t tier_threshold = 1000; // --tier-threshold=N: loop header executions before tiering up
+    TargetArch target = TargetArch::X86; // -m32 | -m64
+    VectorExtension vectorize = VectorExtension::SSE2; // --vectorize=none|sse2|avx2, at -O2
+};
+
 class Compiler {
 public:
-    Compiler();
+    Compiler(const CompilerOptions& options = CompilerOptions());
     void compile(const std::string& text);
 
 private:
     CodeGen codegen;
     SemanticAnalyzer semantic_analyzer;
     AssemblyGenerator asm_gen;
+    ScalarEvolution scalar_evolution;
+    LoopVectorizer loop_vectorizer;
+    LoopUnroller loop_unroller;
+    VariablePromoter variable_promoter;
+    ConstantPropagator constant_propagator;
+    AlgebraicSimplifier algebraic_simplifier;
+    BoundsCheckEliminator bounds_check_eliminator;
+    LoopReverser loop_reverser;
+    IfConverter if_converter;
+    DeadCodeEliminator dead_code_eliminator;
+    CFGSimplifier cfg_simplifier;
+    PassManager pass_manager;
+    CompilerOptions options;
     
     void tokenize(const std::string& text);
+    void build_pipeline();
+    void write_output(const std::string& asm_code);
+    void run_jit();
+    void run_tree_interpreter();
+    void run_bytecode(const std::vector<TacInstr>& tac);
+    void run_tiered(const std::vector<TacInstr>& tac);
+    void check_against_bytecode(const std::vector<std::pair<std::string, int32_t>>& native);
+
+    // Variables the bytecode VM computed, kept as the oracle for --jit
+    std::vector<std::pair<std::string, int32_t>> bytecode_values;
 };
 
 #endif // COMPILER_H
\ No newline at end of file
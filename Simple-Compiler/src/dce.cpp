@@ -0,0 +1,89 @@
+#include "dce.h"
+#include "liveness.h"
+#include <map>
+#include <set>
+
+DeadCodeEliminator::DeadCodeEliminator() : removed_instructions(0) {}
+
+// Finds `MOV x, t` where every definition of t is the load `t = x` and this
+// is the only write to x. x then never holds anything but its initial value,
+// so the store changes nothing. This is what promoted variables that were
+// only written on paths SCCP removed look like.
+static void find_identity_stores(const std::vector<TacInstr>& code, std::vector<bool>& dead, int& found) {
+    std::map<std::string, int> writes;
+    std::map<std::string, std::set<std::string>> sources; // temp -> what it is copied from ("" if computed)
+    for (const auto& instr : code) {
+        if (instr.dest.empty()) continue;
+        if (is_temporary_name(instr.dest)) {
+            bool load = instr.kind == TacOp::Assign && instr.op.empty() && !is_constant(instr.arg1) &&
+                        !is_temporary_name(instr.arg1);
+            sources[instr.dest].insert(load ? instr.arg1 : "");
+        } else {
+            writes[instr.dest]++;
+        }
+    }
+    for (size_t i = 0; i < code.size(); ++i) {
+        const TacInstr& instr = code[i];
+        if (instr.kind != TacOp::Mov || !is_temporary_name(instr.arg1) || writes[instr.dest] != 1) continue;
+        const std::set<std::string>& from = sources[instr.arg1];
+        if (from.size() == 1 && *from.begin() == instr.dest) {
+            dead[i] = true;
+            found++;
+        }
+    }
+}
+
+void DeadCodeEliminator::run(std::vector<TacInstr>& code) {
+    removed_instructions = 0;
+    std::vector<std::string> operands;
+
+    while (true) {
+        LivenessAnalysis liveness(code, true);
+        const ControlFlowGraph& cfg = liveness.graph();
+        std::vector<bool> dead(code.size(), false);
+        int found = 0;
+        find_identity_stores(code, dead, found);
+
+        LiveSet live(liveness);
+        for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+            const BasicBlock& block = cfg.blocks[b];
+            if (block.position < 0) continue;
+            live.start(static_cast<int>(b));
+            auto read = [&](const std::string& name) {
+                int id = liveness.value_id(name);
+                if (id >= 0) live.set(id);
+            };
+            if (block.terminator == BasicBlock::CondJump) {
+                read(block.condition.arg1);
+                read(block.condition.arg2);
+            }
+            for (int i = static_cast<int>(block.instrs.size()) - 1; i >= 0; --i) {
+                const TacInstr& instr = block.instrs[i];
+                if (dead[block.position + i]) continue;
+                // Stores and bounds checks define nothing and are always
+                // kept, as are divisions that may fault
+                if (!instr_def(instr).empty()) {
+                    int id = liveness.value_id(instr_def(instr));
+                    if (id < 0) continue;
+                    if (!live.test(id) && !may_fault(instr)) {
+                        dead[block.position + i] = true;
+                        found++;
+                        continue;
+                    }
+                    live.reset(id);
+                }
+                instr_uses(instr, operands);
+                for (const auto& name : operands) read(name);
+            }
+        }
+
+        if (found == 0) break;
+        std::vector<TacInstr> kept;
+        kept.reserve(code.size() - found);
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (!dead[i]) kept.push_back(code[i]);
+        }
+        code.swap(kept);
+        removed_instructions += found;
+    }
+}
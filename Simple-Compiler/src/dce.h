@@ -0,0 +1,21 @@
+#ifndef DCE_H
+#define DCE_H
+
+#include "ir.h"
+#include <vector>
+
+// Liveness-driven dead code elimination. Removes assignments whose result
+// is never read before being overwritten or before the program ends;
+// named variables count as read at exit since their memory is the
+// program's output. Repeats until a round removes nothing, so chains of
+// temporaries feeding only dead code go in one run. Stores that write a
+// variable's own initial value back to it are removed as well.
+class DeadCodeEliminator {
+public:
+    DeadCodeEliminator();
+    void run(std::vector<TacInstr>& code);
+
+    int removed_instructions;
+};
+
+#endif // DCE_H
@@ -0,0 +1,374 @@
+#include "elf_writer.h"
+#include <elf.h>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+
+// The ELF32 and ELF64 differences the writer cares about
+struct Elf32 {
+    using Ehdr = Elf32_Ehdr;
+    using Phdr = Elf32_Phdr;
+    using Shdr = Elf32_Shdr;
+    using Sym = Elf32_Sym;
+    // i386 relocations keep the addend in the field they patch
+    using Rel = Elf32_Rel;
+    static const bool has_addend = false;
+    static const unsigned char elf_class = ELFCLASS32;
+    static const uint16_t machine = EM_386;
+    static const uint64_t base_address = 0x8048000;
+    static const char* relocation_section() { return ".rel.text"; }
+    static uint32_t relocation_type(Relocation::Kind kind) {
+        if (kind == Relocation::Absolute64) throw std::runtime_error("Assembly Error: No 64-bit relocations on x86.");
+        return kind == Relocation::Absolute32 ? R_386_32 : R_386_PC32;
+    }
+    static void set_info(Rel& rel, uint32_t symbol, uint32_t type) { rel.r_info = ELF32_R_INFO(symbol, type); }
+    static void set_addend(Rel&, long long) {}
+};
+
+struct Elf64 {
+    using Ehdr = Elf64_Ehdr;
+    using Phdr = Elf64_Phdr;
+    using Shdr = Elf64_Shdr;
+    using Sym = Elf64_Sym;
+    using Rel = Elf64_Rela;
+    static const bool has_addend = true;
+    static const unsigned char elf_class = ELFCLASS64;
+    static const uint16_t machine = EM_X86_64;
+    static const uint64_t base_address = 0x400000;
+    static const char* relocation_section() { return ".rela.text"; }
+    static uint32_t relocation_type(Relocation::Kind kind) {
+        if (kind == Relocation::Absolute64) return R_X86_64_64;
+        return kind == Relocation::Absolute32 ? R_X86_64_32 : R_X86_64_PC32;
+    }
+    static void set_info(Rel& rel, uint32_t symbol, uint32_t type) { rel.r_info = ELF64_R_INFO(symbol, type); }
+    static void set_addend(Rel& rel, long long addend) { rel.r_addend = addend; }
+};
+
+const uint64_t kPageSize = 0x1000;
+
+// Headers are written in host byte order, which is little-endian on
+// every host that runs the output
+template <class T>
+void append(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void pad_to(std::vector<uint8_t>& out, uint64_t alignment) {
+    while (out.size() % alignment != 0) out.push_back(0);
+}
+
+void patch(std::vector<uint8_t>& code, size_t offset, long long value, int size) {
+    for (int i = 0; i < size; ++i) code[offset + i] = static_cast<uint8_t>((value >> (8 * i)) & 0xff);
+}
+
+int field_size(Relocation::Kind kind) {
+    return kind == Relocation::Absolute64 ? 8 : 4;
+}
+
+const uint64_t kArrayAlignment = 32;
+
+// Offsets of the arrays in .bss, each aligned for vector loads, and the
+// size of .bss
+std::vector<uint64_t> array_offsets(const std::vector<ArraySymbol>& arrays, uint64_t& size) {
+    std::vector<uint64_t> offsets;
+    size = 0;
+    for (const auto& array : arrays) {
+        size = (size + kArrayAlignment - 1) / kArrayAlignment * kArrayAlignment;
+        offsets.push_back(size);
+        size += 4 * static_cast<uint64_t>(array.size);
+    }
+    return offsets;
+}
+
+// A string table under construction
+struct StringTable {
+    std::vector<uint8_t> bytes{0};
+    uint32_t add(const std::string& text) {
+        uint32_t offset = static_cast<uint32_t>(bytes.size());
+        bytes.insert(bytes.end(), text.begin(), text.end());
+        bytes.push_back(0);
+        return offset;
+    }
+};
+
+// A section to lay out after the ELF header (and program headers)
+template <class Elf>
+struct Section {
+    std::string name;
+    typename Elf::Shdr header;
+    std::vector<uint8_t> contents;
+};
+
+// Sections, then the section header table. Section 0 is the null section
+// and is added here; `sections` are numbered from 1 in order. A SHT_NOBITS
+// section takes no room in the file and keeps the size it was given.
+template <class Elf>
+void write_sections(std::vector<uint8_t>& out, typename Elf::Ehdr& header,
+                    std::vector<Section<Elf>>& sections) {
+    StringTable section_names;
+    Section<Elf> names;
+    names.name = ".shstrtab";
+    std::memset(&names.header, 0, sizeof(names.header));
+    names.header.sh_type = SHT_STRTAB;
+    names.header.sh_addralign = 1;
+    sections.push_back(names);
+    for (auto& section : sections) section.header.sh_name = section_names.add(section.name);
+    sections.back().contents = section_names.bytes;
+
+    for (auto& section : sections) {
+        if (section.header.sh_addralign > 1) pad_to(out, section.header.sh_addralign);
+        section.header.sh_offset = out.size();
+        if (section.header.sh_type != SHT_NOBITS) section.header.sh_size = section.contents.size();
+        out.insert(out.end(), section.contents.begin(), section.contents.end());
+    }
+    pad_to(out, 8);
+    header.e_shoff = out.size();
+    header.e_shnum = static_cast<uint16_t>(sections.size() + 1);
+    header.e_shstrndx = static_cast<uint16_t>(sections.size());
+    typename Elf::Shdr null_section;
+    std::memset(&null_section, 0, sizeof(null_section));
+    append(out, null_section);
+    for (const auto& section : sections) append(out, section.header);
+}
+
+template <class Elf>
+Section<Elf> make_section(const std::string& name, uint32_t type, uint64_t flags, uint64_t alignment,
+                          std::vector<uint8_t> contents) {
+    Section<Elf> section;
+    section.name = name;
+    std::memset(&section.header, 0, sizeof(section.header));
+    section.header.sh_type = type;
+    section.header.sh_flags = flags;
+    section.header.sh_addralign = alignment;
+    section.contents = std::move(contents);
+    return section;
+}
+
+template <class Elf>
+typename Elf::Ehdr make_header(uint16_t type) {
+    typename Elf::Ehdr header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = Elf::elf_class;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = type;
+    header.e_machine = Elf::machine;
+    header.e_version = EV_CURRENT;
+    header.e_ehsize = sizeof(typename Elf::Ehdr);
+    header.e_shentsize = sizeof(typename Elf::Shdr);
+    return header;
+}
+
+// A .bss section of `size` bytes, or none if there are no arrays
+template <class Elf>
+void add_bss(std::vector<Section<Elf>>& sections, uint64_t size, uint64_t address) {
+    if (size == 0) return;
+    auto bss = make_section<Elf>(".bss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE, kArrayAlignment, {});
+    bss.header.sh_size = size;
+    bss.header.sh_addr = address;
+    sections.push_back(bss);
+}
+
+// .symtab and .strtab: the null symbol, one local object per data cell
+// and per array, then the global _start. `text`, `data` and `bss` are
+// section numbers; the values are section offsets in an object and
+// addresses in an executable.
+template <class Elf>
+void add_symbol_table(std::vector<Section<Elf>>& sections, const std::vector<std::string>& data_symbols,
+                      const std::vector<ArraySymbol>& arrays, uint16_t text, uint16_t data, uint16_t bss,
+                      uint64_t text_address, uint64_t data_address, uint64_t bss_address) {
+    StringTable names;
+    std::vector<uint8_t> symbols;
+    typename Elf::Sym symbol;
+    std::memset(&symbol, 0, sizeof(symbol));
+    append(symbols, symbol);
+    for (size_t i = 0; i < data_symbols.size(); ++i) {
+        std::memset(&symbol, 0, sizeof(symbol));
+        symbol.st_name = names.add(data_symbol(data_symbols[i]));
+        symbol.st_info = ELF32_ST_INFO(STB_LOCAL, STT_OBJECT);
+        symbol.st_shndx = data;
+        symbol.st_value = data_address + 4 * i;
+        symbol.st_size = 4;
+        append(symbols, symbol);
+    }
+    uint64_t bss_size = 0;
+    std::vector<uint64_t> offsets = array_offsets(arrays, bss_size);
+    for (size_t i = 0; i < arrays.size(); ++i) {
+        std::memset(&symbol, 0, sizeof(symbol));
+        symbol.st_name = names.add(data_symbol(arrays[i].name));
+        symbol.st_info = ELF32_ST_INFO(STB_LOCAL, STT_OBJECT);
+        symbol.st_shndx = bss;
+        symbol.st_value = bss_address + offsets[i];
+        symbol.st_size = 4 * arrays[i].size;
+        append(symbols, symbol);
+    }
+    std::memset(&symbol, 0, sizeof(symbol));
+    symbol.st_name = names.add("_start");
+    symbol.st_info = ELF32_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+    symbol.st_shndx = text;
+    symbol.st_value = text_address;
+    append(symbols, symbol);
+
+    uint16_t symbol_table = static_cast<uint16_t>(sections.size() + 1);
+    auto table = make_section<Elf>(".symtab", SHT_SYMTAB, 0, 8, symbols);
+    table.header.sh_link = symbol_table + 1;
+    table.header.sh_info = static_cast<uint32_t>(data_symbols.size() + arrays.size() + 1); // First global
+    table.header.sh_entsize = sizeof(typename Elf::Sym);
+    sections.push_back(table);
+    sections.push_back(make_section<Elf>(".strtab", SHT_STRTAB, 0, 1, names.bytes));
+}
+
+template <class Elf>
+std::vector<uint8_t> build_object(const X86Encoder& encoder, const std::vector<std::string>& data_symbols,
+                                  const std::vector<ArraySymbol>& arrays) {
+    std::map<std::string, uint32_t> symbol_index;
+    for (size_t i = 0; i < data_symbols.size(); ++i) {
+        symbol_index[data_symbol(data_symbols[i])] = static_cast<uint32_t>(i + 1);
+    }
+    for (size_t i = 0; i < arrays.size(); ++i) {
+        symbol_index[data_symbol(arrays[i].name)] = static_cast<uint32_t>(data_symbols.size() + i + 1);
+    }
+
+    std::vector<uint8_t> code = encoder.code;
+    std::vector<uint8_t> relocations;
+    for (const auto& relocation : encoder.relocations) {
+        auto found = symbol_index.find(relocation.symbol);
+        if (found == symbol_index.end()) {
+            throw std::runtime_error("Assembly Error: Undefined symbol " + relocation.symbol + ".");
+        }
+        typename Elf::Rel entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.r_offset = relocation.offset;
+        Elf::set_info(entry, found->second, Elf::relocation_type(relocation.kind));
+        Elf::set_addend(entry, relocation.addend);
+        if (!Elf::has_addend) patch(code, relocation.offset, relocation.addend, field_size(relocation.kind));
+        append(relocations, entry);
+    }
+
+    // 1 .text, 2 .data, [3 .bss,] then .rel(a).text, .symtab, .strtab and .shstrtab
+    std::vector<Section<Elf>> sections;
+    sections.push_back(make_section<Elf>(".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 16, code));
+    sections.push_back(make_section<Elf>(".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, 4,
+                                         std::vector<uint8_t>(4 * data_symbols.size(), 0)));
+    uint64_t bss_size = 0;
+    array_offsets(arrays, bss_size);
+    add_bss(sections, bss_size, 0);
+    uint16_t bss = bss_size > 0 ? 3 : 0;
+    auto relocation_table = make_section<Elf>(Elf::relocation_section(), Elf::has_addend ? SHT_RELA : SHT_REL, 0, 8,
+                                              relocations);
+    relocation_table.header.sh_link = static_cast<uint32_t>(sections.size() + 2); // .symtab
+    relocation_table.header.sh_info = 1;
+    relocation_table.header.sh_entsize = sizeof(typename Elf::Rel);
+    sections.push_back(relocation_table);
+    add_symbol_table(sections, data_symbols, arrays, 1, 2, bss, 0, 0, 0);
+
+    typename Elf::Ehdr header = make_header<Elf>(ET_REL);
+    std::vector<uint8_t> out(sizeof(header), 0);
+    write_sections(out, header, sections);
+    std::memcpy(out.data(), &header, sizeof(header));
+    return out;
+}
+
+template <class Elf>
+std::vector<uint8_t> build_executable(const X86Encoder& encoder, const std::vector<std::string>& data_symbols,
+                                      const std::vector<ArraySymbol>& arrays) {
+    // Code on the page after the headers, data on the page after the code,
+    // and .bss in memory right after the data
+    uint64_t text_offset = kPageSize;
+    uint64_t text_address = Elf::base_address + text_offset;
+    uint64_t data_offset = (text_offset + encoder.code.size() + kPageSize - 1) / kPageSize * kPageSize;
+    uint64_t data_address = Elf::base_address + data_offset;
+    uint64_t data_size = 4 * data_symbols.size();
+    uint64_t bss_address = (data_address + data_size + kArrayAlignment - 1) / kArrayAlignment * kArrayAlignment;
+    uint64_t bss_size = 0;
+    std::vector<uint64_t> offsets = array_offsets(arrays, bss_size);
+
+    std::map<std::string, uint64_t> address;
+    for (size_t i = 0; i < data_symbols.size(); ++i) address[data_symbol(data_symbols[i])] = data_address + 4 * i;
+    for (size_t i = 0; i < arrays.size(); ++i) address[data_symbol(arrays[i].name)] = bss_address + offsets[i];
+    std::vector<uint8_t> code = encoder.code;
+    for (const auto& relocation : encoder.relocations) {
+        auto found = address.find(relocation.symbol);
+        if (found == address.end()) {
+            throw std::runtime_error("Assembly Error: Undefined symbol " + relocation.symbol + ".");
+        }
+        long long value = static_cast<long long>(found->second) + relocation.addend;
+        if (relocation.kind == Relocation::PcRelative32) value -= text_address + relocation.offset;
+        patch(code, relocation.offset, value, field_size(relocation.kind));
+    }
+
+    typename Elf::Ehdr header = make_header<Elf>(ET_EXEC);
+    header.e_entry = text_address;
+    header.e_phoff = sizeof(header);
+    header.e_phentsize = sizeof(typename Elf::Phdr);
+    header.e_phnum = data_size > 0 || bss_size > 0 ? 2 : 1;
+
+    std::vector<uint8_t> out(sizeof(header) + header.e_phnum * sizeof(typename Elf::Phdr), 0);
+    typename Elf::Phdr segments[2];
+    std::memset(segments, 0, sizeof(segments));
+    // The first segment maps the headers too, as ld's does
+    segments[0].p_type = PT_LOAD;
+    segments[0].p_flags = PF_R | PF_X;
+    segments[0].p_offset = 0;
+    segments[0].p_vaddr = segments[0].p_paddr = Elf::base_address;
+    segments[0].p_filesz = segments[0].p_memsz = text_offset + code.size();
+    segments[0].p_align = kPageSize;
+    segments[1].p_type = PT_LOAD;
+    segments[1].p_flags = PF_R | PF_W;
+    segments[1].p_offset = data_offset;
+    segments[1].p_vaddr = segments[1].p_paddr = data_address;
+    segments[1].p_filesz = data_size;
+    segments[1].p_memsz = bss_size > 0 ? bss_address + bss_size - data_address : data_size;
+    segments[1].p_align = kPageSize;
+
+    // Sections at the addresses the segments give them
+    std::vector<Section<Elf>> sections;
+    auto text = make_section<Elf>(".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, kPageSize, code);
+    text.header.sh_addr = text_address;
+    sections.push_back(text);
+    auto data = make_section<Elf>(".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, kPageSize,
+                                  std::vector<uint8_t>(data_size, 0));
+    data.header.sh_addr = data_address;
+    sections.push_back(data);
+    add_bss(sections, bss_size, bss_address);
+    add_symbol_table(sections, data_symbols, arrays, 1, 2, bss_size > 0 ? 3 : 0, text_address, data_address,
+                     bss_address);
+
+    write_sections(out, header, sections);
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + sizeof(header), segments, header.e_phnum * sizeof(typename Elf::Phdr));
+    return out;
+}
+
+} // namespace
+
+ElfWriter::ElfWriter(TargetArch target, const X86Encoder& encoder, const std::vector<std::string>& data_symbols,
+                     const std::vector<ArraySymbol>& arrays)
+    : target(target), encoder(encoder), data_symbols(data_symbols), arrays(arrays) {}
+
+std::vector<uint8_t> ElfWriter::object_file() const {
+    if (target == TargetArch::X86_64) return build_object<Elf64>(encoder, data_symbols, arrays);
+    return build_object<Elf32>(encoder, data_symbols, arrays);
+}
+
+std::vector<uint8_t> ElfWriter::executable() const {
+    if (target == TargetArch::X86_64) return build_executable<Elf64>(encoder, data_symbols, arrays);
+    return build_executable<Elf32>(encoder, data_symbols, arrays);
+}
+
+bool write_binary_file(const std::string& path, const std::vector<uint8_t>& bytes, bool executable) {
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    if (!output) return false;
+    output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    output.close();
+    if (!output) return false;
+    if (executable) chmod(path.c_str(), 0755);
+    return true;
+}
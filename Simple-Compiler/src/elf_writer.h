@@ -0,0 +1,38 @@
+#ifndef ELF_WRITER_H
+#define ELF_WRITER_H
+
+#include "x86_encoder.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Packages an encoded program as ELF: ELF64 for x86-64, ELF32 for x86.
+//
+// The object file matches what nasm -f elf64 (or elf32) makes of the
+// assembly: .text with a global _start, .data with one local 4-byte zero
+// cell per variable, .bss with the arrays if there are any, and
+// relocations from the code to those. The executable is what ld would link
+// from it, without the linker: the code and the data in two PT_LOAD
+// segments at the usual static base address, the second one extended in
+// memory past the file to hold .bss, with every relocation already applied.
+// Both keep a symbol table so nm and a debugger see the variables.
+class ElfWriter {
+public:
+    ElfWriter(TargetArch target, const X86Encoder& encoder, const std::vector<std::string>& data_symbols,
+              const std::vector<ArraySymbol>& arrays = {});
+
+    std::vector<uint8_t> object_file() const;
+    std::vector<uint8_t> executable() const;
+
+private:
+    TargetArch target;
+    const X86Encoder& encoder;
+    std::vector<std::string> data_symbols;
+    std::vector<ArraySymbol> arrays;
+};
+
+// Writes `bytes` to `path`, marking it executable if asked. Returns false
+// if the file cannot be written.
+bool write_binary_file(const std::string& path, const std::vector<uint8_t>& bytes, bool executable);
+
+#endif // ELF_WRITER_H
@@ -0,0 +1,41 @@
+#include "frame.h"
+#include <queue>
+#include <vector>
+
+FrameLayout::FrameLayout() : slot_count(0), local_count(0) {}
+
+int FrameLayout::slot_of(const std::string& local) const {
+    auto found = slots.find(local);
+    return found == slots.end() ? -1 : found->second;
+}
+
+void FrameLayout::run(const LivenessAnalysis& liveness) {
+    slots.clear();
+    slot_count = 0;
+    local_count = 0;
+
+    typedef std::pair<int, int> Release; // (end of owner, slot)
+    std::priority_queue<Release, std::vector<Release>, std::greater<Release>> busy;
+    std::vector<int> free_slots;
+
+    // Intervals come sorted by start
+    const std::vector<std::string>& names = liveness.names();
+    for (const auto& interval : liveness.intervals()) {
+        const std::string& name = names[interval.value];
+        if (!is_local_name(name)) continue;
+        while (!busy.empty() && busy.top().first < interval.start()) {
+            free_slots.push_back(busy.top().second);
+            busy.pop();
+        }
+        int slot;
+        if (free_slots.empty()) {
+            slot = slot_count++;
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        slots[name] = slot;
+        busy.push({interval.end(), slot});
+        local_count++;
+    }
+}
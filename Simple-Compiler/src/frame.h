@@ -0,0 +1,27 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "liveness.h"
+#include <string>
+#include <unordered_map>
+
+// Stack slots for block-scoped locals (see is_local_name). Two locals whose
+// live intervals overlap need different slots; the rest may share. Taking
+// each interval's hull turns this into interval-graph coloring, which the
+// greedy pass in order of start solves with the fewest slots.
+class FrameLayout {
+public:
+    FrameLayout();
+    void run(const LivenessAnalysis& liveness);
+
+    // Slot of `local` counted from the start of the locals area, -1 if none
+    int slot_of(const std::string& local) const;
+
+    int slot_count;
+    int local_count;
+
+private:
+    std::unordered_map<std::string, int> slots;
+};
+
+#endif // FRAME_H
@@ -0,0 +1,416 @@
+#include "graph_coloring.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+GraphColoringAllocator::GraphColoringAllocator(const std::vector<std::string>& registers)
+    : RegisterAllocator(registers), k(static_cast<int>(registers.size())) {}
+
+static uint64_t edge_key(int u, int v) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(u)) << 32) | static_cast<uint32_t>(v);
+}
+
+bool GraphColoringAllocator::adjacent(int u, int v) const {
+    return adj_set.count(edge_key(u, v)) > 0;
+}
+
+void GraphColoringAllocator::add_edge(int u, int v) {
+    if (u == v || adjacent(u, v)) return;
+    adj_set.insert(edge_key(u, v));
+    adj_set.insert(edge_key(v, u));
+    if (state[u] != Precolored) {
+        adj_list[u].push_back(v);
+        degree[u]++;
+    }
+    if (state[v] != Precolored) {
+        adj_list[v].push_back(u);
+        degree[v]++;
+    }
+}
+
+void GraphColoringAllocator::run(const LivenessAnalysis& liveness) {
+    reset_statistics();
+    build(liveness);
+    make_worklist();
+
+    while (true) {
+        if (!simplify_worklist.empty()) simplify();
+        else if (!worklist_moves.empty()) coalesce();
+        else if (!freeze_worklist.empty()) freeze();
+        else if (!spill_worklist.empty()) select_spill();
+        else break;
+    }
+    assign_colors();
+    assign_slots();
+
+    for (MoveState s : move_state) {
+        if (s == MoveCoalesced) coalesced_moves++;
+    }
+}
+
+// Interference graph: a value defined by an instruction interferes with
+// everything live after it. Copies between temps are recorded as moves
+// and do not make their two sides interfere.
+void GraphColoringAllocator::build(const LivenessAnalysis& liveness) {
+    const std::vector<std::string>& names = liveness.names();
+    const ControlFlowGraph& cfg = liveness.graph();
+
+    int nodes = k;
+    temp_node.assign(names.size(), -1);
+    node_of.clear();
+    for (size_t v = 0; v < names.size(); ++v) {
+        if (!is_temporary_name(names[v])) continue;
+        temp_node[v] = nodes;
+        node_of[names[v]] = nodes;
+        nodes++;
+    }
+    interval_count = nodes - k;
+
+    adj_set.clear();
+    adj_list.assign(nodes, {});
+    degree.assign(nodes, 0);
+    state.assign(nodes, Initial);
+    alias.assign(nodes, -1);
+    color.assign(nodes, -1);
+    slot.assign(nodes, -1);
+    cost.assign(nodes, 0);
+    move_list.assign(nodes, {});
+    moves.clear();
+    move_state.clear();
+    simplify_worklist.clear();
+    freeze_worklist.clear();
+    spill_worklist.clear();
+    worklist_moves.clear();
+    active_moves.clear();
+    select_stack.clear();
+    for (int r = 0; r < k; ++r) {
+        state[r] = Precolored;
+        color[r] = r;
+        degree[r] = INT_MAX / 2;
+    }
+
+    std::vector<int> depth, block_of;
+    position_info(cfg, depth, block_of);
+    for (const auto& interval : liveness.intervals()) {
+        int n = temp_node[interval.value];
+        if (n < 0) continue;
+        for (int p : interval.uses) cost[n] += std::pow(10.0, std::min(depth[p], 8));
+        for (int p : interval.defs) cost[n] += std::pow(10.0, std::min(depth[p], 8));
+    }
+
+    auto node = [&](const std::string& name) {
+        int id = liveness.value_id(name);
+        return id < 0 ? -1 : temp_node[id];
+    };
+
+    std::vector<std::string> operands;
+    LiveSet live(liveness);
+    for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+        const BasicBlock& block = cfg.blocks[b];
+        if (block.position < 0) continue;
+        live.start(static_cast<int>(b));
+        auto read = [&](const std::string& name) {
+            int id = liveness.value_id(name);
+            if (id >= 0 && temp_node[id] >= 0) live.set(id);
+        };
+        if (block.terminator == BasicBlock::CondJump) {
+            read(block.condition.arg1);
+            read(block.condition.arg2);
+        }
+
+        for (int i = static_cast<int>(block.instrs.size()) - 1; i >= 0; --i) {
+            const TacInstr& instr = block.instrs[i];
+            int def_id = liveness.value_id(instr_def(instr));
+            int def = def_id < 0 ? -1 : temp_node[def_id];
+            instr_uses(instr, operands);
+
+            // `t = a op b` is emitted as `mov t, a` + `op t, b`, so every
+            // assignment from a temp is a move candidate. Only a plain copy
+            // lets the two share a register while both stay live.
+            bool is_move = instr.kind == TacOp::Assign && def >= 0 && node(instr.arg1) >= 0;
+            if (is_move) {
+                int src = node(instr.arg1);
+                if (instr.op.empty()) live.reset(liveness.value_id(instr.arg1));
+                int m = static_cast<int>(moves.size());
+                moves.emplace_back(def, src);
+                move_state.push_back(MoveWorklist);
+                worklist_moves.insert(m);
+                move_list[def].push_back(m);
+                move_list[src].push_back(m);
+            }
+
+            if (def >= 0) {
+                live.for_each([&](size_t l) { add_edge(temp_node[l], def); });
+                // The backend computes `a op b` into the destination before
+                // reading b, so the two cannot share a register
+                if (!instr.arg2.empty() && node(instr.arg2) >= 0) add_edge(def, node(instr.arg2));
+            }
+
+            // Temps live across the instruction, and its operands, cannot sit
+            // in a register it overwrites
+            for (const std::string& reg : clobbered_registers(instr)) {
+                int r = static_cast<int>(std::find(registers.begin(), registers.end(), reg) - registers.begin());
+                if (r >= k) continue;
+                live.for_each([&](size_t l) {
+                    if (static_cast<int>(l) != def_id) add_edge(temp_node[l], r);
+                });
+                for (const auto& name : operands) {
+                    if (node(name) >= 0) add_edge(node(name), r);
+                }
+            }
+
+            if (def_id >= 0) live.reset(def_id);
+            for (const auto& name : operands) read(name);
+        }
+    }
+}
+
+void GraphColoringAllocator::make_worklist() {
+    for (size_t n = k; n < state.size(); ++n) {
+        int node = static_cast<int>(n);
+        if (degree[node] >= k) {
+            state[node] = SpillList;
+            spill_worklist.insert(node);
+        } else if (move_related(node)) {
+            state[node] = FreezeList;
+            freeze_worklist.insert(node);
+        } else {
+            state[node] = SimplifyList;
+            simplify_worklist.insert(node);
+        }
+    }
+}
+
+std::vector<int> GraphColoringAllocator::adjacent_nodes(int n) const {
+    std::vector<int> result;
+    for (int m : adj_list[n]) {
+        if (state[m] != OnStack && state[m] != Coalesced) result.push_back(m);
+    }
+    return result;
+}
+
+std::vector<int> GraphColoringAllocator::node_moves(int n) const {
+    std::vector<int> result;
+    for (int m : move_list[n]) {
+        if (move_state[m] == MoveWorklist || move_state[m] == MoveActive) result.push_back(m);
+    }
+    return result;
+}
+
+bool GraphColoringAllocator::move_related(int n) const {
+    for (int m : move_list[n]) {
+        if (move_state[m] == MoveWorklist || move_state[m] == MoveActive) return true;
+    }
+    return false;
+}
+
+void GraphColoringAllocator::simplify() {
+    int n = *simplify_worklist.begin();
+    simplify_worklist.erase(simplify_worklist.begin());
+    state[n] = OnStack;
+    select_stack.push_back(n);
+    for (int m : adjacent_nodes(n)) decrement_degree(m);
+}
+
+void GraphColoringAllocator::decrement_degree(int m) {
+    if (state[m] == Precolored) return;
+    int d = degree[m]--;
+    if (d != k) return;
+
+    enable_moves(m);
+    for (int n : adjacent_nodes(m)) enable_moves(n);
+    spill_worklist.erase(m);
+    if (move_related(m)) {
+        state[m] = FreezeList;
+        freeze_worklist.insert(m);
+    } else {
+        state[m] = SimplifyList;
+        simplify_worklist.insert(m);
+    }
+}
+
+void GraphColoringAllocator::enable_moves(int n) {
+    for (int m : node_moves(n)) {
+        if (move_state[m] == MoveActive) {
+            active_moves.erase(m);
+            move_state[m] = MoveWorklist;
+            worklist_moves.insert(m);
+        }
+    }
+}
+
+int GraphColoringAllocator::get_alias(int n) const {
+    while (state[n] == Coalesced) n = alias[n];
+    return n;
+}
+
+void GraphColoringAllocator::add_worklist(int u) {
+    if (state[u] != Precolored && !move_related(u) && degree[u] < k) {
+        freeze_worklist.erase(u);
+        state[u] = SimplifyList;
+        simplify_worklist.insert(u);
+    }
+}
+
+// George's test, used when coalescing with a machine register
+bool GraphColoringAllocator::ok(int t, int r) const {
+    return degree[t] < k || state[t] == Precolored || adjacent(t, r);
+}
+
+// Briggs' test: the merged node has fewer than k significant neighbours
+bool GraphColoringAllocator::conservative(const std::vector<int>& nodes) const {
+    int significant = 0;
+    for (int n : nodes) {
+        if (degree[n] >= k) significant++;
+    }
+    return significant < k;
+}
+
+void GraphColoringAllocator::coalesce() {
+    int m = *worklist_moves.begin();
+    worklist_moves.erase(worklist_moves.begin());
+    int x = get_alias(moves[m].first);
+    int y = get_alias(moves[m].second);
+    int u = x, v = y;
+    if (state[y] == Precolored) {
+        u = y;
+        v = x;
+    }
+
+    if (u == v) {
+        move_state[m] = MoveCoalesced;
+        add_worklist(u);
+        return;
+    }
+    if (state[v] == Precolored || adjacent(u, v)) {
+        move_state[m] = MoveConstrained;
+        add_worklist(u);
+        add_worklist(v);
+        return;
+    }
+
+    bool can_combine;
+    std::vector<int> v_adjacent = adjacent_nodes(v);
+    if (state[u] == Precolored) {
+        can_combine = std::all_of(v_adjacent.begin(), v_adjacent.end(), [&](int t) { return ok(t, u); });
+    } else {
+        std::vector<int> nodes = adjacent_nodes(u);
+        nodes.insert(nodes.end(), v_adjacent.begin(), v_adjacent.end());
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        can_combine = conservative(nodes);
+    }
+
+    if (can_combine) {
+        move_state[m] = MoveCoalesced;
+        combine(u, v);
+        add_worklist(u);
+    } else {
+        move_state[m] = MoveActive;
+        active_moves.insert(m);
+    }
+}
+
+void GraphColoringAllocator::combine(int u, int v) {
+    if (state[v] == FreezeList) freeze_worklist.erase(v);
+    else spill_worklist.erase(v);
+    state[v] = Coalesced;
+    alias[v] = u;
+    move_list[u].insert(move_list[u].end(), move_list[v].begin(), move_list[v].end());
+    cost[u] += cost[v];
+    enable_moves(v);
+    for (int t : adjacent_nodes(v)) {
+        add_edge(t, u);
+        decrement_degree(t);
+    }
+    if (degree[u] >= k && state[u] == FreezeList) {
+        freeze_worklist.erase(u);
+        state[u] = SpillList;
+        spill_worklist.insert(u);
+    }
+}
+
+void GraphColoringAllocator::freeze() {
+    int u = *freeze_worklist.begin();
+    freeze_worklist.erase(freeze_worklist.begin());
+    state[u] = SimplifyList;
+    simplify_worklist.insert(u);
+    freeze_moves(u);
+}
+
+void GraphColoringAllocator::freeze_moves(int u) {
+    for (int m : node_moves(u)) {
+        int x = moves[m].first;
+        int y = moves[m].second;
+        int v = get_alias(y) == get_alias(u) ? get_alias(x) : get_alias(y);
+        active_moves.erase(m);
+        worklist_moves.erase(m);
+        move_state[m] = MoveFrozen;
+        if (state[v] == FreezeList && !move_related(v) && degree[v] < k) {
+            freeze_worklist.erase(v);
+            state[v] = SimplifyList;
+            simplify_worklist.insert(v);
+        }
+    }
+}
+
+// Optimistically push the node that is cheapest to keep in memory per
+// neighbour it would free; it is only really spilled if no color is left
+void GraphColoringAllocator::select_spill() {
+    int best = -1;
+    for (int n : spill_worklist) {
+        if (best < 0 || cost[n] * degree[best] < cost[best] * degree[n]) best = n;
+    }
+    spill_worklist.erase(best);
+    state[best] = SimplifyList;
+    simplify_worklist.insert(best);
+    freeze_moves(best);
+}
+
+void GraphColoringAllocator::assign_colors() {
+    while (!select_stack.empty()) {
+        int n = select_stack.back();
+        select_stack.pop_back();
+        std::vector<bool> available(k, true);
+        for (int w : adj_list[n]) {
+            int a = get_alias(w);
+            if (state[a] == Colored || state[a] == Precolored) available[color[a]] = false;
+        }
+        int c = static_cast<int>(std::find(available.begin(), available.end(), true) - available.begin());
+        if (c == k) {
+            state[n] = Spilled;
+        } else {
+            state[n] = Colored;
+            color[n] = c;
+        }
+    }
+}
+
+// Spilled temps that do not interfere share a stack slot
+void GraphColoringAllocator::assign_slots() {
+    for (size_t n = k; n < state.size(); ++n) {
+        if (state[n] != Spilled) continue;
+        spilled_intervals++;
+        std::vector<bool> used(slot_count, false);
+        for (int w : adj_list[n]) {
+            int a = get_alias(w);
+            if (state[a] == Spilled && slot[a] >= 0) used[slot[a]] = true;
+        }
+        int s = static_cast<int>(std::find(used.begin(), used.end(), false) - used.begin());
+        if (s == slot_count) slot_count++;
+        slot[n] = s;
+    }
+}
+
+std::string GraphColoringAllocator::register_at(const std::string& temp, int) const {
+    auto found = node_of.find(temp);
+    if (found == node_of.end()) return "";
+    int n = get_alias(found->second);
+    return state[n] == Colored ? registers[color[n]] : "";
+}
+
+int GraphColoringAllocator::slot_of(const std::string& temp) const {
+    auto found = node_of.find(temp);
+    if (found == node_of.end()) return -1;
+    return slot[get_alias(found->second)];
+}
@@ -0,0 +1,76 @@
+#ifndef GRAPH_COLORING_H
+#define GRAPH_COLORING_H
+
+#include "regalloc.h"
+#include <cstdint>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+// Iterated register coalescing (George & Appel): Chaitin-Briggs coloring of
+// the interference graph with conservative coalescing of copies between
+// temps. The machine registers are precolored nodes, so an instruction that
+// clobbers a register (see clobbered_registers) makes every temp live across
+// it interfere with that register.
+//
+// Each temp gets one register for its whole lifetime or lives in a stack
+// slot. Spilled temps are used as memory operands with eax as scratch, so
+// no rewrite-and-retry round is needed; spilled temps that do not interfere
+// share a slot. Costs more compile time than linear scan but sees the whole
+// graph, and coalesced copies disappear from the output.
+class GraphColoringAllocator : public RegisterAllocator {
+public:
+    GraphColoringAllocator(const std::vector<std::string>& registers);
+    void run(const LivenessAnalysis& liveness) override;
+    const char* name() const override { return "graph coloring"; }
+
+    std::string register_at(const std::string& temp, int position) const override;
+    int slot_of(const std::string& temp) const override;
+
+private:
+    enum NodeState { Precolored, Initial, SimplifyList, FreezeList, SpillList, Spilled, Coalesced, Colored, OnStack };
+    enum MoveState { MoveWorklist, MoveActive, MoveCoalesced, MoveConstrained, MoveFrozen };
+
+    int k;
+    std::vector<int> temp_node;  // Node of each liveness value, -1 for non-temps
+    std::unordered_map<std::string, int> node_of;
+
+    std::unordered_set<uint64_t> adj_set;
+    std::vector<std::vector<int>> adj_list;
+    std::vector<int> degree;
+    std::vector<NodeState> state;
+    std::vector<int> alias;
+    std::vector<int> color;
+    std::vector<int> slot;
+    std::vector<double> cost;
+    std::vector<std::vector<int>> move_list;
+    std::vector<std::pair<int, int>> moves;  // (dest, src)
+    std::vector<MoveState> move_state;
+
+    std::set<int> simplify_worklist, freeze_worklist, spill_worklist, worklist_moves, active_moves;
+    std::vector<int> select_stack;
+
+    void build(const LivenessAnalysis& liveness);
+    void add_edge(int u, int v);
+    bool adjacent(int u, int v) const;
+    std::vector<int> adjacent_nodes(int n) const;
+    std::vector<int> node_moves(int n) const;
+    bool move_related(int n) const;
+    void make_worklist();
+    void simplify();
+    void decrement_degree(int m);
+    void enable_moves(int n);
+    void coalesce();
+    void add_worklist(int u);
+    bool ok(int t, int r) const;
+    bool conservative(const std::vector<int>& nodes) const;
+    int get_alias(int n) const;
+    void combine(int u, int v);
+    void freeze();
+    void freeze_moves(int u);
+    void select_spill();
+    void assign_colors();
+    void assign_slots();
+};
+
+#endif // GRAPH_COLORING_H
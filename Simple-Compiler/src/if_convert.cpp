@@ -0,0 +1,400 @@
+#include "if_convert.h"
+#include "liveness.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+
+// Instructions the shorter arm and the selects may add over the branch,
+// about what a mispredict costs when half the branches go each way
+static const int kMaxExtraWork = 4;
+// Computing instructions per arm
+static const int kMaxArmSize = 4;
+
+IfConverter::IfConverter() : converted(0), selects(0), set_flags(0), next_temp(1) {}
+
+std::string IfConverter::fresh_temp() {
+    return "t" + std::to_string(next_temp++);
+}
+
+static TacInstr make_assign(const std::string& dest, const std::string& arg1, const std::string& op,
+                            const std::string& arg2) {
+    TacInstr instr;
+    instr.kind = TacOp::Assign;
+    instr.dest = dest;
+    instr.arg1 = arg1;
+    instr.op = op;
+    instr.arg2 = arg2;
+    return instr;
+}
+
+static TacInstr make_conditional_move(const std::string& dest, const std::string& condition,
+                                      const std::string& value) {
+    TacInstr instr;
+    instr.kind = TacOp::CondMove;
+    instr.dest = dest;
+    instr.arg1 = condition;
+    instr.arg2 = value;
+    return instr;
+}
+
+namespace {
+
+// One arm run unconditionally: its computations write fresh temps, and
+// `value` maps each temp the arm wrote to the operand holding its result
+struct Arm {
+    std::vector<TacInstr> code;
+    std::map<std::string, std::string> value;
+    int size = 0;
+};
+
+// How a result picks its value after both arms ran
+struct Select {
+    enum Kind { Copy, SetFlag, MoveThen, MoveElse, Both };
+    Kind kind;
+    std::string target, then_value, else_value;
+};
+
+} // namespace
+
+// Liveness of the listing as the sweep found it. Conversions keep the
+// labels they do not remove, so `block_of` still finds each join. A
+// conversion reads no value the branch did not, which leaves the live-in
+// of a later join as it was unless a loop leads from that join back into
+// the rewritten code; there it may only have lost values. `reach` is the
+// lowest block each block can reach. Every rewritten block lies before
+// `last_join`, the highest join rewritten so far, so a join that reaches
+// no block before it has the live-in the sweep computed.
+//
+// The listing itself is a chain of nodes, -1 ending it. A conversion
+// appends its code as new nodes and links them in place of the branch;
+// the nodes it replaced stay behind, unlinked. Labels keep their nodes.
+struct IfConverter::Sweep {
+    std::unique_ptr<LivenessAnalysis> liveness;
+    std::unordered_map<std::string, int> block_of;
+    std::vector<int> reach;
+    int last_join = -1;
+    std::map<std::string, int> references; // Jumps to each label
+
+    std::vector<TacInstr> nodes;
+    std::vector<int> next, prev;
+    int head = -1;
+    std::unordered_map<std::string, int> label_at;
+    std::vector<int> visited; // Per node: the last read_before_written walk to see it
+    int walks = 0;
+
+    // Links `code` in place of the nodes from `first` up to `end`
+    void replace(int first, int end, const std::vector<TacInstr>& code) {
+        int at = prev[first];
+        for (const auto& instr : code) {
+            int node = static_cast<int>(nodes.size());
+            nodes.push_back(instr);
+            next.push_back(-1);
+            prev.push_back(at);
+            visited.push_back(0);
+            (at >= 0 ? next[at] : head) = node;
+            at = node;
+        }
+        (at >= 0 ? next[at] : head) = end;
+        prev[end] = at;
+    }
+};
+
+// Whether `name` may be read on some path from node `from` of the listing
+// before it is written. Temps are dead at the end of the program.
+bool IfConverter::read_before_written(const std::string& name, int from, Sweep& sweep) const {
+    const std::vector<TacInstr>& listing = sweep.nodes;
+    int walk = ++sweep.walks;
+    std::vector<int> pending = {from};
+    std::vector<std::string> uses;
+    while (!pending.empty()) {
+        int at = pending.back();
+        pending.pop_back();
+        for (; at >= 0 && sweep.visited[at] != walk; at = sweep.next[at]) {
+            sweep.visited[at] = walk;
+            const TacInstr& instr = listing[at];
+            instr_uses(instr, uses);
+            if (std::find(uses.begin(), uses.end(), name) != uses.end()) return true;
+            if (instr_def(instr) == name) break;
+            if (instr.is_jump()) pending.push_back(sweep.label_at.at(instr.label));
+            if (instr.kind == TacOp::Goto) break;
+        }
+    }
+    return false;
+}
+
+bool IfConverter::convert(int branch, Sweep& sweep) {
+    const std::vector<TacInstr>& listing = sweep.nodes;
+    const TacInstr test = listing[branch];
+    if (test.kind != TacOp::IfGoto) return false;
+
+    auto straight_end = [&](int from) {
+        while (from >= 0 && listing[from].kind != TacOp::Label && !listing[from].is_jump()) from = sweep.next[from];
+        return from;
+    };
+
+    // IF c GOTO L1; then; GOTO L2; L1: else; L2:   or   IF c GOTO L2; then; L2:
+    int then_begin = sweep.next[branch], then_end = straight_end(then_begin);
+    int else_begin = -1, else_end = -1;
+    if (then_end < 0) return false;
+    std::string join;
+    if (listing[then_end].kind == TacOp::Goto) {
+        join = listing[then_end].label;
+        int else_label = sweep.next[then_end];
+        if (else_label < 0 || listing[else_label].kind != TacOp::Label) return false;
+        if (listing[else_label].label != test.label) return false;
+        else_begin = sweep.next[else_label];
+        else_end = straight_end(else_begin);
+        if (else_end < 0 || listing[else_end].kind != TacOp::Label || listing[else_end].label != join) return false;
+        if (sweep.references[test.label] != 1) return false;
+    } else if (listing[then_end].kind == TacOp::Label && listing[then_end].label == test.label) {
+        join = test.label;
+        else_begin = else_end = then_end;
+    } else {
+        return false;
+    }
+    int join_at = else_end;
+
+    // Arms compute into temps only, and nothing in them may trap
+    auto speculable = [&](int begin, int end) {
+        for (int i = begin; i != end; i = sweep.next[i]) {
+            const TacInstr& instr = listing[i];
+            if (instr.kind != TacOp::Assign || !is_temporary_name(instr.dest)) return false;
+            if (instr.op == "/" || instr.op == "%") return false;
+        }
+        return true;
+    };
+    if (!speculable(then_begin, then_end) || !speculable(else_begin, else_end)) return false;
+
+    // Results live at the join, in order of first write. A value the
+    // sweep's liveness has dead there is dead; one it has live is checked
+    // on the listing as it is now if an earlier conversion of this sweep
+    // may have changed the join's live-in.
+    auto found_block = sweep.block_of.find(join);
+    if (found_block == sweep.block_of.end()) return false;
+    int join_block = found_block->second;
+    bool recheck = sweep.reach[join_block] < sweep.last_join;
+    std::vector<std::string> targets;
+    for (int i = then_begin; i != else_end; i = sweep.next[i]) {
+        const std::string& dest = listing[i].dest;
+        if (dest.empty() || std::find(targets.begin(), targets.end(), dest) != targets.end()) continue;
+        int id = sweep.liveness->value_id(dest);
+        if (!sweep.liveness->live_in(join_block, id)) continue;
+        if (recheck && !read_before_written(dest, join_at, sweep)) continue;
+        targets.push_back(dest);
+    }
+
+    long first_temp = next_temp;
+    auto speculate = [&](int begin, int end, Arm& arm) {
+        auto resolve = [&](const std::string& operand) {
+            auto found = arm.value.find(operand);
+            return found == arm.value.end() ? operand : found->second;
+        };
+        for (int i = begin; i != end; i = sweep.next[i]) {
+            TacInstr instr = listing[i];
+            instr.arg1 = resolve(instr.arg1);
+            if (!instr.arg2.empty()) instr.arg2 = resolve(instr.arg2);
+            if (instr.op.empty()) {
+                arm.value[instr.dest] = instr.arg1;
+                continue;
+            }
+            std::string result = fresh_temp();
+            arm.value[instr.dest] = result;
+            instr.dest = result;
+            instr.indent = test.indent;
+            arm.code.push_back(instr);
+            arm.size++;
+        }
+    };
+    Arm then_arm, else_arm;
+    speculate(then_begin, then_end, then_arm);
+    speculate(else_begin, else_end, else_arm);
+
+    std::vector<Select> plan;
+    int select_count = 0;
+    for (const auto& target : targets) {
+        Select select;
+        select.target = target;
+        auto then_found = then_arm.value.find(target);
+        auto else_found = else_arm.value.find(target);
+        select.then_value = then_found == then_arm.value.end() ? target : then_found->second;
+        select.else_value = else_found == else_arm.value.end() ? target : else_found->second;
+        const std::string& t = select.then_value;
+        const std::string& e = select.else_value;
+        if (t == e) {
+            if (t == target) continue;
+            select.kind = Select::Copy;
+        } else if ((t == "1" && e == "0") || (t == "0" && e == "1")) {
+            select.kind = Select::SetFlag;
+            select_count++;
+        } else if (e == target) {
+            select.kind = Select::MoveThen;
+            select_count++;
+        } else if (t == target) {
+            select.kind = Select::MoveElse;
+            select_count++;
+        } else {
+            select.kind = Select::Both;
+            select_count++;
+        }
+        plan.push_back(select);
+    }
+
+    int extra = std::min(then_arm.size, else_arm.size) + select_count;
+    if (extra > kMaxExtraWork || std::max(then_arm.size, else_arm.size) > kMaxArmSize) {
+        next_temp = first_temp;
+        return false;
+    }
+
+    // Every select reads the values from before the branch. One that reads
+    // a result an earlier select already wrote reads a copy taken first.
+    std::set<std::string> written, stale;
+    for (const auto& select : plan) {
+        for (const std::string* operand : {&test.arg1, &test.arg2, &select.then_value, &select.else_value}) {
+            if (written.count(*operand)) stale.insert(*operand);
+        }
+        written.insert(select.target);
+    }
+
+    std::vector<TacInstr> result = then_arm.code;
+    result.insert(result.end(), else_arm.code.begin(), else_arm.code.end());
+    std::map<std::string, std::string> snapshot;
+    for (const auto& name : stale) {
+        snapshot[name] = fresh_temp();
+        result.push_back(make_assign(snapshot[name], name, "", ""));
+    }
+    auto original = [&](const std::string& operand) {
+        auto found = snapshot.find(operand);
+        return found == snapshot.end() ? operand : found->second;
+    };
+
+    // The branch skips the then arm when its comparison holds
+    const std::string left = original(test.arg1), right = original(test.arg2);
+    const std::string taken = test.op, not_taken = negate_comparison(test.op);
+    for (const auto& select : plan) {
+        const std::string& target = select.target;
+        std::string then_value = original(select.then_value);
+        std::string else_value = original(select.else_value);
+        if (select.kind == Select::Copy) {
+            result.push_back(make_assign(target, then_value, "", ""));
+            continue;
+        }
+        if (select.kind == Select::SetFlag) {
+            result.push_back(make_assign(target, left, then_value == "1" ? not_taken : taken, right));
+            set_flags++;
+            continue;
+        }
+        std::string relation = select.kind == Select::MoveElse ? taken : not_taken;
+        std::string moved = select.kind == Select::MoveElse ? else_value : then_value;
+        std::string condition = fresh_temp();
+        TacInstr compare = make_assign(condition, left, relation, right);
+        if (select.kind == Select::Both) {
+            // The compare goes right before its CMOV so the two fuse, unless
+            // it reads the target the copy overwrites
+            TacInstr copy = make_assign(target, else_value, "", "");
+            if (left == target || right == target) {
+                result.push_back(compare);
+                result.push_back(copy);
+            } else {
+                result.push_back(copy);
+                result.push_back(compare);
+            }
+        } else {
+            result.push_back(compare);
+        }
+        result.push_back(make_conditional_move(target, condition, moved));
+        selects++;
+    }
+    for (auto& instr : result) instr.indent = test.indent;
+
+    sweep.references[test.label]--;
+    if (join != test.label) sweep.references[join]--;
+    sweep.last_join = std::max(sweep.last_join, join_block);
+    sweep.replace(branch, join_at, result);
+    return true;
+}
+
+void IfConverter::run(std::vector<TacInstr>& listing) {
+    converted = selects = set_flags = 0;
+    next_temp = 1;
+    for (const auto& instr : listing) {
+        for (const std::string* operand : {&instr.dest, &instr.arg1, &instr.arg2}) {
+            if (!is_temporary_name(*operand)) continue;
+            if (std::all_of(operand->begin() + 1, operand->end(), ::isdigit)) {
+                next_temp = std::max(next_temp, std::stol(operand->substr(1)) + 1);
+            }
+        }
+    }
+
+    // Sweep until nothing changes; the backing up below makes a second
+    // sweep find little
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        Sweep sweep;
+        sweep.liveness = std::make_unique<LivenessAnalysis>(listing, false);
+        const ControlFlowGraph& cfg = sweep.liveness->graph();
+        int blocks = static_cast<int>(cfg.blocks.size());
+        sweep.reach.resize(blocks);
+        for (int b = 0; b < blocks; ++b) {
+            sweep.reach[b] = b;
+            if (!cfg.blocks[b].removed && !cfg.blocks[b].label.empty()) sweep.block_of[cfg.blocks[b].label] = b;
+        }
+        // Blocks are in layout order, so only back edges need another pass
+        for (bool again = true; again;) {
+            again = false;
+            for (int b = blocks - 1; b >= 0; --b) {
+                if (cfg.blocks[b].removed) continue;
+                for (int successor : cfg.blocks[b].successors()) {
+                    if (sweep.reach[successor] < sweep.reach[b]) {
+                        sweep.reach[b] = sweep.reach[successor];
+                        again = true;
+                    }
+                }
+            }
+        }
+        int count = static_cast<int>(listing.size());
+        sweep.nodes = listing;
+        sweep.next.resize(count);
+        sweep.prev.resize(count);
+        sweep.visited.assign(count, 0);
+        for (int i = 0; i < count; ++i) {
+            sweep.next[i] = i + 1 < count ? i + 1 : -1;
+            sweep.prev[i] = i - 1;
+            if (listing[i].kind == TacOp::Label) sweep.label_at[listing[i].label] = i;
+            if (listing[i].is_jump()) sweep.references[listing[i].label]++;
+        }
+        sweep.head = count > 0 ? 0 : -1;
+
+        const std::vector<TacInstr>& nodes = sweep.nodes;
+        auto back_to_jump = [&](int at) {
+            while (at >= 0 && nodes[at].kind != TacOp::Label && !nodes[at].is_jump()) at = sweep.prev[at];
+            return at;
+        };
+        for (int i = sweep.head; i >= 0;) {
+            int before = sweep.prev[i];
+            if (nodes[i].kind != TacOp::IfGoto || !convert(i, sweep)) {
+                i = sweep.next[i];
+                continue;
+            }
+            converted++;
+            changed = true;
+            // An inner diamond converted can make the arm around it
+            // straight-line: back up to the branch of that arm, if any. Its
+            // then arm ends right before the rewritten code, its else arm at
+            // a label after a GOTO. Otherwise go on from the rewritten code.
+            int at = back_to_jump(before);
+            if (at >= 0 && nodes[at].kind == TacOp::Label && sweep.prev[at] >= 0 &&
+                nodes[sweep.prev[at]].kind == TacOp::Goto) {
+                at = back_to_jump(sweep.prev[sweep.prev[at]]);
+            }
+            if (at >= 0 && nodes[at].kind == TacOp::IfGoto) i = at;
+            else i = before >= 0 ? sweep.next[before] : sweep.head;
+        }
+
+        if (!changed) break;
+        listing.clear();
+        for (int i = sweep.head; i >= 0; i = sweep.next[i]) listing.push_back(sweep.nodes[i]);
+    }
+}
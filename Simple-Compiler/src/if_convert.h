@@ -0,0 +1,54 @@
+#ifndef IF_CONVERT_H
+#define IF_CONVERT_H
+
+#include "ir.h"
+#include <string>
+#include <vector>
+
+// If-conversion of small diamonds and triangles:
+//
+//     IF a > b GOTO L1               t1 = a > b
+//         m = a            becomes   m = b
+//     GOTO L2                        CMOV m, t1, a
+//     L1:
+//         m = b
+//     L2:
+//
+// Arms qualify if they only compute into temps, without division (which
+// could trap once it runs unconditionally). Both arms then run, writing
+// fresh temps. Each result that is live at the join picks its value with
+// a compare and a CMOV; a result that is 1 on one side and 0 on the other
+// becomes the comparison itself, which the backend emits as setcc. The
+// instruction selector folds each compare into its CMOV.
+//
+// Profitability is judged on arm size. The converted code runs both arms
+// plus one select per result, where the branch ran the longer arm at most.
+// The extra work (the shorter arm plus the selects) must stay within the
+// expected cost of a mispredicted data-dependent branch, and no arm may be
+// long, since a cmov also waits for both of its inputs.
+//
+// A sweep computes liveness once and scans the listing forward. After a
+// conversion it goes on from the rewritten code, or from the branch around
+// it when the rewrite may have made that branch's arm straight-line. The
+// sweep keeps the listing as a chain it links rewrites into, and writes it
+// back once at the end, so a conversion costs the size of its diamond.
+class IfConverter {
+public:
+    IfConverter();
+    void run(std::vector<TacInstr>& code);
+
+    int converted;  // Branches removed
+    int selects;    // CMOVs emitted
+    int set_flags;  // Results computed as comparisons (setcc)
+
+private:
+    struct Sweep;  // What a sweep knows about the listing it started on
+
+    long next_temp;
+
+    std::string fresh_temp();
+    bool read_before_written(const std::string& name, int from, Sweep& sweep) const;
+    bool convert(int branch, Sweep& sweep);
+};
+
+#endif // IF_CONVERT_H
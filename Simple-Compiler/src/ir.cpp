@@ -0,0 +1,284 @@
+#include "ir.h"
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+TacInstr make_label(const std::string& label) {
+    TacInstr instr;
+    instr.kind = TacOp::Label;
+    instr.label = label;
+    return instr;
+}
+
+TacInstr make_goto(const std::string& label) {
+    TacInstr instr;
+    instr.kind = TacOp::Goto;
+    instr.label = label;
+    return instr;
+}
+
+TacInstr make_if_goto(const std::string& left, const std::string& op, const std::string& right, const std::string& label) {
+    TacInstr instr;
+    instr.kind = TacOp::IfGoto;
+    instr.arg1 = left;
+    instr.op = op;
+    instr.arg2 = right;
+    instr.label = label;
+    return instr;
+}
+
+static std::string strip_comma(std::string token) {
+    if (!token.empty() && token.back() == ',') token.pop_back();
+    return token;
+}
+
+// Splits `a[i]` into the array and the index
+static bool split_element(const std::string& token, std::string& array, std::string& index) {
+    size_t open = token.find('[');
+    if (open == std::string::npos || open == 0 || token.back() != ']') return false;
+    array = token.substr(0, open);
+    index = token.substr(open + 1, token.size() - open - 2);
+    return !index.empty();
+}
+
+// Splits `VADD.4` into the name and the lane count
+static bool split_vector_mnemonic(const std::string& token, std::string& name, int& lanes) {
+    size_t dot = token.find('.');
+    if (dot == std::string::npos || dot + 1 == token.size() || token[0] != 'V') return false;
+    static const char* names[] = {"VLOAD", "VSTORE", "VSPLAT", "VADD", "VSUB", "VMUL"};
+    name = token.substr(0, dot);
+    if (std::find(std::begin(names), std::end(names), name) == std::end(names)) return false;
+    std::string count = token.substr(dot + 1);
+    if (count.size() > 2 || count.find_first_not_of("0123456789") != std::string::npos) return false;
+    lanes = std::stoi(count);
+    return lanes > 0;
+}
+
+// %v3 -> 3
+static int vector_register(const std::string& token, const std::string& line) {
+    if (token.size() < 3 || token.size() > 4 || token.compare(0, 2, "%v") != 0 ||
+        token.find_first_not_of("0123456789", 2) != std::string::npos) {
+        throw std::runtime_error("IR Error: Bad vector register in TAC line '" + line + "'.");
+    }
+    return std::stoi(token.substr(2));
+}
+
+static std::string vector_register_name(int number) {
+    return "%v" + std::to_string(number);
+}
+
+// The operands of a vector instruction whose mnemonic is `name`
+static void parse_vector_instr(const std::string& name, const std::vector<std::string>& tokens,
+                               const std::string& line, TacInstr& instr) {
+    bool arithmetic = name == "VADD" || name == "VSUB" || name == "VMUL";
+    bool parsed = tokens.size() == (arithmetic ? 4u : 3u);
+    if (parsed && arithmetic) {
+        instr.kind = TacOp::VectorOp;
+        instr.op = name == "VADD" ? "+" : name == "VSUB" ? "-" : "*";
+        instr.vdest = vector_register(strip_comma(tokens[1]), line);
+        instr.vsrc1 = vector_register(strip_comma(tokens[2]), line);
+        instr.vsrc2 = vector_register(tokens[3], line);
+    } else if (parsed && name == "VSTORE") {
+        instr.kind = TacOp::VectorStore;
+        parsed = split_element(strip_comma(tokens[1]), instr.array, instr.arg1);
+        instr.vsrc1 = vector_register(tokens[2], line);
+    } else if (parsed) {
+        instr.kind = name == "VLOAD" ? TacOp::VectorLoad : TacOp::VectorSplat;
+        instr.vdest = vector_register(strip_comma(tokens[1]), line);
+        if (instr.kind == TacOp::VectorSplat) instr.arg1 = tokens[2];
+        else parsed = split_element(tokens[2], instr.array, instr.arg1);
+    }
+    if (!parsed) throw std::runtime_error("IR Error: Cannot parse TAC line '" + line + "'.");
+}
+
+TacInstr parse_tac_line(const std::string& raw) {
+    TacInstr instr;
+    size_t first = raw.find_first_not_of(" \t\r");
+    size_t last = raw.find_last_not_of(" \t\r");
+    if (first == std::string::npos) {
+        throw std::runtime_error("IR Error: Empty TAC line.");
+    }
+    for (size_t i = 0; i < first; ++i) {
+        if (raw[i] == '\t') instr.indent++;
+    }
+    std::string line = raw.substr(first, last - first + 1);
+
+    std::stringstream ss(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (ss >> token) tokens.push_back(token);
+
+    std::string vector_op;
+    if (line.back() == ':') {
+        instr.kind = TacOp::Label;
+        instr.label = line.substr(0, line.size() - 1);
+    } else if (tokens.size() > 1 && tokens[1] != "=" && split_vector_mnemonic(tokens[0], vector_op, instr.lanes)) {
+        // A local such as VADD.1 is only ever assigned, `VADD.1 = t1`
+        parse_vector_instr(vector_op, tokens, line, instr);
+    } else if (tokens[0] == "GOTO" && tokens.size() == 2) {
+        instr.kind = TacOp::Goto;
+        instr.label = tokens[1];
+    } else if (tokens[0] == "IF" && tokens.size() == 6) {
+        instr.kind = TacOp::IfGoto;
+        instr.arg1 = tokens[1];
+        instr.op = tokens[2];
+        instr.arg2 = tokens[3];
+        instr.label = tokens[5];
+    } else if (tokens[0] == "MOV" && tokens.size() == 3) {
+        instr.kind = TacOp::Mov;
+        instr.dest = strip_comma(tokens[1]);
+        instr.arg1 = tokens[2];
+    } else if (tokens[0] == "CMOV" && tokens.size() == 4) {
+        instr.kind = TacOp::CondMove;
+        instr.dest = strip_comma(tokens[1]);
+        instr.arg1 = strip_comma(tokens[2]);
+        instr.arg2 = tokens[3];
+    } else if ((tokens[0] == "ADD" || tokens[0] == "SUB") && tokens.size() == 4) {
+        instr.kind = tokens[0] == "ADD" ? TacOp::Add : TacOp::Sub;
+        instr.dest = strip_comma(tokens[1]);
+        instr.arg1 = strip_comma(tokens[2]);
+        instr.arg2 = tokens[3];
+    } else if ((tokens[0] == "ARRAY" || tokens[0] == "BOUNDS") && tokens.size() == 3) {
+        instr.kind = tokens[0] == "ARRAY" ? TacOp::ArrayDecl : TacOp::BoundsCheck;
+        if (instr.kind == TacOp::ArrayDecl) {
+            instr.array = strip_comma(tokens[1]);
+            instr.arg1 = tokens[2];
+        } else {
+            instr.arg1 = strip_comma(tokens[1]);
+            instr.array = tokens[2];
+        }
+    } else if (tokens.size() == 3 && tokens[1] == "=" && split_element(tokens[0], instr.array, instr.arg1)) {
+        instr.kind = TacOp::Store;
+        instr.arg2 = tokens[2];
+    } else if (tokens.size() == 3 && tokens[1] == "=" && split_element(tokens[2], instr.array, instr.arg1)) {
+        instr.kind = TacOp::Load;
+        instr.dest = tokens[0];
+    } else if (tokens.size() >= 3 && tokens.size() <= 5 && tokens[1] == "=") {
+        instr.kind = TacOp::Assign;
+        instr.dest = tokens[0];
+        if (tokens.size() == 3) {        // t1 = a
+            instr.arg1 = tokens[2];
+        } else if (tokens.size() == 4) { // t1 = - a
+            instr.op = tokens[2];
+            instr.arg1 = tokens[3];
+        } else {                         // t1 = a + b
+            instr.arg1 = tokens[2];
+            instr.op = tokens[3];
+            instr.arg2 = tokens[4];
+        }
+    } else {
+        throw std::runtime_error("IR Error: Cannot parse TAC line '" + line + "'.");
+    }
+    return instr;
+}
+
+std::vector<TacInstr> parse_tac(const std::string& code) {
+    std::vector<TacInstr> result;
+    std::stringstream ss(code);
+    std::string line;
+    while (std::getline(ss, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        result.push_back(parse_tac_line(line));
+    }
+    return result;
+}
+
+std::string tac_to_string(const TacInstr& instr) {
+    switch (instr.kind) {
+        case TacOp::Label:
+            return instr.label + ":";
+        case TacOp::Goto:
+            return "GOTO " + instr.label;
+        case TacOp::IfGoto:
+            return "IF " + instr.arg1 + " " + instr.op + " " + instr.arg2 + " GOTO " + instr.label;
+        case TacOp::Mov:
+            return "MOV " + instr.dest + ", " + instr.arg1;
+        case TacOp::Add:
+            return "ADD " + instr.dest + ", " + instr.arg1 + ", " + instr.arg2;
+        case TacOp::Sub:
+            return "SUB " + instr.dest + ", " + instr.arg1 + ", " + instr.arg2;
+        case TacOp::CondMove:
+            return "CMOV " + instr.dest + ", " + instr.arg1 + ", " + instr.arg2;
+        case TacOp::ArrayDecl:
+            return "ARRAY " + instr.array + ", " + instr.arg1;
+        case TacOp::Load:
+            return instr.dest + " = " + instr.array + "[" + instr.arg1 + "]";
+        case TacOp::Store:
+            return instr.array + "[" + instr.arg1 + "] = " + instr.arg2;
+        case TacOp::BoundsCheck:
+            return "BOUNDS " + instr.arg1 + ", " + instr.array;
+        case TacOp::VectorLoad:
+            return "VLOAD." + std::to_string(instr.lanes) + " " + vector_register_name(instr.vdest) + ", " +
+                   instr.array + "[" + instr.arg1 + "]";
+        case TacOp::VectorStore:
+            return "VSTORE." + std::to_string(instr.lanes) + " " + instr.array + "[" + instr.arg1 + "], " +
+                   vector_register_name(instr.vsrc1);
+        case TacOp::VectorSplat:
+            return "VSPLAT." + std::to_string(instr.lanes) + " " + vector_register_name(instr.vdest) + ", " + instr.arg1;
+        case TacOp::VectorOp: {
+            std::string name = instr.op == "+" ? "VADD." : instr.op == "-" ? "VSUB." : "VMUL.";
+            return name + std::to_string(instr.lanes) + " " + vector_register_name(instr.vdest) + ", " +
+                   vector_register_name(instr.vsrc1) + ", " + vector_register_name(instr.vsrc2);
+        }
+        case TacOp::Assign:
+            if (instr.op.empty()) return instr.dest + " = " + instr.arg1;
+            if (instr.arg2.empty()) return instr.dest + " = " + instr.op + " " + instr.arg1;
+            return instr.dest + " = " + instr.arg1 + " " + instr.op + " " + instr.arg2;
+    }
+    return "";
+}
+
+std::string print_tac(const std::vector<TacInstr>& code) {
+    std::stringstream ss;
+    for (const auto& instr : code) {
+        // Labels are not indented, so they stand out
+        if (instr.kind != TacOp::Label) ss << std::string(instr.indent, '\t');
+        ss << tac_to_string(instr) << "\n";
+    }
+    return ss.str();
+}
+
+bool is_temporary_name(const std::string& name) {
+    return name.size() > 1 && name[0] == 't' && isdigit(static_cast<unsigned char>(name[1]));
+}
+
+bool is_local_name(const std::string& name) {
+    return name.find('.') != std::string::npos;
+}
+
+std::string make_local_name(const std::string& id, int number) {
+    return id + "." + std::to_string(number);
+}
+
+bool is_constant(const std::string& operand) {
+    if (operand.empty()) return false;
+    size_t start = operand[0] == '-' ? 1 : 0;
+    if (start == operand.size()) return false;
+    for (size_t i = start; i < operand.size(); ++i) {
+        if (!isdigit(static_cast<unsigned char>(operand[i]))) return false;
+    }
+    return true;
+}
+
+// Returns the comparison that is true exactly when `op` is false
+std::string negate_comparison(const std::string& op) {
+    if (op == "<") return ">=";
+    if (op == ">=") return "<";
+    if (op == ">") return "<=";
+    if (op == "<=") return ">";
+    if (op == "==") return "!=";
+    return "==";
+}
+
+bool is_comparison(const std::string& op) {
+    return op == "<" || op == "<=" || op == ">" || op == ">=" || op == "==" || op == "!=";
+}
+
+bool may_fault(const TacInstr& instr) {
+    if (instr.kind != TacOp::Assign || (instr.op != "/" && instr.op != "%")) return false;
+    if (!is_constant(instr.arg2)) return true;
+    long long divisor = std::stoll(instr.arg2);
+    return divisor == 0 || divisor == -1;
+}
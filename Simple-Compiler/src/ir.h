@@ -0,0 +1,76 @@
+#ifndef IR_H
+#define IR_H
+
+#include <string>
+#include <vector>
+
+// Structured form of one line of three-address code. The semantic analyzer
+// emits TAC as text; optimization passes parse it into TacInstr, rewrite it,
+// and print it back in the same textual format.
+enum class TacOp {
+    Label,  // L1:
+    Goto,   // GOTO L1
+    IfGoto, // IF a < b GOTO L1
+    Assign, // t1 = a  |  t1 = - a  |  t1 = a + b  |  t1 = a < b (1 or 0)
+    Mov,    // MOV x, a
+    Add,    // ADD x, y, z
+    Sub,    // SUB x, y, z
+    CondMove, // CMOV x, c, y: x = y if c is nonzero, else x keeps its value
+    ArrayDecl,   // ARRAY a, 100: a global array of 100 zeroed ints
+    Load,        // t1 = a[i]
+    Store,       // a[i] = v
+    BoundsCheck, // BOUNDS i, a: stops the program unless 0 <= i < size of a
+    // Vector code, `lanes` ints at a time in vector registers %v0, %v1, ...
+    // which nothing else reads or writes. The lanes follow the mnemonic.
+    VectorLoad,  // VLOAD.4 %v0, a[i]: elements i .. i+3 of a
+    VectorStore, // VSTORE.4 a[i], %v0
+    VectorSplat, // VSPLAT.4 %v1, x: x in every lane
+    VectorOp,    // VADD.4 %v0, %v0, %v1, also VSUB and VMUL, lane by lane and wrapping
+};
+
+struct TacInstr {
+    TacOp kind = TacOp::Assign;
+    std::string dest;  // Written operand (Assign, Mov, Add, Sub, CondMove)
+    std::string arg1;  // First source operand; the condition of a CondMove
+    std::string op;    // Operator of an Assign ("" for a copy) or comparison of an IfGoto
+    std::string arg2;  // Second source operand ("" for copies and unary operators)
+    std::string label; // Label name (Label) or jump target (Goto, IfGoto)
+    std::string array; // Array of an ArrayDecl, Load, Store, BoundsCheck, VectorLoad or
+                       // VectorStore; arg1 is the size or the index, arg2 the value stored.
+                       // arg1 is also the value of a VectorSplat.
+    int lanes = 0;     // Vector instructions: ints per register
+    int vdest = -1;    // Vector registers written and read, by number; op is the
+    int vsrc1 = -1;    // VectorOp's "+", "-" or "*"
+    int vsrc2 = -1;
+    int indent = 0;    // Nesting depth, only used for printing
+
+    bool is_jump() const { return kind == TacOp::Goto || kind == TacOp::IfGoto; }
+    bool is_unary() const { return kind == TacOp::Assign && !op.empty() && arg2.empty(); }
+};
+
+TacInstr make_label(const std::string& label);
+TacInstr make_goto(const std::string& label);
+TacInstr make_if_goto(const std::string& left, const std::string& op, const std::string& right, const std::string& label);
+
+TacInstr parse_tac_line(const std::string& line);
+std::vector<TacInstr> parse_tac(const std::string& code);
+std::string tac_to_string(const TacInstr& instr);
+std::string print_tac(const std::vector<TacInstr>& code);
+
+// Operand classification shared by passes and the backend
+bool is_temporary_name(const std::string& name);
+// Block-scoped variables are named `x.N`, which no source identifier can be.
+// They live in the stack frame and are dead once the program ends.
+bool is_local_name(const std::string& name);
+std::string make_local_name(const std::string& id, int number);
+bool is_constant(const std::string& operand);
+
+// Returns the comparison that is true exactly when `op` is false
+std::string negate_comparison(const std::string& op);
+bool is_comparison(const std::string& op);
+
+// A division or remainder whose divisor is not a constant other than 0 and
+// -1 can fault, so it stays even when nothing reads its result
+bool may_fault(const TacInstr& instr);
+
+#endif // IR_H
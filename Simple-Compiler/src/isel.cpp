@@ -0,0 +1,436 @@
+#include "isel.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+InstructionSelector::InstructionSelector()
+    : folded_nodes(0), code(nullptr), liveness(nullptr), allocator(nullptr) {}
+
+// Costs are in cycles of latency on a current x86 core, with one cycle for
+// each extra mov the pattern needs added when it is selected. Ties go to
+// the earlier rule, so the shorter encodings come first.
+const std::vector<InstructionSelector::Rule>& InstructionSelector::rules() {
+    static const std::vector<Rule> table = {
+        {"zero", Tile::Zero, 1},
+        {"inc", Tile::Increment, 1},
+        {"dec", Tile::Decrement, 1},
+        {"test", Tile::Test, 1},
+        {"cmp-memory", Tile::CompareMemory, 1},
+        {"shl", Tile::ShiftLeft, 1},
+        {"default", Tile::Default, 1},
+        {"imul-immediate", Tile::MultiplyImmediate, 3},
+        {"lea", Tile::Lea, 1},
+        {"divide-shift", Tile::DivideShift, 4},
+        {"divide-magic", Tile::DivideMagic, 6},
+        {"idiv", Tile::Divide, 26},
+        {"setcc", Tile::SetCondition, 3},
+        {"cmov", Tile::ConditionalMove, 2},
+        {"cmp-cmov", Tile::CompareMove, 2},
+    };
+    return table;
+}
+
+int InstructionSelector::rule_cost(Tile::Kind kind) const {
+    for (const auto& rule : rules()) {
+        if (rule.kind == kind) return rule.cost;
+    }
+    return 1;
+}
+
+static bool fits_int32(long long value) {
+    return value >= INT_MIN && value <= INT_MAX;
+}
+
+static long long constant_value(const std::string& operand) {
+    try {
+        return std::stoll(operand);
+    } catch (const std::exception&) {
+        return LLONG_MAX;
+    }
+}
+
+static int log2_exact(long long value) {
+    if (value <= 0 || (value & (value - 1)) != 0) return -1;
+    int shift = 0;
+    while ((1LL << shift) < value) ++shift;
+    return shift;
+}
+
+// Multiplier and shift for signed division by a constant `divisor` with
+// 2 <= |divisor| < 2^31 (Hacker's Delight, 10-1): the quotient is the high
+// half of n * magic, corrected by n when the multiplier's sign differs from
+// the divisor's, shifted right and rounded toward zero.
+static void division_magic(int32_t divisor, int& magic, int& shift) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+    uint32_t t = two31 + (static_cast<uint32_t>(divisor) >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    int p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    uint32_t m = q2 + 1;
+    magic = static_cast<int32_t>(divisor < 0 ? 0u - m : m);
+    shift = p - 32;
+}
+
+// An address mode exists for at most two registers, one of them scaled
+static bool encodable(const std::vector<std::pair<std::string, int>>& terms, long long displacement) {
+    if (terms.empty() || terms.size() > 2 || !fits_int32(displacement)) return false;
+    int scaled = 0;
+    for (const auto& term : terms) {
+        if (term.second != 1 && term.second != 2 && term.second != 4 && term.second != 8) return false;
+        if (term.second != 1) ++scaled;
+    }
+    return scaled <= 1;
+}
+
+// A temp can be read by a tile at `root` instead of at `read_at` if it is
+// still in a register there and nothing in between writes it
+bool InstructionSelector::available(const std::string& temp, int read_at, int root) const {
+    if (!is_temporary_name(temp)) return false;
+    if (allocator->register_at(temp, root).empty()) return false;
+    if (read_at == root) return true;
+    int id = liveness->value_id(temp);
+    if (id < 0) return false;
+    const LiveInterval* interval = interval_of[id];
+    if (!interval || !interval->covers(root)) return false;
+    for (int def : interval->defs) {
+        if (def > read_at && def < root) return false;
+    }
+    return true;
+}
+
+// Position of the instruction computing `operand` if it is a tree node
+// whose only reader is the instruction at `read_at`, else -1
+int InstructionSelector::foldable_def(const std::string& operand, int read_at) const {
+    if (!is_temporary_name(operand)) return -1;
+    int id = liveness->value_id(operand);
+    if (id < 0 || def_at[id] < 0) return -1;
+    return user[def_at[id]] == read_at ? def_at[id] : -1;
+}
+
+// Address forms for a TAC operand read at `read_at`: a displacement for a
+// constant, a register term for a temp, or the folded tree computing it
+std::vector<InstructionSelector::Address> InstructionSelector::operand_addresses(
+    const std::string& operand, int read_at, int root) const {
+    std::vector<Address> result;
+    if (is_constant(operand)) {
+        Address address;
+        address.displacement = constant_value(operand);
+        if (fits_int32(address.displacement)) result.push_back(address);
+        return result;
+    }
+    int def = foldable_def(operand, read_at);
+    if (def >= 0) {
+        for (Address address : expression_addresses(def, root)) {
+            address.covered.push_back(def);
+            address.saved += own_cost[def];
+            result.push_back(address);
+        }
+    }
+    if (available(operand, read_at, root)) {
+        Address address;
+        address.terms.push_back({operand, 1});
+        result.push_back(address);
+    }
+    return result;
+}
+
+// Address forms of the value the Assign at `position` computes
+std::vector<InstructionSelector::Address> InstructionSelector::expression_addresses(int position, int root) const {
+    const TacInstr& instr = (*code)[position];
+    std::vector<Address> result;
+    if (instr.op.empty()) return operand_addresses(instr.arg1, position, root);
+    if (instr.is_unary()) return result;
+
+    if (instr.op == "+") {
+        for (const auto& left : operand_addresses(instr.arg1, position, root)) {
+            for (const auto& right : operand_addresses(instr.arg2, position, root)) {
+                Address sum = left;
+                sum.terms.insert(sum.terms.end(), right.terms.begin(), right.terms.end());
+                sum.displacement += right.displacement;
+                sum.covered.insert(sum.covered.end(), right.covered.begin(), right.covered.end());
+                sum.saved += right.saved;
+                if (sum.terms.size() <= 2 && fits_int32(sum.displacement)) result.push_back(sum);
+            }
+        }
+    } else if (instr.op == "-" && is_constant(instr.arg2)) {
+        long long value = constant_value(instr.arg2);
+        for (Address address : operand_addresses(instr.arg1, position, root)) {
+            address.displacement -= value;
+            if (fits_int32(address.displacement)) result.push_back(address);
+        }
+    } else if (instr.op == "*" && is_constant(instr.arg2) && available(instr.arg1, position, root)) {
+        // The index register is scaled by 1, 2, 4 or 8; 3, 5 and 9 also
+        // add it in again as the base
+        long long factor = constant_value(instr.arg2);
+        Address address;
+        if (factor == 1 || factor == 2 || factor == 4 || factor == 8) {
+            address.terms.push_back({instr.arg1, static_cast<int>(factor)});
+            result.push_back(address);
+        } else if (factor == 3 || factor == 5 || factor == 9) {
+            address.terms.push_back({instr.arg1, 1});
+            address.terms.push_back({instr.arg1, static_cast<int>(factor - 1)});
+            result.push_back(address);
+        }
+    }
+
+    // Trees are small, but keep the alternatives per node bounded
+    std::sort(result.begin(), result.end(), [](const Address& a, const Address& b) { return a.saved > b.saved; });
+    if (result.size() > 16) result.resize(16);
+    return result;
+}
+
+// Cheapest tile for the instruction at `position` as the root of its tree.
+// `cost` is the tile's cost less the own costs of the nodes it covers.
+Tile InstructionSelector::select(int position, bool allow_folding, int& cost, std::vector<int>& covered) const {
+    const TacInstr& instr = (*code)[position];
+    Tile best;
+    cost = INT_MAX;
+    covered.clear();
+
+    auto consider = [&](const Tile& tile, int tile_cost, const std::vector<int>& nodes) {
+        if (tile_cost < cost) {
+            best = tile;
+            cost = tile_cost;
+            covered = nodes;
+        }
+    };
+    auto in_register = [&](const std::string& operand) {
+        return is_temporary_name(operand) ? allocator->register_at(operand, position) : std::string();
+    };
+
+    if (instr.kind == TacOp::IfGoto) {
+        Tile tile;
+        std::string left = in_register(instr.arg1);
+        if (!left.empty() && instr.arg2 == "0") {
+            tile.kind = Tile::Test;
+            consider(tile, rule_cost(Tile::Test), {});
+        }
+        if (left.empty() && !is_constant(instr.arg1) && is_constant(instr.arg2)) {
+            tile.kind = Tile::CompareMemory;
+            consider(tile, rule_cost(Tile::CompareMemory), {});
+        }
+        tile.kind = Tile::Default;
+        consider(tile, rule_cost(Tile::Default) + (left.empty() ? 1 : 0), {});
+        return best;
+    }
+
+    if (instr.kind == TacOp::Add || instr.kind == TacOp::Sub) {
+        Tile tile;
+        if (instr.dest == instr.arg1 && (instr.arg2 == "1" || instr.arg2 == "-1")) {
+            bool up = (instr.kind == TacOp::Add) == (instr.arg2 == "1");
+            tile.kind = up ? Tile::Increment : Tile::Decrement;
+            consider(tile, rule_cost(tile.kind), {});
+        }
+        tile.kind = Tile::Default;
+        consider(tile, rule_cost(Tile::Default), {});
+        return best;
+    }
+
+    if (instr.kind == TacOp::CondMove) {
+        // The comparison computing the condition folds in when its operands
+        // can still be read here, leaving its flags for the cmov
+        Tile tile;
+        tile.kind = Tile::ConditionalMove;
+        consider(tile, rule_cost(Tile::ConditionalMove), {});
+        int def = foldable_def(instr.arg1, position);
+        if (def >= 0 && allow_folding) {
+            const TacInstr& condition = (*code)[def];
+            auto readable = [&](const std::string& operand) {
+                return is_constant(operand) || available(operand, def, position);
+            };
+            if (is_comparison(condition.op) && readable(condition.arg1) && readable(condition.arg2)) {
+                tile.kind = Tile::CompareMove;
+                tile.left = condition.arg1;
+                tile.relation = condition.op;
+                tile.right = condition.arg2;
+                consider(tile, rule_cost(Tile::CompareMove) - own_cost[def], {def});
+            }
+        }
+        return best;
+    }
+
+    if (instr.kind != TacOp::Assign) {
+        cost = 0;
+        return best;
+    }
+
+    // Extra movs of the generic template: into the destination register
+    // first, and out to the destination's slot if it was spilled
+    std::string dest = in_register(instr.dest);
+    int moves = dest.empty() ? 1 : 0;
+    if (dest.empty() || in_register(instr.arg1) != dest) ++moves;
+
+    Tile tile;
+    if (instr.op.empty()) {
+        if (instr.arg1 == "0" && !dest.empty()) {
+            tile.kind = Tile::Zero;
+            consider(tile, rule_cost(Tile::Zero), {});
+        }
+        tile.kind = Tile::Default;
+        consider(tile, in_register(instr.arg1) == dest && !dest.empty() ? 0 : moves, {});
+        return best;
+    }
+
+    if (instr.is_unary()) {
+        tile.kind = Tile::Default;
+        consider(tile, rule_cost(Tile::Default) + moves, {});
+        return best;
+    }
+
+    if (is_comparison(instr.op)) {
+        tile.kind = Tile::SetCondition;
+        consider(tile, rule_cost(Tile::SetCondition) + (dest.empty() ? 1 : 0), {});
+        return best;
+    }
+
+    if (instr.op == "/" || instr.op == "%") {
+        // idiv has no immediate form, so constant divisors avoid it. A zero
+        // or INT_MIN divisor is left to idiv.
+        long long divisor = is_constant(instr.arg2) ? constant_value(instr.arg2) : 0;
+        long long magnitude = divisor < 0 ? -divisor : divisor;
+        int shift = log2_exact(magnitude);
+        if (divisor != 0 && shift >= 0 && shift < 31) {
+            tile.kind = Tile::DivideShift;
+            tile.shift = shift;
+        } else if (divisor != 0 && fits_int32(divisor) && magnitude < (1LL << 31)) {
+            tile.kind = Tile::DivideMagic;
+            division_magic(static_cast<int32_t>(divisor), tile.magic, tile.shift);
+        } else {
+            tile.kind = Tile::Divide;
+        }
+        consider(tile, rule_cost(tile.kind) + (dest.empty() ? 1 : 0), {});
+        return best;
+    }
+
+    bool same = !dest.empty() && in_register(instr.arg1) == dest;
+    if (same && ((instr.op == "+" && instr.arg2 == "1") || (instr.op == "-" && instr.arg2 == "-1"))) {
+        tile.kind = Tile::Increment;
+        consider(tile, rule_cost(Tile::Increment), {});
+    }
+    if (same && ((instr.op == "-" && instr.arg2 == "1") || (instr.op == "+" && instr.arg2 == "-1"))) {
+        tile.kind = Tile::Decrement;
+        consider(tile, rule_cost(Tile::Decrement), {});
+    }
+    bool multiply_constant = instr.op == "*" && is_constant(instr.arg2);
+    int shift = multiply_constant ? log2_exact(constant_value(instr.arg2)) : -1;
+    if (shift > 0 && shift < 32) {
+        tile.kind = Tile::ShiftLeft;
+        tile.shift = shift;
+        consider(tile, rule_cost(Tile::ShiftLeft) + moves, {});
+    }
+    tile.kind = Tile::Default;
+    consider(tile, (instr.op == "*" ? rule_cost(Tile::MultiplyImmediate) : rule_cost(Tile::Default)) + moves, {});
+    if (multiply_constant && !dest.empty() && !is_constant(instr.arg1) && fits_int32(constant_value(instr.arg2))) {
+        tile.kind = Tile::MultiplyImmediate;
+        consider(tile, rule_cost(Tile::MultiplyImmediate), {});
+    }
+
+    if (dest.empty()) return best;
+    for (const Address& address : expression_addresses(position, position)) {
+        if (!allow_folding && !address.covered.empty()) continue;
+        if (!encodable(address.terms, address.displacement)) continue;
+        Tile lea;
+        lea.kind = Tile::Lea;
+        lea.displacement = address.displacement;
+        // The scaled term, if any, is the index
+        auto terms = address.terms;
+        if (terms.size() == 2 && terms[0].second != 1) std::swap(terms[0], terms[1]);
+        if (terms.size() == 1 && terms[0].second != 1) {
+            lea.index = terms[0].first;
+            lea.scale = terms[0].second;
+        } else {
+            lea.base = terms[0].first;
+            if (terms.size() == 2) {
+                lea.index = terms[1].first;
+                lea.scale = terms[1].second;
+            }
+        }
+        consider(lea, rule_cost(Tile::Lea) - address.saved, address.covered);
+    }
+    return best;
+}
+
+void InstructionSelector::run(const std::vector<TacInstr>& listing, const LivenessAnalysis& analysis,
+                              const RegisterAllocator& registers) {
+    code = &listing;
+    liveness = &analysis;
+    allocator = &registers;
+    int n = static_cast<int>(listing.size());
+    tiles.assign(n, Tile());
+    own_cost.assign(n, 0);
+    user.assign(n, -1);
+    def_at.assign(analysis.names().size(), -1);
+    interval_of.assign(analysis.names().size(), nullptr);
+    selected.assign(rules().size(), 0);
+    folded_nodes = 0;
+
+    // Tree nodes: single-def, single-use temps computed by an Assign and
+    // read later in the same straight-line run
+    for (const auto& interval : analysis.intervals()) {
+        interval_of[interval.value] = &interval;
+        if (interval.defs.size() != 1 || interval.uses.size() != 1) continue;
+        int def = interval.defs[0], use = interval.uses[0];
+        if (!is_temporary_name(analysis.names()[interval.value])) continue;
+        if (listing[def].kind != TacOp::Assign || use <= def) continue;
+        bool straight = true;
+        for (int i = def + 1; i < use && straight; ++i) {
+            straight = listing[i].kind != TacOp::Label && !listing[i].is_jump();
+        }
+        if (!straight) continue;
+        def_at[interval.value] = def;
+        user[def] = use;
+    }
+
+    // Label bottom up: what each node costs if it is emitted on its own
+    int cost;
+    std::vector<int> covered;
+    for (int i = 0; i < n; ++i) {
+        if (listing[i].kind != TacOp::Assign) continue;
+        select(i, false, cost, covered);
+        own_cost[i] = cost;
+    }
+
+    // Reduce top down: roots come after the nodes they cover
+    for (int i = n - 1; i >= 0; --i) {
+        if (listing[i].kind == TacOp::Label || listing[i].kind == TacOp::Goto) continue;
+        if (tiles[i].kind == Tile::Folded) continue;
+        tiles[i] = select(i, true, cost, covered);
+        for (int node : covered) {
+            if (tiles[node].kind == Tile::Folded) continue;
+            tiles[node].kind = Tile::Folded;
+            ++folded_nodes;
+        }
+        const auto& table = rules();
+        for (size_t r = 0; r < table.size(); ++r) {
+            if (table[r].kind == tiles[i].kind) ++selected[r];
+        }
+    }
+}
+
+std::vector<std::pair<std::string, int>> InstructionSelector::statistics() const {
+    std::vector<std::pair<std::string, int>> result;
+    const std::vector<Rule>& table = rules();
+    for (size_t r = 0; r < table.size() && r < selected.size(); ++r) {
+        result.push_back({table[r].name, selected[r]});
+    }
+    return result;
+}
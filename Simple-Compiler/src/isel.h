@@ -0,0 +1,98 @@
+#ifndef ISEL_H
+#define ISEL_H
+
+#include "ir.h"
+#include "liveness.h"
+#include "regalloc.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// The x86 pattern chosen for one TAC instruction. Operands are TAC names;
+// the backend resolves them to registers or memory when it emits the tile.
+struct Tile {
+    enum Kind {
+        Default,           // The generic template: mov into the destination, then the op
+        Folded,            // Covered by a later instruction's tile; emits nothing
+        Zero,              // xor r, r
+        Increment,         // inc
+        Decrement,         // dec
+        Test,              // test r, r for a comparison against zero
+        CompareMemory,     // cmp m, imm without a load into eax
+        ShiftLeft,         // (mov) shl for a multiply by a power of two
+        MultiplyImmediate, // Three-operand imul r, r/m, imm
+        Lea,               // lea r, [base + index*scale + displacement]
+        Divide,            // cdq; idiv
+        DivideShift,       // Arithmetic shift with a sign fix-up, for a power-of-two divisor
+        DivideMagic,       // Multiply-high by a magic number, for other constant divisors
+        SetCondition,      // cmp; setcc; movzx for a comparison's 1 or 0
+        ConditionalMove,   // test c, c; cmovne
+        CompareMove,       // cmp; cmovcc, covering the comparison that computes the condition
+    };
+    Kind kind = Default;
+    std::string base, index; // Lea operands; either may be empty
+    int scale = 1;
+    long long displacement = 0;
+    int shift = 0;           // ShiftLeft amount; DivideShift and DivideMagic post-shift
+    int magic = 0;           // DivideMagic multiplier
+    std::string left, relation, right; // CompareMove: the comparison it covers
+};
+
+// Tree-pattern instruction selection (BURS-style) over TAC. Inside a basic
+// block, a temp that is defined once and read once by a later instruction
+// is an inner node of an expression tree rooted at its reader. Every node
+// is labeled bottom-up with the cost of its cheapest tile from a cost table
+// of x86 patterns; trees are then reduced top-down from their roots, and
+// the nodes a root's tile covers (the parts of an address that one lea
+// computes) are folded into it and emit no code of their own.
+//
+// Selection runs after register allocation, since what a tile costs depends
+// on where its operands ended up. A node is only folded when every register
+// the covering tile reads is still live at the root, so folding never needs
+// a register the allocator did not hand out.
+class InstructionSelector {
+public:
+    InstructionSelector();
+    void run(const std::vector<TacInstr>& code, const LivenessAnalysis& liveness, const RegisterAllocator& allocator);
+    const Tile& tile(int position) const { return tiles[position]; }
+
+    // Tile names with the number of instructions that got each
+    std::vector<std::pair<std::string, int>> statistics() const;
+    int folded_nodes;
+
+private:
+    struct Rule {
+        const char* name;
+        Tile::Kind kind;
+        int cost; // Latency-weighted instruction count of the pattern itself
+    };
+    static const std::vector<Rule>& rules();
+
+    // An address expression: up to two (register temp, scale) terms plus a
+    // displacement, and the tree nodes it covers
+    struct Address {
+        std::vector<std::pair<std::string, int>> terms;
+        long long displacement = 0;
+        std::vector<int> covered;
+        int saved = 0; // Own costs of the covered nodes
+    };
+
+    const std::vector<TacInstr>* code;
+    const LivenessAnalysis* liveness;
+    const RegisterAllocator* allocator;
+    std::vector<Tile> tiles;
+    std::vector<int> own_cost;  // Cost of each node's cheapest tile when it folds nothing
+    std::vector<int> user;      // Position of the only reader of a foldable node, else -1
+    std::vector<int> def_at;    // Per liveness value: its only def, or -1
+    std::vector<const LiveInterval*> interval_of; // Per liveness value
+    std::vector<int> selected;  // Roots per rule, for statistics
+
+    int rule_cost(Tile::Kind kind) const;
+    bool available(const std::string& temp, int read_at, int root) const;
+    int foldable_def(const std::string& operand, int read_at) const;
+    std::vector<Address> operand_addresses(const std::string& operand, int read_at, int root) const;
+    std::vector<Address> expression_addresses(int position, int root) const;
+    Tile select(int position, bool allow_folding, int& cost, std::vector<int>& covered) const;
+};
+
+#endif // ISEL_H
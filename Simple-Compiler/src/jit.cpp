@@ -0,0 +1,112 @@
+#include "jit.h"
+#include "x86_encoder.h"
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+size_t round_up(size_t size, size_t page) {
+    return (size + page - 1) / page * page;
+}
+
+} // namespace
+
+JitExecutor::JitExecutor()
+    : code_bytes(0), run_microseconds(0), mapping(MAP_FAILED), mapping_size(0), data_block(nullptr),
+      entry(nullptr) {}
+
+JitExecutor::~JitExecutor() {
+    unload();
+}
+
+void JitExecutor::unload() {
+    if (mapping != MAP_FAILED) munmap(mapping, mapping_size);
+    mapping = MAP_FAILED;
+    data_block = nullptr;
+    entry = nullptr;
+}
+
+void JitExecutor::run(const std::vector<MachineInstr>& program, const std::vector<std::string>& data_symbols,
+                      const std::vector<ArraySymbol>& arrays) {
+    values.clear();
+    load(program, data_symbols, arrays);
+    auto start = std::chrono::steady_clock::now();
+    call();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    run_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    for (size_t i = 0; i < data_symbols.size(); ++i) values.push_back({data_symbols[i], data_block[i]});
+}
+
+void JitExecutor::load(const std::vector<MachineInstr>& program, const std::vector<std::string>& data_symbols,
+                       const std::vector<ArraySymbol>& arrays, const std::map<std::string, int32_t*>& shared) {
+#if !defined(__x86_64__) || !defined(__linux__)
+    (void)program;
+    (void)data_symbols;
+    (void)arrays;
+    (void)shared;
+    throw std::runtime_error("Assembly Error: The JIT needs an x86-64 Linux host.");
+#else
+    unload();
+    X86Encoder encoder(TargetArch::X86_64);
+    encoder.encode(program);
+    code_bytes = encoder.code.size();
+
+    // Byte offsets in the data block; arrays are 32-byte aligned as in .bss
+    std::map<std::string, size_t> offset;
+    size_t data_bytes = 4 * data_symbols.size();
+    for (size_t i = 0; i < data_symbols.size(); ++i) offset[data_symbols[i]] = 4 * i;
+    for (const auto& array : arrays) {
+        if (shared.count(array.name)) continue;
+        data_bytes = round_up(data_bytes, 32);
+        offset[array.name] = data_bytes;
+        data_bytes += 4 * static_cast<size_t>(array.size);
+    }
+
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t code_size = round_up(encoder.code.size(), page);
+    size_t data_size = round_up(data_bytes + 1, page);
+    mapping_size = code_size + data_size;
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Assembly Error: Cannot map memory for the JIT.");
+    }
+    uint8_t* code = static_cast<uint8_t*>(mapping);
+    int32_t* data = reinterpret_cast<int32_t*>(code + code_size); // Zeroed by mmap
+
+    std::memcpy(code, encoder.code.data(), encoder.code.size());
+    std::map<std::string, intptr_t> address;
+    for (const auto& [name, bytes] : offset) address[data_symbol(name)] = reinterpret_cast<intptr_t>(data) + bytes;
+    for (const auto& [name, elements] : shared) address[data_symbol(name)] = reinterpret_cast<intptr_t>(elements);
+    for (const auto& relocation : encoder.relocations) {
+        auto found = address.find(relocation.symbol);
+        if (found == address.end() || relocation.kind == Relocation::Absolute32) {
+            unload();
+            throw std::runtime_error("Assembly Error: Cannot resolve " + relocation.symbol + " in the JIT.");
+        }
+        uint8_t* field = code + relocation.offset;
+        int64_t value = found->second + relocation.addend;
+        if (relocation.kind == Relocation::Absolute64) {
+            std::memcpy(field, &value, sizeof(value));
+            continue;
+        }
+        int32_t displacement = static_cast<int32_t>(value - reinterpret_cast<intptr_t>(field));
+        std::memcpy(field, &displacement, sizeof(displacement));
+    }
+    if (mprotect(code, code_size, PROT_READ | PROT_EXEC) != 0) {
+        unload();
+        throw std::runtime_error("Assembly Error: Cannot make JIT code executable.");
+    }
+    data_block = data;
+    entry = reinterpret_cast<void (*)()>(code);
+#endif
+}
+
+void JitExecutor::call() {
+    if (!entry) throw std::runtime_error("Assembly Error: No program loaded in the JIT.");
+    entry();
+}
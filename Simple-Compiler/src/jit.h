@@ -0,0 +1,63 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "assembly_gen.h"
+#include "machine.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runs a generated x86-64 program inside the compiler, with no file, no
+// assembler and no linker.
+//
+// The program is encoded by X86Encoder into one anonymous mapping: code
+// pages, followed by the data block that holds the variables and then the
+// arrays. The code is written while its pages are read-write and only then
+// made read-execute, so no page is ever writable and executable at once.
+// The data block stays read-write and sits right behind the code, so the
+// rip-relative references to it resolve within the mapping; arrays are
+// reached through 64-bit absolute addresses, so they may also live
+// elsewhere. The program has to end by returning (ProgramExit::Return); it
+// is called as a plain function.
+//
+// A program that never ends keeps the compiler running, and one that
+// divides INT_MIN by -1 kills it, as either would kill the executable. A
+// zero divisor is caught before idiv and sets __divide_by_zero.
+class JitExecutor {
+public:
+    JitExecutor();
+    ~JitExecutor();
+    JitExecutor(const JitExecutor&) = delete;
+    JitExecutor& operator=(const JitExecutor&) = delete;
+
+    // Loads the program, calls it once and collects the variables
+    void run(const std::vector<MachineInstr>& program, const std::vector<std::string>& data_symbols,
+             const std::vector<ArraySymbol>& arrays = {});
+
+    // Maps and links the program so it can be called any number of times.
+    // The data block starts zeroed and keeps its contents between calls;
+    // the caller may read and write it in between. An array named in
+    // `shared` is not given room in the block: the program uses the
+    // caller's elements at that address instead.
+    void load(const std::vector<MachineInstr>& program, const std::vector<std::string>& data_symbols,
+              const std::vector<ArraySymbol>& arrays = {}, const std::map<std::string, int32_t*>& shared = {});
+    void call();
+    int32_t* data() const { return data_block; } // One int per data symbol, in order
+
+    // The data block after run(), in layout order
+    std::vector<std::pair<std::string, int32_t>> values;
+    size_t code_bytes;
+    long long run_microseconds;
+
+private:
+    void* mapping;
+    size_t mapping_size;
+    int32_t* data_block;
+    void (*entry)();
+
+    void unload();
+};
+
+#endif // JIT_H
@@ -0,0 +1,296 @@
+#include "liveness.h"
+#include <algorithm>
+
+void instr_uses(const TacInstr& instr, std::vector<std::string>& out) {
+    out.clear();
+    switch (instr.kind) {
+        case TacOp::Label:
+        case TacOp::Goto:
+        case TacOp::ArrayDecl:
+            break;
+        case TacOp::Load:
+        case TacOp::BoundsCheck:
+        case TacOp::VectorLoad:
+        case TacOp::VectorStore:
+        case TacOp::VectorSplat:
+            out.push_back(instr.arg1);
+            break;
+        case TacOp::VectorOp: // Vector registers are not values here
+            break;
+        case TacOp::Store:
+            out.push_back(instr.arg1);
+            out.push_back(instr.arg2);
+            break;
+        case TacOp::IfGoto:
+        case TacOp::Assign:
+        case TacOp::Mov:
+            out.push_back(instr.arg1);
+            if (!instr.arg2.empty()) out.push_back(instr.arg2);
+            break;
+        case TacOp::Add:
+        case TacOp::Sub:
+        case TacOp::CondMove:
+            out.push_back(instr.dest);
+            out.push_back(instr.arg1);
+            out.push_back(instr.arg2);
+            break;
+    }
+}
+
+std::string instr_def(const TacInstr& instr) {
+    return instr.dest;
+}
+
+bool LiveInterval::covers(int position) const {
+    for (const auto& range : ranges) {
+        if (position < range.first) return false;
+        if (position <= range.second) return true;
+    }
+    return false;
+}
+
+LivenessAnalysis::LivenessAnalysis(const std::vector<TacInstr>& code, bool track_variables)
+    : iterations(0), cfg(code) {
+    number_values(code, track_variables);
+    number_slots(track_variables);
+    compute_local_sets();
+
+    // Named variables are observable after the program ends; block locals
+    // are not
+    BitVector at_exit(slot_value.size());
+    for (size_t s = 0; s < slot_value.size(); ++s) {
+        const std::string& name = value_names[slot_value[s]];
+        if (!is_temporary_name(name) && !is_local_name(name)) at_exit.set(s);
+    }
+    in[cfg.exit] = at_exit;
+    out[cfg.exit] = at_exit;
+
+    solve();
+    build_intervals();
+}
+
+int LivenessAnalysis::value_id(const std::string& name) const {
+    auto found = ids.find(name);
+    return found == ids.end() ? -1 : found->second;
+}
+
+bool LivenessAnalysis::tracked(const std::string& operand, bool track_variables) const {
+    if (operand.empty() || is_constant(operand)) return false;
+    return track_variables || is_temporary_name(operand);
+}
+
+void LivenessAnalysis::number_values(const std::vector<TacInstr>& code, bool track_variables) {
+    std::vector<std::string> operands;
+    for (const auto& instr : code) {
+        instr_uses(instr, operands);
+        operands.push_back(instr_def(instr));
+        for (const auto& operand : operands) {
+            if (!tracked(operand, track_variables) || ids.count(operand)) continue;
+            ids[operand] = static_cast<int>(value_names.size());
+            value_names.push_back(operand);
+        }
+    }
+}
+
+// A value gets a slot if some block reads it before writing it, or if it
+// is a named variable live at exit. Any other value is dead at every block
+// boundary, so the dataflow sets can leave it out.
+void LivenessAnalysis::number_slots(bool track_variables) {
+    slot.assign(value_names.size(), -1);
+    slot_value.clear();
+    auto add_slot = [&](int id) {
+        if (slot[id] >= 0) return;
+        slot[id] = static_cast<int>(slot_value.size());
+        slot_value.push_back(id);
+    };
+
+    std::vector<int> written_in(value_names.size(), -1);
+    std::vector<std::string> operands;
+    for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+        const BasicBlock& block = cfg.blocks[b];
+        int here = static_cast<int>(b);
+        auto read = [&](const std::string& name) {
+            int id = value_id(name);
+            if (id >= 0 && written_in[id] != here) add_slot(id);
+        };
+        for (const auto& instr : block.instrs) {
+            instr_uses(instr, operands);
+            for (const auto& name : operands) read(name);
+            int id = value_id(instr_def(instr));
+            if (id >= 0) written_in[id] = here;
+        }
+        if (block.terminator == BasicBlock::CondJump) {
+            read(block.condition.arg1);
+            read(block.condition.arg2);
+        }
+    }
+    if (!track_variables) return;
+    for (size_t v = 0; v < value_names.size(); ++v) {
+        if (!is_temporary_name(value_names[v]) && !is_local_name(value_names[v])) add_slot(static_cast<int>(v));
+    }
+}
+
+void LivenessAnalysis::compute_local_sets() {
+    size_t count = cfg.blocks.size();
+    size_t slots = slot_value.size();
+    use.assign(count, BitVector(slots));
+    def.assign(count, BitVector(slots));
+    in.assign(count, BitVector(slots));
+    out.assign(count, BitVector(slots));
+
+    std::vector<std::string> operands;
+    for (size_t b = 0; b < count; ++b) {
+        const BasicBlock& block = cfg.blocks[b];
+        auto read = [&](const std::string& name) {
+            int id = value_id(name);
+            if (crosses(id) && !def[b].test(slot[id])) use[b].set(slot[id]);
+        };
+        for (const auto& instr : block.instrs) {
+            instr_uses(instr, operands);
+            for (const auto& name : operands) read(name);
+            int id = value_id(instr_def(instr));
+            if (crosses(id)) def[b].set(slot[id]);
+        }
+        if (block.terminator == BasicBlock::CondJump) {
+            read(block.condition.arg1);
+            read(block.condition.arg2);
+        }
+    }
+}
+
+// Iterates in[b] = use[b] | (out[b] - def[b]), out[b] = union of in[succ]
+// to a fixpoint. Blocks start on the worklist in reverse order, which is
+// close to the order a backward problem converges fastest in.
+void LivenessAnalysis::solve() {
+    std::vector<std::vector<int>> preds = cfg.predecessors();
+    std::vector<int> worklist;
+    std::vector<bool> queued(cfg.blocks.size(), false);
+    for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+        if (cfg.blocks[b].removed || static_cast<int>(b) == cfg.exit) continue;
+        worklist.push_back(static_cast<int>(b));
+        queued[b] = true;
+    }
+
+    while (!worklist.empty()) {
+        int b = worklist.back();
+        worklist.pop_back();
+        queued[b] = false;
+        iterations++;
+
+        for (int succ : cfg.blocks[b].successors()) out[b].union_with(in[succ]);
+        BitVector next = out[b];
+        next.subtract(def[b]);
+        next.union_with(use[b]);
+        if (next == in[b]) continue;
+        in[b] = next;
+        for (int pred : preds[b]) {
+            if (!queued[pred]) {
+                queued[pred] = true;
+                worklist.push_back(pred);
+            }
+        }
+    }
+}
+
+// Walks the blocks backwards from the last position, growing each value's
+// ranges: a value live out of a block covers the whole block, a use extends
+// its range back to the block start, and a definition cuts it off there.
+void LivenessAnalysis::build_intervals() {
+    std::vector<LiveInterval> building(value_names.size());
+    for (size_t v = 0; v < building.size(); ++v) building[v].value = static_cast<int>(v);
+
+    // Ranges are collected last-first, so the earliest one is at the back
+    auto add_range = [&](int v, int from, int to) {
+        auto& ranges = building[v].ranges;
+        if (!ranges.empty() && ranges.back().first <= to + 1) {
+            ranges.back().first = std::min(ranges.back().first, from);
+            ranges.back().second = std::max(ranges.back().second, to);
+        } else {
+            ranges.emplace_back(from, to);
+        }
+    };
+
+    std::vector<std::string> operands;
+    LiveSet live(*this);
+    for (int b = static_cast<int>(cfg.blocks.size()) - 1; b >= 0; --b) {
+        const BasicBlock& block = cfg.blocks[b];
+        if (block.position < 0) continue;
+        int from = block.position;
+        int to = from + static_cast<int>(block.instrs.size()) - 1;
+        if (block.terminator != BasicBlock::FallThrough) to++;
+
+        live.start(b);
+        out[b].for_each([&](size_t s) { add_range(slot_value[s], from, to); });
+
+        auto read = [&](const std::string& name, int position) {
+            int id = value_id(name);
+            if (id < 0) return;
+            add_range(id, from, position);
+            auto& uses = building[id].uses;
+            if (uses.empty() || uses.back() != position) uses.push_back(position);
+            live.set(id);
+        };
+
+        if (block.terminator == BasicBlock::CondJump) {
+            read(block.condition.arg2, to);
+            read(block.condition.arg1, to);
+        }
+        for (int i = static_cast<int>(block.instrs.size()) - 1; i >= 0; --i) {
+            const TacInstr& instr = block.instrs[i];
+            int position = from + i;
+            int id = value_id(instr_def(instr));
+            if (id >= 0) {
+                if (live.test(id)) {
+                    building[id].ranges.back().first = position;
+                } else {
+                    add_range(id, position, position); // Dead definition
+                }
+                building[id].defs.push_back(position);
+                live.reset(id);
+            }
+            instr_uses(instr, operands);
+            for (auto it = operands.rbegin(); it != operands.rend(); ++it) read(*it, position);
+        }
+    }
+
+    value_intervals.clear();
+    for (auto& interval : building) {
+        if (interval.ranges.empty()) continue;
+        std::reverse(interval.ranges.begin(), interval.ranges.end());
+        std::reverse(interval.uses.begin(), interval.uses.end());
+        std::reverse(interval.defs.begin(), interval.defs.end());
+        value_intervals.push_back(std::move(interval));
+    }
+    std::stable_sort(value_intervals.begin(), value_intervals.end(),
+                     [](const LiveInterval& a, const LiveInterval& b) { return a.start() < b.start(); });
+}
+
+std::vector<std::vector<int>> LivenessAnalysis::last_uses() const {
+    int length = 0;
+    for (const auto& interval : value_intervals) length = std::max(length, interval.end() + 1);
+    std::vector<std::vector<int>> result(length);
+    for (const auto& interval : value_intervals) result[interval.end()].push_back(interval.value);
+    return result;
+}
+
+LiveSet::LiveSet(const LivenessAnalysis& liveness) : liveness(liveness), bits(liveness.names().size()) {}
+
+void LiveSet::start(int block) {
+    for (int value : touched) bits.reset(value);
+    touched.clear();
+    liveness.out[block].for_each([&](size_t s) { set(liveness.slot_value[s]); });
+}
+
+void LiveSet::set(int value) {
+    if (bits.test(value)) return;
+    bits.set(value);
+    touched.push_back(value);
+}
+
+// Drops the values reset since, and sorts what is left
+void LiveSet::compact() {
+    touched.erase(std::remove_if(touched.begin(), touched.end(), [&](int value) { return !bits.test(value); }),
+                  touched.end());
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+}
@@ -0,0 +1,113 @@
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include "bitvector.h"
+#include "cfg.h"
+#include "ir.h"
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Registers an instruction reads and writes. ADD/SUB and CMOV read their
+// destination too, since they update it in place or may leave it as it is.
+void instr_uses(const TacInstr& instr, std::vector<std::string>& out);
+std::string instr_def(const TacInstr& instr);
+
+// Lifetime of one value over the listing, in instruction positions (index
+// into the TAC vector). `ranges` are disjoint and sorted; a value that is
+// defined and never read gets the single range [def, def].
+struct LiveInterval {
+    int value = -1;                          // Index into LivenessAnalysis::names()
+    std::vector<std::pair<int, int>> ranges; // Inclusive [from, to] pieces
+    std::vector<int> uses;                   // Positions reading the value, ascending
+    std::vector<int> defs;                   // Positions writing the value, ascending
+
+    int start() const { return ranges.front().first; }
+    int end() const { return ranges.back().second; }
+    bool covers(int position) const;
+};
+
+// Backward dataflow liveness over the CFG of a TAC listing, with one bit
+// vector per block for each of use, def, live-in and live-out.
+//
+// Most temporaries are written and read in the same block and are never
+// live at a block boundary. Only values read before they are written in
+// some block, or live at exit, get a slot in the bit vectors; the rest are
+// handled by the backward scan over each block that builds the intervals.
+// The dataflow problem therefore grows with the values that cross blocks,
+// not with all of them.
+//
+// Temporaries are always tracked. With `track_variables`, named variables
+// are too; they live in memory that outlives the program, so all of them
+// except block locals are treated as live at exit.
+class LivenessAnalysis {
+public:
+    LivenessAnalysis(const std::vector<TacInstr>& code, bool track_variables);
+
+    const ControlFlowGraph& graph() const { return cfg; }
+    const std::vector<std::string>& names() const { return value_names; }
+    int value_id(const std::string& name) const;
+
+    // Whether `value` (an id from value_id) is live on entry to / exit from
+    // the block
+    bool live_in(int block, int value) const { return crosses(value) && in[block].test(slot[value]); }
+    bool live_out(int block, int value) const { return crosses(value) && out[block].test(slot[value]); }
+
+    // One interval per value that occurs in the listing, sorted by start
+    const std::vector<LiveInterval>& intervals() const { return value_intervals; }
+
+    // For each position, the values whose interval ends there
+    std::vector<std::vector<int>> last_uses() const;
+
+    int iterations;  // Worklist steps until the fixpoint, for statistics
+
+private:
+    friend class LiveSet;
+
+    ControlFlowGraph cfg;
+    std::vector<std::string> value_names;
+    std::unordered_map<std::string, int> ids;
+    std::vector<int> slot;         // Per value: its bit in the block sets, or -1
+    std::vector<int> slot_value;   // Per bit: the value
+    std::vector<BitVector> use, def, in, out;
+    std::vector<LiveInterval> value_intervals;
+
+    bool crosses(int value) const { return value >= 0 && slot[value] >= 0; }
+    bool tracked(const std::string& operand, bool track_variables) const;
+    void number_values(const std::vector<TacInstr>& code, bool track_variables);
+    void number_slots(bool track_variables);
+    void compute_local_sets();
+    void solve();
+    void build_intervals();
+};
+
+// The values live at one point of a backward scan over a block: the
+// block's live-out set, then updated instruction by instruction. One set is
+// reused for every block, so starting a block costs its live-out set and
+// what the previous block touched, not the number of values.
+class LiveSet {
+public:
+    explicit LiveSet(const LivenessAnalysis& liveness);
+
+    void start(int block);
+    bool test(int value) const { return bits.test(value); }
+    void set(int value);
+    void reset(int value) { bits.reset(value); }
+
+    // Calls f(value) for every live value in increasing order
+    template <typename F>
+    void for_each(F f) {
+        compact();
+        for (int value : touched) f(value);
+    }
+
+private:
+    const LivenessAnalysis& liveness;
+    BitVector bits;            // By value id
+    std::vector<int> touched;  // Every value set since start(), maybe more than once
+
+    void compact();
+};
+
+#endif // LIVENESS_H
@@ -0,0 +1,209 @@
+#include "loop_reverse.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+LoopReverser::LoopReverser() : reversed_loops(0), code(nullptr), next_temp(1) {}
+
+static TacInstr make_assign(const std::string& dest, const std::string& arg1, const std::string& op,
+                            const std::string& arg2) {
+    TacInstr instr;
+    instr.kind = TacOp::Assign;
+    instr.dest = dest;
+    instr.arg1 = arg1;
+    instr.op = op;
+    instr.arg2 = arg2;
+    return instr;
+}
+
+static bool reads(const TacInstr& instr, const std::string& name) {
+    if (instr.kind == TacOp::Label || instr.kind == TacOp::Goto) return false;
+    bool in_place = instr.kind == TacOp::Add || instr.kind == TacOp::Sub || instr.kind == TacOp::CondMove;
+    if (in_place && instr.dest == name) return true;
+    return instr.arg1 == name || instr.arg2 == name;
+}
+
+static int32_t constant_value(const std::string& operand) {
+    return static_cast<int32_t>(static_cast<uint32_t>(std::stoll(operand)));
+}
+
+// Whether the loop at `header` runs its body at least once, either because
+// of a guard `IF start >= bound GOTO exit` right before it or because start
+// and bound are constants in order. `start` receives the counter's value on
+// entry.
+bool LoopReverser::enters_body(const std::string& counter, const std::string& bound, int header, int exit,
+                               std::string& start) const {
+    const std::vector<TacInstr>& listing = *code;
+    if (header == 0) return false;
+    int before = header - 1;
+    const TacInstr& guard = listing[before];
+
+    // The value the straight-line run before `from` last gave the counter
+    auto entry_value = [&](int from) -> std::string {
+        for (int i = from; i >= 0; --i) {
+            const TacInstr& instr = listing[i];
+            if (instr.kind == TacOp::Label || instr.is_jump()) break;
+            if (instr.dest != counter) continue;
+            bool copy = instr.kind == TacOp::Assign && instr.op.empty();
+            return copy && is_constant(instr.arg1) ? instr.arg1 : "";
+        }
+        return "";
+    };
+
+    if (guard.kind == TacOp::IfGoto) {
+        if (exit >= static_cast<int>(listing.size()) || listing[exit].kind != TacOp::Label ||
+            guard.label != listing[exit].label) {
+            return false;
+        }
+        std::string tested;
+        if (guard.op == ">=" && guard.arg2 == bound) tested = guard.arg1;
+        else if (guard.op == "<=" && guard.arg1 == bound) tested = guard.arg2;
+        else return false;
+        if (tested == counter) {
+            start = counter;
+            return true;
+        }
+        if (!is_constant(tested) || entry_value(before - 1) != tested) return false;
+        start = tested;
+        return true;
+    }
+    if (guard.is_jump() || !is_constant(bound)) return false;
+    std::string value = entry_value(before);
+    if (value.empty() || constant_value(value) >= constant_value(bound)) return false;
+    start = value;
+    return true;
+}
+
+bool LoopReverser::reverse(int back_edge) {
+    std::vector<TacInstr>& listing = *code;
+    const TacInstr& test = listing[back_edge];
+    if (test.kind != TacOp::IfGoto || test.op != "<" || !is_temporary_name(test.arg1)) return false;
+    const std::string counter = test.arg1;
+    const std::string bound = test.arg2;
+    if (bound == counter) return false;
+
+    std::unordered_map<std::string, int> label_at;
+    for (size_t i = 0; i < listing.size(); ++i) {
+        if (listing[i].kind == TacOp::Label) label_at[listing[i].label] = static_cast<int>(i);
+    }
+    auto header_found = label_at.find(test.label);
+    if (header_found == label_at.end() || header_found->second >= back_edge) return false;
+    const int header = header_found->second;
+
+    // Only the back edge enters the header by a jump, and no jump crosses
+    // the loop's boundary in either direction
+    for (size_t q = 0; q < listing.size(); ++q) {
+        const TacInstr& instr = listing[q];
+        int at = static_cast<int>(q);
+        if (!instr.is_jump() || at == back_edge) continue;
+        int target = label_at.at(instr.label);
+        bool inside = at > header && at < back_edge;
+        bool target_inside = target > header && target < back_edge;
+        if (target == header || inside != target_inside) return false;
+    }
+
+    // The counter is written once in the loop, by `counter = counter + 1` or
+    // by `x = counter + 1; counter = x` with x read nowhere else, and read
+    // by nothing else; the bound is not written at all
+    std::unordered_map<std::string, int> read_count;
+    for (const auto& instr : listing) {
+        if (instr.kind == TacOp::Label || instr.kind == TacOp::Goto) continue;
+        if (!instr.arg1.empty()) read_count[instr.arg1]++;
+        if (!instr.arg2.empty()) read_count[instr.arg2]++;
+    }
+    auto is_increment = [&](const TacInstr& instr) {
+        return instr.kind == TacOp::Assign && instr.op == "+" &&
+               ((instr.arg1 == counter && instr.arg2 == "1") || (instr.arg2 == counter && instr.arg1 == "1"));
+    };
+    int write = -1;
+    for (int i = header + 1; i < back_edge; ++i) {
+        const TacInstr& instr = listing[i];
+        if (!is_constant(bound) && instr.dest == bound) return false;
+        if (instr.dest != counter) continue;
+        if (write >= 0) return false;
+        write = i;
+    }
+    if (write < 0) return false;
+    int increment = write, copy = -1;
+    if (!is_increment(listing[write])) {
+        const TacInstr& instr = listing[write];
+        if (instr.kind != TacOp::Assign || !instr.op.empty() || !is_temporary_name(instr.arg1) ||
+            instr.arg1 == bound || read_count[instr.arg1] != 1) {
+            return false;
+        }
+        copy = write;
+        increment = -1;
+        for (int i = copy - 1; i > header; --i) {
+            const TacInstr& before = listing[i];
+            if (before.kind == TacOp::Label || before.is_jump()) break;
+            if (before.dest == instr.arg1) {
+                if (is_increment(before)) increment = i;
+                break;
+            }
+        }
+        if (increment < 0) return false;
+    }
+    for (int i = header + 1; i < back_edge; ++i) {
+        if (i != increment && reads(listing[i], counter)) return false;
+    }
+
+    // The increment runs exactly once per iteration: nothing before it jumps
+    // past it, and nothing after it jumps back over it
+    for (int i = header + 1; i < back_edge; ++i) {
+        if (!listing[i].is_jump()) continue;
+        int target = label_at.at(listing[i].label);
+        if (i < increment && target > increment) return false;
+        if (i > increment && target < increment) return false;
+    }
+
+    std::string start;
+    if (!enters_body(counter, bound, header, back_edge + 1, start)) return false;
+
+    // Rewrite from the bottom up so positions above stay valid
+    const std::string count = "t" + std::to_string(next_temp++);
+    const std::string label = test.label;
+    const int indent = test.indent;
+    TacInstr exit_value = make_assign(counter, bound, "", "");
+    exit_value.indent = indent;
+    listing.insert(listing.begin() + back_edge + 1, exit_value);
+    listing[back_edge] = make_if_goto(count, "!=", "0", label);
+    listing[back_edge].indent = indent;
+    if (copy >= 0) listing.erase(listing.begin() + copy);
+    int body_indent = listing[increment].indent;
+    listing[increment] = make_assign(count, count, "+", "-1");
+    listing[increment].indent = body_indent;
+    TacInstr initial = make_assign(count, bound, "-", start);
+    if (is_constant(bound) && is_constant(start)) {
+        uint32_t trips = static_cast<uint32_t>(constant_value(bound)) - static_cast<uint32_t>(constant_value(start));
+        initial = make_assign(count, std::to_string(static_cast<int32_t>(trips)), "", "");
+    } else if (start == "0") {
+        initial = make_assign(count, bound, "", "");
+    }
+    initial.indent = indent;
+    listing.insert(listing.begin() + header, initial);
+    reversed_loops++;
+    return true;
+}
+
+void LoopReverser::run(std::vector<TacInstr>& listing) {
+    code = &listing;
+    reversed_loops = 0;
+    next_temp = 1;
+    for (const auto& instr : listing) {
+        for (const std::string* operand : {&instr.dest, &instr.arg1, &instr.arg2}) {
+            if (!is_temporary_name(*operand)) continue;
+            if (std::all_of(operand->begin() + 1, operand->end(), ::isdigit)) {
+                next_temp = std::max(next_temp, std::stol(operand->substr(1)) + 1);
+            }
+        }
+    }
+
+    // Each rewrite shifts the positions after it, so look again from the top
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < listing.size() && !changed; ++i) {
+            if (listing[i].kind == TacOp::IfGoto) changed = reverse(static_cast<int>(i));
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef LOOP_REVERSE_H
+#define LOOP_REVERSE_H
+
+#include "ir.h"
+#include <string>
+#include <vector>
+
+// Turns counting-up loops into counting-down ones. A bottom-tested loop
+//
+//     L: ...  i = i + 1  ...  IF i < n GOTO L
+//
+// whose counter is read by nothing but its own increment and the exit test
+// runs n - i times, so it can count a fresh temp k from n - i down to zero
+// instead and test `IF k != 0 GOTO L`. The backend emits that as dec + jnz,
+// which needs no compare and keeps n out of a register inside the loop.
+//
+// The rewrite is only made when the body is known to run at least once: a
+// guard `IF i >= n GOTO exit` just before the loop, or constant start and
+// bound with start < n. Since the count wraps like the hardware does, a trip
+// count above INT_MAX still counts down correctly. The counter is set to n
+// where the loop falls out; DCE removes that again if nothing reads it.
+class LoopReverser {
+public:
+    LoopReverser();
+    void run(std::vector<TacInstr>& code);
+
+    int reversed_loops;
+
+private:
+    std::vector<TacInstr>* code;
+    long next_temp;
+
+    bool reverse(int back_edge);
+    bool enters_body(const std::string& counter, const std::string& bound, int header, int exit,
+                     std::string& start) const;
+};
+
+#endif // LOOP_REVERSE_H
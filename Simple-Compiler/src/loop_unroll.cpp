@@ -0,0 +1,161 @@
+#include "loop_unroll.h"
+#include "ast_utils.h"
+#include "printing_options.h"
+#include <cstdint>
+#include <iostream>
+#include <set>
+
+LoopUnroller::LoopUnroller(UnrollOptions opts) : options(opts), bound_count(0) {}
+
+void LoopUnroller::reset() {
+    bound_count = 0;
+}
+
+void LoopUnroller::run(StatementList* root) {
+    if (!root) return;
+    visit_list(root);
+}
+
+void LoopUnroller::visit_list(StatementList* list) {
+    if (!list) return;
+    for (auto& stmt : list->statements) {
+        visit(stmt);
+    }
+}
+
+void LoopUnroller::visit(std::unique_ptr<Statement>& slot) {
+    if (!slot) return;
+    if (auto if_stmt = dynamic_cast<IfStatement*>(slot.get())) {
+        visit(if_stmt->if_body);
+        visit(if_stmt->else_body);
+    } else if (auto block = dynamic_cast<Block*>(slot.get())) {
+        visit_list(block->statement_list.get());
+    } else if (auto loop = dynamic_cast<ForStatement*>(slot.get())) {
+        if (contains_loop(loop->body.get())) {
+            // Only innermost loops are unrolled; outer bodies would grow too fast.
+            visit(loop->body);
+            return;
+        }
+        if (loop->keep_rolled) return;
+        InductionInfo info;
+        if (!analyze_loop(loop, info)) return;
+
+        int body_size = node_count(loop->body.get()) + node_count(loop->increment.get());
+        if (info.constant_trip && info.trip_count <= options.max_full_trip_count &&
+            info.trip_count * body_size <= options.full_unroll_budget) {
+            if (should_print(PRINT_PARSE_TREE)) {
+                std::cout << "Optimizer: Fully unrolling loop over '" << info.iv.var << "' ("
+                          << info.trip_count << " iterations)" << std::endl;
+            }
+            slot = fully_unroll(loop, info);
+            return;
+        }
+
+        int factor = choose_factor(body_size, info);
+        if (factor < 2) return;
+        if (should_print(PRINT_PARSE_TREE)) {
+            std::cout << "Optimizer: Unrolling loop over '" << info.iv.var << "' by " << factor << std::endl;
+        }
+        slot = partially_unroll(loop, info, factor);
+    }
+}
+
+/******************************************************************
+ * Loop recognition
+ ******************************************************************/
+
+bool LoopUnroller::analyze_loop(ForStatement* loop, InductionInfo& info) {
+    if (!match_induction_variable(loop, info.iv)) return false;
+
+    info.constant_trip = false;
+    info.trip_count = -1;
+    long long start, bound;
+    if (info.iv.start && evaluate_constant(info.iv.start, start) && evaluate_constant(info.iv.bound, bound)) {
+        info.trip_count = compute_trip_count(start, info.iv.op, bound, info.iv.step);
+        if (info.trip_count < 0) return false;
+        info.constant_trip = true;
+    }
+    return true;
+}
+
+int LoopUnroller::choose_factor(int body_size, const InductionInfo& info) {
+    // Partial unrolling needs an ordered comparison that moves towards the bound,
+    // so that "bound - (factor - 1) * step" guards a whole group of iterations.
+    bool upward = (info.iv.op == "<" || info.iv.op == "<=") && info.iv.step > 0;
+    bool downward = (info.iv.op == ">" || info.iv.op == ">=") && info.iv.step < 0;
+    if (!upward && !downward) return 1;
+
+    long long bound;
+    bool constant_bound = evaluate_constant(info.iv.bound, bound);
+    for (int factor = options.max_factor; factor >= 2; factor /= 2) {
+        if (factor * body_size > options.partial_unroll_budget) continue;
+        if (info.constant_trip && info.trip_count < factor) continue;
+        // A constant limit must itself be an int
+        long long limit = bound - (factor - 1) * info.iv.step;
+        if (constant_bound && (limit < INT32_MIN || limit > INT32_MAX)) continue;
+        return factor;
+    }
+    return 1;
+}
+
+/******************************************************************
+ * Transformations
+ ******************************************************************/
+
+void LoopUnroller::append_iterations(StatementList* list, ForStatement* loop, long long count) {
+    for (long long i = 0; i < count; ++i) {
+        if (loop->body) list->statements.push_back(clone_statement(loop->body.get()));
+        list->statements.push_back(clone_statement(loop->increment.get()));
+    }
+}
+
+std::unique_ptr<Statement> LoopUnroller::fully_unroll(ForStatement* loop, const InductionInfo& info) {
+    auto list = std::make_unique<StatementList>();
+    if (loop->init) list->statements.push_back(std::move(loop->init));
+    append_iterations(list.get(), loop, info.trip_count);
+    return std::make_unique<Block>(std::move(list));
+}
+
+std::unique_ptr<Statement> LoopUnroller::partially_unroll(ForStatement* loop, const InductionInfo& info, int factor) {
+    auto list = std::make_unique<StatementList>();
+    if (loop->init) list->statements.push_back(std::move(loop->init));
+
+    // The unrolled loop runs while a whole group of `factor` iterations fits:
+    //   var op bound - (factor - 1) * step
+    long long offset = (factor - 1) * info.iv.step;
+    std::unique_ptr<Expression> limit;
+    std::unique_ptr<BinaryOp> guard;
+    long long bound_value;
+    if (evaluate_constant(info.iv.bound, bound_value)) {
+        limit = std::make_unique<Number>(static_cast<double>(bound_value - offset)); // In range, see choose_factor
+    } else {
+        // Hoist the adjusted bound so it is computed once at loop entry
+        std::string name = "__unroll_bound" + std::to_string(++bound_count);
+        auto adjusted = std::make_unique<BinaryOp>("-", clone_expression(info.iv.bound),
+                                                   std::make_unique<Number>(static_cast<double>(offset)));
+        list->statements.push_back(std::make_unique<Declaration>("int", name, std::move(adjusted)));
+        limit = std::make_unique<Identifier>(name);
+        // It wraps around for a bound within `offset` of the end of the int
+        // range; the remainder loop then runs every iteration instead
+        long long edge = offset > 0 ? INT32_MIN + offset : INT32_MAX + offset;
+        guard = std::make_unique<BinaryOp>(offset > 0 ? ">=" : "<=", clone_expression(info.iv.bound),
+                                           std::make_unique<Number>(static_cast<double>(edge)));
+    }
+
+    auto group = std::make_unique<StatementList>();
+    append_iterations(group.get(), loop, factor);
+    auto unrolled_cond = std::make_unique<BinaryOp>(info.iv.op, std::make_unique<Identifier>(info.iv.var), std::move(limit));
+    std::unique_ptr<Statement> unrolled = std::make_unique<ForStatement>(
+        nullptr, std::move(unrolled_cond), nullptr, std::make_unique<Block>(std::move(group)));
+    if (guard) unrolled = std::make_unique<IfStatement>(std::move(guard), std::move(unrolled));
+    list->statements.push_back(std::move(unrolled));
+
+    // Remainder: at most factor - 1 iterations are left
+    if (info.constant_trip) {
+        append_iterations(list.get(), loop, info.trip_count % factor);
+    } else {
+        list->statements.push_back(std::make_unique<ForStatement>(nullptr, std::move(loop->condition),
+                                                                  std::move(loop->increment), std::move(loop->body)));
+    }
+    return std::make_unique<Block>(std::move(list));
+}
@@ -0,0 +1,53 @@
+#ifndef LOOP_UNROLL_H
+#define LOOP_UNROLL_H
+
+#include "ast.h"
+#include "ast_utils.h"
+#include <string>
+#include <memory>
+
+// Size limits that decide how far a loop may be unrolled.
+// Sizes are measured in AST nodes (see node_count).
+struct UnrollOptions {
+    int max_full_trip_count = 16;   // Loops with more iterations are never fully unrolled
+    int full_unroll_budget = 128;   // Max size of the straight-line code a full unroll produces
+    int partial_unroll_budget = 64; // Max size of one unrolled loop body
+    int max_factor = 8;             // Largest partial unroll factor (8, 4 or 2 are tried)
+};
+
+// Unrolls innermost for loops with a simple induction variable:
+//   for (i = start; i < bound; i++) body
+// Loops with a small constant trip count are fully unrolled into straight-line
+// code. Other loops whose trip count is known at loop entry are unrolled by
+// 2/4/8 followed by a remainder loop, so the compare and jumps of the loop
+// test are paid once per group of iterations instead of once per iteration.
+// A bound near the end of the int range, where the group limit would wrap
+// around, leaves all the iterations to the remainder loop.
+// Loops the vectorizer made (keep_rolled) already do a group per iteration.
+class LoopUnroller {
+public:
+    LoopUnroller(UnrollOptions options = UnrollOptions());
+    void run(StatementList* root);
+    void reset();
+
+private:
+    struct InductionInfo {
+        InductionVariable iv;
+        bool constant_trip; // True if trip_count is known at compile time
+        long long trip_count;
+    };
+
+    UnrollOptions options;
+    int bound_count;
+
+    void visit_list(StatementList* list);
+    void visit(std::unique_ptr<Statement>& slot);
+
+    bool analyze_loop(ForStatement* loop, InductionInfo& info);
+    int choose_factor(int body_size, const InductionInfo& info);
+    std::unique_ptr<Statement> fully_unroll(ForStatement* loop, const InductionInfo& info);
+    std::unique_ptr<Statement> partially_unroll(ForStatement* loop, const InductionInfo& info, int factor);
+    void append_iterations(StatementList* list, ForStatement* loop, long long count);
+};
+
+#endif // LOOP_UNROLL_H
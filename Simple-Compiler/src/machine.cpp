@@ -0,0 +1,130 @@
+#include "machine.h"
+#include "ir.h"
+#include <map>
+
+static std::string strip(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+MachineInstr parse_machine_instr(const std::string& text) {
+    MachineInstr instr;
+    std::string line = strip(text);
+    if (!line.empty() && line.back() == ':') {
+        instr.kind = MachineInstr::Label;
+        instr.opcode = line.substr(0, line.size() - 1);
+        return instr;
+    }
+    size_t space = line.find(' ');
+    instr.opcode = line.substr(0, space);
+    if (space == std::string::npos) return instr;
+
+    // Operands never contain commas inside brackets
+    std::string rest = line.substr(space + 1);
+    size_t start = 0;
+    while (start <= rest.size()) {
+        size_t comma = rest.find(',', start);
+        if (comma == std::string::npos) comma = rest.size();
+        instr.operands.push_back(strip(rest.substr(start, comma - start)));
+        start = comma + 1;
+    }
+    return instr;
+}
+
+std::string machine_instr_to_string(const MachineInstr& instr) {
+    if (instr.is_label()) return instr.opcode + ":";
+    std::string text = "    " + instr.opcode;
+    for (size_t i = 0; i < instr.operands.size(); ++i) {
+        text += (i == 0 ? " " : ", ") + instr.operands[i];
+    }
+    return text;
+}
+
+bool is_register_operand(const std::string& operand) {
+    static const char* registers[] = {"eax", "ebx", "ecx", "edx", "esi", "edi", "ebp", "esp",
+                                      "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp"};
+    for (const char* reg : registers) {
+        if (operand == reg) return true;
+    }
+    // r8-r15 and their 32-bit halves r8d-r15d
+    if (operand.size() < 2 || operand[0] != 'r' || !isdigit(static_cast<unsigned char>(operand[1]))) return false;
+    size_t end = 1;
+    while (end < operand.size() && isdigit(static_cast<unsigned char>(operand[end]))) end++;
+    int number = std::stoi(operand.substr(1, end - 1));
+    std::string suffix = operand.substr(end);
+    return number >= 8 && number <= 15 && (suffix.empty() || suffix == "d");
+}
+
+bool is_memory_operand(const std::string& operand) {
+    return operand.find('[') != std::string::npos;
+}
+
+bool is_immediate_operand(const std::string& operand) {
+    return is_constant(operand);
+}
+
+static std::string address_of(const std::string& operand) {
+    size_t open = operand.find('[');
+    return open == std::string::npos ? operand : operand.substr(open);
+}
+
+bool same_operand(const std::string& a, const std::string& b) {
+    if (is_memory_operand(a) && is_memory_operand(b)) return address_of(a) == address_of(b);
+    return a == b;
+}
+
+bool mentions_register(const std::string& operand, const std::string& reg) {
+    size_t found = operand.find(reg);
+    while (found != std::string::npos) {
+        bool starts = found == 0 || !isalnum(static_cast<unsigned char>(operand[found - 1]));
+        size_t end = found + reg.size();
+        bool ends = end == operand.size() || !isalnum(static_cast<unsigned char>(operand[end]));
+        if (starts && ends) return true;
+        found = operand.find(reg, found + 1);
+    }
+    return false;
+}
+
+static const std::map<std::string, std::string>& jump_inverses() {
+    static const std::map<std::string, std::string> inverses = {
+        {"je", "jne"}, {"jne", "je"}, {"jl", "jge"}, {"jge", "jl"},
+        {"jg", "jle"}, {"jle", "jg"}, {"jb", "jae"}, {"jae", "jb"},
+        {"ja", "jbe"}, {"jbe", "ja"}, {"js", "jns"}, {"jns", "js"},
+    };
+    return inverses;
+}
+
+bool is_conditional_jump(const MachineInstr& instr) {
+    return instr.kind == MachineInstr::Instr && jump_inverses().count(instr.opcode) > 0;
+}
+
+bool is_unconditional_jump(const MachineInstr& instr) {
+    return instr.is("jmp");
+}
+
+bool reads_flags(const MachineInstr& instr) {
+    if (instr.kind != MachineInstr::Instr) return false;
+    const std::string& op = instr.opcode;
+    return is_conditional_jump(instr) || op.rfind("set", 0) == 0 || op.rfind("cmov", 0) == 0 ||
+           op == "adc" || op == "sbb";
+}
+
+bool sets_result_flags(const MachineInstr& instr) {
+    if (instr.kind != MachineInstr::Instr || instr.operands.empty()) return false;
+    const std::string& op = instr.opcode;
+    if (op == "inc" || op == "dec" || op == "neg") return instr.operands.size() == 1;
+    if (instr.operands.size() != 2) return false;
+    if (op == "add" || op == "sub" || op == "and" || op == "or" || op == "xor") return true;
+    // A shift by zero leaves the flags alone
+    if (op == "shl" || op == "sal" || op == "sar" || op == "shr") {
+        return is_immediate_operand(instr.operands[1]) && (std::stoll(instr.operands[1]) & 31) != 0;
+    }
+    return false;
+}
+
+std::string inverse_jump(const std::string& opcode) {
+    auto found = jump_inverses().find(opcode);
+    return found == jump_inverses().end() ? "" : found->second;
+}
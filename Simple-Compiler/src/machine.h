@@ -0,0 +1,42 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <string>
+#include <vector>
+
+// One line of generated assembly in structured form: a label, or an opcode
+// with Intel-syntax operands (destination first). The backend emits these
+// and the peephole optimizer rewrites them before they are printed.
+struct MachineInstr {
+    enum Kind { Instr, Label };
+    Kind kind = Instr;
+    std::string opcode;                // Mnemonic, or the label's name
+    std::vector<std::string> operands; // e.g. {"ebx", "dword [x]"}
+
+    bool is_label() const { return kind == Label; }
+    bool is(const std::string& mnemonic) const { return kind == Instr && opcode == mnemonic; }
+};
+
+MachineInstr parse_machine_instr(const std::string& text);
+std::string machine_instr_to_string(const MachineInstr& instr);
+
+// Operand classification
+bool is_register_operand(const std::string& operand);
+bool is_memory_operand(const std::string& operand);
+bool is_immediate_operand(const std::string& operand);
+// Memory operands compare equal with or without a size keyword
+bool same_operand(const std::string& a, const std::string& b);
+// True if `operand` reads or writes register `reg`, including as an address
+bool mentions_register(const std::string& operand, const std::string& reg);
+
+// Instruction classification
+bool is_conditional_jump(const MachineInstr& instr);
+bool is_unconditional_jump(const MachineInstr& instr);
+bool reads_flags(const MachineInstr& instr);
+// True if `instr` leaves ZF and SF describing the value it wrote to its
+// first operand, as `test` on that operand would
+bool sets_result_flags(const MachineInstr& instr);
+// The jump taken exactly when `opcode` is not, e.g. jle for jg
+std::string inverse_jump(const std::string& opcode);
+
+#endif // MACHINE_H
@@ -1,11 +1,76 @@
 #include "compiler.h"
 #include "printing_options.h"
+#include <fstream>
 #include <iostream>
+#include <sstream>
+
+int main(int argc, char** argv) {
+    CompilerOptions options;
+    std::string input_path;
+    bool wants_32_bit = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (parse_opt_level(arg, options.opt_level)) continue;
+        if (parse_vector_extension(arg, options.vectorize)) continue;
+        if (parse_target(arg, options.target)) {
+            wants_32_bit = arg == "-m32";
+            continue;
+        }
+        if (arg == "--verify-ir") {
+            options.verify_ir = true;
+        } else if (arg == "--pass-stats") {
+            options.pass_stats = true;
+        } else if (arg == "--regalloc=linear") {
+            options.allocator = AllocatorKind::LinearScan;
+        } else if (arg == "--regalloc=graph") {
+            options.allocator = AllocatorKind::GraphColoring;
+        } else if (arg == "--emit=asm") {
+            options.emit = OutputFormat::Assembly;
+        } else if (arg == "--emit=obj") {
+            options.emit = OutputFormat::Object;
+        } else if (arg == "--emit=exe") {
+            options.emit = OutputFormat::Executable;
+        } else if (arg == "--jit") {
+            options.jit = true;
+        } else if (arg == "--interpret" || arg == "--interpret=vm") {
+            options.interpret = InterpreterKind::Bytecode;
+        } else if (arg == "--interpret=ast") {
+            options.interpret = InterpreterKind::Tree;
+        } else if (arg == "--interpret=tiered") {
+            options.interpret = InterpreterKind::Tiered;
+        } else if (arg.rfind("--tier-threshold=", 0) == 0 && arg.size() > 17 &&
+                   arg.find_first_not_of("0123456789", 17) == std::string::npos) {
+            options.tier_threshold = static_cast<uint32_t>(std::stoul(arg.substr(17)));
+        } else if (arg == "-o" && i + 1 < argc) {
+            options.output_path = argv[++i];
+        } else if (arg[0] != '-' && input_path.empty()) {
+            input_path = arg;
+        } else {
+            std::cerr << "Unknown option '" << arg << "'" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [-O0|-O1|-O2|-Os] [-m32|-m64] [--regalloc=linear|graph]"
+                      << " [--vectorize=none|sse2|avx2] [--verify-ir] [--pass-stats] [--emit=asm|obj|exe] [-o out] [--jit]"
+                      << " [--interpret[=vm|ast|tiered]] [--tier-threshold=N] [input]" << std::endl;
+            return 1;
+        }
+    }
+    // The JIT runs the code in this 64-bit process
+    if (options.jit) {
+        if (wants_32_bit) {
+            std::cerr << "--jit runs x86-64 code and cannot be combined with -m32" << std::endl;
+            return 1;
+        }
+        options.target = TargetArch::X86_64;
+    }
+    // Both run the vector code on this machine
+    bool runs_natively = options.jit || options.interpret == InterpreterKind::Tiered;
+    if (runs_natively && options.vectorize == VectorExtension::AVX2 && !__builtin_cpu_supports("avx2")) {
+        std::cerr << "--vectorize=avx2 needs a CPU with AVX2 to run the code in-process" << std::endl;
+        return 1;
+    }
 
-int main() {
     setup_printing_options();
 
-    Compiler compiler;
+    Compiler compiler(options);
     std::string code = R"(
    // nested if else and nested for loop
     int n;
@@ -30,6 +95,18 @@ int main() {
     }
     )";
 
+    // A source file on the command line replaces the built-in program
+    if (!input_path.empty()) {
+        std::ifstream input(input_path);
+        if (!input) {
+            std::cerr << "Cannot open '" << input_path << "'" << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << input.rdbuf();
+        code = buffer.str();
+    }
+
     if (should_print(PRINT_INPUT_CODE)) {
         std::cout << code << std::endl;
     }
@@ -0,0 +1,83 @@
+#include "mem2reg.h"
+#include "liveness.h"
+#include <algorithm>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+VariablePromoter::VariablePromoter() : promoted_variables(0), loads(0), stores(0) {}
+
+static TacInstr make_copy(const std::string& dest, const std::string& src, TacOp kind) {
+    TacInstr instr;
+    instr.kind = kind;
+    instr.dest = dest;
+    instr.arg1 = src;
+    return instr;
+}
+
+void VariablePromoter::run(std::vector<TacInstr>& code) {
+    promoted_variables = 0;
+    loads = 0;
+    stores = 0;
+
+    // Variables in order of first appearance, and the first unused temp number
+    std::vector<std::string> variables;
+    std::unordered_map<std::string, std::string> temp_of;
+    std::set<std::string> written;
+    long next_temp = 1;
+    auto note = [&](const std::string& operand) {
+        if (operand.empty() || is_constant(operand)) return;
+        if (is_temporary_name(operand)) {
+            if (std::all_of(operand.begin() + 1, operand.end(), ::isdigit)) {
+                next_temp = std::max(next_temp, std::stol(operand.substr(1)) + 1);
+            }
+            return;
+        }
+        if (temp_of.emplace(operand, "").second) variables.push_back(operand);
+    };
+    for (const auto& instr : code) {
+        note(instr.dest);
+        note(instr.arg1);
+        note(instr.arg2);
+        if (!instr.dest.empty() && !is_temporary_name(instr.dest)) written.insert(instr.dest);
+    }
+    if (variables.empty()) return;
+
+    LivenessAnalysis liveness(code, true);
+    int entry = liveness.graph().entry;
+
+    std::vector<TacInstr> result;
+    result.reserve(code.size() + 2 * variables.size());
+    for (const auto& name : variables) {
+        temp_of[name] = "t" + std::to_string(next_temp++);
+        if (liveness.live_in(entry, liveness.value_id(name))) {
+            result.push_back(make_copy(temp_of[name], name, TacOp::Assign));
+            loads++;
+        }
+    }
+
+    auto rename = [&](std::string& operand) {
+        auto found = temp_of.find(operand);
+        if (found != temp_of.end()) operand = found->second;
+    };
+    for (TacInstr instr : code) {
+        rename(instr.dest);
+        rename(instr.arg1);
+        rename(instr.arg2);
+        if (instr.kind == TacOp::Mov) {
+            instr.kind = TacOp::Assign;
+        } else if (instr.kind == TacOp::Add || instr.kind == TacOp::Sub) {
+            instr.op = instr.kind == TacOp::Add ? "+" : "-";
+            instr.kind = TacOp::Assign;
+        }
+        result.push_back(instr);
+    }
+
+    for (const auto& name : variables) {
+        if (!written.count(name) || is_local_name(name)) continue;
+        result.push_back(make_copy(name, temp_of[name], TacOp::Mov));
+        stores++;
+    }
+    promoted_variables = static_cast<int>(variables.size());
+    code.swap(result);
+}
@@ -0,0 +1,28 @@
+#ifndef MEM2REG_H
+#define MEM2REG_H
+
+#include "ir.h"
+#include <vector>
+
+// Promotes scalar variables from their `.data` cells to temporaries, so the
+// register allocator can keep loop counters and accumulators in registers.
+// Nothing in the language can take a variable's address, so every scalar
+// qualifies.
+//
+// Each variable gets one fresh temp for the whole program. It is loaded at
+// entry only if some path reads it before writing it, and stored back once
+// at the end only if the program writes it, since memory is only observed
+// after the program exits; block locals are never stored back. Reads and
+// writes in between become plain temp operations that SCCP and DCE can see
+// through.
+class VariablePromoter {
+public:
+    VariablePromoter();
+    void run(std::vector<TacInstr>& code);
+
+    int promoted_variables;
+    int loads;
+    int stores;
+};
+
+#endif // MEM2REG_H
@@ -67,7 +67,7 @@
 
 
 /* First part of user prologue.  */
-#line 1 "src/parser.y"
+#line 1 "parser.y"
 
 /******************************************************************
 Corrected Prologue for Bison
@@ -86,7 +86,7 @@ extern StatementList* ast_root;
 // Error reporting function
 void yyerror(const char *s);
 
-#line 90 "src/parser.tab.cpp"
+#line 90 "parser.tab.cpp"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -520,16 +520,16 @@ union yyalloc
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  3
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   80
+#define YYLAST   110
 
 /* YYNTOKENS -- Number of terminals.  */
 #define YYNTOKENS  62
 /* YYNNTS -- Number of nonterminals.  */
 #define YYNNTS  17
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  43
+#define YYNRULES  47
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  79
+#define YYNSTATES  95
 
 /* YYMAXUTOK -- Last valid token kind.  */
 #define YYMAXUTOK   316
@@ -585,10 +585,10 @@ static const yytype_int8 yytranslate[] =
 static const yytype_uint8 yyrline[] =
 {
        0,    62,    62,    66,    67,    74,    75,    76,    77,    78,
-      79,    80,    84,    88,    95,    99,   106,   110,   114,   121,
-     125,   128,   136,   145,   146,   147,   151,   152,   153,   157,
-     163,   164,   165,   166,   167,   168,   169,   170,   174,   175,
-     176,   177,   178,   179
+      79,    80,    84,    88,    95,    96,   104,   108,   115,   119,
+     123,   130,   134,   137,   145,   154,   155,   156,   160,   161,
+     162,   166,   172,   173,   174,   175,   176,   177,   178,   179,
+     180,   181,   185,   186,   187,   188,   189,   190
 };
 #endif
 
@@ -626,7 +626,7 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-49)
+#define YYPACT_NINF (-58)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
@@ -640,14 +640,16 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-     -49,     5,     3,   -49,   -32,   -43,   -35,    29,   -49,   -49,
-     -49,   -18,   -49,    -6,   -49,    -5,   -49,   -49,   -49,   -49,
-      -2,   -49,   -49,     8,    -2,     6,    -3,   -49,   -49,   -49,
-     -49,   -49,    -2,    -2,   -26,    12,   -49,   -49,    -4,    30,
-       9,    -2,   -49,   -49,    20,    -2,    -2,    -2,    -2,    -2,
-      -2,    -2,    -2,    -2,    -2,    -2,     3,   -26,   -49,   -38,
-     -38,   -49,   -49,    13,   -26,   -26,   -26,   -26,   -26,   -26,
-      33,    54,     3,   -49,   -49,    11,   -49,     3,   -49
+     -58,    13,    26,   -58,   -41,   -48,   -36,    17,   -58,   -58,
+     -58,   -29,   -58,    -4,   -58,     2,   -58,   -58,   -58,   -58,
+       5,     5,   -58,   -58,     3,     5,    -7,     1,   -58,   -58,
+     -58,   -30,   -58,     5,     5,    54,    24,    -6,    51,   -58,
+     -58,     8,    59,     6,     5,    57,   -58,     5,   -58,    49,
+       5,     5,     5,     5,     5,    30,    31,     5,     5,     5,
+       5,     5,     5,     5,    26,    54,    15,    29,   -58,   -31,
+     -31,   -58,   -58,   -58,     5,    25,    54,    54,    54,    54,
+      54,    54,    62,    28,   -58,    54,    77,    26,   -58,   -58,
+     -58,    32,   -58,    26,   -58
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -657,26 +659,28 @@ static const yytype_int8 yydefact[] =
 {
        3,     0,     2,     1,     0,     0,     0,     0,    11,     3,
        4,     0,     5,     0,     6,     0,    10,     7,     8,     9,
-       0,    17,    18,    25,     0,    12,     0,    14,    16,    19,
-      36,    37,     0,     0,    15,     0,    24,    23,     0,     0,
-       0,     0,    29,    34,     0,     0,     0,     0,     0,     0,
-       0,     0,     0,     0,     0,     0,     0,    13,    35,    30,
-      31,    32,    33,     0,    39,    41,    38,    40,    42,    43,
-      20,    28,     0,    26,    27,     0,    21,     0,    22
+       0,     0,    19,    20,    27,     0,    12,     0,    14,    18,
+      21,    39,    41,     0,     0,    16,     0,     0,     0,    26,
+      25,     0,     0,     0,     0,     0,    31,     0,    37,     0,
+       0,     0,     0,     0,     0,     0,    12,     0,     0,     0,
+       0,     0,     0,     0,     0,    13,     0,     0,    38,    32,
+      33,    34,    35,    36,     0,     0,    43,    45,    42,    44,
+      46,    47,    22,     0,    40,    17,    30,     0,    15,    28,
+      29,     0,    23,     0,    24
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -49,   -49,    57,   -48,    44,   -49,   -16,   -49,     2,   -49,
-     -49,   -49,   -49,   -49,   -49,   -11,    19
+     -58,   -58,    74,   -57,    60,   -58,   -24,   -58,    -1,   -58,
+     -58,   -58,   -58,   -58,   -58,   -19,    53
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
        0,     1,     2,    10,    11,    12,    13,    14,    15,    16,
-      17,    18,    38,    75,    19,    39,    40
+      17,    18,    41,    91,    19,    42,    43
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -684,28 +688,34 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int8 yytable[] =
 {
-       4,    30,    31,    47,    48,     3,     4,    37,    70,    34,
-      23,    35,    20,    45,    46,    47,    48,     5,    24,     6,
-       7,    43,    44,     5,    76,     6,     7,    21,    22,    78,
-      57,     7,    25,    27,    59,    60,    61,    62,    32,    64,
-      65,    66,    67,    68,    69,    28,    29,    49,     8,    72,
-      41,    33,     9,    42,     8,    73,    20,     4,     9,    45,
-      46,    47,    48,    56,    71,    77,    26,    36,    63,    45,
-      46,    47,    48,    74,    58,    50,    51,    52,    53,    54,
-      55
+      40,    35,    36,    20,     4,    24,    37,    82,    31,    32,
+      52,    53,    54,     3,    48,    49,    21,    25,    22,    23,
+      26,     5,    28,     6,     7,    65,    38,    47,    67,     4,
+      92,    69,    70,    71,    72,    73,    94,    44,    20,    76,
+      77,    78,    79,    80,    81,    33,     5,    29,     6,     7,
+      45,    21,     8,    30,    56,    85,     9,    46,    34,    57,
+      64,    66,    89,    50,    51,    52,    53,    54,    50,    51,
+      52,    53,    54,    83,    74,    44,    86,     8,    87,    88,
+       4,     9,    55,    27,    39,    90,    93,    84,    50,    51,
+      52,    53,    54,    50,    51,    52,    53,    54,    50,    51,
+      52,    53,    54,    68,    58,    59,    60,    61,    62,    63,
+      75
 };
 
 static const yytype_int8 yycheck[] =
 {
-       3,     3,     4,    41,    42,     0,     3,    23,    56,    20,
-      53,     3,    44,    39,    40,    41,    42,    20,    53,    22,
-      23,    32,    33,    20,    72,    22,    23,    59,    60,    77,
-      41,    23,     3,    51,    45,    46,    47,    48,    40,    50,
-      51,    52,    53,    54,    55,    51,    51,    51,    51,    16,
-      44,    53,    55,    56,    51,    71,    44,     3,    55,    39,
-      40,    41,    42,    54,    51,    54,     9,    23,    49,    39,
-      40,    41,    42,    71,    54,    45,    46,    47,    48,    49,
-      50
+      24,    20,    21,    44,     3,    53,     3,    64,     3,     4,
+      41,    42,    43,     0,    33,    34,    57,    53,    59,    60,
+       3,    20,    51,    22,    23,    44,    23,    57,    47,     3,
+      87,    50,    51,    52,    53,    54,    93,    44,    44,    58,
+      59,    60,    61,    62,    63,    40,    20,    51,    22,    23,
+      57,    57,    51,    51,     3,    74,    55,    56,    53,    51,
+      54,     4,    86,    39,    40,    41,    42,    43,    39,    40,
+      41,    42,    43,    58,    44,    44,    51,    51,    16,    51,
+       3,    55,    58,     9,    24,    86,    54,    58,    39,    40,
+      41,    42,    43,    39,    40,    41,    42,    43,    39,    40,
+      41,    42,    43,    54,    45,    46,    47,    48,    49,    50,
+      57
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
@@ -714,32 +724,34 @@ static const yytype_int8 yystos[] =
 {
        0,    63,    64,     0,     3,    20,    22,    23,    51,    55,
       65,    66,    67,    68,    69,    70,    71,    72,    73,    76,
-      44,    59,    60,    53,    53,     3,    64,    51,    51,    51,
-       3,     4,    40,    53,    77,     3,    66,    68,    74,    77,
-      78,    44,    56,    77,    77,    39,    40,    41,    42,    51,
-      45,    46,    47,    48,    49,    50,    54,    77,    54,    77,
-      77,    77,    77,    78,    77,    77,    77,    77,    77,    77,
-      65,    51,    16,    68,    70,    75,    65,    54,    65
+      44,    57,    59,    60,    53,    53,     3,    64,    51,    51,
+      51,     3,     4,    40,    53,    77,    77,     3,    23,    66,
+      68,    74,    77,    78,    44,    57,    56,    57,    77,    77,
+      39,    40,    41,    42,    43,    58,     3,    51,    45,    46,
+      47,    48,    49,    50,    54,    77,     4,    77,    54,    77,
+      77,    77,    77,    77,    44,    78,    77,    77,    77,    77,
+      77,    77,    65,    58,    58,    77,    51,    16,    51,    68,
+      70,    75,    65,    54,    65
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr1[] =
 {
        0,    62,    63,    64,    64,    65,    65,    65,    65,    65,
-      65,    65,    66,    66,    67,    68,    69,    70,    70,    71,
-      72,    72,    73,    74,    74,    74,    75,    75,    75,    76,
-      77,    77,    77,    77,    77,    77,    77,    77,    78,    78,
-      78,    78,    78,    78
+      65,    65,    66,    66,    67,    67,    68,    68,    69,    70,
+      70,    71,    72,    72,    73,    74,    74,    74,    75,    75,
+      75,    76,    77,    77,    77,    77,    77,    77,    77,    77,
+      77,    77,    78,    78,    78,    78,    78,    78
 };
 
 /* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr2[] =
 {
        0,     2,     1,     0,     2,     1,     1,     1,     1,     1,
-       1,     1,     2,     4,     2,     3,     2,     2,     2,     2,
-       5,     7,     9,     1,     1,     0,     1,     1,     0,     3,
-       3,     3,     3,     3,     2,     3,     1,     1,     3,     3,
-       3,     3,     3,     3
+       1,     1,     2,     4,     2,     6,     3,     6,     2,     2,
+       2,     2,     5,     7,     9,     1,     1,     0,     1,     1,
+       0,     3,     3,     3,     3,     3,     3,     2,     3,     1,
+       4,     1,     3,     3,     3,     3,     3,     3
 };
 
 
@@ -943,51 +955,51 @@ yydestruct (const char *yymsg,
   switch (yykind)
     {
     case YYSYMBOL_ID: /* ID  */
-#line 45 "src/parser.y"
+#line 45 "parser.y"
             { delete ((*yyvaluep).str); }
-#line 949 "src/parser.tab.cpp"
+#line 961 "parser.tab.cpp"
         break;
 
     case YYSYMBOL_CONSTANT: /* CONSTANT  */
-#line 45 "src/parser.y"
+#line 45 "parser.y"
             { delete ((*yyvaluep).str); }
-#line 955 "src/parser.tab.cpp"
+#line 967 "parser.tab.cpp"
         break;
 
     case YYSYMBOL_FLOAT_CONSTANT: /* FLOAT_CONSTANT  */
-#line 45 "src/parser.y"
+#line 45 "parser.y"
             { delete ((*yyvaluep).str); }
-#line 961 "src/parser.tab.cpp"
+#line 973 "parser.tab.cpp"
         break;
 
     case YYSYMBOL_STRING: /* STRING  */
-#line 45 "src/parser.y"
+#line 45 "parser.y"
             { delete ((*yyvaluep).str); }
-#line 967 "src/parser.tab.cpp"
+#line 979 "parser.tab.cpp"
         break;
 
     case YYSYMBOL_statement_list: /* statement_list  */
-#line 46 "src/parser.y"
+#line 46 "parser.y"
             { delete ((*yyvaluep).statement_list); }
-#line 973 "src/parser.tab.cpp"
+#line 985 "parser.tab.cpp"
         break;
 
     case YYSYMBOL_statement: /* statement  */
-#line 47 "src/parser.y"
+#line 47 "parser.y"
             { delete ((*yyvaluep).statement); }
-#line 979 "src/parser.tab.cpp"
+#line 991 "parser.tab.cpp"
         break;
 
     case YYSYMBOL_expression: /* expression  */
-#line 48 "src/parser.y"
+#line 48 "parser.y"
             { delete ((*yyvaluep).expression); }
-#line 985 "src/parser.tab.cpp"
+#line 997 "parser.tab.cpp"
         break;
 
     case YYSYMBOL_condition: /* condition  */
-#line 49 "src/parser.y"
+#line 49 "parser.y"
             { delete ((*yyvaluep).condition); }
-#line 991 "src/parser.tab.cpp"
+#line 1003 "parser.tab.cpp"
         break;
 
       default:
@@ -1255,290 +1267,321 @@ yyreduce:
   switch (yyn)
     {
   case 2: /* program: statement_list  */
-#line 62 "src/parser.y"
+#line 62 "parser.y"
                    { ast_root = (yyvsp[0].statement_list); }
-#line 1261 "src/parser.tab.cpp"
+#line 1273 "parser.tab.cpp"
     break;
 
   case 3: /* statement_list: %empty  */
-#line 66 "src/parser.y"
+#line 66 "parser.y"
                   { (yyval.statement_list) = new StatementList(); }
-#line 1267 "src/parser.tab.cpp"
+#line 1279 "parser.tab.cpp"
     break;
 
   case 4: /* statement_list: statement_list statement  */
-#line 67 "src/parser.y"
+#line 67 "parser.y"
                                {
         if ((yyvsp[0].statement)) { (yyvsp[-1].statement_list)->statements.emplace_back((yyvsp[0].statement)); }
         (yyval.statement_list) = (yyvsp[-1].statement_list);
     }
-#line 1276 "src/parser.tab.cpp"
+#line 1288 "parser.tab.cpp"
     break;
 
   case 5: /* statement: declaration  */
-#line 74 "src/parser.y"
+#line 74 "parser.y"
                   { (yyval.statement) = (yyvsp[0].statement); }
-#line 1282 "src/parser.tab.cpp"
+#line 1294 "parser.tab.cpp"
     break;
 
   case 6: /* statement: assignment  */
-#line 75 "src/parser.y"
+#line 75 "parser.y"
                  { (yyval.statement) = (yyvsp[0].statement); }
-#line 1288 "src/parser.tab.cpp"
+#line 1300 "parser.tab.cpp"
     break;
 
   case 7: /* statement: if_statement  */
-#line 76 "src/parser.y"
+#line 76 "parser.y"
                    { (yyval.statement) = (yyvsp[0].statement); }
-#line 1294 "src/parser.tab.cpp"
+#line 1306 "parser.tab.cpp"
     break;
 
   case 8: /* statement: for_statement  */
-#line 77 "src/parser.y"
+#line 77 "parser.y"
                     { (yyval.statement) = (yyvsp[0].statement); }
-#line 1300 "src/parser.tab.cpp"
+#line 1312 "parser.tab.cpp"
     break;
 
   case 9: /* statement: block  */
-#line 78 "src/parser.y"
+#line 78 "parser.y"
             { (yyval.statement) = (yyvsp[0].statement); }
-#line 1306 "src/parser.tab.cpp"
+#line 1318 "parser.tab.cpp"
     break;
 
   case 10: /* statement: increment_statement  */
-#line 79 "src/parser.y"
+#line 79 "parser.y"
                           { (yyval.statement) = (yyvsp[0].statement); }
-#line 1312 "src/parser.tab.cpp"
+#line 1324 "parser.tab.cpp"
     break;
 
   case 11: /* statement: SEMICOLON  */
-#line 80 "src/parser.y"
+#line 80 "parser.y"
                 { (yyval.statement) = nullptr; }
-#line 1318 "src/parser.tab.cpp"
+#line 1330 "parser.tab.cpp"
     break;
 
   case 12: /* declaration_core: INT ID  */
-#line 84 "src/parser.y"
+#line 84 "parser.y"
              {
         (yyval.statement) = new Declaration("int", *(yyvsp[0].str));
         delete (yyvsp[0].str);
       }
-#line 1327 "src/parser.tab.cpp"
+#line 1339 "parser.tab.cpp"
     break;
 
   case 13: /* declaration_core: INT ID ASSIGN expression  */
-#line 88 "src/parser.y"
+#line 88 "parser.y"
                                {
         (yyval.statement) = new Declaration("int", *(yyvsp[-2].str), std::unique_ptr<Expression>((yyvsp[0].expression)));
         delete (yyvsp[-2].str);
       }
-#line 1336 "src/parser.tab.cpp"
+#line 1348 "parser.tab.cpp"
     break;
 
   case 14: /* declaration: declaration_core SEMICOLON  */
-#line 95 "src/parser.y"
-                               { (yyval.statement) = (yyvsp[-1].statement); }
-#line 1342 "src/parser.tab.cpp"
+#line 95 "parser.y"
+                                 { (yyval.statement) = (yyvsp[-1].statement); }
+#line 1354 "parser.tab.cpp"
     break;
 
-  case 15: /* assignment_core: ID ASSIGN expression  */
-#line 99 "src/parser.y"
-                         {
+  case 15: /* declaration: INT ID LBRACKET CONSTANT RBRACKET SEMICOLON  */
+#line 96 "parser.y"
+                                                  {
+        (yyval.statement) = new ArrayDeclaration("int", *(yyvsp[-4].str), static_cast<long long>(std::stod(*(yyvsp[-2].str))));
+        delete (yyvsp[-4].str);
+        delete (yyvsp[-2].str);
+      }
+#line 1364 "parser.tab.cpp"
+    break;
+
+  case 16: /* assignment_core: ID ASSIGN expression  */
+#line 104 "parser.y"
+                           {
         (yyval.statement) = new Assignment(*(yyvsp[-2].str), std::unique_ptr<Expression>((yyvsp[0].expression)));
         delete (yyvsp[-2].str);
-    }
-#line 1351 "src/parser.tab.cpp"
+      }
+#line 1373 "parser.tab.cpp"
     break;
 
-  case 16: /* assignment: assignment_core SEMICOLON  */
-#line 106 "src/parser.y"
+  case 17: /* assignment_core: ID LBRACKET expression RBRACKET ASSIGN expression  */
+#line 108 "parser.y"
+                                                        {
+        (yyval.statement) = new ArrayAssignment(*(yyvsp[-5].str), std::unique_ptr<Expression>((yyvsp[-3].expression)), std::unique_ptr<Expression>((yyvsp[0].expression)));
+        delete (yyvsp[-5].str);
+      }
+#line 1382 "parser.tab.cpp"
+    break;
+
+  case 18: /* assignment: assignment_core SEMICOLON  */
+#line 115 "parser.y"
                               { (yyval.statement) = (yyvsp[-1].statement); }
-#line 1357 "src/parser.tab.cpp"
+#line 1388 "parser.tab.cpp"
     break;
 
-  case 17: /* increment_core: ID INCREMENT  */
-#line 110 "src/parser.y"
+  case 19: /* increment_core: ID INCREMENT  */
+#line 119 "parser.y"
                    {
         (yyval.statement) = new IncrementStatement(*(yyvsp[-1].str), "++");
         delete (yyvsp[-1].str);
       }
-#line 1366 "src/parser.tab.cpp"
+#line 1397 "parser.tab.cpp"
     break;
 
-  case 18: /* increment_core: ID DECREMENT  */
-#line 114 "src/parser.y"
+  case 20: /* increment_core: ID DECREMENT  */
+#line 123 "parser.y"
                    {
         (yyval.statement) = new IncrementStatement(*(yyvsp[-1].str), "--");
         delete (yyvsp[-1].str);
       }
-#line 1375 "src/parser.tab.cpp"
+#line 1406 "parser.tab.cpp"
     break;
 
-  case 19: /* increment_statement: increment_core SEMICOLON  */
-#line 121 "src/parser.y"
+  case 21: /* increment_statement: increment_core SEMICOLON  */
+#line 130 "parser.y"
                              { (yyval.statement) = (yyvsp[-1].statement); }
-#line 1381 "src/parser.tab.cpp"
+#line 1412 "parser.tab.cpp"
     break;
 
-  case 20: /* if_statement: IF LPAREN condition RPAREN statement  */
-#line 125 "src/parser.y"
+  case 22: /* if_statement: IF LPAREN condition RPAREN statement  */
+#line 134 "parser.y"
                                            {
         (yyval.statement) = new IfStatement(std::unique_ptr<BinaryOp>((yyvsp[-2].condition)), std::unique_ptr<Statement>((yyvsp[0].statement)));
       }
-#line 1389 "src/parser.tab.cpp"
+#line 1420 "parser.tab.cpp"
     break;
 
-  case 21: /* if_statement: IF LPAREN condition RPAREN statement ELSE statement  */
-#line 128 "src/parser.y"
+  case 23: /* if_statement: IF LPAREN condition RPAREN statement ELSE statement  */
+#line 137 "parser.y"
                                                           {
         (yyval.statement) = new IfStatement(std::unique_ptr<BinaryOp>((yyvsp[-4].condition)),
                              std::unique_ptr<Statement>((yyvsp[-2].statement)),
                              std::unique_ptr<Statement>((yyvsp[0].statement)));
       }
-#line 1399 "src/parser.tab.cpp"
+#line 1430 "parser.tab.cpp"
     break;
 
-  case 22: /* for_statement: FOR LPAREN for_init SEMICOLON condition SEMICOLON for_increment RPAREN statement  */
-#line 136 "src/parser.y"
+  case 24: /* for_statement: FOR LPAREN for_init SEMICOLON condition SEMICOLON for_increment RPAREN statement  */
+#line 145 "parser.y"
                                                                                      {
         (yyval.statement) = new ForStatement(std::unique_ptr<Statement>((yyvsp[-6].statement)),
                               std::unique_ptr<BinaryOp>((yyvsp[-4].condition)),
                               std::unique_ptr<Statement>((yyvsp[-2].statement)),
                               std::unique_ptr<Statement>((yyvsp[0].statement)));
     }
-#line 1410 "src/parser.tab.cpp"
+#line 1441 "parser.tab.cpp"
     break;
 
-  case 23: /* for_init: assignment_core  */
-#line 145 "src/parser.y"
+  case 25: /* for_init: assignment_core  */
+#line 154 "parser.y"
                       { (yyval.statement) = (yyvsp[0].statement); }
-#line 1416 "src/parser.tab.cpp"
+#line 1447 "parser.tab.cpp"
     break;
 
-  case 24: /* for_init: declaration_core  */
-#line 146 "src/parser.y"
+  case 26: /* for_init: declaration_core  */
+#line 155 "parser.y"
                        { (yyval.statement) = (yyvsp[0].statement); }
-#line 1422 "src/parser.tab.cpp"
+#line 1453 "parser.tab.cpp"
     break;
 
-  case 25: /* for_init: %empty  */
-#line 147 "src/parser.y"
+  case 27: /* for_init: %empty  */
+#line 156 "parser.y"
                   { (yyval.statement) = nullptr; }
-#line 1428 "src/parser.tab.cpp"
+#line 1459 "parser.tab.cpp"
     break;
 
-  case 26: /* for_increment: assignment_core  */
-#line 151 "src/parser.y"
+  case 28: /* for_increment: assignment_core  */
+#line 160 "parser.y"
                       { (yyval.statement) = (yyvsp[0].statement); }
-#line 1434 "src/parser.tab.cpp"
+#line 1465 "parser.tab.cpp"
     break;
 
-  case 27: /* for_increment: increment_core  */
-#line 152 "src/parser.y"
+  case 29: /* for_increment: increment_core  */
+#line 161 "parser.y"
                      { (yyval.statement) = (yyvsp[0].statement); }
-#line 1440 "src/parser.tab.cpp"
+#line 1471 "parser.tab.cpp"
     break;
 
-  case 28: /* for_increment: %empty  */
-#line 153 "src/parser.y"
+  case 30: /* for_increment: %empty  */
+#line 162 "parser.y"
                   { (yyval.statement) = nullptr; }
-#line 1446 "src/parser.tab.cpp"
+#line 1477 "parser.tab.cpp"
     break;
 
-  case 29: /* block: LBRACE statement_list RBRACE  */
-#line 157 "src/parser.y"
+  case 31: /* block: LBRACE statement_list RBRACE  */
+#line 166 "parser.y"
                                  {
         (yyval.statement) = new Block(std::unique_ptr<StatementList>((yyvsp[-1].statement_list)));
     }
-#line 1454 "src/parser.tab.cpp"
+#line 1485 "parser.tab.cpp"
     break;
 
-  case 30: /* expression: expression PLUS expression  */
-#line 163 "src/parser.y"
+  case 32: /* expression: expression PLUS expression  */
+#line 172 "parser.y"
                                  { (yyval.expression) = new BinaryOp("+", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1460 "src/parser.tab.cpp"
+#line 1491 "parser.tab.cpp"
     break;
 
-  case 31: /* expression: expression MINUS expression  */
-#line 164 "src/parser.y"
+  case 33: /* expression: expression MINUS expression  */
+#line 173 "parser.y"
                                   { (yyval.expression) = new BinaryOp("-", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1466 "src/parser.tab.cpp"
+#line 1497 "parser.tab.cpp"
     break;
 
-  case 32: /* expression: expression TIMES expression  */
-#line 165 "src/parser.y"
+  case 34: /* expression: expression TIMES expression  */
+#line 174 "parser.y"
                                   { (yyval.expression) = new BinaryOp("*", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1472 "src/parser.tab.cpp"
+#line 1503 "parser.tab.cpp"
     break;
 
-  case 33: /* expression: expression DIVIDE expression  */
-#line 166 "src/parser.y"
+  case 35: /* expression: expression DIVIDE expression  */
+#line 175 "parser.y"
                                    { (yyval.expression) = new BinaryOp("/", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1478 "src/parser.tab.cpp"
+#line 1509 "parser.tab.cpp"
+    break;
+
+  case 36: /* expression: expression MODULO expression  */
+#line 176 "parser.y"
+                                   { (yyval.expression) = new BinaryOp("%", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
+#line 1515 "parser.tab.cpp"
     break;
 
-  case 34: /* expression: MINUS expression  */
-#line 167 "src/parser.y"
+  case 37: /* expression: MINUS expression  */
+#line 177 "parser.y"
                                     { (yyval.expression) = new UnaryOp("-", std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1484 "src/parser.tab.cpp"
+#line 1521 "parser.tab.cpp"
     break;
 
-  case 35: /* expression: LPAREN expression RPAREN  */
-#line 168 "src/parser.y"
+  case 38: /* expression: LPAREN expression RPAREN  */
+#line 178 "parser.y"
                                { (yyval.expression) = (yyvsp[-1].expression); }
-#line 1490 "src/parser.tab.cpp"
+#line 1527 "parser.tab.cpp"
     break;
 
-  case 36: /* expression: ID  */
-#line 169 "src/parser.y"
+  case 39: /* expression: ID  */
+#line 179 "parser.y"
          { (yyval.expression) = new Identifier(*(yyvsp[0].str)); delete (yyvsp[0].str); }
-#line 1496 "src/parser.tab.cpp"
+#line 1533 "parser.tab.cpp"
+    break;
+
+  case 40: /* expression: ID LBRACKET expression RBRACKET  */
+#line 180 "parser.y"
+                                      { (yyval.expression) = new ArrayAccess(*(yyvsp[-3].str), std::unique_ptr<Expression>((yyvsp[-1].expression))); delete (yyvsp[-3].str); }
+#line 1539 "parser.tab.cpp"
     break;
 
-  case 37: /* expression: CONSTANT  */
-#line 170 "src/parser.y"
+  case 41: /* expression: CONSTANT  */
+#line 181 "parser.y"
                { (yyval.expression) = new Number(std::stod(*(yyvsp[0].str))); delete (yyvsp[0].str); }
-#line 1502 "src/parser.tab.cpp"
+#line 1545 "parser.tab.cpp"
     break;
 
-  case 38: /* condition: expression GT expression  */
-#line 174 "src/parser.y"
+  case 42: /* condition: expression GT expression  */
+#line 185 "parser.y"
                                { (yyval.condition) = new BinaryOp(">", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1508 "src/parser.tab.cpp"
+#line 1551 "parser.tab.cpp"
     break;
 
-  case 39: /* condition: expression LT expression  */
-#line 175 "src/parser.y"
+  case 43: /* condition: expression LT expression  */
+#line 186 "parser.y"
                                { (yyval.condition) = new BinaryOp("<", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1514 "src/parser.tab.cpp"
+#line 1557 "parser.tab.cpp"
     break;
 
-  case 40: /* condition: expression GE expression  */
-#line 176 "src/parser.y"
+  case 44: /* condition: expression GE expression  */
+#line 187 "parser.y"
                                { (yyval.condition) = new BinaryOp(">=", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1520 "src/parser.tab.cpp"
+#line 1563 "parser.tab.cpp"
     break;
 
-  case 41: /* condition: expression LE expression  */
-#line 177 "src/parser.y"
+  case 45: /* condition: expression LE expression  */
+#line 188 "parser.y"
                                { (yyval.condition) = new BinaryOp("<=", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1526 "src/parser.tab.cpp"
+#line 1569 "parser.tab.cpp"
     break;
 
-  case 42: /* condition: expression EQ expression  */
-#line 178 "src/parser.y"
+  case 46: /* condition: expression EQ expression  */
+#line 189 "parser.y"
                                { (yyval.condition) = new BinaryOp("==", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1532 "src/parser.tab.cpp"
+#line 1575 "parser.tab.cpp"
     break;
 
-  case 43: /* condition: expression NE expression  */
-#line 179 "src/parser.y"
+  case 47: /* condition: expression NE expression  */
+#line 190 "parser.y"
                                { (yyval.condition) = new BinaryOp("!=", std::unique_ptr<Expression>((yyvsp[-2].expression)), std::unique_ptr<Expression>((yyvsp[0].expression))); }
-#line 1538 "src/parser.tab.cpp"
+#line 1581 "parser.tab.cpp"
     break;
 
 
-#line 1542 "src/parser.tab.cpp"
+#line 1585 "parser.tab.cpp"
 
       default: break;
     }
@@ -1731,7 +1774,7 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 182 "src/parser.y"
+#line 193 "parser.y"
 
 /******************************************************************
 Epilogue
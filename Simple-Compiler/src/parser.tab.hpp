@@ -35,8 +35,8 @@
    especially those whose name start with YY_ or yy_.  They are
    private implementation details that can be changed or removed.  */
 
-#ifndef YY_YY_SRC_PARSER_TAB_HPP_INCLUDED
-# define YY_YY_SRC_PARSER_TAB_HPP_INCLUDED
+#ifndef YY_YY_PARSER_TAB_HPP_INCLUDED
+# define YY_YY_PARSER_TAB_HPP_INCLUDED
 /* Debug traces.  */
 #ifndef YYDEBUG
 # define YYDEBUG 0
@@ -121,7 +121,7 @@ extern int yydebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 23 "src/parser.y"
+#line 23 "parser.y"
 
     std::string*   str;
     StatementList* statement_list;
@@ -129,7 +129,7 @@ union YYSTYPE
     Expression*    expression;
     BinaryOp*      condition;
 
-#line 133 "src/parser.tab.hpp"
+#line 133 "parser.tab.hpp"
 
 };
 typedef union YYSTYPE YYSTYPE;
@@ -144,4 +144,4 @@ extern YYSTYPE yylval;
 int yyparse (void);
 
 
-#endif /* !YY_YY_SRC_PARSER_TAB_HPP_INCLUDED  */
+#endif /* !YY_YY_PARSER_TAB_HPP_INCLUDED  */
@@ -92,14 +92,23 @@ declaration_core:
 ;
 
 declaration:
-    declaration_core SEMICOLON { $$ = $1; }
+      declaration_core SEMICOLON { $$ = $1; }
+    | INT ID LBRACKET CONSTANT RBRACKET SEMICOLON {
+        $$ = new ArrayDeclaration("int", *$2, static_cast<long long>(std::stod(*$4)));
+        delete $2;
+        delete $4;
+      }
 ;
 
 assignment_core:
-    ID ASSIGN expression {
+      ID ASSIGN expression {
         $$ = new Assignment(*$1, std::unique_ptr<Expression>($3));
         delete $1;
-    }
+      }
+    | ID LBRACKET expression RBRACKET ASSIGN expression {
+        $$ = new ArrayAssignment(*$1, std::unique_ptr<Expression>($3), std::unique_ptr<Expression>($6));
+        delete $1;
+      }
 ;
 
 assignment:
@@ -164,9 +173,11 @@ expression:
     | expression MINUS expression { $$ = new BinaryOp("-", std::unique_ptr<Expression>($1), std::unique_ptr<Expression>($3)); }
     | expression TIMES expression { $$ = new BinaryOp("*", std::unique_ptr<Expression>($1), std::unique_ptr<Expression>($3)); }
     | expression DIVIDE expression { $$ = new BinaryOp("/", std::unique_ptr<Expression>($1), std::unique_ptr<Expression>($3)); }
+    | expression MODULO expression { $$ = new BinaryOp("%", std::unique_ptr<Expression>($1), std::unique_ptr<Expression>($3)); }
     | MINUS expression %prec UMINUS { $$ = new UnaryOp("-", std::unique_ptr<Expression>($2)); }
     | LPAREN expression RPAREN { $$ = $2; }
     | ID { $$ = new Identifier(*$1); delete $1; }
+    | ID LBRACKET expression RBRACKET { $$ = new ArrayAccess(*$1, std::unique_ptr<Expression>($3)); delete $1; }
     | CONSTANT { $$ = new Number(std::stod(*$1)); delete $1; }
 ;
 
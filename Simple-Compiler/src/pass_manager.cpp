@@ -0,0 +1,257 @@
+#include "pass_manager.h"
+#include "cfg.h"
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <set>
+#include <stdexcept>
+
+bool parse_opt_level(const std::string& flag, OptLevel& level) {
+    if (flag == "-O0") level = OptLevel::O0;
+    else if (flag == "-O1") level = OptLevel::O1;
+    else if (flag == "-O2") level = OptLevel::O2;
+    else if (flag == "-Os") level = OptLevel::Os;
+    else return false;
+    return true;
+}
+
+std::string opt_level_name(OptLevel level) {
+    switch (level) {
+        case OptLevel::O0: return "-O0";
+        case OptLevel::O1: return "-O1";
+        case OptLevel::O2: return "-O2";
+        case OptLevel::Os: return "-Os";
+    }
+    return "";
+}
+
+PassManager::PassManager() : verify_each(false) {}
+
+void PassManager::add_pass(const std::string& name, Pass pass) {
+    passes.emplace_back(name, pass);
+}
+
+void PassManager::clear() {
+    passes.clear();
+    stats.clear();
+}
+
+// Text of every live block, used to tell which blocks a pass touched. The
+// label is left out so renumbering alone does not count as a change.
+static std::multiset<std::string> block_fingerprints(const std::vector<TacInstr>& code) {
+    ControlFlowGraph cfg(code);
+    std::multiset<std::string> result;
+    for (size_t i = 0; i < cfg.blocks.size(); ++i) {
+        const BasicBlock& block = cfg.blocks[i];
+        if (block.removed || static_cast<int>(i) == cfg.exit) continue;
+        std::string text;
+        for (const auto& instr : block.instrs) text += tac_to_string(instr) + "\n";
+        if (block.terminator == BasicBlock::CondJump) {
+            text += "IF " + block.condition.arg1 + " " + block.condition.op + " " + block.condition.arg2;
+        } else if (block.terminator == BasicBlock::Jump) {
+            text += "GOTO";
+        }
+        result.insert(text);
+    }
+    return result;
+}
+
+void PassManager::run(std::vector<TacInstr>& code) {
+    stats.clear();
+    if (verify_each) verify_ir(code);
+
+    for (auto& [name, pass] : passes) {
+        PassStats entry;
+        entry.name = name;
+        entry.instrs_before = code.size();
+        std::multiset<std::string> before = block_fingerprints(code);
+
+        auto start = std::chrono::steady_clock::now();
+        pass(code);
+        auto end = std::chrono::steady_clock::now();
+        entry.microseconds = std::chrono::duration<double, std::micro>(end - start).count();
+
+        if (verify_each) {
+            try {
+                verify_ir(code);
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error(std::string(e.what()) + " (after pass '" + name + "')");
+            }
+        }
+
+        std::multiset<std::string> after = block_fingerprints(code);
+        entry.instrs_after = code.size();
+        entry.blocks_before = static_cast<int>(before.size());
+        entry.blocks_after = static_cast<int>(after.size());
+        for (const auto& block : after) {
+            auto found = before.find(block);
+            if (found != before.end()) {
+                before.erase(found);
+            } else {
+                entry.blocks_changed++;
+            }
+        }
+        stats.push_back(entry);
+    }
+}
+
+void PassManager::print_statistics(std::ostream& out) const {
+    out << std::left << std::setw(16) << "Pass" << std::right
+        << std::setw(12) << "Time (us)"
+        << std::setw(16) << "Instrs before" << std::setw(14) << "Instrs after"
+        << std::setw(16) << "Blocks" << std::setw(10) << "Changed" << std::endl;
+    for (const auto& entry : stats) {
+        out << std::left << std::setw(16) << entry.name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1) << entry.microseconds
+            << std::setw(16) << entry.instrs_before << std::setw(14) << entry.instrs_after
+            << std::setw(16) << (std::to_string(entry.blocks_before) + "->" + std::to_string(entry.blocks_after))
+            << std::setw(10) << entry.blocks_changed << std::endl;
+    }
+}
+
+static bool is_operand(const std::string& operand) {
+    if (operand.empty()) return false;
+    if (is_constant(operand)) return true;
+    if (!isalpha(static_cast<unsigned char>(operand[0])) && operand[0] != '_') return false;
+    for (char c : operand) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') return false;
+    }
+    return true;
+}
+
+void verify_ir(const std::vector<TacInstr>& code) {
+    static const std::set<std::string> binary_ops = {"+", "-", "*", "/", "%", ">>>"};
+    static const std::set<std::string> comparisons = {"<", "<=", ">", ">=", "==", "!="};
+
+    std::set<std::string> labels;
+    std::set<std::string> written;
+    std::set<std::string> arrays;
+    for (const auto& instr : code) {
+        if (instr.kind == TacOp::Label) {
+            if (!labels.insert(instr.label).second) {
+                throw std::runtime_error("IR Error: Label '" + instr.label + "' is defined twice.");
+            }
+        } else if (instr.kind == TacOp::ArrayDecl) {
+            if (!arrays.insert(instr.array).second) {
+                throw std::runtime_error("IR Error: Array '" + instr.array + "' is declared twice.");
+            }
+        } else if (!instr.dest.empty()) {
+            written.insert(instr.dest);
+        }
+    }
+
+    // Vector registers only hold values within a straight-line run
+    std::set<int> vectors;
+    for (const auto& instr : code) {
+        std::string text = tac_to_string(instr);
+        auto check_operand = [&](const std::string& operand) {
+            if (!is_operand(operand)) {
+                throw std::runtime_error("IR Error: Bad operand '" + operand + "' in '" + text + "'.");
+            }
+            if (is_temporary_name(operand) && !written.count(operand)) {
+                throw std::runtime_error("IR Error: Temporary '" + operand + "' is never written, in '" + text + "'.");
+            }
+            if (arrays.count(operand)) {
+                throw std::runtime_error("IR Error: Array '" + operand + "' used as a value, in '" + text + "'.");
+            }
+        };
+        auto check_array = [&]() {
+            if (!arrays.count(instr.array)) {
+                throw std::runtime_error("IR Error: Undeclared array in '" + text + "'.");
+            }
+        };
+        auto check_vector = [&](int reg) {
+            if (!vectors.count(reg)) {
+                throw std::runtime_error("IR Error: Vector register read before it is written, in '" + text + "'.");
+            }
+        };
+        if (instr.kind == TacOp::Label || instr.is_jump()) vectors.clear();
+        bool vector = instr.kind == TacOp::VectorLoad || instr.kind == TacOp::VectorStore ||
+                      instr.kind == TacOp::VectorSplat || instr.kind == TacOp::VectorOp;
+        if (vector && instr.lanes != 4 && instr.lanes != 8) {
+            throw std::runtime_error("IR Error: Vectors are 4 or 8 lanes, in '" + text + "'.");
+        }
+
+        switch (instr.kind) {
+            case TacOp::Label:
+                break;
+            case TacOp::Goto:
+            case TacOp::IfGoto:
+                if (!labels.count(instr.label)) {
+                    throw std::runtime_error("IR Error: Jump to undefined label in '" + text + "'.");
+                }
+                if (instr.kind == TacOp::IfGoto) {
+                    if (!comparisons.count(instr.op)) {
+                        throw std::runtime_error("IR Error: Unknown comparison in '" + text + "'.");
+                    }
+                    check_operand(instr.arg1);
+                    check_operand(instr.arg2);
+                }
+                break;
+            case TacOp::Assign:
+                if (!instr.op.empty() && !instr.arg2.empty() && !binary_ops.count(instr.op) &&
+                    !comparisons.count(instr.op)) {
+                    throw std::runtime_error("IR Error: Unknown operator in '" + text + "'.");
+                }
+                if (instr.is_unary() && instr.op != "-") {
+                    throw std::runtime_error("IR Error: Unknown unary operator in '" + text + "'.");
+                }
+                check_operand(instr.dest);
+                check_operand(instr.arg1);
+                if (!instr.arg2.empty()) check_operand(instr.arg2);
+                break;
+            case TacOp::Mov:
+                check_operand(instr.dest);
+                check_operand(instr.arg1);
+                break;
+            case TacOp::Add:
+            case TacOp::Sub:
+            case TacOp::CondMove:
+                check_operand(instr.dest);
+                check_operand(instr.arg1);
+                check_operand(instr.arg2);
+                break;
+            case TacOp::ArrayDecl:
+                if (!is_constant(instr.arg1) || std::stoll(instr.arg1) <= 0) {
+                    throw std::runtime_error("IR Error: Array size is not a positive constant in '" + text + "'.");
+                }
+                break;
+            case TacOp::Load:
+                check_array();
+                check_operand(instr.dest);
+                check_operand(instr.arg1);
+                break;
+            case TacOp::Store:
+                check_array();
+                check_operand(instr.arg1);
+                check_operand(instr.arg2);
+                break;
+            case TacOp::BoundsCheck:
+                check_array();
+                check_operand(instr.arg1);
+                break;
+            case TacOp::VectorLoad:
+            case TacOp::VectorSplat:
+                if (instr.kind == TacOp::VectorLoad) check_array();
+                check_operand(instr.arg1);
+                vectors.insert(instr.vdest);
+                break;
+            case TacOp::VectorStore:
+                check_array();
+                check_operand(instr.arg1);
+                check_vector(instr.vsrc1);
+                break;
+            case TacOp::VectorOp:
+                if (instr.op != "+" && instr.op != "-" && instr.op != "*") {
+                    throw std::runtime_error("IR Error: Unknown vector operator in '" + text + "'.");
+                }
+                check_vector(instr.vsrc1);
+                check_vector(instr.vsrc2);
+                vectors.insert(instr.vdest);
+                break;
+        }
+        if (!instr.dest.empty() && is_constant(instr.dest)) {
+            throw std::runtime_error("IR Error: Constant used as destination in '" + text + "'.");
+        }
+    }
+}
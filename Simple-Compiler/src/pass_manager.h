@@ -0,0 +1,63 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include "ir.h"
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Optimization levels, selected with -O0 / -O1 / -O2 / -Os:
+//   O0  no optimization, TAC goes straight to the backend
+//   O1  cheap IR cleanups: variable promotion, constant propagation, dead
+//       code elimination and CFG simplification
+//   O2  O1 plus algebraic simplification, bounds-check elimination, loop
+//       reversal, if-conversion and the AST loop passes (closed forms,
+//       vectorization, unrolling)
+//   Os  O2 without transformations that trade code size for speed
+enum class OptLevel { O0, O1, O2, Os };
+
+// Parses "-O0", "-O1", "-O2" or "-Os"; returns false for anything else
+bool parse_opt_level(const std::string& flag, OptLevel& level);
+std::string opt_level_name(OptLevel level);
+
+// What one pass did to the TAC in one run
+struct PassStats {
+    std::string name;
+    double microseconds = 0;
+    size_t instrs_before = 0;
+    size_t instrs_after = 0;
+    int blocks_before = 0;
+    int blocks_after = 0;
+    int blocks_changed = 0;  // Blocks of the result that did not exist before
+};
+
+// Runs a pipeline of TAC passes in registration order. Passes are plain
+// callables so every existing pass class can be registered through a lambda.
+class PassManager {
+public:
+    typedef std::function<void(std::vector<TacInstr>&)> Pass;
+
+    PassManager();
+    void add_pass(const std::string& name, Pass pass);
+    void clear();
+    void run(std::vector<TacInstr>& code);
+
+    // Check the IR before the first pass and after every pass
+    bool verify_each;
+
+    const std::vector<PassStats>& statistics() const { return stats; }
+    void print_statistics(std::ostream& out) const;
+
+private:
+    std::vector<std::pair<std::string, Pass>> passes;
+    std::vector<PassStats> stats;
+};
+
+// Throws std::runtime_error if the listing is malformed: duplicate or
+// undefined labels, instructions missing operands, unknown operators,
+// temporaries read without being written anywhere, or vector registers
+// read before they are written in the same straight-line run.
+void verify_ir(const std::vector<TacInstr>& code);
+
+#endif // PASS_MANAGER_H
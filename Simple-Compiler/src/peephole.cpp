@@ -0,0 +1,214 @@
+#include "peephole.h"
+#include <map>
+
+PeepholeOptimizer::PeepholeOptimizer() : rewrites(0) {}
+
+static void erase(std::vector<MachineInstr>& code, size_t at) {
+    code.erase(code.begin() + at);
+}
+
+// mov r, r
+static bool self_move(std::vector<MachineInstr>& code, size_t at) {
+    const MachineInstr& mov = code[at];
+    if (!mov.is("mov") || mov.operands.size() != 2) return false;
+    if (!is_register_operand(mov.operands[0]) || mov.operands[0] != mov.operands[1]) return false;
+    erase(code, at);
+    return true;
+}
+
+// add r, 0 / sub r, 0 / imul r, 1, unless the flags they set are read next
+static bool identity_arithmetic(std::vector<MachineInstr>& code, size_t at) {
+    const MachineInstr& instr = code[at];
+    if (instr.kind != MachineInstr::Instr || instr.operands.size() != 2) return false;
+    const std::string& value = instr.operands[1];
+    bool identity = ((instr.opcode == "add" || instr.opcode == "sub") && value == "0") ||
+                    (instr.opcode == "imul" && value == "1");
+    if (!identity) return false;
+    if (at + 1 < code.size() && reads_flags(code[at + 1])) return false;
+    erase(code, at);
+    return true;
+}
+
+// mov [m], r ; mov r2, [m]  ->  mov [m], r ; mov r2, r
+static bool store_load(std::vector<MachineInstr>& code, size_t at) {
+    const MachineInstr& store = code[at];
+    MachineInstr& load = code[at + 1];
+    if (!store.is("mov") || !load.is("mov") || store.operands.size() != 2 || load.operands.size() != 2) return false;
+    const std::string& reg = store.operands[1];
+    if (!is_memory_operand(store.operands[0]) || !is_register_operand(reg)) return false;
+    if (!is_register_operand(load.operands[0]) || !same_operand(store.operands[0], load.operands[1])) return false;
+    if (load.operands[0] == reg) {
+        erase(code, at + 1);
+    } else {
+        load.operands[1] = reg;
+    }
+    return true;
+}
+
+// mov r, [m] ; mov r, [m]
+static bool repeated_load(std::vector<MachineInstr>& code, size_t at) {
+    const MachineInstr& first = code[at];
+    const MachineInstr& second = code[at + 1];
+    if (!first.is("mov") || !second.is("mov") || first.operands.size() != 2 || second.operands.size() != 2) return false;
+    const std::string& reg = first.operands[0];
+    if (!is_register_operand(reg) || reg != second.operands[0]) return false;
+    if (!is_memory_operand(first.operands[1]) || !same_operand(first.operands[1], second.operands[1])) return false;
+    if (mentions_register(first.operands[1], reg)) return false;
+    erase(code, at + 1);
+    return true;
+}
+
+// jmp L / jcc L straight into L, possibly past other labels
+static bool jump_to_next(std::vector<MachineInstr>& code, size_t at) {
+    const MachineInstr& jump = code[at];
+    if (!is_unconditional_jump(jump) && !is_conditional_jump(jump)) return false;
+    for (size_t i = at + 1; i < code.size() && code[i].is_label(); ++i) {
+        if (code[i].opcode == jump.operands[0]) {
+            erase(code, at);
+            return true;
+        }
+    }
+    return false;
+}
+
+// jcc L1 ; jmp L2 ; L1:  ->  jncc L2 ; L1:
+static bool branch_over_jump(std::vector<MachineInstr>& code, size_t at) {
+    MachineInstr& branch = code[at];
+    const MachineInstr& jump = code[at + 1];
+    const MachineInstr& label = code[at + 2];
+    if (!is_conditional_jump(branch) || !is_unconditional_jump(jump) || !label.is_label()) return false;
+    if (branch.operands[0] != label.opcode) return false;
+    branch.opcode = inverse_jump(branch.opcode);
+    branch.operands[0] = jump.operands[0];
+    erase(code, at + 1);
+    return true;
+}
+
+// Code after an unconditional jump up to the next label never runs
+static bool unreachable(std::vector<MachineInstr>& code, size_t at) {
+    if (!is_unconditional_jump(code[at])) return false;
+    size_t end = at + 1;
+    while (end < code.size() && !code[end].is_label()) end++;
+    if (end == at + 1) return false;
+    code.erase(code.begin() + at + 1, code.begin() + end);
+    return true;
+}
+
+// Whether eax is read before it is overwritten in the code from `from` on
+static bool eax_live(const std::vector<MachineInstr>& code, size_t from) {
+    for (size_t i = from; i < code.size(); ++i) {
+        const MachineInstr& instr = code[i];
+        if (instr.is_label() || is_unconditional_jump(instr)) return false;
+        bool overwrite = instr.is("mov") && instr.operands.size() == 2 && instr.operands[0] == "eax" &&
+                         !mentions_register(instr.operands[1], "eax");
+        if (overwrite) return false;
+        for (const auto& operand : instr.operands) {
+            if (mentions_register(operand, "eax")) return true;
+        }
+    }
+    return false;
+}
+
+// mov eax, [m] ; cmp eax, r/imm  ->  cmp dword [m], r/imm
+static bool compare_memory(std::vector<MachineInstr>& code, size_t at) {
+    const MachineInstr& load = code[at];
+    MachineInstr& compare = code[at + 1];
+    if (!load.is("mov") || !compare.is("cmp") || load.operands.size() != 2 || compare.operands.size() != 2) return false;
+    if (load.operands[0] != "eax" || compare.operands[0] != "eax") return false;
+    const std::string& memory = load.operands[1];
+    const std::string& other = compare.operands[1];
+    if (!is_memory_operand(memory) || is_memory_operand(other) || other == "eax") return false;
+    if (eax_live(code, at + 2)) return false;
+    compare.operands[0] = memory.rfind("dword", 0) == 0 ? memory : "dword " + memory;
+    erase(code, at);
+    return true;
+}
+
+// Whether `instr` is `test r, r` or `cmp x, 0` on `operand`
+static bool compares_with_zero(const MachineInstr& instr, const std::string& operand) {
+    if (instr.operands.size() != 2) return false;
+    if (instr.is("test")) return instr.operands[0] == instr.operands[1] && same_operand(instr.operands[0], operand);
+    return instr.is("cmp") && instr.operands[1] == "0" && same_operand(instr.operands[0], operand);
+}
+
+// dec r ; test r, r ; jcc  ->  dec r ; jcc
+// The arithmetic already set ZF and SF from its result. test also clears
+// OF and CF, so only jumps that read ZF or SF alone carry over, with jl and
+// jge turning into js and jns.
+static bool redundant_test(std::vector<MachineInstr>& code, size_t at) {
+    const MachineInstr& arith = code[at];
+    MachineInstr& branch = code[at + 2];
+    if (!sets_result_flags(arith) || !compares_with_zero(code[at + 1], arith.operands[0])) return false;
+    static const std::map<std::string, std::string> carried = {
+        {"je", "je"}, {"jne", "jne"}, {"js", "js"}, {"jns", "jns"}, {"jl", "js"}, {"jge", "jns"},
+    };
+    auto found = carried.find(branch.kind == MachineInstr::Instr ? branch.opcode : "");
+    if (found == carried.end()) return false;
+    if (at + 3 < code.size() && reads_flags(code[at + 3])) return false;
+    branch.opcode = found->second;
+    erase(code, at + 1);
+    return true;
+}
+
+// cmp a, b ; jcc L ; cmp a, b  ->  cmp a, b ; jcc L
+// A jump does not touch the flags, so the fallthrough still has them.
+static bool repeated_compare(std::vector<MachineInstr>& code, size_t at) {
+    const MachineInstr& first = code[at];
+    const MachineInstr& second = code[at + 2];
+    if ((!first.is("cmp") && !first.is("test")) || first.opcode != second.opcode) return false;
+    if (!is_conditional_jump(code[at + 1]) || first.operands.size() != 2 || second.operands.size() != 2) return false;
+    if (!same_operand(first.operands[0], second.operands[0]) || !same_operand(first.operands[1], second.operands[1])) {
+        return false;
+    }
+    erase(code, at + 2);
+    return true;
+}
+
+const std::vector<PeepholeOptimizer::Rule>& PeepholeOptimizer::rules() {
+    static const std::vector<Rule> table = {
+        {"self-move", 1, self_move},
+        {"identity-arith", 1, identity_arithmetic},
+        {"store-load", 2, store_load},
+        {"repeated-load", 2, repeated_load},
+        {"compare-memory", 2, compare_memory},
+        {"redundant-test", 3, redundant_test},
+        {"repeated-compare", 3, repeated_compare},
+        {"jump-to-next", 1, jump_to_next},
+        {"branch-over-jump", 3, branch_over_jump},
+        {"unreachable", 1, unreachable},
+    };
+    return table;
+}
+
+void PeepholeOptimizer::run(std::vector<MachineInstr>& code) {
+    const std::vector<Rule>& table = rules();
+    fired.assign(table.size(), 0);
+    rewrites = 0;
+
+    size_t at = 0;
+    while (at < code.size()) {
+        bool changed = false;
+        for (size_t r = 0; r < table.size(); ++r) {
+            if (at + table[r].window > code.size() || !table[r].apply(code, at)) continue;
+            fired[r]++;
+            rewrites++;
+            changed = true;
+            break;
+        }
+        if (!changed) {
+            at++;
+        } else {
+            // The widest window could now match starting a little earlier
+            at = at >= 2 ? at - 2 : 0;
+        }
+    }
+}
+
+std::vector<std::pair<std::string, int>> PeepholeOptimizer::statistics() const {
+    std::vector<std::pair<std::string, int>> result;
+    const std::vector<Rule>& table = rules();
+    for (size_t r = 0; r < table.size() && r < fired.size(); ++r) {
+        result.push_back({table[r].name, fired[r]});
+    }
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "machine.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Peephole optimizer over the generated machine instructions. A table of
+// rules is tried at each position of a sliding window; a rule that fires
+// rewrites the instructions in place, and the window backs up so patterns
+// the rewrite exposed are seen too. Every rule removes an instruction or
+// turns a memory read into a register read, so the pass terminates.
+//
+// Relies on one backend invariant: eax is scratch, so it is never live at a
+// label; a value left in eax is dead once the straight-line code after it
+// overwrites eax or reaches a label.
+class PeepholeOptimizer {
+public:
+    PeepholeOptimizer();
+    void run(std::vector<MachineInstr>& code);
+
+    // Rule names with the number of times each fired in the last run
+    std::vector<std::pair<std::string, int>> statistics() const;
+    int rewrites;
+
+private:
+    struct Rule {
+        const char* name;
+        size_t window; // Instructions the pattern needs at the position
+        bool (*apply)(std::vector<MachineInstr>& code, size_t at);
+    };
+    static const std::vector<Rule>& rules();
+
+    std::vector<int> fired;
+};
+
+#endif // PEEPHOLE_H
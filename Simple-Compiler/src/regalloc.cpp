@@ -0,0 +1,265 @@
+#include "regalloc.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+std::vector<std::string> clobbered_registers(const TacInstr& instr) {
+    // cdq/idiv write edx:eax
+    if (instr.kind == TacOp::Assign && (instr.op == "/" || instr.op == "%")) return {"edx"};
+    return {};
+}
+
+RegisterAllocator::RegisterAllocator(const std::vector<std::string>& registers) : registers(registers) {
+    reset_statistics();
+}
+
+void RegisterAllocator::reset_statistics() {
+    slot_count = 0;
+    interval_count = 0;
+    spilled_intervals = 0;
+    split_intervals = 0;
+    coalesced_moves = 0;
+}
+
+const std::vector<SpillMove>& RegisterAllocator::moves_before(int) const {
+    static const std::vector<SpillMove> none;
+    return none;
+}
+
+void RegisterAllocator::position_info(const ControlFlowGraph& cfg, std::vector<int>& depth, std::vector<int>& block) {
+    std::vector<int> depths = cfg.loop_depths();
+    int length = 0;
+    for (const auto& b : cfg.blocks) {
+        if (b.position < 0) continue;
+        int end = b.position + static_cast<int>(b.instrs.size());
+        if (b.terminator != BasicBlock::FallThrough) end++;
+        length = std::max(length, end);
+    }
+    depth.assign(length, 0);
+    block.assign(length, -1);
+    for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+        const BasicBlock& bb = cfg.blocks[b];
+        if (bb.position < 0) continue;
+        int end = bb.position + static_cast<int>(bb.instrs.size());
+        if (bb.terminator != BasicBlock::FallThrough) end++;
+        for (int p = bb.position; p < end; ++p) {
+            block[p] = static_cast<int>(b);
+            depth[p] = depths[b];
+        }
+    }
+}
+
+LinearScanAllocator::LinearScanAllocator(const std::vector<std::string>& registers) : RegisterAllocator(registers) {}
+
+double LinearScanAllocator::spill_weight(const std::vector<int>& positions, int from, int to) const {
+    double cost = 0;
+    for (int position : positions) cost += std::pow(10.0, std::min(position_depth[position], 8));
+    return cost / (to - from + 1);
+}
+
+std::string LinearScanAllocator::register_at(const std::string& temp, int position) const {
+    auto found = locations.find(temp);
+    if (found == locations.end()) return "";
+    for (const auto& segment : found->second.segments) {
+        if (!segment.reg.empty() && segment.from <= position && position <= segment.to) return segment.reg;
+    }
+    return "";
+}
+
+int LinearScanAllocator::slot_of(const std::string& temp) const {
+    auto found = locations.find(temp);
+    return found == locations.end() ? -1 : found->second.slot;
+}
+
+const std::vector<SpillMove>& LinearScanAllocator::moves_before(int position) const {
+    static const std::vector<SpillMove> none;
+    if (position < 0 || position >= static_cast<int>(moves.size())) return none;
+    return moves[position];
+}
+
+void LinearScanAllocator::run(const LivenessAnalysis& liveness) {
+    locations.clear();
+    reset_statistics();
+
+    const std::vector<std::string>& names = liveness.names();
+    std::vector<int> block_of;
+    position_info(liveness.graph(), position_depth, block_of);
+    moves.assign(position_depth.size(), {});
+
+    std::vector<Piece> pieces;
+    std::vector<int> temp_end(names.size(), -1);
+    typedef std::pair<int, int> Event; // (position, index)
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> unhandled;
+
+    for (const auto& interval : liveness.intervals()) {
+        if (!is_temporary_name(names[interval.value])) continue;
+        Piece piece;
+        piece.value = interval.value;
+        piece.from = interval.start();
+        piece.to = interval.end();
+        std::merge(interval.uses.begin(), interval.uses.end(), interval.defs.begin(), interval.defs.end(),
+                   std::back_inserter(piece.positions));
+        piece.positions.erase(std::unique(piece.positions.begin(), piece.positions.end()), piece.positions.end());
+        piece.weight = spill_weight(piece.positions, piece.from, piece.to);
+        piece.single_block = block_of[piece.from] == block_of[piece.to];
+        piece.reload = false;
+        temp_end[piece.value] = piece.to;
+        unhandled.push({piece.from, static_cast<int>(pieces.size())});
+        pieces.push_back(piece);
+        interval_count++;
+    }
+
+    auto register_index = [&](const std::string& reg) {
+        return static_cast<size_t>(std::find(registers.begin(), registers.end(), reg) - registers.begin());
+    };
+
+    // Per register, the positions of the instructions that overwrite it
+    // behind the allocator's back, ascending, with the temps each reads
+    struct Clobbers {
+        std::vector<int> positions;
+        std::vector<std::vector<std::string>> operands;
+    };
+    std::vector<Clobbers> clobbers(registers.size());
+    for (const auto& block : liveness.graph().blocks) {
+        if (block.removed || block.position < 0) continue;
+        for (size_t i = 0; i < block.instrs.size(); ++i) {
+            for (const std::string& reg : clobbered_registers(block.instrs[i])) {
+                size_t r = register_index(reg);
+                if (r == registers.size()) continue;
+                clobbers[r].positions.push_back(block.position + static_cast<int>(i));
+                clobbers[r].operands.emplace_back();
+                instr_uses(block.instrs[i], clobbers[r].operands.back());
+            }
+        }
+    }
+    // A piece cannot hold a register across an instruction that clobbers it
+    // or while it is read there; a temp defined there is written afterwards
+    auto clobbered = [&](const Piece& piece, size_t reg) {
+        const Clobbers& list = clobbers[reg];
+        auto it = std::lower_bound(list.positions.begin(), list.positions.end(), piece.from);
+        if (it == list.positions.end() || *it > piece.to) return false;
+        if (*it > piece.from) return true;
+        const std::vector<std::string>& operands = list.operands[it - list.positions.begin()];
+        if (std::find(operands.begin(), operands.end(), names[piece.value]) != operands.end()) return true;
+        ++it;
+        return it != list.positions.end() && *it <= piece.to;
+    };
+
+    std::vector<bool> register_free(registers.size(), true);
+    std::vector<int> active;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> slot_release; // (owner's end, slot)
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> free_slots;   // (free after, slot)
+
+    // Gives the temp a stack slot no other live temp uses from `needed_from` on
+    auto ensure_slot = [&](int value, int needed_from) {
+        TempLocation& location = locations[names[value]];
+        if (location.slot >= 0) return;
+        if (!free_slots.empty() && free_slots.top().first < needed_from) {
+            location.slot = free_slots.top().second;
+            free_slots.pop();
+        } else {
+            location.slot = slot_count++;
+        }
+        slot_release.push({temp_end[value], location.slot});
+    };
+
+    auto assign = [&](int index, size_t reg) {
+        Piece& piece = pieces[index];
+        TempLocation& location = locations[names[piece.value]];
+        piece.reg = registers[reg];
+        piece.segment = static_cast<int>(location.segments.size());
+        location.segments.push_back({piece.from, piece.to, piece.reg});
+        register_free[reg] = false;
+        active.push_back(index);
+        if (piece.reload) moves[piece.from].push_back({SpillMove::Reload, names[piece.value], piece.reg});
+    };
+
+    while (!unhandled.empty()) {
+        int current = unhandled.top().second;
+        unhandled.pop();
+        int position = pieces[current].from;
+
+        // Registers of pieces that ended before this position are free again;
+        // an operand's register is only reused once its instruction is done
+        for (size_t i = 0; i < active.size();) {
+            if (pieces[active[i]].to < position) {
+                register_free[register_index(pieces[active[i]].reg)] = true;
+                active[i] = active.back();
+                active.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        while (!slot_release.empty() && slot_release.top().first < position) {
+            free_slots.push(slot_release.top());
+            slot_release.pop();
+        }
+
+        size_t reg = 0;
+        while (reg < registers.size() && (!register_free[reg] || clobbered(pieces[current], reg))) ++reg;
+        if (reg < registers.size()) {
+            assign(current, reg);
+            continue;
+        }
+
+        int victim = current;
+        for (int index : active) {
+            const Piece& candidate = pieces[index];
+            if (clobbered(pieces[current], register_index(candidate.reg))) continue;
+            const Piece& worst = pieces[victim];
+            if (candidate.weight < worst.weight || (candidate.weight == worst.weight && candidate.to > worst.to)) {
+                victim = index;
+            }
+        }
+
+        if (victim == current) {
+            ensure_slot(pieces[current].value, pieces[current].from);
+            spilled_intervals++;
+            continue;
+        }
+
+        Piece& spilled = pieces[victim];
+        TempLocation& location = locations[names[spilled.value]];
+        reg = register_index(spilled.reg);
+        active.erase(std::find(active.begin(), active.end(), victim));
+
+        if (spilled.single_block && spilled.from < position) {
+            // Keep the register up to here, store, and requeue the rest from
+            // its next use so it can come back into a register
+            location.segments[spilled.segment].to = position - 1;
+            ensure_slot(spilled.value, position);
+            moves[position].insert(moves[position].begin(), {SpillMove::Store, names[spilled.value], spilled.reg});
+            split_intervals++;
+
+            auto next = std::upper_bound(spilled.positions.begin(), spilled.positions.end(), position);
+            if (next != spilled.positions.end()) {
+                Piece rest = spilled;
+                rest.from = *next;
+                rest.positions.assign(next, spilled.positions.end());
+                rest.weight = spill_weight(rest.positions, rest.from, rest.to);
+                rest.reload = true;
+                rest.segment = -1;
+                rest.reg.clear();
+                unhandled.push({rest.from, static_cast<int>(pieces.size())});
+                pieces.push_back(rest);
+            }
+        } else {
+            // Spill the whole piece. Nothing has been emitted yet, so its
+            // earlier positions simply read the slot instead.
+            location.segments[spilled.segment].reg.clear();
+            if (spilled.reload) {
+                auto& before = moves[spilled.from];
+                for (auto it = before.begin(); it != before.end(); ++it) {
+                    if (it->kind == SpillMove::Reload && it->temp == names[spilled.value]) {
+                        before.erase(it);
+                        break;
+                    }
+                }
+            }
+            ensure_slot(spilled.value, spilled.from);
+            spilled_intervals++;
+        }
+        register_free[reg] = true;
+        assign(current, reg);
+    }
+}
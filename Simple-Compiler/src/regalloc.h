@@ -0,0 +1,111 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "liveness.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Code the allocator needs inserted before an instruction: a Store copies a
+// temp from its register to its stack slot, a Reload copies it back.
+struct SpillMove {
+    enum Kind { Store, Reload };
+    Kind kind;
+    std::string temp;
+    std::string reg;
+};
+
+// Where one temp lives: in `reg` over each listed segment of positions, and
+// in stack slot `slot` everywhere else it is live.
+struct TempLocation {
+    struct Segment {
+        int from;
+        int to;
+        std::string reg;
+    };
+    std::vector<Segment> segments;
+    int slot = -1;
+};
+
+// Which allocator the backend uses; Default picks graph coloring at -O2
+// and linear scan otherwise
+enum class AllocatorKind { Default, LinearScan, GraphColoring };
+
+// Registers the backend cannot keep a temp in across an instruction, because
+// the instruction's x86 form overwrites them (eax is never allocated)
+std::vector<std::string> clobbered_registers(const TacInstr& instr);
+
+// Common interface of the register allocators. The backend asks where a temp
+// is at each instruction and emits any spill code the allocator requests.
+class RegisterAllocator {
+public:
+    RegisterAllocator(const std::vector<std::string>& registers);
+    virtual ~RegisterAllocator() {}
+
+    virtual void run(const LivenessAnalysis& liveness) = 0;
+    virtual const char* name() const = 0;
+
+    // Register holding `temp` at `position`, or "" if it is in its slot
+    virtual std::string register_at(const std::string& temp, int position) const = 0;
+    virtual int slot_of(const std::string& temp) const = 0;
+    virtual const std::vector<SpillMove>& moves_before(int position) const;
+
+    int slot_count;
+    int interval_count;
+    int spilled_intervals;
+    int split_intervals;
+    int coalesced_moves;
+
+protected:
+    std::vector<std::string> registers;
+
+    void reset_statistics();
+    // Loop depth and block id of every position of the listing
+    static void position_info(const ControlFlowGraph& cfg, std::vector<int>& depth, std::vector<int>& block);
+};
+
+// Linear-scan register allocation (Poletto & Sarkar) over the live
+// intervals of the TAC temporaries, O(n log n) in the number of intervals.
+//
+// When every register is taken, the interval with the lowest spill weight
+// (uses and defs, each weighted 10^loop depth, divided by interval length)
+// gives up its register. An interval that lies within one basic block is
+// split instead: it keeps the register up to the conflict, is stored to its
+// slot there, and the rest is queued again from its next use with a reload
+// in front of it. Intervals that cross blocks are spilled whole, since a
+// split point would not be on every path through them. Spilled temps are
+// read and written in place as memory operands; stack slots are reused once
+// the temp that owned them is dead. A register an instruction clobbers (see
+// clobbered_registers) is not given to a piece live across it or read by it.
+class LinearScanAllocator : public RegisterAllocator {
+public:
+    LinearScanAllocator(const std::vector<std::string>& registers);
+    void run(const LivenessAnalysis& liveness) override;
+    const char* name() const override { return "linear scan"; }
+
+    std::string register_at(const std::string& temp, int position) const override;
+    int slot_of(const std::string& temp) const override;
+    const std::vector<SpillMove>& moves_before(int position) const override;
+
+private:
+    // A piece of a temp's lifetime waiting for, or holding, a register
+    struct Piece {
+        int value;
+        int from;
+        int to;
+        std::vector<int> positions;  // Uses and defs inside [from, to]
+        double weight;
+        bool single_block;
+        bool reload;                 // Starts with a reload from the slot
+        int segment = -1;            // Index into the temp's segments once allocated
+        std::string reg;
+    };
+
+    std::unordered_map<std::string, TempLocation> locations;
+    std::vector<std::vector<SpillMove>> moves;
+    std::vector<int> position_depth;
+
+    double spill_weight(const std::vector<int>& positions, int from, int to) const;
+};
+
+#endif // REGALLOC_H
@@ -0,0 +1,407 @@
+#include "scalar_evolution.h"
+#include "printing_options.h"
+#include <cstdint>
+#include <iostream>
+
+ScalarEvolution::ScalarEvolution() : temp_count(0) {}
+
+void ScalarEvolution::reset() {
+    temp_count = 0;
+}
+
+void ScalarEvolution::run(StatementList* root) {
+    if (!root) return;
+    visit_list(root);
+}
+
+void ScalarEvolution::visit_list(StatementList* list) {
+    if (!list) return;
+    for (auto& stmt : list->statements) {
+        visit(stmt);
+    }
+}
+
+void ScalarEvolution::visit(std::unique_ptr<Statement>& slot) {
+    if (!slot) return;
+    if (auto if_stmt = dynamic_cast<IfStatement*>(slot.get())) {
+        visit(if_stmt->if_body);
+        visit(if_stmt->else_body);
+    } else if (auto block = dynamic_cast<Block*>(slot.get())) {
+        visit_list(block->statement_list.get());
+    } else if (auto loop = dynamic_cast<ForStatement*>(slot.get())) {
+        // Inner loops first, so their closed forms become part of the outer body
+        visit(loop->body);
+        auto replacement = closed_form(loop, 0);
+        if (replacement) {
+            if (should_print(PRINT_PARSE_TREE)) {
+                InductionVariable iv;
+                match_induction_variable(loop, iv);
+                std::cout << "Optimizer: Replaced loop over '" << iv.var << "' with its closed form" << std::endl;
+            }
+            slot = std::move(replacement);
+        }
+    }
+}
+
+/******************************************************************
+ * Expression building with constant folding
+ * Values are folded with 32-bit wrap-around, like the generated code.
+ ******************************************************************/
+
+static long long wrap32(long long value) {
+    return static_cast<int32_t>(static_cast<uint32_t>(value));
+}
+
+static std::unique_ptr<Expression> number(long long value) {
+    return std::make_unique<Number>(static_cast<double>(wrap32(value)));
+}
+
+static bool is_number(const Expression* expr, long long value) {
+    long long v;
+    auto num = dynamic_cast<const Number*>(expr);
+    return num && evaluate_constant(num, v) && v == value;
+}
+
+static std::unique_ptr<Expression> fold(const std::string& op, std::unique_ptr<Expression> l, std::unique_ptr<Expression> r) {
+    long long a, b;
+    bool const_l = evaluate_constant(l.get(), a);
+    bool const_r = evaluate_constant(r.get(), b);
+    if (const_l && const_r) {
+        if (op == "+") return number(a + b);
+        if (op == "-") return number(a - b);
+        if (op == "*") return number(wrap32(a) * wrap32(b));
+        if (op == ">>>") return number(static_cast<uint32_t>(a) >> b);
+    }
+    if ((op == "+" || op == "-" || op == ">>>") && is_number(r.get(), 0)) return l;
+    if (op == "+" && is_number(l.get(), 0)) return r;
+    if (op == "*" && (is_number(l.get(), 0) || is_number(r.get(), 0))) return number(0);
+    if (op == "*" && is_number(l.get(), 1)) return r;
+    if (op == "*" && is_number(r.get(), 1)) return l;
+    return std::make_unique<BinaryOp>(op, std::move(l), std::move(r));
+}
+
+static std::unique_ptr<Expression> negate(std::unique_ptr<Expression> e) {
+    return fold("-", number(0), std::move(e));
+}
+
+// Clones `expr`, replacing variables found in `values` and folding constants
+static std::unique_ptr<Expression> rewrite(const Expression* expr, const std::map<std::string, const Expression*>& values) {
+    if (auto id = dynamic_cast<const Identifier*>(expr)) {
+        auto found = values.find(id->name);
+        if (found != values.end()) return clone_expression(found->second);
+        return std::make_unique<Identifier>(id->name);
+    }
+    if (auto binop = dynamic_cast<const BinaryOp*>(expr)) {
+        return fold(binop->op, rewrite(binop->left.get(), values), rewrite(binop->right.get(), values));
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(expr)) {
+        auto inner = rewrite(unop->expr.get(), values);
+        if (unop->op == "-") return negate(std::move(inner));
+        return std::make_unique<UnaryOp>(unop->op, std::move(inner));
+    }
+    return clone_expression(expr);
+}
+
+// T * (T - 1) / 2 without a division: with h = T >> 1 this equals
+// h * (2T - 2h - 1) exactly, so it also holds under 32-bit wrap-around.
+static std::unique_ptr<Expression> series_sum(const Expression* trip) {
+    long long t;
+    if (evaluate_constant(trip, t)) return number(t * (t - 1) / 2);
+    auto half = [&]() { return fold(">>>", clone_expression(trip), number(1)); };
+    auto twice_trip = fold("*", number(2), clone_expression(trip));
+    auto factor = fold("-", fold("-", std::move(twice_trip), fold("*", number(2), half())), number(1));
+    return fold("*", half(), std::move(factor));
+}
+
+/******************************************************************
+ * Analysis
+ ******************************************************************/
+
+std::unique_ptr<Expression> ScalarEvolution::substitute(const Expression* expr, const LoopState& state) {
+    std::map<std::string, const Expression*> values;
+    for (const auto& [name, value] : state.known) values[name] = value.get();
+    return rewrite(expr, values);
+}
+
+bool ScalarEvolution::is_invariant(const Expression* expr, const LoopState& state, bool allow_iv) {
+    std::set<std::string> used;
+    collect_used(expr, used);
+    for (const auto& name : used) {
+        if (name == state.iv.var) {
+            if (!allow_iv) return false;
+        } else if (state.modified.count(name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Splits `expr` into base + step * i for the induction variable i
+bool ScalarEvolution::affine(const Expression* expr, const LoopState& state, AddRecurrence& out) {
+    if (is_invariant(expr, state, false)) {
+        out.base = clone_expression(expr);
+        out.step = number(0);
+        return true;
+    }
+    if (auto id = dynamic_cast<const Identifier*>(expr)) {
+        if (id->name != state.iv.var) return false;
+        out.base = number(0);
+        out.step = number(1);
+        return true;
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(expr)) {
+        AddRecurrence inner;
+        if (unop->op != "-" || !affine(unop->expr.get(), state, inner)) return false;
+        out.base = negate(std::move(inner.base));
+        out.step = negate(std::move(inner.step));
+        return true;
+    }
+    auto binop = dynamic_cast<const BinaryOp*>(expr);
+    if (!binop) return false;
+    if (binop->op == "+" || binop->op == "-") {
+        AddRecurrence l, r;
+        if (!affine(binop->left.get(), state, l) || !affine(binop->right.get(), state, r)) return false;
+        out.base = fold(binop->op, std::move(l.base), std::move(r.base));
+        out.step = fold(binop->op, std::move(l.step), std::move(r.step));
+        return true;
+    }
+    if (binop->op == "*") {
+        const Expression* scale = binop->left.get();
+        const Expression* other = binop->right.get();
+        if (!is_invariant(scale, state, false)) std::swap(scale, other);
+        AddRecurrence inner;
+        if (!is_invariant(scale, state, false) || !affine(other, state, inner)) return false;
+        out.base = fold("*", clone_expression(scale), std::move(inner.base));
+        out.step = fold("*", clone_expression(scale), std::move(inner.step));
+        return true;
+    }
+    return false;
+}
+
+bool ScalarEvolution::process_assignment(LoopState& state, const std::string& var, const Expression* expr, bool is_declaration) {
+    auto value = substitute(expr, state);
+    std::set<std::string> used;
+    collect_used(value.get(), used);
+
+    if (!used.count(var)) {
+        // Plain assignment: the value only depends on i and invariants
+        if (state.accumulators.count(var) || !is_invariant(value.get(), state, true)) return false;
+        if (!state.known.count(var)) state.known_order.push_back(var);
+        state.known[var] = std::move(value);
+        return true;
+    }
+    if (is_declaration) return false;
+
+    // Accumulator: v = v + e, v = e + v or v = v - e
+    auto binop = dynamic_cast<BinaryOp*>(value.get());
+    if (!binop) return false;
+    auto left_id = dynamic_cast<Identifier*>(binop->left.get());
+    auto right_id = dynamic_cast<Identifier*>(binop->right.get());
+    std::unique_ptr<Expression> increment;
+    if (left_id && left_id->name == var && (binop->op == "+" || binop->op == "-")) {
+        increment = binop->op == "+" ? std::move(binop->right) : negate(std::move(binop->right));
+    } else if (right_id && right_id->name == var && binop->op == "+") {
+        increment = std::move(binop->left);
+    } else {
+        return false;
+    }
+    std::set<std::string> increment_uses;
+    collect_used(increment.get(), increment_uses);
+    if (increment_uses.count(var)) return false;
+
+    AddRecurrence per_i;
+    if (!affine(increment.get(), state, per_i)) return false;
+
+    // In iteration space the increment is {base + step*i0, +, step*s}
+    AddRecurrence rec;
+    rec.base = fold("+", std::move(per_i.base),
+                    fold("*", clone_expression(per_i.step.get()), std::make_unique<Identifier>(state.iv.var)));
+    rec.step = fold("*", std::move(per_i.step), number(state.iv.step));
+
+    auto existing = state.accumulators.find(var);
+    if (existing == state.accumulators.end()) {
+        state.accumulator_order.push_back(var);
+        state.accumulators[var] = std::move(rec);
+    } else {
+        existing->second.base = fold("+", std::move(existing->second.base), std::move(rec.base));
+        existing->second.step = fold("+", std::move(existing->second.step), std::move(rec.step));
+    }
+    return true;
+}
+
+// Flattens nested blocks; fails on inner loops. The analysis keys values
+// by name, so it also fails on a declaration in a block nested inside the
+// body, whose name would stand for two variables once flattened.
+static bool flatten(const Statement* stmt, std::vector<const Statement*>& out, int depth = 0) {
+    if (!stmt) return true;
+    if (auto block = dynamic_cast<const Block*>(stmt)) {
+        for (const auto& inner : block->statement_list->statements) {
+            if (!flatten(inner.get(), out, depth + 1)) return false;
+        }
+        return true;
+    }
+    if (dynamic_cast<const ForStatement*>(stmt)) return false;
+    if (dynamic_cast<const Declaration*>(stmt) && depth > 1) return false;
+    out.push_back(stmt);
+    return true;
+}
+
+std::unique_ptr<Statement> ScalarEvolution::closed_form(const ForStatement* loop, int unswitch_depth) {
+    LoopState state;
+    if (!match_induction_variable(loop, state.iv)) return nullptr;
+    // A closed form reads an element once where the loop read it on every
+    // iteration, which would drop the bounds checks of the other reads
+    if (reads_array(loop)) return nullptr;
+
+    // The trip count is computed with a shift, so |step| must be a power of two
+    long long magnitude = state.iv.step < 0 ? -state.iv.step : state.iv.step;
+    if ((magnitude & (magnitude - 1)) != 0) return nullptr;
+    bool upward = (state.iv.op == "<" || state.iv.op == "<=") && state.iv.step > 0;
+    bool downward = (state.iv.op == ">" || state.iv.op == ">=") && state.iv.step < 0;
+    if (!upward && !downward) return nullptr;
+
+    collect_assigned(loop->body.get(), state.modified);
+    state.modified.insert(state.iv.var);
+
+    std::vector<const Statement*> body;
+    if (!flatten(loop->body.get(), body)) return nullptr;
+
+    std::set<std::string> mentioned; // By the statements so far
+    for (size_t i = 0; i < body.size(); ++i) {
+        const Statement* stmt = body[i];
+        bool ok = false;
+        if (auto assign = dynamic_cast<const Assignment*>(stmt)) {
+            ok = process_assignment(state, assign->id, assign->expr.get(), false);
+        } else if (auto decl = dynamic_cast<const Declaration*>(stmt)) {
+            // Above the declaration the name is the outer variable
+            if (mentioned.count(decl->id)) return nullptr;
+            state.declared.insert(decl->id);
+            ok = !decl->expr || process_assignment(state, decl->id, decl->expr.get(), true);
+        } else if (auto inc = dynamic_cast<const IncrementStatement*>(stmt)) {
+            BinaryOp update(inc->op == "++" ? "+" : "-", std::make_unique<Identifier>(inc->id),
+                            std::make_unique<Number>(1));
+            ok = process_assignment(state, inc->id, &update, false);
+        } else if (auto if_stmt = dynamic_cast<const IfStatement*>(stmt)) {
+            // Same outcome on every iteration: split the loop on it
+            auto condition = substitute(if_stmt->condition.get(), state);
+            if (!is_invariant(condition.get(), state, false) || unswitch_depth >= 3) return nullptr;
+            return unswitch(loop, body, i, std::move(condition), unswitch_depth);
+        }
+        if (!ok) return nullptr;
+        collect_used(stmt, mentioned);
+        collect_assigned(stmt, mentioned);
+    }
+    // A local without an initializer, accumulated in, carries nothing out
+    for (const auto& var : state.accumulator_order) {
+        if (state.declared.count(var)) return nullptr;
+    }
+    return emit_closed_form(loop, state);
+}
+
+std::unique_ptr<Statement> ScalarEvolution::unswitch(const ForStatement* loop, const std::vector<const Statement*>& body,
+                                                     size_t index, std::unique_ptr<Expression> condition, int unswitch_depth) {
+    auto if_stmt = static_cast<const IfStatement*>(body[index]);
+    auto version = [&](const Statement* arm) {
+        auto list = std::make_unique<StatementList>();
+        for (size_t i = 0; i < body.size(); ++i) {
+            const Statement* stmt = i == index ? arm : body[i];
+            if (stmt) list->statements.push_back(clone_statement(stmt));
+        }
+        ForStatement variant(clone_statement(loop->init.get()), clone_condition(loop->condition.get()),
+                             clone_statement(loop->increment.get()), std::make_unique<Block>(std::move(list)));
+        return closed_form(&variant, unswitch_depth + 1);
+    };
+
+    auto cond = dynamic_cast<BinaryOp*>(condition.get());
+    if (!cond) return nullptr;
+    bool outcome;
+    if (evaluate_condition(cond, outcome)) {
+        return version(outcome ? if_stmt->if_body.get() : if_stmt->else_body.get());
+    }
+
+    auto then_version = version(if_stmt->if_body.get());
+    auto else_version = then_version ? version(if_stmt->else_body.get()) : nullptr;
+    if (!then_version || !else_version) return nullptr;
+    condition.release();
+    return std::make_unique<IfStatement>(std::unique_ptr<BinaryOp>(cond), std::move(then_version), std::move(else_version));
+}
+
+/******************************************************************
+ * Code generation
+ ******************************************************************/
+
+std::unique_ptr<Statement> ScalarEvolution::emit_closed_form(const ForStatement* loop, LoopState& state) {
+    const InductionVariable& iv = state.iv;
+    auto list = std::make_unique<StatementList>();
+    if (loop->init) list->statements.push_back(clone_statement(loop->init.get()));
+
+    // Use the start value directly when it is a compile-time constant
+    std::map<std::string, const Expression*> at_entry;
+    long long start_value;
+    std::unique_ptr<Expression> start_number;
+    if (iv.start && evaluate_constant(iv.start, start_value)) {
+        start_number = number(start_value);
+        at_entry[iv.var] = start_number.get();
+    }
+    auto start = [&]() { return rewrite(std::make_unique<Identifier>(iv.var).get(), at_entry); };
+
+    // Trip count: ceil(distance / |step|) for < and >, distance / |step| + 1 for <= and >=.
+    // The guard makes the distance non-negative, so a logical shift divides exactly.
+    long long magnitude = iv.step < 0 ? -iv.step : iv.step;
+    int shift = 0;
+    while ((1LL << shift) < magnitude) shift++;
+    auto distance = iv.step > 0 ? fold("-", clone_expression(iv.bound), start())
+                                : fold("-", start(), clone_expression(iv.bound));
+    std::unique_ptr<Expression> trip;
+    if (iv.op == "<" || iv.op == ">") {
+        trip = fold(">>>", fold("+", std::move(distance), number(magnitude - 1)), number(shift));
+    } else {
+        trip = fold("+", fold(">>>", std::move(distance), number(shift)), number(1));
+    }
+
+    auto guard = std::make_unique<BinaryOp>(iv.op, start(), clone_expression(iv.bound));
+    bool guard_value;
+    bool constant_guard = evaluate_condition(guard.get(), guard_value);
+    if (constant_guard && !guard_value) {
+        // The loop never runs
+        return std::make_unique<Block>(std::move(list));
+    }
+
+    auto body = std::make_unique<StatementList>();
+    long long trip_value;
+    std::unique_ptr<Expression> trip_ref;
+    if (evaluate_constant(trip.get(), trip_value) || dynamic_cast<Identifier*>(trip.get())) {
+        trip_ref = std::move(trip);
+    } else {
+        std::string name = "__scev_trip" + std::to_string(++temp_count);
+        body->statements.push_back(std::make_unique<Declaration>("int", name, std::move(trip)));
+        trip_ref = std::make_unique<Identifier>(name);
+    }
+
+    // v += T * base + step * T(T-1)/2
+    for (const auto& var : state.accumulator_order) {
+        AddRecurrence& rec = state.accumulators[var];
+        auto total = fold("+", fold("*", clone_expression(trip_ref.get()), rewrite(rec.base.get(), at_entry)),
+                          fold("*", std::move(rec.step), series_sum(trip_ref.get())));
+        body->statements.push_back(std::make_unique<Assignment>(
+            var, fold("+", std::make_unique<Identifier>(var), std::move(total))));
+    }
+
+    // Variables assigned in the loop keep the value of the last iteration
+    auto last_iv = fold("+", start(), fold("*", fold("-", clone_expression(trip_ref.get()), number(1)), number(iv.step)));
+    std::map<std::string, const Expression*> at_last = {{iv.var, last_iv.get()}};
+    for (const auto& var : state.known_order) {
+        if (state.declared.count(var)) continue;
+        body->statements.push_back(std::make_unique<Assignment>(var, rewrite(state.known[var].get(), at_last)));
+    }
+
+    body->statements.push_back(std::make_unique<Assignment>(
+        iv.var, fold("+", start(), fold("*", clone_expression(trip_ref.get()), number(iv.step)))));
+
+    if (constant_guard) {
+        for (auto& stmt : body->statements) list->statements.push_back(std::move(stmt));
+    } else {
+        list->statements.push_back(std::make_unique<IfStatement>(std::move(guard), std::make_unique<Block>(std::move(body))));
+    }
+    return std::make_unique<Block>(std::move(list));
+}
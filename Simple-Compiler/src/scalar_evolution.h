@@ -0,0 +1,66 @@
+#ifndef SCALAR_EVOLUTION_H
+#define SCALAR_EVOLUTION_H
+
+#include "ast.h"
+#include "ast_utils.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// An add-recurrence {base, +, step}: on iteration k (counting from 0) the
+// value is base + k * step. Both coefficients are loop-invariant expressions.
+struct AddRecurrence {
+    std::unique_ptr<Expression> base;
+    std::unique_ptr<Expression> step;
+};
+
+// Replaces for loops whose effect has a closed form by direct computation.
+// Every value the loop carries must be either
+//   - the induction variable i itself,
+//   - an accumulator updated as  v = v + e  where e is affine in i, so v
+//     evolves as {v0, +, {e0, +, c}} and its final value is
+//     v0 + T*e0 + c*T*(T-1)/2 for trip count T, or
+//   - a variable assigned a value that only depends on i and invariants,
+//     whose final value is that expression at the last iteration.
+// If statements with a loop-invariant condition are unswitched first, so
+// nested accumulation loops collapse one level at a time.
+// Values are tracked by name, so a loop that declares a variable in a block
+// nested in its body, or after using the same name in the body, is left
+// alone.
+class ScalarEvolution {
+public:
+    ScalarEvolution();
+    void run(StatementList* root);
+    void reset();
+
+private:
+    // Per-loop analysis state while walking the body in order
+    struct LoopState {
+        InductionVariable iv;
+        std::set<std::string> modified;  // Everything the loop writes
+        std::set<std::string> declared;  // Declared in the body: dead after the loop
+        std::map<std::string, std::unique_ptr<Expression>> known; // Value in terms of i and invariants
+        std::vector<std::string> known_order;
+        std::map<std::string, AddRecurrence> accumulators;         // Per-iteration increment
+        std::vector<std::string> accumulator_order;
+    };
+
+    int temp_count;
+
+    void visit_list(StatementList* list);
+    void visit(std::unique_ptr<Statement>& slot);
+
+    std::unique_ptr<Statement> closed_form(const ForStatement* loop, int unswitch_depth);
+    std::unique_ptr<Statement> unswitch(const ForStatement* loop, const std::vector<const Statement*>& body,
+                                        size_t index, std::unique_ptr<Expression> condition, int unswitch_depth);
+    bool process_assignment(LoopState& state, const std::string& var, const Expression* expr, bool is_declaration);
+    std::unique_ptr<Statement> emit_closed_form(const ForStatement* loop, LoopState& state);
+
+    std::unique_ptr<Expression> substitute(const Expression* expr, const LoopState& state);
+    bool is_invariant(const Expression* expr, const LoopState& state, bool allow_iv);
+    bool affine(const Expression* expr, const LoopState& state, AddRecurrence& out);
+};
+
+#endif // SCALAR_EVOLUTION_H
@@ -0,0 +1,445 @@
+#include "sccp.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+ConstantPropagator::ConstantPropagator() : folded_instructions(0), folded_branches(0), removed_blocks(0) {}
+
+ConstantPropagator::LatticeValue ConstantPropagator::meet(const LatticeValue& a, const LatticeValue& b) {
+    if (a.state == LatticeValue::Top) return b;
+    if (b.state == LatticeValue::Top) return a;
+    if (a == b) return a;
+    LatticeValue bottom;
+    bottom.state = LatticeValue::Bottom;
+    return bottom;
+}
+
+static bool compare(const std::string& op, int32_t a, int32_t b);
+
+// Evaluates a binary or unary operator with the target's 32-bit wrap-around.
+// Returns false for operations that trap or are not foldable.
+static bool fold(const std::string& op, int32_t a, int32_t b, int32_t& result) {
+    uint32_t ua = static_cast<uint32_t>(a);
+    uint32_t ub = static_cast<uint32_t>(b);
+    if (op == "+") result = static_cast<int32_t>(ua + ub);
+    else if (op == "-") result = static_cast<int32_t>(ua - ub);
+    else if (op == "*") result = static_cast<int32_t>(ua * ub);
+    else if (op == ">>>") result = static_cast<int32_t>(ua >> (ub & 31));
+    else if (op == "/" || op == "%") {
+        if (b == 0 || (a == INT32_MIN && b == -1)) return false;
+        result = op == "/" ? a / b : a % b;
+    } else if (is_comparison(op)) {
+        result = compare(op, a, b) ? 1 : 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool compare(const std::string& op, int32_t a, int32_t b) {
+    if (op == "<") return a < b;
+    if (op == "<=") return a <= b;
+    if (op == ">") return a > b;
+    if (op == ">=") return a >= b;
+    if (op == "==") return a == b;
+    return a != b;
+}
+
+// `operands` are the values of arg1, arg2 and the old value of dest
+ConstantPropagator::LatticeValue ConstantPropagator::evaluate(const TacInstr& instr,
+                                                              const LatticeValue operands[3]) {
+    LatticeValue result;
+    LatticeValue left = operands[0];
+    LatticeValue right;
+    std::string op = instr.op;
+
+    if (instr.kind == TacOp::Mov || (instr.kind == TacOp::Assign && op.empty())) {
+        return left;
+    }
+    if (instr.kind == TacOp::Load) {
+        // Array contents are not tracked
+        result.state = LatticeValue::Bottom;
+        return result;
+    }
+    if (instr.kind == TacOp::CondMove) {
+        // The moved value if the condition holds, the old one if it does
+        // not, and either if it is unknown
+        const LatticeValue& moved = operands[1];
+        const LatticeValue& kept = operands[2];
+        if (left.state == LatticeValue::Top) return left;
+        if (left.state == LatticeValue::Constant) return left.value != 0 ? moved : kept;
+        return meet(moved, kept);
+    }
+    if (instr.is_unary()) {
+        // Only unary minus exists: evaluate it as 0 - a
+        right = left;
+        left.state = LatticeValue::Constant;
+        left.value = 0;
+    } else {
+        right = operands[1];
+        if (instr.kind == TacOp::Add) op = "+";
+        if (instr.kind == TacOp::Sub) op = "-";
+    }
+
+    if (left.state == LatticeValue::Bottom || right.state == LatticeValue::Bottom) {
+        result.state = LatticeValue::Bottom;
+    } else if (left.state == LatticeValue::Constant && right.state == LatticeValue::Constant) {
+        if (fold(op, left.value, right.value, result.value)) {
+            result.state = LatticeValue::Constant;
+        } else {
+            result.state = LatticeValue::Bottom;
+        }
+    }
+    return result;
+}
+
+// Numbers the nodes in reverse postorder and links every operand to its
+// source. A name read before any write in its block becomes a variable
+// with an entry value per block.
+void ConstantPropagator::build(ControlFlowGraph& cfg) {
+    size_t count = cfg.blocks.size();
+    std::vector<int> postorder;
+    std::vector<bool> seen(count, false);
+    std::vector<std::pair<int, size_t>> stack = {{cfg.entry, 0}};
+    seen[cfg.entry] = true;
+    while (!stack.empty()) {
+        int block = stack.back().first;
+        std::vector<int> successors = cfg.blocks[block].successors();
+        if (stack.back().second < successors.size()) {
+            int successor = successors[stack.back().second++];
+            if (!seen[successor]) {
+                seen[successor] = true;
+                stack.push_back({successor, 0});
+            }
+        } else {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+
+    nodes.clear();
+    block_nodes.assign(count, {});
+    readers.assign(count, {});
+    last_writes.assign(count, {});
+    std::unordered_map<std::string, int> name_ids;
+    std::vector<int> variable_of;  // Per name, -1 until some block reads it on entry
+    std::vector<int> last_write;   // Per name, its last writer so far in the current block
+    std::vector<LatticeValue> initial;
+    std::vector<std::vector<std::pair<int, int>>> writes(count); // (name, node) per block
+
+    // Variables hold unknown values when the program starts; temporaries are
+    // always written before they are read and stay Top.
+    auto source_of = [&](const std::string& operand, int block, int node, Source& source) {
+        if (operand.empty()) return;
+        if (is_constant(operand)) {
+            source.kind = Source::Constant;
+            source.value = static_cast<int32_t>(std::stoll(operand));
+            return;
+        }
+        auto [found, added] = name_ids.emplace(operand, static_cast<int>(variable_of.size()));
+        if (added) {
+            variable_of.push_back(-1);
+            last_write.push_back(-1);
+        }
+        int name = found->second;
+        if (last_write[name] >= 0) {
+            source.kind = Source::Local;
+            source.id = last_write[name];
+            nodes[source.id].users.push_back(node);
+            return;
+        }
+        if (variable_of[name] < 0) {
+            variable_of[name] = static_cast<int>(initial.size());
+            initial.emplace_back();
+            if (!is_temporary_name(operand)) initial.back().state = LatticeValue::Bottom;
+        }
+        source.kind = Source::Entry;
+        source.id = variable_of[name];
+        readers[block].push_back({source.id, node});
+    };
+    auto add_node = [&](int block, TacInstr& instr, bool condition) {
+        int id = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+        nodes[id].block = block;
+        nodes[id].instr = &instr;
+        nodes[id].condition = condition;
+        source_of(instr.arg1, block, id, nodes[id].sources[0]);
+        source_of(instr.arg2, block, id, nodes[id].sources[1]);
+        if (instr.kind == TacOp::CondMove) source_of(instr.dest, block, id, nodes[id].sources[2]);
+        block_nodes[block].push_back(id);
+        return id;
+    };
+
+    for (auto at = postorder.rbegin(); at != postorder.rend(); ++at) {
+        int block = *at;
+        BasicBlock& current = cfg.blocks[block];
+        for (auto& instr : current.instrs) {
+            int id = add_node(block, instr, false);
+            if (instr.dest.empty()) continue;
+            int name = name_ids.emplace(instr.dest, static_cast<int>(variable_of.size())).first->second;
+            if (name == static_cast<int>(variable_of.size())) {
+                variable_of.push_back(-1);
+                last_write.push_back(-1);
+            }
+            if (last_write[name] < 0) writes[block].push_back({name, id});
+            last_write[name] = id;
+        }
+        if (current.terminator == BasicBlock::CondJump) add_node(block, current.condition, true);
+        for (auto& [name, node] : writes[block]) {
+            node = last_write[name];
+            last_write[name] = -1;
+        }
+    }
+
+    // Only a variable's last write in a block is passed on to its successors
+    for (size_t block = 0; block < count; ++block) {
+        for (const auto& [name, node] : writes[block]) {
+            if (variable_of[name] < 0) continue;
+            last_writes[block].push_back({variable_of[name], node});
+            nodes[node].variable = variable_of[name];
+        }
+        std::sort(last_writes[block].begin(), last_writes[block].end());
+        std::sort(readers[block].begin(), readers[block].end());
+    }
+    entry.assign(count, {});
+    for (int block : postorder) entry[block].assign(initial.size(), LatticeValue());
+    entry[cfg.entry] = initial;
+}
+
+ConstantPropagator::LatticeValue ConstantPropagator::value_of(const Source& source, int block) const {
+    LatticeValue result;
+    if (source.kind == Source::Constant) {
+        result.state = LatticeValue::Constant;
+        result.value = source.value;
+    } else if (source.kind == Source::Local) {
+        result = values[source.id];
+    } else if (source.kind == Source::Entry) {
+        result = entry[block][source.id];
+    }
+    return result;
+}
+
+// The value of a variable when control leaves the block
+ConstantPropagator::LatticeValue ConstantPropagator::passed_on(int block, int variable) const {
+    const auto& writes = last_writes[block];
+    auto found = std::lower_bound(writes.begin(), writes.end(), std::make_pair(variable, -1));
+    if (found != writes.end() && found->first == variable) return values[found->second];
+    return entry[block][variable];
+}
+
+void ConstantPropagator::run(std::vector<TacInstr>& code) {
+    folded_instructions = 0;
+    folded_branches = 0;
+    removed_blocks = 0;
+
+    ControlFlowGraph cfg(code);
+    size_t count = cfg.blocks.size();
+    build(cfg);
+    int variables = static_cast<int>(entry[cfg.entry].size());
+    values.assign(nodes.size(), LatticeValue());
+    executable.assign(count, {});
+    reached.assign(count, false);
+
+    // Three worklists: edges found executable, values passed on to a
+    // block's entry and nodes to evaluate again, lowest id (reverse
+    // postorder) first. Entry values only fall, so each one passed on is
+    // met into what the block has.
+    std::vector<std::pair<int, int>> edges = {{-1, cfg.entry}};
+    std::vector<std::tuple<int, int, LatticeValue>> passed;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> worklist;
+    std::vector<bool> queued(nodes.size(), false);
+    auto enqueue = [&](int node) {
+        if (queued[node]) return;
+        queued[node] = true;
+        worklist.push(node);
+    };
+    auto follow = [&](int from, int to) {
+        if (from >= 0) {
+            std::vector<int>& out = executable[from];
+            if (std::find(out.begin(), out.end(), to) != out.end()) return;
+            out.push_back(to);
+        }
+        if (!reached[to]) {
+            reached[to] = true;
+            for (int node : block_nodes[to]) enqueue(node);
+            const BasicBlock& block = cfg.blocks[to];
+            if (block.terminator == BasicBlock::Jump) edges.push_back({to, block.taken});
+            if (block.terminator == BasicBlock::FallThrough && block.next >= 0) edges.push_back({to, block.next});
+        }
+        if (from < 0) return;
+        for (int variable = 0; variable < variables; ++variable) {
+            LatticeValue value = passed_on(from, variable);
+            if (value.state != LatticeValue::Top) passed.emplace_back(to, variable, value);
+        }
+    };
+    auto receive = [&](int block, int variable, const LatticeValue& incoming) {
+        LatticeValue& value = entry[block][variable];
+        LatticeValue merged = meet(value, incoming);
+        if (merged == value) return;
+        value = merged;
+        const auto& reads = readers[block];
+        auto read = std::lower_bound(reads.begin(), reads.end(), std::make_pair(variable, -1));
+        for (; read != reads.end() && read->first == variable; ++read) {
+            if (reached[block]) enqueue(read->second);
+        }
+        const auto& writes = last_writes[block];
+        if (std::binary_search(writes.begin(), writes.end(), std::make_pair(variable, -1),
+                               [](const auto& a, const auto& b) { return a.first < b.first; })) {
+            return;
+        }
+        for (int successor : executable[block]) passed.emplace_back(successor, variable, merged);
+    };
+
+    while (true) {
+        if (!edges.empty()) {
+            auto [from, to] = edges.back();
+            edges.pop_back();
+            follow(from, to);
+            continue;
+        }
+        if (!passed.empty()) {
+            auto [block, variable, value] = passed.back();
+            passed.pop_back();
+            receive(block, variable, value);
+            continue;
+        }
+        if (worklist.empty()) break;
+        int id = worklist.top();
+        worklist.pop();
+        queued[id] = false;
+        const Node& node = nodes[id];
+        LatticeValue operands[3];
+        for (int i = 0; i < 3; ++i) operands[i] = value_of(node.sources[i], node.block);
+
+        if (node.condition) {
+            // Decide which outgoing edges can execute. A condition that still
+            // depends on a Top operand enables nothing until that operand settles.
+            const BasicBlock& block = cfg.blocks[node.block];
+            const LatticeValue& left = operands[0];
+            const LatticeValue& right = operands[1];
+            if (left.state == LatticeValue::Constant && right.state == LatticeValue::Constant) {
+                bool holds = compare(block.condition.op, left.value, right.value);
+                edges.push_back({node.block, holds ? block.taken : block.next});
+            } else if (left.state != LatticeValue::Top && right.state != LatticeValue::Top) {
+                edges.push_back({node.block, block.taken});
+                edges.push_back({node.block, block.next});
+            }
+            continue;
+        }
+        if (node.instr->dest.empty()) continue;
+        LatticeValue value = evaluate(*node.instr, operands);
+        if (value == values[id]) continue;
+        values[id] = value;
+        for (int user : node.users) enqueue(user);
+        if (node.variable < 0) continue;
+        for (int successor : executable[node.block]) passed.emplace_back(successor, node.variable, value);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        BasicBlock& block = cfg.blocks[i];
+        if (block.removed || static_cast<int>(i) == cfg.exit) continue;
+        if (!reached[i]) {
+            block.removed = true;
+            removed_blocks++;
+            continue;
+        }
+        rewrite_block(block_nodes[i]);
+
+        // Keep only the edges the analysis found executable
+        if (block.terminator == BasicBlock::CondJump) {
+            const std::vector<int>& out = executable[i];
+            bool taken = std::find(out.begin(), out.end(), block.taken) != out.end();
+            bool fall = std::find(out.begin(), out.end(), block.next) != out.end();
+            if (taken && !fall) {
+                block.terminator = BasicBlock::Jump;
+                block.next = -1;
+                folded_branches++;
+            } else if (fall && !taken) {
+                block.terminator = BasicBlock::FallThrough;
+                block.taken = -1;
+                folded_branches++;
+            }
+        }
+    }
+
+    while (remove_dead_temporaries(cfg) > 0) {}
+    code = cfg.linearize();
+}
+
+// Replaces operands known to be constant at their use by the constant, and
+// instructions whose whole result is constant by a copy of it.
+void ConstantPropagator::rewrite_block(const std::vector<int>& ids) {
+    for (int id : ids) {
+        const Node& node = nodes[id];
+        TacInstr& instr = *node.instr;
+        auto substitute = [&](std::string& operand, const Source& source) {
+            LatticeValue value = value_of(source, node.block);
+            if (value.state == LatticeValue::Constant && !is_constant(operand)) {
+                operand = std::to_string(value.value);
+            }
+        };
+
+        if (node.condition || instr.dest.empty()) {
+            // Branch conditions, stores, bounds checks and array declarations
+            substitute(instr.arg1, node.sources[0]);
+            if (node.condition || instr.kind == TacOp::Store) substitute(instr.arg2, node.sources[1]);
+            continue;
+        }
+        const LatticeValue& value = values[id];
+        bool is_copy = instr.kind == TacOp::Mov || (instr.kind == TacOp::Assign && instr.op.empty());
+        if (value.state == LatticeValue::Constant) {
+            if (!is_copy || !is_constant(instr.arg1)) folded_instructions++;
+            if (instr.kind == TacOp::CondMove) instr.kind = TacOp::Assign;
+            if (instr.kind != TacOp::Assign) instr.kind = TacOp::Mov;
+            instr.op.clear();
+            instr.arg1 = std::to_string(value.value);
+            instr.arg2.clear();
+        } else if (instr.kind == TacOp::Assign || instr.kind == TacOp::Mov || instr.kind == TacOp::CondMove ||
+                   instr.kind == TacOp::Load) {
+            substitute(instr.arg1, node.sources[0]);
+            // Shift counts are already immediates
+            if (!instr.arg2.empty()) substitute(instr.arg2, node.sources[1]);
+        } else {
+            // ADD/SUB update their destination in place; only the addend may change
+            substitute(instr.arg2, node.sources[1]);
+        }
+    }
+}
+
+// Deletes assignments to temporaries that nothing reads any more, typically
+// the `t1 = 5` feeding an operand that now holds the constant itself. A
+// division that may fault stays.
+int ConstantPropagator::remove_dead_temporaries(ControlFlowGraph& cfg) {
+    std::set<std::string> used;
+    for (const auto& block : cfg.blocks) {
+        if (block.removed) continue;
+        for (const auto& instr : block.instrs) {
+            used.insert(instr.arg1);
+            used.insert(instr.arg2);
+        }
+        if (block.terminator == BasicBlock::CondJump) {
+            used.insert(block.condition.arg1);
+            used.insert(block.condition.arg2);
+        }
+    }
+
+    int removed = 0;
+    for (auto& block : cfg.blocks) {
+        if (block.removed) continue;
+        std::vector<TacInstr> kept;
+        for (const auto& instr : block.instrs) {
+            if (instr.kind == TacOp::Assign && is_temporary_name(instr.dest) && !used.count(instr.dest) &&
+                !may_fault(instr)) {
+                removed++;
+                continue;
+            }
+            kept.push_back(instr);
+        }
+        block.instrs = kept;
+    }
+    return removed;
+}
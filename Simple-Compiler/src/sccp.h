@@ -0,0 +1,92 @@
+#ifndef SCCP_H
+#define SCCP_H
+
+#include "cfg.h"
+#include "ir.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Sparse conditional constant propagation on the TAC control-flow graph.
+// Values start optimistic (Top) and only edges proven executable are
+// followed, so a branch with a known outcome never makes its dead arm's
+// assignments pollute the join.
+//
+// The TAC is not in SSA form. Instead every operand is linked to where its
+// value comes from: a constant, the instruction that last wrote it in the
+// same block, or its value on entry to the block. Only variables read
+// before they are written in some block have entry values; each block keeps
+// them in a vector indexed by a dense id. An entry value is the meet of what
+// the executable predecessors pass on, which is what a phi at every join
+// would compute. A changed value is pushed along these links to the
+// instructions that read it, and the worklist is taken in reverse
+// postorder, so each instruction is evaluated again only when one of its
+// inputs changed.
+//
+// Afterwards constant operands are substituted, fully constant instructions
+// become copies of the constant, decided branches become jumps, blocks never
+// reached are deleted and temporaries left without uses are dropped.
+class ConstantPropagator {
+public:
+    ConstantPropagator();
+    void run(std::vector<TacInstr>& code);
+
+    int folded_instructions;
+    int folded_branches;
+    int removed_blocks;
+
+private:
+    struct LatticeValue {
+        enum State { Top, Constant, Bottom };
+        State state = Top;
+        int32_t value = 0;
+
+        bool operator==(const LatticeValue& other) const {
+            return state == other.state && (state != Constant || value == other.value);
+        }
+        bool operator!=(const LatticeValue& other) const { return !(*this == other); }
+    };
+
+    // Where an operand's value comes from. `id` is the writing node of a
+    // Local source and the variable of an Entry source.
+    struct Source {
+        enum Kind { None, Constant, Local, Entry };
+        Kind kind = None;
+        int id = -1;
+        int32_t value = 0;
+    };
+
+    // An instruction, or the condition of a CondJump block. `sources` are
+    // those of arg1, arg2 and, for a CMOV, of the old value of dest.
+    struct Node {
+        int block = -1;
+        TacInstr* instr = nullptr;
+        bool condition = false;
+        Source sources[3];
+        std::vector<int> users; // Nodes of the same block reading the result
+        int variable = -1;      // What it passes on to successors, if the last write to one
+    };
+
+    // Analysis state of one run. Node ids follow the reverse postorder of
+    // the blocks; `entry` holds the entry value of every variable per block.
+    std::vector<Node> nodes;
+    std::vector<std::vector<LatticeValue>> entry;
+    std::vector<LatticeValue> values;                          // Per node
+    std::vector<std::vector<std::pair<int, int>>> readers;     // Per block: (variable, node) reading it on entry
+    std::vector<std::vector<std::pair<int, int>>> last_writes; // Per block: (variable, node), by variable
+    std::vector<std::vector<int>> block_nodes;
+    std::vector<std::vector<int>> executable; // Per block: successors on executable edges
+    std::vector<bool> reached;
+
+    static LatticeValue meet(const LatticeValue& a, const LatticeValue& b);
+    static LatticeValue evaluate(const TacInstr& instr, const LatticeValue operands[3]);
+
+    void build(ControlFlowGraph& cfg);
+    LatticeValue value_of(const Source& source, int block) const;
+    LatticeValue passed_on(int block, int variable) const;
+    void rewrite_block(const std::vector<int>& block_nodes);
+    int remove_dead_temporaries(ControlFlowGraph& cfg);
+};
+
+#endif // SCCP_H
@@ -1,6 +1,9 @@
 #include "semantic.h"
 #include "printing_options.h"
+#include "ir.h"
+#include "ast_utils.h"
 #include <iostream>
+#include <set>
 #include <tuple>
 #include <stdexcept>
 
@@ -58,10 +61,19 @@ Symbol* SymbolTable::lookup_symbol(const std::string& name) {
  * SemanticAnalyzer Implementation
  ******************************************************************/
 
-SemanticAnalyzer::SemanticAnalyzer(CodeGen& cg) : codegen(cg) {}
+static const long long kMaxArraySize = 1 << 24;
+
+static bool is_array(const Symbol* symbol) {
+    return symbol->type.size() > 2 && symbol->type.compare(symbol->type.size() - 2, 2, "[]") == 0;
+}
+
+SemanticAnalyzer::SemanticAnalyzer(CodeGen& cg) : codegen(cg), local_count(0), branch_depth(0) {}
 
 void SemanticAnalyzer::reset() {
     symbol_table = SymbolTable();
+    tac_scopes.clear();
+    local_count = 0;
+    branch_depth = 0;
 }
 void SemanticAnalyzer::analyze(StatementList* root) {
     if (!root) return;
@@ -76,11 +88,42 @@ void SemanticAnalyzer::analyze(StatementList* root) {
         throw e;
     }
     if (should_print(PRINT_PARSE_TREE)) {
-        std::cout << "Semantic: Analysis complete. Starting TAC generation..." << std::endl;
+        std::cout << "Semantic: Analysis complete." << std::endl;
     }
+}
+
+void SemanticAnalyzer::generate(StatementList* root) {
+    if (!root) return;
+    if (should_print(PRINT_PARSE_TREE)) {
+        std::cout << "Semantic: Starting TAC generation..." << std::endl;
+    }
+    tac_scopes.assign(1, {});
     generate_tac(root);
 }
 
+void SemanticAnalyzer::enter_tac_scope() {
+    tac_scopes.emplace_back();
+}
+
+void SemanticAnalyzer::exit_tac_scope() {
+    if (tac_scopes.size() > 1) tac_scopes.pop_back();
+}
+
+std::string SemanticAnalyzer::declare_tac_name(const std::string& id) {
+    std::string name = tac_scopes.size() == 1 ? id : make_local_name(id, ++local_count);
+    tac_scopes.back()[id] = name;
+    return name;
+}
+
+// Names the AST passes introduce without a declaration resolve to themselves
+std::string SemanticAnalyzer::tac_name(const std::string& id) const {
+    for (auto it = tac_scopes.rbegin(); it != tac_scopes.rend(); ++it) {
+        auto found = it->find(id);
+        if (found != it->end()) return found->second;
+    }
+    return id;
+}
+
 void SemanticAnalyzer::print_ast(Node* node, int indent) {
     if (!node) return;
 
@@ -103,9 +146,15 @@ void SemanticAnalyzer::print_ast(Node* node, int indent) {
         } else {
             std::cout << std::endl;
         }
+    } else if (auto array = dynamic_cast<ArrayDeclaration*>(node)) {
+        std::cout << "ArrayDeclaration: " << array->type << " " << array->id << "[" << array->size << "]" << std::endl;
     } else if (auto assign = dynamic_cast<Assignment*>(node)) {
         std::cout << "Assignment: " << assign->id << " =" << std::endl;
         print_ast(assign->expr.get(), indent + 1);
+    } else if (auto store = dynamic_cast<ArrayAssignment*>(node)) {
+        std::cout << "ArrayAssignment: " << store->id << "[] =" << std::endl;
+        print_ast(store->index.get(), indent + 1);
+        print_ast(store->expr.get(), indent + 1);
     } else if (auto if_stmt = dynamic_cast<IfStatement*>(node)) {
         std::cout << "IfStatement:" << std::endl;
         print_indent();
@@ -147,6 +196,9 @@ void SemanticAnalyzer::print_ast(Node* node, int indent) {
         print_ast(unop->expr.get(), indent + 1);
     } else if (auto id = dynamic_cast<Identifier*>(node)) {
         std::cout << "Identifier: " << id->name << std::endl;
+    } else if (auto access = dynamic_cast<ArrayAccess*>(node)) {
+        std::cout << "ArrayAccess: " << access->id << "[]" << std::endl;
+        print_ast(access->index.get(), indent + 1);
     } else if (auto num = dynamic_cast<Number*>(node)) {
         std::cout << "Number: " << num->value << std::endl;
     }
@@ -158,14 +210,22 @@ void SemanticAnalyzer::analyze_node(Node* node) {
     if (!node) return;
     if (auto sl = dynamic_cast<StatementList*>(node)) analyze_statement_list(sl);
     else if (auto decl = dynamic_cast<Declaration*>(node)) analyze_declaration(decl);
+    else if (auto array = dynamic_cast<ArrayDeclaration*>(node)) analyze_array_declaration(array);
     else if (auto assign = dynamic_cast<Assignment*>(node)) analyze_assignment(assign);
+    else if (auto store = dynamic_cast<ArrayAssignment*>(node)) analyze_array_assignment(store);
     else if (auto if_stmt = dynamic_cast<IfStatement*>(node)) analyze_if(if_stmt);
     else if (auto for_stmt = dynamic_cast<ForStatement*>(node)) analyze_for(for_stmt);
     else if (auto block = dynamic_cast<Block*>(node)) analyze_block(block);
     else if (auto id = dynamic_cast<Identifier*>(node)) analyze_id(id);
+    else if (auto access = dynamic_cast<ArrayAccess*>(node)) analyze_array_access(access);
     else if (auto binop = dynamic_cast<BinaryOp*>(node)) { analyze_node(binop->left.get()); analyze_node(binop->right.get()); }
     else if (auto unop = dynamic_cast<UnaryOp*>(node)) { analyze_node(unop->expr.get()); }
-    else if (dynamic_cast<IncrementStatement*>(node)) { /* ID checked in parser/TAC gen */ }
+    else if (auto inc = dynamic_cast<IncrementStatement*>(node)) {
+        Symbol* symbol = symbol_table.lookup_symbol(inc->id);
+        if (symbol && is_array(symbol)) {
+            throw std::runtime_error("Semantic Error: Array '" + inc->id + "' used without an index.");
+        }
+    }
     else if (dynamic_cast<Number*>(node)) { /* No analysis needed */ }
 }
 
@@ -183,25 +243,70 @@ void SemanticAnalyzer::analyze_declaration(Declaration* node) {
     }
 }
 
+// Arrays live in .bss for the whole run, so they are only declared at the
+// top level. The size bounds the 32-bit element offsets.
+void SemanticAnalyzer::analyze_array_declaration(ArrayDeclaration* node) {
+    if (!symbol_table.at_top_level() || branch_depth > 0) {
+        throw std::runtime_error("Semantic Error: Array '" + node->id + "' must be declared at the top level.");
+    }
+    if (node->size < 1 || node->size > kMaxArraySize) {
+        throw std::runtime_error("Semantic Error: Array '" + node->id + "' must have between 1 and " +
+                                 std::to_string(kMaxArraySize) + " elements.");
+    }
+    symbol_table.add_symbol(Symbol(node->id, node->type + "[]"));
+}
+
 void SemanticAnalyzer::analyze_assignment(Assignment* node) {
-    if (!symbol_table.lookup_symbol(node->id)) {
+    Symbol* symbol = symbol_table.lookup_symbol(node->id);
+    if (!symbol) {
         throw std::runtime_error("Semantic Error: Undeclared variable '" + node->id + "' used in assignment.");
     }
+    if (is_array(symbol)) {
+        throw std::runtime_error("Semantic Error: Array '" + node->id + "' used without an index.");
+    }
+    analyze_node(node->expr.get());
+}
+
+Symbol* SemanticAnalyzer::lookup_array(const std::string& id, const std::string& context) {
+    Symbol* symbol = symbol_table.lookup_symbol(id);
+    if (!symbol) {
+        throw std::runtime_error("Semantic Error: Undeclared variable '" + id + "' used in " + context + ".");
+    }
+    if (!is_array(symbol)) {
+        throw std::runtime_error("Semantic Error: Variable '" + id + "' is not an array.");
+    }
+    return symbol;
+}
+
+void SemanticAnalyzer::analyze_array_assignment(ArrayAssignment* node) {
+    lookup_array(node->id, "assignment");
+    analyze_node(node->index.get());
     analyze_node(node->expr.get());
 }
 
+void SemanticAnalyzer::analyze_array_access(ArrayAccess* node) {
+    lookup_array(node->id, "expression");
+    analyze_node(node->index.get());
+}
+
 void SemanticAnalyzer::analyze_id(Identifier* node) {
-    if (!symbol_table.lookup_symbol(node->name)) {
+    Symbol* symbol = symbol_table.lookup_symbol(node->name);
+    if (!symbol) {
         throw std::runtime_error("Semantic Error: Undeclared variable '" + node->name + "' used in expression.");
     }
+    if (is_array(symbol)) {
+        throw std::runtime_error("Semantic Error: Array '" + node->name + "' used without an index.");
+    }
 }
 
 void SemanticAnalyzer::analyze_if(IfStatement* node) {
     analyze_node(node->condition.get());
+    ++branch_depth;
     analyze_node(node->if_body.get());
     if (node->else_body) {
         analyze_node(node->else_body.get());
     }
+    --branch_depth;
 }
 
 void SemanticAnalyzer::analyze_for(ForStatement* node) {
@@ -226,10 +331,15 @@ void SemanticAnalyzer::generate_tac(Node* node) {
     if (auto sl = dynamic_cast<StatementList*>(node)) generate_tac_statement_list(sl);
     else if (auto decl = dynamic_cast<Declaration*>(node)) generate_tac_declaration(decl);
     else if (auto assign = dynamic_cast<Assignment*>(node)) generate_tac_assignment(assign);
+    else if (auto store = dynamic_cast<ArrayAssignment*>(node)) generate_tac_array_assignment(store);
+    else if (auto array = dynamic_cast<ArrayDeclaration*>(node)) {
+        codegen.emit("ARRAY " + array->id + ", " + std::to_string(array->size));
+    }
     else if (auto if_stmt = dynamic_cast<IfStatement*>(node)) generate_tac_if(if_stmt);
     else if (auto for_stmt = dynamic_cast<ForStatement*>(node)) generate_tac_for(for_stmt);
     else if (auto block = dynamic_cast<Block*>(node)) generate_tac_block(block);
     else if (auto inc = dynamic_cast<IncrementStatement*>(node)) generate_tac_increment(inc);
+    else if (auto vector = dynamic_cast<VectorAssignment*>(node)) generate_tac_vector_assignment(vector);
 }
 
 void SemanticAnalyzer::generate_tac_statement_list(StatementList* node) {
@@ -238,37 +348,153 @@ void SemanticAnalyzer::generate_tac_statement_list(StatementList* node) {
     }
 }
 
+// The initializer is evaluated before the name is bound, so `int x = x + 1`
+// in a block reads the outer x. Locals share stack slots with locals of
+// other scopes, so one without an initializer starts at 0 like a global.
 void SemanticAnalyzer::generate_tac_declaration(Declaration* node) {
+    std::string expr_val;
+    if (node->expr) expr_val = generate_tac_expression(node->expr.get());
+    std::string name = declare_tac_name(node->id);
     if (node->expr) {
-        std::string expr_val = generate_tac_expression(node->expr.get());
-        codegen.emit("MOV " + node->id + ", " + expr_val);
+        codegen.emit("MOV " + name + ", " + expr_val);
+    } else if (is_local_name(name)) {
+        codegen.emit("MOV " + name + ", 0");
     }
 }
 
 void SemanticAnalyzer::generate_tac_assignment(Assignment* node) {
     std::string expr_val = generate_tac_expression(node->expr.get());
-    codegen.emit("MOV " + node->id + ", " + expr_val);
+    codegen.emit("MOV " + tac_name(node->id) + ", " + expr_val);
+}
+
+// Every element access is preceded by its bounds check, which the
+// bounds-check eliminator removes where the index is provably in range
+void SemanticAnalyzer::generate_tac_array_assignment(ArrayAssignment* node) {
+    std::string index = generate_tac_expression(node->index.get());
+    std::string value = generate_tac_expression(node->expr.get());
+    codegen.emit("BOUNDS " + index + ", " + node->id);
+    codegen.emit(node->id + "[" + index + "] = " + value);
+}
+
+// `lanes` iterations of a[s] = e at once. Parts of e that use the loop
+// variable are evaluated lane by lane; the rest is computed once and
+// copied to every lane. Vector registers are numbered by depth in e, with
+// the left operand of an operator in the register it is given and the
+// right one in the next, so %v0 ends up holding the values stored.
+void SemanticAnalyzer::generate_tac_vector_assignment(VectorAssignment* node) {
+    ArrayAssignment* store = node->store.get();
+    std::string index = generate_tac_vector_index(store->id, store->index.get(), node->lanes);
+    generate_tac_vector_expression(store->expr.get(), node->var, node->lanes, 0);
+    codegen.emit("VSTORE." + std::to_string(node->lanes) + " " + store->id + "[" + index + "], %v0");
+}
+
+// The first element's index, with both the first and the last element's
+// bounds checked
+std::string SemanticAnalyzer::generate_tac_vector_index(const std::string& array, Expression* index, int lanes) {
+    std::string first = generate_tac_expression(index);
+    codegen.emit("BOUNDS " + first + ", " + array);
+    std::string last = codegen.new_temp();
+    codegen.emit(last + " = " + first + " + " + std::to_string(lanes - 1));
+    codegen.emit("BOUNDS " + last + ", " + array);
+    return first;
+}
+
+void SemanticAnalyzer::generate_tac_vector_expression(Expression* expr, const std::string& var, int lanes, int reg) {
+    std::string suffix = "." + std::to_string(lanes) + " ";
+    std::string dest = "%v" + std::to_string(reg);
+    std::set<std::string> used;
+    collect_used(expr, used);
+    if (!used.count(var)) {
+        codegen.emit("VSPLAT" + suffix + dest + ", " + generate_tac_expression(expr));
+    } else if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
+        std::string index = generate_tac_vector_index(access->id, access->index.get(), lanes);
+        codegen.emit("VLOAD" + suffix + dest + ", " + access->id + "[" + index + "]");
+    } else if (auto binop = dynamic_cast<BinaryOp*>(expr)) {
+        static const std::map<std::string, std::string> names = {{"+", "VADD"}, {"-", "VSUB"}, {"*", "VMUL"}};
+        generate_tac_vector_expression(binop->left.get(), var, lanes, reg);
+        generate_tac_vector_expression(binop->right.get(), var, lanes, reg + 1);
+        codegen.emit(names.at(binop->op) + suffix + dest + ", " + dest + ", %v" + std::to_string(reg + 1));
+    } else if (auto unop = dynamic_cast<UnaryOp*>(expr)) {
+        // - e is 0 - e
+        codegen.emit("VSPLAT" + suffix + dest + ", 0");
+        generate_tac_vector_expression(unop->expr.get(), var, lanes, reg + 1);
+        codegen.emit("VSUB" + suffix + dest + ", " + dest + ", %v" + std::to_string(reg + 1));
+    }
 }
 
 void SemanticAnalyzer::generate_tac_increment(IncrementStatement* node) {
-     if (node->op == "++") {
-        codegen.emit("ADD " + node->id + ", " + node->id + ", 1");
+    std::string name = tac_name(node->id);
+    if (node->op == "++") {
+        codegen.emit("ADD " + name + ", " + name + ", 1");
     } else { // --
-        codegen.emit("SUB " + node->id + ", " + node->id + ", 1");
+        codegen.emit("SUB " + name + ", " + name + ", 1");
+    }
+}
+
+// True if evaluating the expression can stop the program: a division or
+// remainder by anything but a constant other than 0 and -1, or an array
+// element, which is bounds checked
+static bool can_fail(const Expression* expr) {
+    if (auto binop = dynamic_cast<const BinaryOp*>(expr)) {
+        if (binop->op == "/" || binop->op == "%") {
+            auto divisor = dynamic_cast<const Number*>(binop->right.get());
+            if (!divisor || divisor->value == 0 || divisor->value == -1) return true;
+        }
+        return can_fail(binop->left.get()) || can_fail(binop->right.get());
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(expr)) return can_fail(unop->expr.get());
+    return dynamic_cast<const ArrayAccess*>(expr) != nullptr;
+}
+
+// True if lowering the statement emits any TAC. An if statement whose arms
+// are empty needs code only for a condition that can fail.
+static bool generates_code(const Node* node) {
+    if (!node) return false;
+    if (auto decl = dynamic_cast<const Declaration*>(node)) return decl->expr != nullptr;
+    if (auto if_stmt = dynamic_cast<const IfStatement*>(node)) {
+        return generates_code(if_stmt->if_body.get()) || generates_code(if_stmt->else_body.get()) ||
+               can_fail(if_stmt->condition.get());
+    }
+    if (auto block = dynamic_cast<const Block*>(node)) return generates_code(block->statement_list.get());
+    if (auto sl = dynamic_cast<const StatementList*>(node)) {
+        for (const auto& stmt : sl->statements) {
+            if (generates_code(stmt.get())) return true;
+        }
+        return false;
     }
+    return true;
 }
 
+// The condition is inverted so the then-body falls through:
+//     IF !cond GOTO Lelse
+//     then-body
+//     GOTO Lend
+//   Lelse:
+//     else-body
+//   Lend:
+// Empty arms are dropped along with the jumps around them. With both arms
+// empty only a condition that can fail is evaluated, and its result unused.
 void SemanticAnalyzer::generate_tac_if(IfStatement* node) {
+    bool has_then = generates_code(node->if_body.get());
+    bool has_else = generates_code(node->else_body.get());
+    if (!has_then && !has_else) {
+        if (can_fail(node->condition.get())) generate_tac_condition(node->condition.get());
+        return;
+    }
+
     auto [left, op, right] = generate_tac_condition(node->condition.get());
-    std::string label_true = codegen.new_label();
     std::string label_end = codegen.new_label();
 
-    if (node->else_body) {
+    if (!has_then) {
+        // Only the else arm does anything: branch around it on the original condition
+        codegen.emit("IF " + left + " " + op + " " + right + " GOTO " + label_end);
+        codegen.increase_indent();
+        generate_tac(node->else_body.get());
+        codegen.decrease_indent();
+    } else if (has_else) {
         std::string label_false = codegen.new_label();
-        codegen.emit("IF " + left + " " + op + " " + right + " GOTO " + label_true);
-        codegen.emit("GOTO " + label_false);
-        codegen.emit(label_true + ":");
-        
+        codegen.emit("IF " + left + " " + negate_comparison(op) + " " + right + " GOTO " + label_false);
+
         codegen.increase_indent();
         generate_tac(node->if_body.get());
         codegen.decrease_indent();
@@ -280,9 +506,7 @@ void SemanticAnalyzer::generate_tac_if(IfStatement* node) {
         generate_tac(node->else_body.get());
         codegen.decrease_indent();
     } else {
-        codegen.emit("IF " + left + " " + op + " " + right + " GOTO " + label_true);
-        codegen.emit("GOTO " + label_end);
-        codegen.emit(label_true + ":");
+        codegen.emit("IF " + left + " " + negate_comparison(op) + " " + right + " GOTO " + label_end);
 
         codegen.increase_indent();
         generate_tac(node->if_body.get());
@@ -291,47 +515,64 @@ void SemanticAnalyzer::generate_tac_if(IfStatement* node) {
     codegen.emit(label_end + ":");
 }
 
+// Loops are rotated into bottom-tested form:
+//     IF !cond GOTO Lend      (guard, evaluated once)
+//   Lbody:
+//     body; increment
+//     IF cond GOTO Lbody
+//   Lend:
+// so each iteration executes a single conditional branch.
 void SemanticAnalyzer::generate_tac_for(ForStatement* node) {
+    enter_tac_scope();
     generate_tac(node->init.get());
     
-    std::string label_start = codegen.new_label();
     std::string label_body = codegen.new_label();
     std::string label_end = codegen.new_label();
 
-    codegen.emit(label_start + ":");
-    auto [left, op, right] = generate_tac_condition(node->condition.get());
-    codegen.emit("IF " + left + " " + op + " " + right + " GOTO " + label_body);
-    codegen.emit("GOTO " + label_end);
+    auto [guard_left, guard_op, guard_right] = generate_tac_condition(node->condition.get());
+    codegen.emit("IF " + guard_left + " " + negate_comparison(guard_op) + " " + guard_right + " GOTO " + label_end);
 
     codegen.emit(label_body + ":");
     
     codegen.increase_indent();
     generate_tac(node->body.get());
     generate_tac(node->increment.get());
+    auto [left, op, right] = generate_tac_condition(node->condition.get());
+    codegen.emit("IF " + left + " " + op + " " + right + " GOTO " + label_body);
     codegen.decrease_indent();
 
-    codegen.emit("GOTO " + label_start);
     codegen.emit(label_end + ":");
+    exit_tac_scope();
 }
 
 void SemanticAnalyzer::generate_tac_block(Block* node) {
+    enter_tac_scope();
     generate_tac_statement_list(node->statement_list.get());
+    exit_tac_scope();
 }
 
 std::string SemanticAnalyzer::generate_tac_expression(Expression* expr) {
     if (auto num = dynamic_cast<Number*>(expr)) {
         std::string temp = codegen.new_temp();
-        codegen.emit(temp + " = " + std::to_string(num->value));
+        // The language only has int values; print them without a fraction
+        codegen.emit(temp + " = " + std::to_string(static_cast<long long>(num->value)));
         return temp;
     }
     if (auto id = dynamic_cast<Identifier*>(expr)) {
         // When using a variable, we don't need a new temporary.
         // We just use the variable's name directly in the TAC.
-        return id->name;
+        return tac_name(id->name);
     }
     if (auto binop = dynamic_cast<BinaryOp*>(expr)) {
         std::string left = generate_tac_expression(binop->left.get());
-        std::string right = generate_tac_expression(binop->right.get());
+        std::string right;
+        auto count = dynamic_cast<Number*>(binop->right.get());
+        if (binop->op == ">>>" && count) {
+            // Shift counts are emitted as immediates
+            right = std::to_string(static_cast<long long>(count->value));
+        } else {
+            right = generate_tac_expression(binop->right.get());
+        }
         std::string temp = codegen.new_temp();
         codegen.emit(temp + " = " + left + " " + binop->op + " " + right);
         return temp;
@@ -342,6 +583,13 @@ std::string SemanticAnalyzer::generate_tac_expression(Expression* expr) {
         codegen.emit(temp + " = " + unop->op + " " + val);
         return temp;
     }
+    if (auto access = dynamic_cast<ArrayAccess*>(expr)) {
+        std::string index = generate_tac_expression(access->index.get());
+        codegen.emit("BOUNDS " + index + ", " + access->id);
+        std::string temp = codegen.new_temp();
+        codegen.emit(temp + " = " + access->id + "[" + index + "]");
+        return temp;
+    }
     return ""; // Should not happen with a valid AST
 }
 
@@ -22,6 +22,7 @@ public:
     void exit_scope();
     void add_symbol(const Symbol& symbol);
     Symbol* lookup_symbol(const std::string& name);
+    bool at_top_level() const { return scopes.size() == 1; }
 
 private:
     std::vector<std::map<std::string, Symbol>> scopes;
@@ -31,17 +32,33 @@ class SemanticAnalyzer {
 public:
     SemanticAnalyzer(CodeGen& codegen);
     void analyze(StatementList* root);
+    void generate(StatementList* root);
     void reset();
 
 private:
     SymbolTable symbol_table;
     CodeGen& codegen;
 
+    // TAC names of the variables visible during generation, innermost scope
+    // last. Top-level variables keep their name and live in .data; variables
+    // declared in a block or a for init get a fresh local name.
+    std::vector<std::map<std::string, std::string>> tac_scopes;
+    int local_count;
+    int branch_depth; // If bodies being analyzed; arrays are declared unconditionally
+    void enter_tac_scope();
+    void exit_tac_scope();
+    std::string declare_tac_name(const std::string& id);
+    std::string tac_name(const std::string& id) const;
+
     // Analysis methods (for checking)
     void analyze_node(Node* node);
     void analyze_statement_list(StatementList* node);
     void analyze_declaration(Declaration* node);
+    void analyze_array_declaration(ArrayDeclaration* node);
     void analyze_assignment(Assignment* node);
+    void analyze_array_assignment(ArrayAssignment* node);
+    void analyze_array_access(ArrayAccess* node);
+    Symbol* lookup_array(const std::string& id, const std::string& context);
     void analyze_if(IfStatement* node);
     void analyze_for(ForStatement* node);
     void analyze_block(Block* node);
@@ -54,10 +71,14 @@ private:
     void generate_tac_statement_list(StatementList* node);
     void generate_tac_declaration(Declaration* node);
     void generate_tac_assignment(Assignment* node);
+    void generate_tac_array_assignment(ArrayAssignment* node);
     void generate_tac_if(IfStatement* node);
     void generate_tac_for(ForStatement* node);
     void generate_tac_block(Block* node);
     void generate_tac_increment(IncrementStatement* node);
+    void generate_tac_vector_assignment(VectorAssignment* node);
+    std::string generate_tac_vector_index(const std::string& array, Expression* index, int lanes);
+    void generate_tac_vector_expression(Expression* expr, const std::string& var, int lanes, int reg);
 
     std::string generate_tac_expression(Expression* expr);
     std::tuple<std::string, std::string, std::string> generate_tac_condition(BinaryOp* cond);
@@ -0,0 +1,209 @@
+#include "simplify_cfg.h"
+#include <algorithm>
+
+CFGSimplifier::CFGSimplifier() : threaded_edges(0), merged_blocks(0), removed_blocks(0), cfg(nullptr) {}
+
+void CFGSimplifier::run(std::vector<TacInstr>& code) {
+    threaded_edges = 0;
+    merged_blocks = 0;
+    removed_blocks = 0;
+
+    ControlFlowGraph graph(code);
+    cfg = &graph;
+    removed_blocks += graph.remove_unreachable();
+    int removed;
+    do {
+        seed();
+        while (!worklist.empty()) {
+            int id = worklist.front();
+            worklist.pop_front();
+            queued[id] = false;
+            process(id);
+        }
+        removed = graph.remove_unreachable();
+        removed_blocks += removed;
+    } while (removed > 0);
+    code = graph.linearize();
+    cfg = nullptr;
+}
+
+void CFGSimplifier::seed() {
+    size_t count = cfg->blocks.size();
+    preds.assign(count, {});
+    in_degree.assign(count, 0);
+    queued.assign(count, false);
+    worklist.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (cfg->blocks[i].removed) continue;
+        for (int succ : cfg->blocks[i].successors()) {
+            preds[succ].push_back(static_cast<int>(i));
+            in_degree[succ]++;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!cfg->blocks[i].removed) enqueue(static_cast<int>(i));
+    }
+}
+
+void CFGSimplifier::enqueue(int id) {
+    if (queued[id]) return;
+    queued[id] = true;
+    worklist.push_back(id);
+}
+
+// Drops the stale entries of the predecessor list on the way
+void CFGSimplifier::enqueue_predecessors(int id) {
+    std::vector<int>& list = preds[id];
+    list.erase(std::remove_if(list.begin(), list.end(), [&](int pred) { return !is_predecessor(pred, id); }),
+               list.end());
+    for (int pred : list) enqueue(pred);
+}
+
+bool CFGSimplifier::is_predecessor(int pred, int id) const {
+    if (cfg->blocks[pred].removed) return false;
+    std::vector<int> successors = cfg->blocks[pred].successors();
+    return std::find(successors.begin(), successors.end(), id) != successors.end();
+}
+
+// Rewires a block and keeps the in-degrees and predecessor lists up to date
+void CFGSimplifier::set_edges(int id, BasicBlock::Terminator terminator, int taken, int next) {
+    BasicBlock& block = cfg->blocks[id];
+    std::vector<int> before = block.successors();
+    block.terminator = terminator;
+    block.taken = taken;
+    block.next = next;
+    std::vector<int> after = block.successors();
+    for (int succ : after) {
+        if (std::find(before.begin(), before.end(), succ) != before.end()) continue;
+        preds[succ].push_back(id);
+        in_degree[succ]++;
+    }
+    for (int succ : before) {
+        if (std::find(after.begin(), after.end(), succ) == after.end()) drop_edge(id, succ);
+    }
+}
+
+// A block left without predecessors is deleted along with its edges; one
+// left with a single predecessor may now be merged into it
+void CFGSimplifier::drop_edge(int from, int to) {
+    std::vector<std::pair<int, int>> dropped = {{from, to}};
+    while (!dropped.empty()) {
+        int id = dropped.back().second;
+        dropped.pop_back();
+        if (--in_degree[id] == 1) enqueue_predecessors(id);
+        if (in_degree[id] > 0 || id == cfg->entry || id == cfg->exit) continue;
+        BasicBlock& block = cfg->blocks[id];
+        block.removed = true;
+        removed_blocks++;
+        for (int succ : block.successors()) dropped.push_back({id, succ});
+    }
+}
+
+// A block that contains nothing but a jump or a fall-through is skipped by
+// all its predecessors. A cycle of such blocks is an infinite loop; it
+// shrinks to one block jumping to itself, which stays.
+void CFGSimplifier::forward_empty(int id) {
+    const BasicBlock& block = cfg->blocks[id];
+    if (!block.instrs.empty() || block.terminator == BasicBlock::CondJump || id == cfg->exit) return;
+    int target = block.terminator == BasicBlock::Jump ? block.taken : block.next;
+    if (target < 0 || target == id) return;
+
+    std::vector<int> list = preds[id];
+    for (int p : list) {
+        if (!is_predecessor(p, id)) continue;
+        const BasicBlock& pred = cfg->blocks[p];
+        int taken = pred.taken == id ? target : pred.taken;
+        int next = pred.next == id ? target : pred.next;
+        set_edges(p, pred.terminator, taken, next);
+        threaded_edges++;
+        enqueue(p);
+    }
+}
+
+static bool same_operands(const TacInstr& a, const TacInstr& b) {
+    return a.arg1 == b.arg1 && a.arg2 == b.arg2;
+}
+
+// True if `id` does nothing but re-test a condition
+static bool is_condition_only(const ControlFlowGraph& cfg, int id) {
+    const BasicBlock& block = cfg.blocks[id];
+    return block.instrs.empty() && block.terminator == BasicBlock::CondJump;
+}
+
+// On the taken edge the condition is known true, on the fall-through edge
+// known false. A successor that only re-tests the same operands can be
+// skipped; a cycle of such tests is followed once around.
+void CFGSimplifier::thread_conditions(int id) {
+    const BasicBlock& block = cfg->blocks[id];
+    if (block.terminator != BasicBlock::CondJump) return;
+    const TacInstr& cond = block.condition;
+    auto thread = [&](int edge, bool holds) {
+        std::vector<int> seen;
+        while (edge != id && is_condition_only(*cfg, edge) && same_operands(cfg->blocks[edge].condition, cond) &&
+               std::find(seen.begin(), seen.end(), edge) == seen.end()) {
+            const BasicBlock& target = cfg->blocks[edge];
+            seen.push_back(edge);
+            if (target.condition.op == cond.op) {
+                edge = holds ? target.taken : target.next;
+            } else if (target.condition.op == negate_comparison(cond.op)) {
+                edge = holds ? target.next : target.taken;
+            } else {
+                break;
+            }
+            threaded_edges++;
+        }
+        return edge;
+    };
+    int taken = thread(block.taken, true);
+    int next = thread(block.next, false);
+
+    // Both edges lead to the same place: the test is useless
+    if (taken == next) {
+        set_edges(id, BasicBlock::FallThrough, -1, next);
+        threaded_edges++;
+    } else if (taken != block.taken || next != block.next) {
+        set_edges(id, BasicBlock::CondJump, taken, next);
+    }
+}
+
+// Appends the block's only successor when that has no other predecessor
+bool CFGSimplifier::merge_successor(int id) {
+    BasicBlock& block = cfg->blocks[id];
+    if (block.terminator == BasicBlock::CondJump) return false;
+    int succ = block.terminator == BasicBlock::Jump ? block.taken : block.next;
+    if (succ < 0 || succ == id || succ == cfg->exit || succ == cfg->entry || in_degree[succ] != 1) return false;
+
+    BasicBlock& absorbed = cfg->blocks[succ];
+    block.instrs.insert(block.instrs.end(), absorbed.instrs.begin(), absorbed.instrs.end());
+    block.terminator = absorbed.terminator;
+    block.condition = absorbed.condition;
+    block.taken = absorbed.taken;
+    block.next = absorbed.next;
+    block.indent = absorbed.indent;
+    absorbed.removed = true;
+    for (int s : block.successors()) preds[s].push_back(id);
+    merged_blocks++;
+    return true;
+}
+
+void CFGSimplifier::process(int id) {
+    if (cfg->blocks[id].removed) return;
+    forward_empty(id);
+    if (cfg->blocks[id].removed) return;
+
+    const BasicBlock& block = cfg->blocks[id];
+    BasicBlock::Terminator terminator = block.terminator;
+    int taken = block.taken, next = block.next;
+    thread_conditions(id);
+    bool merged = false;
+    while (merge_successor(id)) {
+        merged = true;
+        thread_conditions(id);
+    }
+    if (!merged && block.terminator == terminator && block.taken == taken && block.next == next) return;
+
+    // Look at the block again, and at its predecessors if they can now
+    // thread through it or skip it
+    enqueue(id);
+    if (block.instrs.empty()) enqueue_predecessors(id);
+}
@@ -0,0 +1,51 @@
+#ifndef SIMPLIFY_CFG_H
+#define SIMPLIFY_CFG_H
+
+#include "cfg.h"
+#include "ir.h"
+#include <deque>
+#include <vector>
+
+// Control-flow cleanup on the TAC listing, until nothing changes:
+//   - jump threading through empty blocks and through blocks that only
+//     re-test a condition whose outcome is already known on that edge
+//   - deletion of blocks unreachable from the entry
+//   - merging a block into its only predecessor when that is its only edge
+//
+// A worklist drives the rewrites. Each block is processed once, then again
+// only when an edge next to it changed: its predecessors when it can be
+// threaded through, its remaining predecessor when its in-degree drops to
+// one. Blocks whose in-degree drops to zero are deleted at once. Every
+// rewrite removes an edge or a block, so the work is linear in the size of
+// the graph. A loop cut off from the entry keeps its in-degree and is found
+// by one reachability pass at the end; only if there was one does another
+// pass run.
+class CFGSimplifier {
+public:
+    CFGSimplifier();
+    void run(std::vector<TacInstr>& code);
+
+    int threaded_edges;
+    int merged_blocks;
+    int removed_blocks;
+
+private:
+    ControlFlowGraph* cfg;
+    std::vector<std::vector<int>> preds; // May hold stale entries; see is_predecessor
+    std::vector<int> in_degree;          // Distinct live predecessors
+    std::deque<int> worklist;
+    std::vector<bool> queued;
+
+    void seed();
+    void enqueue(int id);
+    void enqueue_predecessors(int id);
+    bool is_predecessor(int pred, int id) const;
+    void set_edges(int id, BasicBlock::Terminator terminator, int taken, int next);
+    void drop_edge(int from, int to);
+    void forward_empty(int id);
+    void thread_conditions(int id);
+    bool merge_successor(int id);
+    void process(int id);
+};
+
+#endif // SIMPLIFY_CFG_H
@@ -0,0 +1,212 @@
+#include "tiered.h"
+#include "algebraic.h"
+#include "assembly_gen.h"
+#include "bounds_check.h"
+#include "dce.h"
+#include "if_convert.h"
+#include "loop_reverse.h"
+#include "mem2reg.h"
+#include "sccp.h"
+#include "simplify_cfg.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+const std::string kSlotPrefix = "__tier_";
+const std::string kExitVariable = "__tier_exit";
+
+long long microseconds_since(std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+// The -O2 TAC pipeline, in the same order
+void optimize_fragment(std::vector<TacInstr>& code) {
+    VariablePromoter variable_promoter;
+    ConstantPropagator constant_propagator;
+    AlgebraicSimplifier algebraic_simplifier;
+    BoundsCheckEliminator bounds_check_eliminator;
+    LoopReverser loop_reverser;
+    IfConverter if_converter;
+    DeadCodeEliminator dead_code_eliminator;
+    CFGSimplifier cfg_simplifier;
+    variable_promoter.run(code);
+    constant_propagator.run(code);
+    algebraic_simplifier.run(code);
+    bounds_check_eliminator.run(code);
+    loop_reverser.run(code);
+    if_converter.run(code);
+    dead_code_eliminator.run(code);
+    cfg_simplifier.run(code);
+}
+
+// The largest N of any label LN, so labels made up later cannot collide
+long last_label_number(const std::vector<TacInstr>& code) {
+    long last = 0;
+    for (const auto& instr : code) {
+        if (instr.kind != TacOp::Label || instr.label.size() < 2 || instr.label[0] != 'L') continue;
+        if (!std::all_of(instr.label.begin() + 1, instr.label.end(), ::isdigit)) continue;
+        last = std::max(last, std::stol(instr.label.substr(1)));
+    }
+    return last;
+}
+
+} // namespace
+
+TieredExecutor::TieredExecutor()
+    : hot_threshold(1000), run_microseconds(0), compile_microseconds(0), compiled_loops(0), rejected_loops(0),
+      native_entries(0) {}
+
+void TieredExecutor::run(const std::vector<TacInstr>& code) {
+    values.clear();
+    compile_microseconds = 0;
+    compiled_loops = 0;
+    rejected_loops = 0;
+    native_entries = 0;
+    BytecodeProgram program = compile_bytecode(code, true);
+    // Timed like the VM's run, plus the time spent compiling loops
+    auto start = std::chrono::steady_clock::now();
+    std::vector<NativeLoop> loops(program.loops.size());
+    BytecodeVM vm;
+    vm.start(program);
+    vm.loop_budget.assign(loops.size(), std::max<uint32_t>(hot_threshold, 1));
+    std::map<std::string, int32_t*> arrays; // The VM's elements, shared with compiled loops
+    for (size_t i = 0; i < program.arrays.size(); ++i) arrays[program.arrays[i].first] = vm.arrays[i].data();
+
+    for (int number; (number = vm.resume(program)) >= 0;) {
+        NativeLoop& native = loops[number];
+        if (!native.tried) {
+            auto compile_start = std::chrono::steady_clock::now();
+            compile_loop(code, program, program.loops[number], arrays, native);
+            compile_microseconds += microseconds_since(compile_start);
+        }
+        if (!native.jit) {
+            // Not coming back: the loop runs on in the VM
+            vm.loop_budget[number] = UINT32_MAX;
+            ++vm.pc;
+            continue;
+        }
+
+        int32_t* data = native.jit->data();
+        for (size_t i = 0; i < native.slots.size(); ++i) data[native.symbols[i]] = vm.slots[native.slots[i]];
+        native.jit->call();
+        for (size_t i = 0; i < native.slots.size(); ++i) vm.slots[native.slots[i]] = data[native.symbols[i]];
+        if (native.bounds_symbol >= 0 && data[native.bounds_symbol] != 0) {
+            throw std::runtime_error("Runtime Error: Array index out of bounds.");
+        }
+        int32_t exit = data[native.exit_symbol];
+        if (exit < 0 || static_cast<size_t>(exit) >= native.exits.size()) {
+            throw std::runtime_error("IR Error: Compiled loop left through unknown exit " + std::to_string(exit));
+        }
+        vm.pc = native.exits[exit];
+        vm.loop_budget[number] = 1; // Enter natively again next time
+        ++native_entries;
+    }
+
+    run_microseconds = microseconds_since(start);
+    vm.collect_values(program);
+    values = vm.values;
+}
+
+void TieredExecutor::compile_loop(const std::vector<TacInstr>& code, const BytecodeProgram& program,
+                                  const BytecodeLoop& loop, const std::map<std::string, int32_t*>& arrays,
+                                  NativeLoop& native) {
+    native.tried = true;
+    std::set<std::string> inside; // Labels of the loop itself
+    std::set<std::string> used_arrays;
+    for (size_t i = loop.header; i <= loop.back_edge; ++i) {
+        const TacInstr& instr = code[i];
+        if (instr.kind == TacOp::Label) inside.insert(instr.label);
+        if (!instr.array.empty()) used_arrays.insert(instr.array);
+    }
+
+    // Exit 0 falls off the end of the loop; every label outside it that the
+    // loop jumps to gets the next number
+    long next_label = last_label_number(code);
+    std::string done = "L" + std::to_string(++next_label);
+    std::map<std::string, size_t> exit_number;
+    std::vector<std::string> exit_labels = {""};
+    native.exits = {program.instruction_of[loop.back_edge + 1]};
+
+    auto rename = [&](std::string& operand) {
+        if (operand.empty() || is_constant(operand)) return;
+        operand = kSlotPrefix + std::to_string(program.slot_of.at(operand));
+    };
+    std::vector<TacInstr> fragment;
+    for (const auto& [name, size] : program.arrays) {
+        if (!used_arrays.count(name)) continue;
+        TacInstr declaration;
+        declaration.kind = TacOp::ArrayDecl;
+        declaration.array = name;
+        declaration.arg1 = std::to_string(size);
+        fragment.push_back(declaration);
+    }
+    for (size_t i = loop.header; i <= loop.back_edge; ++i) {
+        TacInstr instr = code[i];
+        rename(instr.dest);
+        rename(instr.arg1);
+        rename(instr.arg2);
+        if (instr.is_jump() && !inside.count(instr.label)) {
+            auto [found, inserted] = exit_number.emplace(instr.label, native.exits.size());
+            if (inserted) {
+                native.exits.push_back(program.labels.at(instr.label));
+                exit_labels.push_back("L" + std::to_string(++next_label));
+            }
+            instr.label = exit_labels[found->second];
+        }
+        fragment.push_back(instr);
+    }
+    for (size_t number = 0; number < exit_labels.size(); ++number) {
+        if (number > 0) fragment.push_back(make_label(exit_labels[number]));
+        TacInstr set_exit;
+        set_exit.kind = TacOp::Mov;
+        set_exit.dest = kExitVariable;
+        set_exit.arg1 = std::to_string(number);
+        fragment.push_back(set_exit);
+        fragment.push_back(make_goto(done));
+    }
+    fragment.push_back(make_label(done));
+
+    try {
+        optimize_fragment(fragment);
+        // Checked after constant propagation, which may make the divisor a constant
+        for (const auto& instr : fragment) {
+            if (may_fault(instr)) throw std::runtime_error("IR Error: Loop division may fault.");
+        }
+        AssemblyGenerator generator;
+        generator.set_target(TargetArch::X86_64);
+        generator.set_allocator(AllocatorKind::GraphColoring);
+        generator.optimize_assembly = true;
+        generator.generate_from_tac(print_tac(fragment));
+        std::vector<std::string> symbols = generator.data_symbols();
+        auto jit = std::make_unique<JitExecutor>();
+        jit->load(generator.program(ProgramExit::Return), symbols, generator.array_symbols(), arrays);
+
+        bool has_exit = false;
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            if (symbols[i] == kExitVariable) {
+                native.exit_symbol = i;
+                has_exit = true;
+            } else if (symbols[i] == "__out_of_bounds") {
+                native.bounds_symbol = static_cast<int>(i);
+            } else if (symbols[i].rfind(kSlotPrefix, 0) == 0) {
+                native.slots.push_back(static_cast<uint16_t>(std::stoul(symbols[i].substr(kSlotPrefix.size()))));
+                native.symbols.push_back(i);
+            }
+        }
+        if (!has_exit) throw std::runtime_error("IR Error: Compiled loop has no exit.");
+        native.jit = std::move(jit);
+        ++compiled_loops;
+    } catch (const std::runtime_error&) {
+        // Whatever the backend or the host cannot handle, the VM still runs
+        native.slots.clear();
+        native.symbols.clear();
+        native.bounds_symbol = -1;
+        ++rejected_loops;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef TIERED_H
+#define TIERED_H
+
+#include "bytecode.h"
+#include "ir.h"
+#include "jit.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Tiered execution: the program starts in the bytecode VM, and a loop that
+// turns out to be hot is compiled to x86-64 code and finished natively.
+//
+// Every loop header carries a counter. When a loop has been entered or
+// iterated `hot_threshold` times, its TAC, from the header label through
+// the back edge, is cut out as a fragment of its own. Every operand of the
+// fragment is renamed to a variable named after its VM slot, so the JIT's
+// data block holds exactly the VM state the loop touches; mem2reg then
+// moves it into registers for the run. Jumps out of the loop, and falling
+// off its end, set an exit number and leave the fragment. The fragment goes
+// through the -O2 TAC passes and the backend and is loaded by JitExecutor.
+//
+// Control transfers at the loop header, whether the loop is being entered
+// or is in the middle of its iterations: the VM's slots are copied into
+// the data block, the code is called, the block is copied back and the VM
+// resumes at the exit the loop took. A compiled loop is entered natively
+// every time the VM reaches its header again. Arrays are not copied: the
+// fragment declares the ones it uses and the JIT links them to the VM's
+// own elements. A fragment whose bounds check fails returns at once, and
+// the run ends with the same Runtime Error the VM would raise.
+//
+// Loops with a division that may fault (see may_fault) stay in the VM,
+// which reports a zero divisor and INT_MIN / -1 as Runtime Errors, and so
+// does every loop on hosts the JIT cannot run on.
+class TieredExecutor {
+public:
+    TieredExecutor();
+    void run(const std::vector<TacInstr>& code);
+
+    uint32_t hot_threshold; // Header executions before a loop is compiled
+
+    // The program's variables after the run, in layout order
+    std::vector<std::pair<std::string, int32_t>> values;
+    long long run_microseconds;
+    long long compile_microseconds;
+    int compiled_loops;
+    int rejected_loops;
+    int native_entries;
+
+private:
+    struct NativeLoop {
+        bool tried = false;
+        std::unique_ptr<JitExecutor> jit; // Null if the loop stays in the VM
+        std::vector<uint16_t> slots;      // VM slot of each data symbol but the exit number
+        std::vector<size_t> symbols;      // Data block index of each of those
+        size_t exit_symbol = 0;
+        int bounds_symbol = -1;           // Data block index of __out_of_bounds, if any
+        std::vector<size_t> exits;        // Instruction to resume at, by exit number
+    };
+
+    void compile_loop(const std::vector<TacInstr>& code, const BytecodeProgram& program,
+                      const BytecodeLoop& loop, const std::map<std::string, int32_t*>& arrays,
+                      NativeLoop& native);
+};
+
+#endif // TIERED_H
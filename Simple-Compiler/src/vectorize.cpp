@@ -0,0 +1,328 @@
+#include "vectorize.h"
+#include "printing_options.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <set>
+
+namespace {
+
+// %v0-%v5; see AssemblyGenerator::vector_register
+const int kVectorRegisters = 6;
+
+bool mentions(const Node* node, const std::string& var) {
+    std::set<std::string> used;
+    collect_used(node, used);
+    return used.count(var) > 0;
+}
+
+// The array stores of a body made only of them, in order
+bool collect_stores(Statement* stmt, std::vector<ArrayAssignment*>& out) {
+    if (auto store = dynamic_cast<ArrayAssignment*>(stmt)) {
+        out.push_back(store);
+        return true;
+    }
+    auto block = dynamic_cast<Block*>(stmt);
+    if (!block || !block->statement_list) return false;
+    for (auto& inner : block->statement_list->statements) {
+        if (!collect_stores(inner.get(), out)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool parse_vector_extension(const std::string& flag, VectorExtension& extension) {
+    if (flag == "--vectorize=none") extension = VectorExtension::None;
+    else if (flag == "--vectorize=sse2") extension = VectorExtension::SSE2;
+    else if (flag == "--vectorize=avx2") extension = VectorExtension::AVX2;
+    else return false;
+    return true;
+}
+
+LoopVectorizer::LoopVectorizer()
+    : vectorized(0), dependent(0), gcd_proofs(0), banerjee_proofs(0), lanes(4), bound_count(0) {}
+
+void LoopVectorizer::reset() {
+    vectorized = dependent = gcd_proofs = banerjee_proofs = 0;
+    bound_count = 0;
+}
+
+void LoopVectorizer::run(StatementList* root, VectorExtension extension) {
+    if (!root || extension == VectorExtension::None) return;
+    lanes = extension == VectorExtension::AVX2 ? 8 : 4;
+    visit_list(root);
+}
+
+void LoopVectorizer::visit_list(StatementList* list) {
+    if (!list) return;
+    for (auto& stmt : list->statements) {
+        visit(stmt);
+    }
+}
+
+void LoopVectorizer::visit(std::unique_ptr<Statement>& slot) {
+    if (!slot) return;
+    if (auto if_stmt = dynamic_cast<IfStatement*>(slot.get())) {
+        visit(if_stmt->if_body);
+        visit(if_stmt->else_body);
+        return;
+    }
+    if (auto block = dynamic_cast<Block*>(slot.get())) {
+        visit_list(block->statement_list.get());
+        return;
+    }
+    auto loop = dynamic_cast<ForStatement*>(slot.get());
+    if (!loop) return;
+    if (contains_loop(loop->body.get())) {
+        visit(loop->body);
+        return;
+    }
+
+    InductionVariable iv;
+    if (loop->keep_rolled || !match_induction_variable(loop, iv)) return;
+    if (iv.step != 1 || (iv.op != "<" && iv.op != "<=")) return;
+    std::vector<ArrayAssignment*> body;
+    if (!loop->body || !collect_stores(loop->body.get(), body) || body.empty()) return;
+
+    long long trip_count = -1;
+    IterationRange range;
+    long long start, bound;
+    if (iv.start && evaluate_constant(iv.start, start) && evaluate_constant(iv.bound, bound)) {
+        trip_count = compute_trip_count(start, iv.op, bound, iv.step);
+        range.known = true;
+        range.first = start;
+        range.last = iv.op == "<" ? bound - 1 : bound;
+    }
+    if (trip_count >= 0 && trip_count < lanes) return;
+
+    // Stores must move with the loop; reads may also stay put
+    std::vector<Reference> refs;
+    for (size_t s = 0; s < body.size(); ++s) {
+        Reference write;
+        write.array = body[s]->id;
+        write.statement = s;
+        write.write = true;
+        if (!affine(body[s]->index.get(), iv.var, write.subscript) || write.subscript.coefficient != 1) return;
+        int registers = 0;
+        if (!vectorizable_expression(body[s]->expr.get(), iv.var, s, refs, registers)) return;
+        if (registers > kVectorRegisters) return;
+        refs.push_back(write);
+    }
+
+    for (const Reference& source : refs) {
+        for (const Reference& sink : refs) {
+            if (&source == &sink || source.array != sink.array || (!source.write && !sink.write)) continue;
+            bool kept = source.statement < sink.statement ||
+                        (source.statement == sink.statement && !source.write && sink.write);
+            if (kept || !may_depend(source, sink, range)) continue;
+            ++dependent;
+            if (should_print(PRINT_PARSE_TREE)) {
+                std::cout << "Optimizer: Not vectorizing loop over '" << iv.var << "': a dependence on '"
+                          << source.array << "'" << std::endl;
+            }
+            return;
+        }
+    }
+
+    if (should_print(PRINT_PARSE_TREE)) {
+        std::cout << "Optimizer: Vectorizing loop over '" << iv.var << "' (" << lanes << " lanes)" << std::endl;
+    }
+    ++vectorized;
+    slot = vectorize(loop, iv, body, trip_count);
+}
+
+/******************************************************************
+ * Loop recognition
+ ******************************************************************/
+
+bool LoopVectorizer::affine(const Expression* expr, const std::string& var, Subscript& out) const {
+    out = Subscript();
+    long long value;
+    if (evaluate_constant(expr, value)) {
+        out.constant = value;
+        return true;
+    }
+    if (auto id = dynamic_cast<const Identifier*>(expr)) {
+        if (id->name == var) out.coefficient = 1;
+        else out.terms[id->name] = 1;
+        return true;
+    }
+    if (auto unop = dynamic_cast<const UnaryOp*>(expr)) {
+        if (unop->op != "-" || !affine(unop->expr.get(), var, out)) return false;
+        out.coefficient = -out.coefficient;
+        out.constant = -out.constant;
+        for (auto& [name, factor] : out.terms) factor = -factor;
+        return true;
+    }
+    auto binop = dynamic_cast<const BinaryOp*>(expr);
+    if (!binop) return false;
+    Subscript left, right;
+    if (binop->op == "*") {
+        // One side must be a constant factor
+        long long factor;
+        const Expression* other;
+        if (evaluate_constant(binop->left.get(), factor)) other = binop->right.get();
+        else if (evaluate_constant(binop->right.get(), factor)) other = binop->left.get();
+        else return false;
+        if (!affine(other, var, out)) return false;
+        out.coefficient *= factor;
+        out.constant *= factor;
+        for (auto& [name, term] : out.terms) term *= factor;
+    } else if (binop->op == "+" || binop->op == "-") {
+        if (!affine(binop->left.get(), var, left) || !affine(binop->right.get(), var, right)) return false;
+        long long sign = binop->op == "+" ? 1 : -1;
+        out = left;
+        out.coefficient += sign * right.coefficient;
+        out.constant += sign * right.constant;
+        for (const auto& [name, factor] : right.terms) out.terms[name] += sign * factor;
+    } else {
+        return false;
+    }
+    for (auto it = out.terms.begin(); it != out.terms.end();) {
+        it = it->second == 0 ? out.terms.erase(it) : std::next(it);
+    }
+    return true;
+}
+
+// Checks a stored expression and records the elements it reads. A part
+// without i is computed once and copied to every lane; one with i is
+// evaluated lane by lane, its left operand in the register it is given and
+// its right operand in the next, so `registers` is 1 for a leaf and
+// max(left, right + 1) for an operator.
+bool LoopVectorizer::vectorizable_expression(const Expression* expr, const std::string& var, size_t statement,
+                                             std::vector<Reference>& refs, int& registers) const {
+    registers = 1;
+    if (dynamic_cast<const Number*>(expr)) return true;
+    if (auto id = dynamic_cast<const Identifier*>(expr)) return id->name != var;
+    if (auto access = dynamic_cast<const ArrayAccess*>(expr)) {
+        Reference read;
+        read.array = access->id;
+        read.statement = statement;
+        read.write = false;
+        if (!affine(access->index.get(), var, read.subscript)) return false;
+        // A subscript that mentions i must also move with it: a[i - i] is not a vector
+        bool moves = read.subscript.coefficient != 0;
+        if (read.subscript.coefficient > 1 || read.subscript.coefficient < 0) return false;
+        if (!moves && mentions(access->index.get(), var)) return false;
+        refs.push_back(read);
+        return true;
+    }
+    bool invariant = !mentions(expr, var);
+    if (auto unop = dynamic_cast<const UnaryOp*>(expr)) {
+        int inner = 0;
+        if (unop->op != "-" || !vectorizable_expression(unop->expr.get(), var, statement, refs, inner)) return false;
+        // 0 - x, with the 0 in the register given
+        if (!invariant) registers = inner + 1;
+        return true;
+    }
+    auto binop = dynamic_cast<const BinaryOp*>(expr);
+    if (!binop || (binop->op != "+" && binop->op != "-" && binop->op != "*")) return false;
+    int left = 0, right = 0;
+    if (!vectorizable_expression(binop->left.get(), var, statement, refs, left) ||
+        !vectorizable_expression(binop->right.get(), var, statement, refs, right)) {
+        return false;
+    }
+    if (!invariant) registers = std::max(left, right + 1);
+    return true;
+}
+
+/******************************************************************
+ * Dependence testing
+ ******************************************************************/
+
+// Solves a1 * i1 + c1 = a2 * (i1 + d) + c2, rewritten as
+//   (a1 - a2) * i1 - a2 * d = c2 - c1
+// for d in [1, lanes - 1] and i1, i1 + d iterations of the loop
+bool LoopVectorizer::may_depend(const Reference& source, const Reference& sink, const IterationRange& range) {
+    if (source.subscript.terms != sink.subscript.terms) return true;
+    long long x = source.subscript.coefficient - sink.subscript.coefficient;
+    long long y = -sink.subscript.coefficient;
+    long long rhs = sink.subscript.constant - source.subscript.constant;
+
+    long long divisor = std::gcd(x, y);
+    if (divisor == 0 ? rhs != 0 : rhs % divisor != 0) {
+        ++gcd_proofs;
+        return false;
+    }
+
+    // The left side's extremes, term by term
+    long long low = std::min(y, y * (lanes - 1));
+    long long high = std::max(y, y * (lanes - 1));
+    if (x != 0) {
+        if (!range.known) return true;
+        long long last = range.last - 1; // i1 + d is an iteration too
+        low += std::min(x * range.first, x * last);
+        high += std::max(x * range.first, x * last);
+    }
+    if (rhs < low || rhs > high) {
+        ++banerjee_proofs;
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************
+ * Transformation
+ ******************************************************************/
+
+std::unique_ptr<Statement> LoopVectorizer::vectorize(ForStatement* loop, const InductionVariable& iv,
+                                                     const std::vector<ArrayAssignment*>& body,
+                                                     long long trip_count) {
+    auto list = std::make_unique<StatementList>();
+    if (loop->init) list->statements.push_back(std::move(loop->init));
+
+    // The vector loop runs while all `lanes` iterations are left:
+    //   var op bound - (lanes - 1)
+    std::unique_ptr<Expression> limit;
+    std::unique_ptr<BinaryOp> guard;
+    long long bound_value;
+    if (evaluate_constant(iv.bound, bound_value) && bound_value - (lanes - 1) >= INT32_MIN) {
+        limit = std::make_unique<Number>(static_cast<double>(bound_value - (lanes - 1)));
+    } else {
+        std::string name = "__vector_bound" + std::to_string(++bound_count);
+        auto adjusted = std::make_unique<BinaryOp>("-", clone_expression(iv.bound),
+                                                   std::make_unique<Number>(static_cast<double>(lanes - 1)));
+        list->statements.push_back(std::make_unique<Declaration>("int", name, std::move(adjusted)));
+        limit = std::make_unique<Identifier>(name);
+        // The limit wraps around for a bound this close to INT_MIN; the
+        // epilogue loop then runs every iteration
+        guard = std::make_unique<BinaryOp>(">=", clone_expression(iv.bound),
+                                           std::make_unique<Number>(static_cast<double>(INT32_MIN + lanes - 1)));
+    }
+
+    auto group = std::make_unique<StatementList>();
+    for (const ArrayAssignment* store : body) {
+        group->statements.push_back(std::make_unique<VectorAssignment>(
+            iv.var, lanes,
+            std::make_unique<ArrayAssignment>(store->id, clone_expression(store->index.get()),
+                                              clone_expression(store->expr.get()))));
+    }
+    auto step = std::make_unique<Assignment>(
+        iv.var, std::make_unique<BinaryOp>("+", std::make_unique<Identifier>(iv.var),
+                                           std::make_unique<Number>(static_cast<double>(lanes))));
+    auto condition = std::make_unique<BinaryOp>(iv.op, std::make_unique<Identifier>(iv.var), std::move(limit));
+    auto vector_loop = std::make_unique<ForStatement>(nullptr, std::move(condition), std::move(step),
+                                                      std::make_unique<Block>(std::move(group)));
+    vector_loop->keep_rolled = true;
+    if (guard) {
+        list->statements.push_back(std::make_unique<IfStatement>(std::move(guard), std::move(vector_loop)));
+    } else {
+        list->statements.push_back(std::move(vector_loop));
+    }
+
+    // Epilogue: at most lanes - 1 iterations are left
+    if (trip_count >= 0) {
+        for (long long i = 0; i < trip_count % lanes; ++i) {
+            list->statements.push_back(clone_statement(loop->body.get()));
+            list->statements.push_back(clone_statement(loop->increment.get()));
+        }
+    } else {
+        auto epilogue = std::make_unique<ForStatement>(nullptr, std::move(loop->condition), std::move(loop->increment),
+                                                       std::move(loop->body));
+        epilogue->keep_rolled = true;
+        list->statements.push_back(std::move(epilogue));
+    }
+    return std::make_unique<Block>(std::move(list));
+}
@@ -0,0 +1,91 @@
+#ifndef VECTORIZE_H
+#define VECTORIZE_H
+
+#include "ast.h"
+#include "ast_utils.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Instruction set vector code is generated for: SSE2 does 4 ints per
+// instruction in xmm registers, AVX2 does 8 in ymm registers
+enum class VectorExtension { None, SSE2, AVX2 };
+
+// Accepts --vectorize=none|sse2|avx2; returns false for any other flag
+bool parse_vector_extension(const std::string& flag, VectorExtension& extension);
+
+// Rewrites innermost for loops over arrays to do `lanes` iterations at a
+// time. A loop qualifies when
+//   - it counts up by one, for (i = start; i < bound; i++) or with <=;
+//   - its body is only array stores a[s] = e, with every subscript affine
+//     in i: i + c plus loop-invariant terms for a subscript that moves with
+//     the loop, or no i at all for one that does not;
+//   - the stored expressions use only +, - and *, read i only in
+//     subscripts, and fit in the six vector registers the backend has;
+//   - no dependence between iterations fewer than `lanes` apart is
+//     reversed by running them together (see below).
+//
+// The loop becomes
+//   init; for (; i < bound - (lanes - 1); i = i + lanes) vector stores
+// followed by the scalar loop for the last iterations, or by those
+// iterations as straight-line code when the trip count is constant.
+//
+// Vector order runs each statement for `lanes` iterations before the next
+// statement. For two references to the same array, at least one a store,
+// the source at iteration i1 and the sink at i1 + d touch the same element
+// when a1 * i1 + c1 = a2 * (i1 + d) + c2 (a is 1 or 0, the coefficient of
+// i). That order is kept when the source's statement comes first, or in
+// the same statement when the source is the read. Any other pair must be
+// independent for d in [1, lanes - 1], which is shown by the GCD test (the
+// gcd of the coefficients of i1 and d does not divide c2 - c1) or by the
+// Banerjee test (c2 - c1 is outside the range the left side takes over
+// the loop's iterations). Subscripts with different invariant terms are
+// assumed to depend.
+class LoopVectorizer {
+public:
+    LoopVectorizer();
+    void run(StatementList* root, VectorExtension extension);
+    void reset();
+
+    int vectorized;      // Loops rewritten
+    int dependent;       // Loops left scalar for a possible dependence
+    int gcd_proofs;      // Reference pairs shown independent by the GCD test
+    int banerjee_proofs; // Reference pairs shown independent by the Banerjee bounds
+
+private:
+    // coefficient * i + constant + sum of terms, for the loop's i
+    struct Subscript {
+        long long coefficient = 0;
+        long long constant = 0;
+        std::map<std::string, long long> terms; // Invariant variable -> its factor
+    };
+
+    struct Reference {
+        std::string array;
+        Subscript subscript;
+        size_t statement; // Position in the body
+        bool write;
+    };
+
+    // The loop's iterations, if its start and bound are constants
+    struct IterationRange {
+        bool known = false;
+        long long first = 0, last = 0;
+    };
+
+    int lanes;
+    int bound_count;
+
+    void visit_list(StatementList* list);
+    void visit(std::unique_ptr<Statement>& slot);
+
+    bool affine(const Expression* expr, const std::string& var, Subscript& out) const;
+    bool vectorizable_expression(const Expression* expr, const std::string& var, size_t statement,
+                                 std::vector<Reference>& refs, int& registers) const;
+    bool may_depend(const Reference& source, const Reference& sink, const IterationRange& range);
+    std::unique_ptr<Statement> vectorize(ForStatement* loop, const InductionVariable& iv,
+                                         const std::vector<ArrayAssignment*>& body, long long trip_count);
+};
+
+#endif // VECTORIZE_H
@@ -0,0 +1,561 @@
+#include "x86_encoder.h"
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+// A parsed Intel-syntax operand
+struct Operand {
+    enum Kind { Register, Memory, Immediate };
+    Kind kind = Immediate;
+    int reg = 0;            // Register number, 0-15
+    int size = 32;          // Register or memory width in bits
+    int base = -1;          // Memory: [base + index*scale + displacement]
+    int index = -1;
+    int scale = 1;
+    int address_size = 0;   // Width of the base and index registers
+    long long value = 0;    // Displacement, or the immediate
+    std::string symbol;     // A .data variable or .bss array, in memory or as an address
+    bool rip_relative = false;
+};
+
+} // namespace
+
+static std::string strip(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) return "";
+    size_t last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+// Outside long mode there are no 64-bit registers and no r8-r15 or
+// xmm8-xmm15, so those names are symbols there
+static bool parse_register(const std::string& name, int& number, int& size, bool long_mode) {
+    if (!long_mode) {
+        int wide_number = 0, wide_size = 0;
+        if (!parse_register(name, wide_number, wide_size, true)) return false;
+        if (wide_size == 64 || wide_number >= 8) return false;
+        number = wide_number;
+        size = wide_size;
+        return true;
+    }
+    static const char* names32[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+    static const char* names64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi"};
+    static const char* names8[] = {"al", "cl", "dl", "bl"};
+    for (int i = 0; i < 8; ++i) {
+        if (name == names32[i]) { number = i; size = 32; return true; }
+        if (name == names64[i]) { number = i; size = 64; return true; }
+        if (i < 4 && name == names8[i]) { number = i; size = 8; return true; }
+    }
+    // xmm0-xmm15 and ymm0-ymm15
+    if (name.size() > 3 && (name.rfind("xmm", 0) == 0 || name.rfind("ymm", 0) == 0)) {
+        std::string digits = name.substr(3);
+        if (digits.size() > 2 || !std::all_of(digits.begin(), digits.end(), ::isdigit)) return false;
+        number = std::stoi(digits);
+        size = name[0] == 'y' ? 256 : 128;
+        return number < 16;
+    }
+    // r8-r15 and r8d-r15d
+    if (name.size() < 2 || name[0] != 'r' || !isdigit(static_cast<unsigned char>(name[1]))) return false;
+    size_t end = 1;
+    while (end < name.size() && isdigit(static_cast<unsigned char>(name[end]))) end++;
+    number = std::stoi(name.substr(1, end - 1));
+    std::string suffix = name.substr(end);
+    if (number < 8 || number > 15 || (!suffix.empty() && suffix != "d")) return false;
+    size = suffix.empty() ? 64 : 32;
+    return true;
+}
+
+static bool parse_number(const std::string& text, long long& value) {
+    if (text.empty()) return false;
+    try {
+        size_t used = 0;
+        value = std::stoll(text, &used, 0);
+        return used == text.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+static Operand parse_operand(const std::string& text, bool long_mode) {
+    Operand operand;
+    std::string rest = strip(text);
+    for (const auto& [keyword, size] : {std::pair<std::string, int>{"byte", 8}, {"dword", 32}, {"qword", 64}}) {
+        if (rest.rfind(keyword + " ", 0) == 0) {
+            operand.size = size;
+            rest = strip(rest.substr(keyword.size()));
+        }
+    }
+    if (rest.empty() || rest[0] != '[') {
+        if (parse_register(rest, operand.reg, operand.size, long_mode)) {
+            operand.kind = Operand::Register;
+        } else if (!rest.empty() && (isalpha(static_cast<unsigned char>(rest[0])) || rest[0] == '_')) {
+            operand.symbol = rest;
+        } else if (!parse_number(rest, operand.value)) {
+            throw std::runtime_error("Assembly Error: Unknown operand '" + text + "'.");
+        }
+        return operand;
+    }
+
+    operand.kind = Operand::Memory;
+    std::string inside = strip(rest.substr(1, rest.find(']') - 1));
+    if (inside.rfind("rel ", 0) == 0) {
+        operand.rip_relative = true;
+        inside = strip(inside.substr(4));
+    }
+    // Terms joined by + and -; a register term may carry a *scale
+    size_t at = 0;
+    int sign = 1;
+    while (at < inside.size()) {
+        size_t end = inside.find_first_of("+-", at);
+        if (end == std::string::npos) end = inside.size();
+        std::string term = strip(inside.substr(at, end - at));
+        int scale = 1;
+        size_t star = term.find('*');
+        if (star != std::string::npos) {
+            scale = std::stoi(term.substr(star + 1));
+            term = strip(term.substr(0, star));
+        }
+        int number = 0, size = 0;
+        long long value = 0;
+        if (parse_register(term, number, size, long_mode) && size != 8) {
+            operand.address_size = size;
+            if (operand.base < 0 && scale == 1) {
+                operand.base = number;
+            } else {
+                operand.index = number;
+                operand.scale = scale;
+            }
+        } else if (parse_number(term, value)) {
+            operand.value += sign * value;
+        } else if (!term.empty()) {
+            operand.symbol = term;
+        }
+        if (end < inside.size()) sign = inside[end] == '-' ? -1 : 1;
+        at = end + 1;
+    }
+    return operand;
+}
+
+static int condition_number(const std::string& code) {
+    static const std::map<std::string, int> codes = {
+        {"o", 0}, {"no", 1}, {"b", 2}, {"c", 2}, {"nae", 2}, {"ae", 3}, {"nb", 3}, {"nc", 3},
+        {"e", 4}, {"z", 4}, {"ne", 5}, {"nz", 5}, {"be", 6}, {"na", 6}, {"a", 7}, {"nbe", 7},
+        {"s", 8}, {"ns", 9}, {"p", 10}, {"pe", 10}, {"np", 11}, {"po", 11},
+        {"l", 12}, {"nge", 12}, {"ge", 13}, {"nl", 13}, {"le", 14}, {"ng", 14}, {"g", 15}, {"nle", 15},
+    };
+    auto found = codes.find(code);
+    return found == codes.end() ? -1 : found->second;
+}
+
+static bool fits_byte(long long value) {
+    return value >= -128 && value <= 127;
+}
+
+static void append_value(std::vector<uint8_t>& bytes, long long value, int size) {
+    for (int i = 0; i < size; ++i) bytes.push_back(static_cast<uint8_t>((value >> (8 * i)) & 0xff));
+}
+
+X86Encoder::X86Encoder(TargetArch target) : short_jumps(0), long_jumps(0), target(target) {}
+
+X86Encoder::Encoded X86Encoder::encode_instruction(const MachineInstr& instr) {
+    Encoded result;
+    std::vector<uint8_t>& out = result.bytes;
+    const std::string& op = instr.opcode;
+    bool long_mode = target == TargetArch::X86_64;
+    auto fail = [&]() -> Encoded {
+        throw std::runtime_error("Assembly Error: Cannot encode '" + strip(machine_instr_to_string(instr)) + "'.");
+    };
+    std::vector<Operand> operands; // Parsed once the instruction is known not to be a jump
+
+    // [0x67] [prefix] [REX] opcode ModRM [SIB] [displacement] [immediate].
+    // `rm` is a register or memory; `field` is the ModRM reg field, a
+    // register or an opcode extension.
+    auto address_size = [&](const Operand& rm) {
+        if (rm.kind == Operand::Immediate) fail();
+        if (rm.kind == Operand::Memory && rm.address_size != 0) {
+            if (!long_mode && rm.address_size == 64) fail();
+            if (long_mode && rm.address_size == 32) out.push_back(0x67);
+        }
+    };
+    // REX.R, REX.X and REX.B: the fourth bit of each register number
+    auto extension_bits = [&](int field, const Operand& rm) {
+        int bits = (field >> 3) << 2;
+        if (rm.kind == Operand::Register) bits |= rm.reg >> 3;
+        if (rm.kind == Operand::Memory && rm.index >= 0) bits |= (rm.index >> 3) << 1;
+        if (rm.kind == Operand::Memory && rm.base >= 0) bits |= rm.base >> 3;
+        return bits;
+    };
+    auto modrm = [&](int field, const Operand& rm, int immediate_size, long long immediate) {
+        int reg_bits = (field & 7) << 3;
+        if (rm.kind == Operand::Register) {
+            out.push_back(static_cast<uint8_t>(0xc0 | reg_bits | (rm.reg & 7)));
+        } else if (!rm.symbol.empty() || rm.rip_relative) {
+            if (rm.base >= 0 || (rm.index >= 0 && long_mode)) fail();
+            // mod 00, r/m 101 is disp32 on x86 and rip + disp32 on x86-64
+            if (long_mode != rm.rip_relative) fail();
+            if (rm.index >= 0) { // [symbol + index*scale] on x86: a SIB byte with no base
+                static const std::map<int, int> scales = {{1, 0}, {2, 1}, {4, 2}, {8, 3}};
+                if (!scales.count(rm.scale) || rm.index == 4) fail();
+                out.push_back(static_cast<uint8_t>(reg_bits | 4));
+                out.push_back(static_cast<uint8_t>((scales.at(rm.scale) << 6) | ((rm.index & 7) << 3) | 5));
+            } else {
+                out.push_back(static_cast<uint8_t>(reg_bits | 5));
+            }
+            Relocation relocation;
+            relocation.kind = rm.rip_relative ? Relocation::PcRelative32 : Relocation::Absolute32;
+            relocation.offset = out.size();
+            relocation.symbol = rm.symbol;
+            // rip is the end of the instruction, past any immediate
+            relocation.addend = rm.value - (rm.rip_relative ? 4 + immediate_size : 0);
+            result.relocations.push_back(relocation);
+            append_value(out, 0, 4);
+        } else if (rm.base < 0) {
+            // [index*scale + disp32] needs a SIB byte with no base
+            if (rm.index < 0) fail();
+            static const std::map<int, int> scales = {{1, 0}, {2, 1}, {4, 2}, {8, 3}};
+            if (!scales.count(rm.scale) || rm.index == 4) fail();
+            out.push_back(static_cast<uint8_t>(reg_bits | 4));
+            out.push_back(static_cast<uint8_t>((scales.at(rm.scale) << 6) | ((rm.index & 7) << 3) | 5));
+            append_value(out, rm.value, 4);
+        } else {
+            // ebp and r13 as a base always take a displacement
+            int mod = 2;
+            if (rm.value == 0 && (rm.base & 7) != 5) mod = 0;
+            else if (fits_byte(rm.value)) mod = 1;
+            // esp and r12 as a base need a SIB byte
+            bool sib = rm.index >= 0 || (rm.base & 7) == 4;
+            out.push_back(static_cast<uint8_t>((mod << 6) | reg_bits | (sib ? 4 : (rm.base & 7))));
+            if (sib) {
+                static const std::map<int, int> scales = {{1, 0}, {2, 1}, {4, 2}, {8, 3}};
+                if (!scales.count(rm.scale) || rm.index == 4) fail(); // esp cannot be an index
+                int index = rm.index >= 0 ? (rm.index & 7) : 4;
+                out.push_back(static_cast<uint8_t>((scales.at(rm.scale) << 6) | (index << 3) | (rm.base & 7)));
+            }
+            if (mod == 1) append_value(out, rm.value, 1);
+            if (mod == 2) append_value(out, rm.value, 4);
+        }
+        append_value(out, immediate, immediate_size);
+    };
+    auto emit = [&](bool wide, std::vector<uint8_t> opcode, int field, const Operand& rm, int immediate_size,
+                    long long immediate) {
+        address_size(rm);
+        int rex = (wide ? 8 : 0) | extension_bits(field, rm);
+        if (rex != 0) {
+            if (!long_mode) fail();
+            out.push_back(static_cast<uint8_t>(0x40 | rex));
+        }
+        out.insert(out.end(), opcode.begin(), opcode.end());
+        modrm(field, rm, immediate_size, immediate);
+    };
+    // An SSE2 instruction: a mandatory 66 or F3 prefix, then 0F and `opcode`
+    auto emit_sse = [&](uint8_t prefix, uint8_t opcode, int field, const Operand& rm, int immediate_size,
+                        long long immediate) {
+        address_size(rm);
+        out.push_back(prefix);
+        int rex = extension_bits(field, rm);
+        if (rex != 0) {
+            if (!long_mode) fail();
+            out.push_back(static_cast<uint8_t>(0x40 | rex));
+        }
+        out.push_back(0x0f);
+        out.push_back(opcode);
+        modrm(field, rm, immediate_size, immediate);
+    };
+    // A VEX-encoded instruction. `prefix` is the implied 66 (1) or F3 (2),
+    // `map` the implied 0F (1) or 0F 38 (2), `source` the extra register
+    // operand, if any, and `length` 1 for ymm. The 2-byte C5 form does when
+    // neither X nor B is set and the map is 0F; R, X, B and the source are
+    // stored inverted.
+    auto emit_vex = [&](int length, int prefix, int map, int source, uint8_t opcode, int field, const Operand& rm) {
+        address_size(rm);
+        int bits = extension_bits(field, rm);
+        int r = (~bits >> 2) & 1, x = (~bits >> 1) & 1, b = ~bits & 1;
+        int last = ((~source & 15) << 3) | (length << 2) | prefix;
+        if (x && b && map == 1) {
+            out.push_back(0xc5);
+            out.push_back(static_cast<uint8_t>((r << 7) | last));
+        } else {
+            out.push_back(0xc4);
+            out.push_back(static_cast<uint8_t>((r << 7) | (x << 6) | (b << 5) | map));
+            out.push_back(static_cast<uint8_t>(last));
+        }
+        out.push_back(opcode);
+        modrm(field, rm, 0, 0);
+    };
+    auto is_register = [&](size_t i) { return operands.size() > i && operands[i].kind == Operand::Register; };
+    auto is_immediate = [&](size_t i) { return operands.size() > i && operands[i].kind == Operand::Immediate; };
+    auto is_rm = [&](size_t i) { return operands.size() > i && operands[i].kind != Operand::Immediate; };
+    auto wide = [&](const Operand& operand) { return operand.size == 64; };
+    // Both register-or-memory operands of a two-operand form have one width
+    auto same_size = [&]() {
+        if (operands.size() != 2 || operands[0].size != operands[1].size) fail();
+        return operands[0].size;
+    };
+
+    if (instr.operands.empty()) {
+        if (op == "cdq") out = {0x99};
+        else if (op == "syscall") out = {0x0f, 0x05};
+        else if (op == "ret") out = {0xc3};
+        else if (op == "nop") out = {0x90};
+        else if (op == "vzeroupper") out = {0xc5, 0xf8, 0x77};
+        else fail();
+        return result;
+    }
+
+    if (op == "jmp" || (op[0] == 'j' && condition_number(op.substr(1)) >= 0)) {
+        if (instr.operands.size() != 1) fail();
+        result.jump_target = instr.operands[0];
+        result.condition = op == "jmp" ? -1 : condition_number(op.substr(1));
+        return result;
+    }
+
+    for (const auto& text : instr.operands) operands.push_back(parse_operand(text, long_mode));
+    // The only immediate address is the array base load, mov r64, symbol
+    for (size_t i = 0; i < operands.size(); ++i) {
+        if (!is_immediate(i) || operands[i].symbol.empty()) continue;
+        if (op != "mov" || i != 1 || !long_mode || !is_register(0) || !wide(operands[0])) fail();
+        out.push_back(static_cast<uint8_t>(0x48 | (operands[0].reg >> 3)));
+        out.push_back(static_cast<uint8_t>(0xb8 + (operands[0].reg & 7)));
+        result.relocations.push_back({Relocation::Absolute64, out.size(), operands[1].symbol, 0});
+        append_value(out, 0, 8);
+        return result;
+    }
+    // Vector instructions, on xmm and ymm registers and unaligned memory
+    static const std::map<std::string, std::pair<uint8_t, uint8_t>> sse = { // Prefix and opcode after 0F
+        {"movdqa", {0x66, 0x6f}},  {"movdqu", {0xf3, 0x6f}}, {"paddd", {0x66, 0xfe}},     {"psubd", {0x66, 0xfa}},
+        {"pmuludq", {0x66, 0xf4}}, {"pshufd", {0x66, 0x70}}, {"punpckldq", {0x66, 0x62}},
+    };
+    static const std::map<std::string, std::pair<int, uint8_t>> avx = { // Map and opcode, with an implied 66
+        {"vpaddd", {1, 0xfe}}, {"vpsubd", {1, 0xfa}}, {"vpmulld", {2, 0x40}},
+    };
+    static const std::set<std::string> moves = {"movd", "psrlq", "vmovd", "vmovdqu", "vpbroadcastd"};
+    auto sized_register = [&](size_t i, int size) { return is_register(i) && operands[i].size == size; };
+    auto is_memory = [&](size_t i) { return operands.size() > i && operands[i].kind == Operand::Memory; };
+    auto is_rm32 = [&](size_t i) { return is_memory(i) || sized_register(i, 32); };
+    bool vector = sse.count(op) || avx.count(op) || moves.count(op) ||
+                  std::any_of(operands.begin(), operands.end(), [](const Operand& operand) {
+                      return operand.kind == Operand::Register && operand.size >= 128;
+                  });
+    if (vector) {
+        if (sse.count(op) && sized_register(0, 128)) {
+            auto [prefix, opcode] = sse.at(op);
+            bool shuffle = op == "pshufd";
+            if (operands.size() != (shuffle ? 3u : 2u) || !(sized_register(1, 128) || is_memory(1))) fail();
+            if (shuffle && !is_immediate(2)) fail();
+            long long order = shuffle ? operands[2].value : 0;
+            emit_sse(prefix, opcode, operands[0].reg, operands[1], shuffle ? 1 : 0, order);
+        } else if ((op == "movdqu" || op == "movdqa") && operands.size() == 2 && is_memory(0) &&
+                   sized_register(1, 128)) {
+            emit_sse(op == "movdqu" ? 0xf3 : 0x66, 0x7f, operands[1].reg, operands[0], 0, 0);
+        } else if (op == "movd" && operands.size() == 2 && sized_register(0, 128) && is_rm32(1)) {
+            emit_sse(0x66, 0x6e, operands[0].reg, operands[1], 0, 0);
+        } else if (op == "psrlq" && operands.size() == 2 && sized_register(0, 128) && is_immediate(1)) {
+            emit_sse(0x66, 0x73, 2, operands[0], 1, operands[1].value);
+        } else if (op == "vmovdqu" && operands.size() == 2 && is_register(0) && operands[0].size >= 128 &&
+                   is_rm(1)) {
+            if (is_register(1) && operands[1].size != operands[0].size) fail();
+            emit_vex(operands[0].size == 256, 2, 1, 0, 0x6f, operands[0].reg, operands[1]);
+        } else if (op == "vmovdqu" && operands.size() == 2 && is_memory(0) && is_register(1) &&
+                   operands[1].size >= 128) {
+            emit_vex(operands[1].size == 256, 2, 1, 0, 0x7f, operands[1].reg, operands[0]);
+        } else if (op == "vmovd" && operands.size() == 2 && sized_register(0, 128) && is_rm32(1)) {
+            emit_vex(0, 1, 1, 0, 0x6e, operands[0].reg, operands[1]);
+        } else if (op == "vpbroadcastd" && operands.size() == 2 && is_register(0) && operands[0].size >= 128 &&
+                   (sized_register(1, 128) || is_memory(1))) {
+            emit_vex(operands[0].size == 256, 1, 2, 0, 0x58, operands[0].reg, operands[1]);
+        } else if (avx.count(op) && operands.size() == 3 && is_register(0) && operands[0].size >= 128 &&
+                   sized_register(1, operands[0].size) && (sized_register(2, operands[0].size) || is_memory(2))) {
+            auto [map, opcode] = avx.at(op);
+            emit_vex(operands[0].size == 256, 1, map, operands[1].reg, opcode, operands[0].reg, operands[2]);
+        } else {
+            fail();
+        }
+        return result;
+    }
+
+    static const std::map<std::string, int> arithmetic = {
+        {"add", 0}, {"or", 1}, {"adc", 2}, {"sbb", 3}, {"and", 4}, {"sub", 5}, {"xor", 6}, {"cmp", 7},
+    };
+    static const std::map<std::string, int> unary = {{"not", 2}, {"neg", 3}, {"idiv", 7}, {"div", 6}};
+    static const std::map<std::string, int> shifts = {{"shl", 4}, {"sal", 4}, {"shr", 5}, {"sar", 7}};
+    auto found = arithmetic.find(op);
+    if (found != arithmetic.end() && operands.size() == 2) {
+        int digit = found->second;
+        const Operand& dest = operands[0];
+        const Operand& src = operands[1];
+        if (is_immediate(1) && is_rm(0)) {
+            if (fits_byte(src.value)) emit(wide(dest), {0x83}, digit, dest, 1, src.value);
+            else emit(wide(dest), {0x81}, digit, dest, 4, src.value);
+        } else if (is_register(1) && is_rm(0)) {
+            emit(same_size() == 64, {static_cast<uint8_t>(digit * 8 + 1)}, src.reg, dest, 0, 0);
+        } else if (is_register(0) && is_rm(1)) {
+            emit(same_size() == 64, {static_cast<uint8_t>(digit * 8 + 3)}, dest.reg, src, 0, 0);
+        } else {
+            fail();
+        }
+    } else if (op == "mov" && operands.size() == 2) {
+        const Operand& dest = operands[0];
+        const Operand& src = operands[1];
+        if (is_immediate(1) && is_register(0) && !wide(dest)) {
+            if (dest.reg >= 8) {
+                if (!long_mode) fail();
+                out.push_back(0x41);
+            }
+            out.push_back(static_cast<uint8_t>(0xb8 + (dest.reg & 7)));
+            append_value(out, src.value, 4);
+        } else if (is_immediate(1) && is_rm(0)) {
+            emit(wide(dest), {0xc7}, 0, dest, 4, src.value);
+        } else if (is_register(1) && is_rm(0)) {
+            emit(same_size() == 64, {0x89}, src.reg, dest, 0, 0);
+        } else if (is_register(0) && is_rm(1)) {
+            emit(same_size() == 64, {0x8b}, dest.reg, src, 0, 0);
+        } else {
+            fail();
+        }
+    } else if (op == "test" && operands.size() == 2) {
+        if (is_immediate(1) && is_rm(0)) emit(wide(operands[0]), {0xf7}, 0, operands[0], 4, operands[1].value);
+        else if (is_register(1) && is_rm(0)) emit(same_size() == 64, {0x85}, operands[1].reg, operands[0], 0, 0);
+        else fail();
+    } else if (op == "imul") {
+        // imul r, imm is shorthand for imul r, r, imm
+        if (operands.size() == 2 && is_register(0) && is_immediate(1)) operands.insert(operands.begin() + 1, operands[0]);
+        if (operands.size() == 1 && is_rm(0)) {
+            emit(wide(operands[0]), {0xf7}, 5, operands[0], 0, 0);
+        } else if (operands.size() == 2 && is_register(0) && is_rm(1)) {
+            emit(same_size() == 64, {0x0f, 0xaf}, operands[0].reg, operands[1], 0, 0);
+        } else if (operands.size() == 3 && is_register(0) && is_rm(1) && is_immediate(2)) {
+            long long value = operands[2].value;
+            if (operands[0].size != operands[1].size) fail();
+            if (fits_byte(value)) emit(wide(operands[0]), {0x6b}, operands[0].reg, operands[1], 1, value);
+            else emit(wide(operands[0]), {0x69}, operands[0].reg, operands[1], 4, value);
+        } else {
+            fail();
+        }
+    } else if (unary.count(op) && operands.size() == 1 && is_rm(0)) {
+        emit(wide(operands[0]), {0xf7}, unary.at(op), operands[0], 0, 0);
+    } else if ((op == "inc" || op == "dec") && operands.size() == 1 && is_rm(0)) {
+        emit(wide(operands[0]), {0xff}, op == "inc" ? 0 : 1, operands[0], 0, 0);
+    } else if (shifts.count(op) && operands.size() == 2 && is_rm(0)) {
+        int digit = shifts.at(op);
+        if (is_immediate(1) && operands[1].value == 1) {
+            emit(wide(operands[0]), {0xd1}, digit, operands[0], 0, 0);
+        } else if (is_immediate(1)) {
+            emit(wide(operands[0]), {0xc1}, digit, operands[0], 1, operands[1].value);
+        } else if (is_register(1) && operands[1].reg == 1 && operands[1].size == 8) { // cl
+            emit(wide(operands[0]), {0xd3}, digit, operands[0], 0, 0);
+        } else {
+            fail();
+        }
+    } else if (op == "lea" && operands.size() == 2 && is_register(0) && operands[1].kind == Operand::Memory) {
+        emit(wide(operands[0]), {0x8d}, operands[0].reg, operands[1], 0, 0);
+    } else if (op == "movzx" && operands.size() == 2 && is_register(0) && is_rm(1)) {
+        if (operands[1].size != 8) fail();
+        emit(wide(operands[0]), {0x0f, 0xb6}, operands[0].reg, operands[1], 0, 0);
+    } else if (op.rfind("set", 0) == 0 && condition_number(op.substr(3)) >= 0 && operands.size() == 1 && is_rm(0)) {
+        if (operands[0].kind == Operand::Register && operands[0].size != 8) fail();
+        emit(false, {0x0f, static_cast<uint8_t>(0x90 + condition_number(op.substr(3)))}, 0, operands[0], 0, 0);
+    } else if (op.rfind("cmov", 0) == 0 && condition_number(op.substr(4)) >= 0 && operands.size() == 2 &&
+               is_register(0) && is_rm(1)) {
+        uint8_t opcode = static_cast<uint8_t>(0x40 + condition_number(op.substr(4)));
+        emit(same_size() == 64, {0x0f, opcode}, operands[0].reg, operands[1], 0, 0);
+    } else if ((op == "push" || op == "pop") && operands.size() == 1 && is_register(0)) {
+        // Stack operations are always the full register width
+        if (operands[0].size != (long_mode ? 64 : 32)) fail();
+        if (operands[0].reg >= 8) out.push_back(0x41);
+        out.push_back(static_cast<uint8_t>((op == "push" ? 0x50 : 0x58) + (operands[0].reg & 7)));
+    } else if ((op == "push" || op == "pop") && operands.size() == 1 && operands[0].kind == Operand::Memory) {
+        if (operands[0].size != (long_mode ? 64 : 32)) fail();
+        emit(false, {static_cast<uint8_t>(op == "push" ? 0xff : 0x8f)}, op == "push" ? 6 : 0, operands[0], 0, 0);
+    } else if (op == "push" && operands.size() == 1 && is_immediate(0)) {
+        long long value = operands[0].value;
+        out.push_back(fits_byte(value) ? 0x6a : 0x68);
+        append_value(out, value, fits_byte(value) ? 1 : 4);
+    } else if (op == "int" && operands.size() == 1 && is_immediate(0)) {
+        out.push_back(0xcd);
+        out.push_back(static_cast<uint8_t>(operands[0].value));
+    } else {
+        fail();
+    }
+    return result;
+}
+
+void X86Encoder::encode(const std::vector<MachineInstr>& program) {
+    code.clear();
+    relocations.clear();
+    labels.clear();
+    short_jumps = long_jumps = 0;
+
+    std::vector<Encoded> pieces;
+    for (const auto& instr : program) {
+        if (instr.is_label()) {
+            if (labels.count(instr.opcode)) {
+                throw std::runtime_error("Assembly Error: Label " + instr.opcode + " is defined twice.");
+            }
+            labels[instr.opcode] = 0;
+            pieces.push_back(Encoded());
+        } else {
+            pieces.push_back(encode_instruction(instr));
+        }
+    }
+    for (const auto& piece : pieces) {
+        if (!piece.jump_target.empty() && !labels.count(piece.jump_target)) {
+            throw std::runtime_error("Assembly Error: Undefined label " + piece.jump_target + ".");
+        }
+    }
+
+    auto size_of = [](const Encoded& piece) -> size_t {
+        if (piece.jump_target.empty()) return piece.bytes.size();
+        if (!piece.wide) return 2;
+        return piece.condition < 0 ? 5 : 6;
+    };
+    std::vector<size_t> offsets(pieces.size());
+    bool grew = true;
+    while (grew) {
+        size_t offset = 0;
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            offsets[i] = offset;
+            if (program[i].is_label()) labels[program[i].opcode] = offset;
+            offset += size_of(pieces[i]);
+        }
+        grew = false;
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            Encoded& piece = pieces[i];
+            if (piece.jump_target.empty() || piece.wide) continue;
+            long long distance = static_cast<long long>(labels[piece.jump_target]) - (offsets[i] + 2);
+            if (!fits_byte(distance)) {
+                piece.wide = true;
+                grew = true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        const Encoded& piece = pieces[i];
+        if (piece.jump_target.empty()) {
+            for (Relocation relocation : piece.relocations) {
+                relocation.offset += offsets[i];
+                relocations.push_back(relocation);
+            }
+            code.insert(code.end(), piece.bytes.begin(), piece.bytes.end());
+            continue;
+        }
+        long long distance = static_cast<long long>(labels[piece.jump_target]) - (offsets[i] + size_of(piece));
+        if (!piece.wide) {
+            code.push_back(static_cast<uint8_t>(piece.condition < 0 ? 0xeb : 0x70 + piece.condition));
+            append_value(code, distance, 1);
+            short_jumps++;
+        } else {
+            if (piece.condition < 0) {
+                code.push_back(0xe9);
+            } else {
+                code.push_back(0x0f);
+                code.push_back(static_cast<uint8_t>(0x80 + piece.condition));
+            }
+            append_value(code, distance, 4);
+            long_jumps++;
+        }
+    }
+}
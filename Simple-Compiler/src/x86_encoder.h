@@ -0,0 +1,66 @@
+#ifndef X86_ENCODER_H
+#define X86_ENCODER_H
+
+#include "assembly_gen.h"
+#include "machine.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// A field in the code that the linker (or the ELF writer, for an
+// executable) fills with the address of a data symbol
+struct Relocation {
+    enum Kind {
+        Absolute32,   // S + A: [x] and [a + ebx*4] on x86
+        PcRelative32, // S + A - P: [rel x] on x86-64
+        Absolute64    // S + A, 8 bytes: mov r11, a on x86-64
+    };
+    Kind kind;
+    size_t offset;      // Of the field, from the start of the code
+    std::string symbol; // A .data variable or a .bss array
+    long long addend;
+};
+
+// Machine-code encoder for the instructions the backend emits, so the
+// compiler can write an object file without an external assembler.
+//
+// Jumps to labels are resolved here. Every jump starts out in its 2-byte
+// short form; the ones whose target is out of rel8 reach are widened to
+// rel32 and the layout is redone, until no jump grows (jumps only ever
+// grow, so this ends). Operands naming .data variables or .bss arrays
+// become relocations.
+//
+// Only the forms the backend produces are known: 32-bit operations on
+// registers, frame slots, globals, array elements and lea addresses, plus
+// the 64-bit stack pointer and frame pointer arithmetic of the x86-64
+// prologue and the array base loads, and the vectorizer's SSE2 and
+// VEX-encoded AVX2 instructions on xmm and ymm registers. Anything else
+// throws an Assembly Error naming the instruction.
+class X86Encoder {
+public:
+    explicit X86Encoder(TargetArch target);
+    void encode(const std::vector<MachineInstr>& program);
+
+    std::vector<uint8_t> code;
+    std::vector<Relocation> relocations;
+    std::map<std::string, size_t> labels; // Offsets in code
+    int short_jumps;
+    int long_jumps;
+
+private:
+    // One instruction in bytes, with relocation offsets relative to it
+    struct Encoded {
+        std::vector<uint8_t> bytes;
+        std::vector<Relocation> relocations;
+        std::string jump_target; // Empty unless a jump to a label
+        int condition = -1;      // Condition code of a jcc; -1 for jmp
+        bool wide = false;       // rel32 form
+    };
+
+    TargetArch target;
+
+    Encoded encode_instruction(const MachineInstr& instr);
+};
+
+#endif // X86_ENCODER_H